@@ -0,0 +1,81 @@
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "cpu/aot/Recompiler.hpp"
+
+/*
+* Offline recompiler, writes the C++ source
+* of a module that the emulator loads with
+* the aot_module config entry.
+* The entries file lists extra code addresses
+* in hex, one per line, bit 0 set for THUMB
+*/
+int main(int argc, char* argv[]) {
+	if (argc < 3) {
+		std::cout << "Usage: gba_aot <rom> <output.cpp> [entries file]" << std::endl;
+		return 1;
+	}
+
+	std::ifstream rom_file(argv[1], std::ios::binary);
+
+	if (!rom_file.is_open()) {
+		std::cerr << "Could not open " << argv[1] << std::endl;
+		return 1;
+	}
+
+	std::vector<GBA::common::u8> rom{
+		std::istreambuf_iterator<char>(rom_file),
+		std::istreambuf_iterator<char>()
+	};
+
+	GBA::cpu::aot::Recompiler recompiler{ std::move(rom) };
+
+	recompiler.AddEntry(GBA::cpu::aot::Recompiler::ROM_START, false);
+
+	if (argc > 3) {
+		std::ifstream entries(argv[3]);
+
+		if (!entries.is_open()) {
+			std::cerr << "Could not open " << argv[3] << std::endl;
+			return 1;
+		}
+
+		std::string line{};
+
+		while (std::getline(entries, line)) {
+			if (line.empty() || line[0] == '#')
+				continue;
+
+			try {
+				GBA::common::u32 address = std::stoul(line, nullptr, 16);
+				recompiler.AddEntry(address & ~1, address & 1);
+			}
+			catch (std::exception const&) {
+				std::cerr << "Invalid entry " << line << std::endl;
+			}
+		}
+	}
+
+	recompiler.Explore();
+
+	std::ofstream output(argv[2]);
+
+	if (!output.is_open()) {
+		std::cerr << "Could not open " << argv[2] << std::endl;
+		return 1;
+	}
+
+	output << recompiler.Generate(argv[1]);
+
+	std::cout << recompiler.GetBlockCount() << " blocks, "
+		<< recompiler.GetInstructionCount() << " instructions, "
+		<< recompiler.GetTranslatedCount() << " translated" << std::endl;
+
+	std::cout << "Build with: c++ -std=c++20 -O2 -shared -fPIC -I<emulator source> "
+		<< argv[2] << " -o <module>" << std::endl;
+
+	return 0;
+}
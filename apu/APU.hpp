@@ -16,6 +16,10 @@ namespace GBA {
 		class MMIO;
 		class EventScheduler;
 	}
+
+	namespace timers {
+		class TimerChain;
+	}
 }
 
 namespace GBA::apu {
@@ -41,6 +45,7 @@ namespace GBA::apu {
 		APU();
 
 		void SetDma(memory::DMA* _1, memory::DMA* _2);
+		void SetTimers(timers::TimerChain* timers);
 		void SetCallback(SampleCallback callback, u32 required_samples);
 
 		void Clock(u32 num_cycles);
@@ -50,6 +55,12 @@ namespace GBA::apu {
 
 		void TimerOverflow(u8 id);
 
+		//Overflows of this timer are consumed by a FIFO
+		bool IsFifoTimer(u8 id) const {
+			return m_soundcnt_x.master_en && (m_soundcnt_h.fifo_a_timer_sel == id ||
+				m_soundcnt_h.fifo_b_timer_sel == id);
+		}
+
 		void SetFreq(u32 freq);
 
 		void StoreState(std::ostream& out) const;
@@ -106,6 +117,7 @@ namespace GBA::apu {
 	private :
 		memory::DMA* m_dma1;
 		memory::DMA* m_dma2;
+		timers::TimerChain* m_timers;
 
 		SampleCallback m_buffer_callback;
 		u32 m_curr_samples;
@@ -0,0 +1,15 @@
+#pragma once
+
+namespace GBA::common {
+	/*
+	* Instruction set extensions of the host
+	* usable by hand vectorized code, detected
+	* once (always false outside x86-64)
+	*/
+	struct CpuFeatures {
+		bool sse41;
+		bool avx2;
+	};
+
+	CpuFeatures const& GetCpuFeatures();
+}
@@ -25,6 +25,7 @@ namespace GBA::config {
 
 		section.set("skip", "true");
 		section.set("file", "gba_bios.bin");
+		section.set("hle", "false");
 
 		data.set({ { "BIOS", section } });
 
@@ -38,6 +39,9 @@ namespace GBA::config {
 		section.set("rewind_enable", "true");
 		section.set("game_save_path", "./saves");
 		section.set("startup_load_save", "true");
+		section.set("cpu_backend", "interpreter");
+		section.set("color_correction", "false");
+		section.set("render_threads", "0");
 
 		data.set({ { "EMU", section } });
 	}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "../../common/Defs.hpp"
+
+/*
+* Interface between the emulator and the
+* modules generated by the AOT recompiler.
+* Generated code only includes this header
+* and Runtime.hpp, so nothing here may
+* depend on the layout of emulator types
+*/
+namespace GBA::cpu::aot {
+	using namespace common;
+
+	/*
+	* Same signature as the code emitted by the
+	* JIT. cpsr points to the CPSR, whose raw
+	* value has NZCV in bits 31-28
+	*/
+	using BlockFunction = void(*)(void* jit, u32* regs, void* cpsr);
+
+	/*
+	* Callbacks into the emulator, index is the
+	* position of the instruction in the block.
+	* interpret returns true if the block
+	* must be left
+	*/
+	struct Api {
+		bool(*interpret_arm)(void* jit, u32 index);
+		bool(*interpret_thumb)(void* jit, u32 index);
+		void(*exit_arm)(void* jit, u32 index);
+		void(*exit_thumb)(void* jit, u32 index);
+	};
+
+	/*
+	* One precompiled block. It is used only
+	* if the runtime block starting at address
+	* has exactly the same opcodes.
+	* translated[i] tells if instruction i
+	* was compiled (1) or calls the interpreter.
+	* regs is the whole register file, blocks
+	* that access r8-r14 set banked and use the
+	* User/SYS mode slots
+	*/
+	struct Entry {
+		u32 address;
+		u32 thumb;
+		u32 count;
+		u32 banked;
+		u32 const* opcodes;
+		u8 const* translated;
+		BlockFunction function;
+	};
+
+	/*
+	* Bumped whenever Api, Entry or the
+	* semantics of Runtime.hpp change
+	*/
+	static constexpr u32 ABI_VERSION = 2;
+
+	//Exported by every module with C linkage
+	using VersionFunction = u32(*)();
+	using InitFunction = void(*)(Api const* api);
+	using EntriesFunction = Entry const*(*)(u32* count);
+
+	static constexpr char VERSION_SYMBOL[] = "gba_aot_version";
+	static constexpr char INIT_SYMBOL[] = "gba_aot_init";
+	static constexpr char ENTRIES_SYMBOL[] = "gba_aot_entries";
+}
+
+#if defined(WIN32) || defined(__WIN32__) || defined(_WIN32)
+	#define AOT_EXPORT extern "C" __declspec(dllexport)
+#else
+	#define AOT_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Abi.hpp"
+#include "../../shared_obj/SharedObject.hpp"
+
+#include <string_view>
+#include <unordered_map>
+
+namespace GBA::cpu::aot {
+	/*
+	* A module generated by the AOT recompiler,
+	* loaded at runtime. Blocks are looked up
+	* by start address and instruction set
+	*/
+	class Module {
+	public :
+		Module();
+
+		bool Load(std::string_view path, Api const* api);
+
+		Entry const* Find(u32 address, bool thumb) const {
+			auto it = m_entries.find(address | u32(thumb));
+			return it != m_entries.end() ? it->second : nullptr;
+		}
+
+		std::size_t GetEntryCount() const {
+			return m_entries.size();
+		}
+
+	private :
+		shared_object::SharedObject m_object;
+		std::unordered_map<u32, Entry const*> m_entries;
+	};
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "../../common/Defs.hpp"
+
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace GBA::cpu::aot {
+	using namespace common;
+
+	/*
+	* Offline translator, walks the code
+	* reachable from the given entries and
+	* generates the C++ source of a module.
+	* Blocks are split with the same rules
+	* as the BlockCache, so that every
+	* generated block can match a runtime one
+	*/
+	class Recompiler {
+	public :
+		explicit Recompiler(std::vector<u8> rom);
+
+		//Address of an ARM or THUMB block in ROM
+		void AddEntry(u32 address, bool thumb);
+
+		/*
+		* Follow direct branches, calls, returns
+		* and literal pool values used as code
+		* pointers, until no new block is found
+		*/
+		void Explore();
+
+		std::string Generate(std::string_view rom_name) const;
+
+		std::size_t GetBlockCount() const {
+			return m_blocks.size();
+		}
+
+		std::size_t GetInstructionCount() const;
+		std::size_t GetTranslatedCount() const;
+
+		static constexpr u32 ROM_START = 0x08000000;
+
+	private :
+		struct Block {
+			u32 address;
+			bool thumb;
+			bool banked;
+			std::vector<u32> opcodes;
+			std::vector<u8> translated;
+		};
+
+		template <bool Thumb>
+		void Walk(u32 address);
+
+		bool Read(u32 address, u32 size, u32& value) const;
+		bool IsCode(u32 address, bool thumb) const;
+
+		static u32 GetKey(u32 address, bool thumb) {
+			return address | u32(thumb);
+		}
+
+		std::vector<u8> m_rom;
+
+		std::map<u32, Block> m_blocks;
+		std::vector<u32> m_pending;
+		std::set<u32> m_seen;
+	};
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "Abi.hpp"
+
+/*
+* Helpers used by the code generated by the
+* AOT recompiler. Results and flags are the
+* same as the interpreter ones, flags live
+* in the raw CPSR value
+*/
+namespace GBA::cpu::aot {
+	static constexpr u32 N_FLAG = 1u << 31;
+	static constexpr u32 Z_FLAG = 1u << 30;
+	static constexpr u32 C_FLAG = 1u << 29;
+	static constexpr u32 V_FLAG = 1u << 28;
+
+	inline u32 GetCarry(u32 cpsr) {
+		return (cpsr >> 29) & 1;
+	}
+
+	inline void SetNZ(u32& cpsr, u32 result) {
+		cpsr &= ~(N_FLAG | Z_FLAG);
+		cpsr |= result & N_FLAG;
+
+		if (!result)
+			cpsr |= Z_FLAG;
+	}
+
+	inline void SetC(u32& cpsr, u32 carry) {
+		cpsr = (cpsr & ~C_FLAG) | (carry << 29);
+	}
+
+	inline void SetV(u32& cpsr, u32 overflow) {
+		cpsr = (cpsr & ~V_FLAG) | (overflow << 28);
+	}
+
+	//first + second + carry
+	inline u32 Add(u32& cpsr, u32 first, u32 second, u32 carry, bool flags) {
+		uint64_t wide = uint64_t(first) + second + carry;
+		u32 result = u32(wide);
+
+		if (flags) {
+			SetNZ(cpsr, result);
+			SetC(cpsr, u32(wide >> 32));
+			SetV(cpsr, (~(first ^ second) & (second ^ result)) >> 31);
+		}
+
+		return result;
+	}
+
+	//first - second - !carry
+	inline u32 Sub(u32& cpsr, u32 first, u32 second, u32 carry, bool flags) {
+		u32 borrow = carry ^ 1;
+		u32 result = first - second - borrow;
+
+		if (flags) {
+			SetNZ(cpsr, result);
+			SetC(cpsr, uint64_t(first) >= uint64_t(second) + borrow);
+			SetV(cpsr, ((first ^ second) & (first ^ result)) >> 31);
+		}
+
+		return result;
+	}
+
+	/*
+	* Shift by immediate, type is the ARM
+	* encoding. Amount 0 is LSL #0, LSR #32
+	* and ASR #32, RRX is never generated.
+	* carry is left untouched by LSL #0
+	*/
+	inline u32 ShiftImm(u32 value, u32 type, u32 amount, u32& carry) {
+		switch (type)
+		{
+		case 0:
+			if (!amount)
+				return value;
+
+			carry = (value >> (32 - amount)) & 1;
+			return value << amount;
+
+		case 1:
+			if (!amount) {
+				carry = value >> 31;
+				return 0;
+			}
+
+			carry = (value >> (amount - 1)) & 1;
+			return value >> amount;
+
+		case 2:
+			if (!amount) {
+				carry = value >> 31;
+				return u32(i32(value) >> 31);
+			}
+
+			carry = (value >> (amount - 1)) & 1;
+			return u32(i32(value) >> amount);
+
+		default:
+			value = (value >> amount) | (value << (32 - amount));
+			carry = value >> 31;
+			return value;
+		}
+	}
+
+	inline bool CheckCondition(u32 cpsr, u32 cond) {
+		bool n = cpsr & N_FLAG;
+		bool z = cpsr & Z_FLAG;
+		bool c = cpsr & C_FLAG;
+		bool v = cpsr & V_FLAG;
+
+		switch (cond)
+		{
+		case 0x0: return z;
+		case 0x1: return !z;
+		case 0x2: return c;
+		case 0x3: return !c;
+		case 0x4: return n;
+		case 0x5: return !n;
+		case 0x6: return v;
+		case 0x7: return !v;
+		case 0x8: return c && !z;
+		case 0x9: return !c || z;
+		case 0xA: return n == v;
+		case 0xB: return n != v;
+		case 0xC: return !z && n == v;
+		case 0xD: return z || n != v;
+		case 0xE: return true;
+		default: return false;
+		}
+	}
+}
@@ -1,20 +1,61 @@
 #pragma once
 
 #include "CPUContext.hpp"
+#include "BlockCache.hpp"
+
+#include <array>
+#include <memory>
+#include <string_view>
+#include <vector>
 
 namespace GBA::memory {
 	class InterruptController;
+	class EventScheduler;
+}
+
+namespace GBA::cpu::jit {
+	class Jit;
+}
+
+namespace GBA::cpu::aot {
+	class Module;
 }
 
 namespace GBA::cpu {
+	/*
+	* How instructions are executed,
+	* JIT_LOCKSTEP runs every translated
+	* block through the interpreter too
+	* and checks that the results match.
+	* AOT only leaves the interpreter for
+	* blocks of the precompiled module
+	*/
+	enum class ExecutionMode {
+		INTERPRETER,
+		JIT,
+		JIT_LOCKSTEP,
+		AOT
+	};
+
 	class ARM7TDI {
 	public :
 		ARM7TDI();
+		~ARM7TDI();
 
 		void AttachBus(memory::Bus* bus);
 
 		void SkipBios();
 
+		/*
+		* Execute until the scheduler reaches
+		* deadline, a DMA becomes active or
+		* the CPU halts. Always stops between
+		* two instructions
+		*/
+		void Run(uint64_t deadline);
+
+		//One instruction or halted cycle,
+		//nothing while a DMA is active
 		u8 Step();
 		
 		static u32 GetExceptVector(ExceptionCode const& exc);
@@ -26,15 +67,60 @@ namespace GBA::cpu {
 
 		void SetInterruptControl(memory::InterruptController* int_controller);
 
+		void SetEventScheduler(memory::EventScheduler* sched) {
+			m_sched = sched;
+		}
+
 		inline void SetHalted() {
 			m_halt = true;
 		}
 
+		/*
+		* Drop every decoded block, must be
+		* called when code memory changes
+		* outside of Bus::Write
+		*/
+		void FlushBlockCache() {
+			m_block_cache.Flush();
+		}
+
+		/*
+		* The bus must already be attached.
+		* Falls back to the interpreter when
+		* the JIT is not available on the host
+		*/
+		void SetExecutionMode(ExecutionMode mode);
+
+		ExecutionMode GetExecutionMode() const {
+			return m_exec_mode;
+		}
+
+		//nullptr when running on the interpreter
+		jit::Jit const* GetJit() const {
+			return m_jit.get();
+		}
+
+		/*
+		* Load a module generated by gba_aot,
+		* its blocks are used in every mode
+		* except INTERPRETER
+		*/
+		bool LoadPrecompiled(std::string_view path);
+
+		/*
+		* Addresses of loops known to only wait
+		* for an event (from the ROM database),
+		* branching to one skips to the next event
+		*/
+		void SetIdleLoops(std::vector<u32> addresses) {
+			m_idle_loops = std::move(addresses);
+		}
+
 		template <typename Ar>
 		void save(Ar& ar) const {
 			ar(m_halt);
 			ar(m_ctx.m_regs);
-			ar(m_ctx.m_cpsr);
+			ar(m_ctx.GetResolvedCPSR());
 			ar(m_ctx.m_spsr);
 			ar(m_ctx.m_pipeline);
 			ar(m_ctx.m_old_pc);
@@ -48,15 +134,63 @@ namespace GBA::cpu {
 			ar(m_ctx.m_spsr);
 			ar(m_ctx.m_pipeline);
 			ar(m_ctx.m_old_pc);
+
+			m_ctx.m_flags.op = FlagOp::NONE;
+			m_block_cache.Flush();
 		}
 
 	private :
+		friend class jit::Jit;
+
 		bool CheckIRQ();
+		bool InterruptPending();
+
+		template <InstructionMode InstrSet>
+		void Execute(bool& branch);
+
+		/*
+		* Inner loop for one instruction set,
+		* returns on a state switch, a pending
+		* IRQ or any of the Run exit conditions
+		*/
+		template <InstructionMode InstrSet>
+		void RunLoop(uint64_t deadline);
+
+		void AdvancePC(bool branch);
+
+		/*
+		* Called after every taken branch. When
+		* two consecutive iterations of a loop
+		* without side effects start in the same
+		* state, skip the iterations that would
+		* end before deadline
+		*/
+		void CheckIdleLoop(uint64_t deadline);
+
+		struct IdleLoop {
+			u32 address;
+			u32 cpsr;
+			u32 timer_reads;
+			std::array<u32, 15> regs;
+			uint64_t timestamp;
+		};
+
+		static constexpr u32 NO_IDLE_LOOP = 0xFFFFFFFF;
 
 	private :
 		CPUContext m_ctx;
 		memory::Bus* m_bus;
 		memory::InterruptController* m_int_controller;
+		memory::EventScheduler* m_sched;
 		bool m_halt;
+
+		BlockCache m_block_cache;
+
+		ExecutionMode m_exec_mode;
+		std::unique_ptr<jit::Jit> m_jit;
+		std::unique_ptr<aot::Module> m_aot_module;
+
+		IdleLoop m_idle;
+		std::vector<u32> m_idle_loops;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,407 @@
+#pragma once
+
+#include "../../common/Defs.hpp"
+#include "../arm/Instruction.hpp"
+#include "../thumb/Instruction.hpp"
+
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+namespace GBA::memory {
+	class Bus;
+}
+
+namespace GBA::cpu {
+	using namespace common;
+
+	struct CPUContext;
+
+	using ArmHandler = void(*)(arm::ARMInstruction, CPUContext&, memory::Bus*, bool&);
+	using ThumbHandler = void(*)(thumb::THUMBInstruction, memory::Bus*, CPUContext&, bool&);
+
+	/*
+	* One pre-decoded instruction.
+	* fetch_opcode and fetch_cycles describe
+	* the pipeline fetch that follows the
+	* execution of this instruction (the
+	* instruction two slots ahead), cycles
+	* are indexed by memory::Access
+	*/
+	struct CachedInstruction {
+		union {
+			ArmHandler arm;
+			ThumbHandler thumb;
+		} handler;
+
+		u32 opcode;
+		u32 fetch_opcode;
+		u8 condition;
+		u8 fetch_cycles[2];
+	};
+
+	/*
+	* Straight line run of instructions
+	* starting at start. A block without
+	* instructions marks an address that
+	* cannot be cached.
+	* exec_count and translation belong
+	* to the JIT, translation is only
+	* valid while generation matches
+	* the one of the JIT.
+	* idle_end is the position after a branch
+	* back to start preceded only by instructions
+	* that change registers and flags, 0 if the
+	* block does not start such a loop
+	*/
+	struct CachedBlock {
+		u32 start;
+		u32 end;
+		bool thumb;
+		std::vector<CachedInstruction> instructions;
+		u32 idle_end;
+
+		u32 exec_count;
+		u32 generation;
+		void* translation;
+	};
+
+	/*
+	* Translation of an erased block, the
+	* generation tells if it still belongs
+	* to the JIT
+	*/
+	struct RetiredTranslation {
+		void* translation;
+		u32 generation;
+	};
+
+	/*
+	* Cache of decoded basic blocks, keyed
+	* by PC and instruction set.
+	* Only code running from EWRAM, IWRAM
+	* and plain ROM is cached, RAM writes
+	* invalidate the blocks in the written
+	* page
+	*/
+	class BlockCache {
+	public :
+		BlockCache();
+
+		void AttachBus(memory::Bus* bus) {
+			m_bus = bus;
+		}
+
+		/*
+		* Get the cached instruction at pc.
+		* decoded is the opcode currently
+		* in the pipeline, the cached entry
+		* is used only when it matches.
+		* Returns nullptr when the slow path
+		* must be used
+		*/
+		template <bool Thumb>
+		CachedInstruction const* Next(u32 pc, u32 decoded) {
+			if (m_curr_block != nullptr && pc == m_next_pc
+				&& m_curr_block->thumb == Thumb) [[likely]] {
+				auto const& instructions = m_curr_block->instructions;
+
+				if (m_curr_index < instructions.size() &&
+					instructions[m_curr_index].opcode == decoded) {
+					m_next_pc += Thumb ? 2 : 4;
+					return &instructions[m_curr_index++];
+				}
+			}
+
+			return Enter(pc, decoded, Thumb);
+		}
+
+		/*
+		* False if the block that contains
+		* the last returned instruction has
+		* been invalidated in the meantime
+		*/
+		bool IsCurrentValid() const {
+			return m_curr_block != nullptr;
+		}
+
+		CachedBlock* GetCurrentBlock() const {
+			return m_curr_block;
+		}
+
+		//Index of the next instruction of the current block
+		u32 GetPosition() const {
+			return m_curr_index;
+		}
+
+		/*
+		* Move the cursor inside the current
+		* block, index is the position of the
+		* next instruction
+		*/
+		void SetPosition(u32 index) {
+			if (m_curr_block == nullptr)
+				return;
+
+			m_curr_index = index;
+			m_next_pc = m_curr_block->start +
+				index * (m_curr_block->thumb ? 2 : 4);
+		}
+
+		/*
+		* Must be called on every write to
+		* EWRAM/IWRAM, address is relative
+		* to the start of the region and
+		* aligned to the size of the access
+		*/
+		template <bool Iwram>
+		void InvalidateWrite(u32 address, u32 len) {
+			u32 page = GetPageIndex<Iwram>(address);
+
+			if (!m_pages[page].empty()) [[unlikely]]
+				InvalidatePage(page, GetOffset<Iwram>(address), len);
+		}
+
+		template <bool Iwram>
+		void InvalidateRange(u32 address, u32 len) {
+			if (!len)
+				return;
+
+			u32 first = GetPageIndex<Iwram>(address);
+			u32 last = GetPageIndex<Iwram>(address + len - 1);
+
+			for (u32 page = first; page <= last; page++) {
+				if (!m_pages[page].empty())
+					InvalidatePage(page, GetOffset<Iwram>(address), len);
+			}
+		}
+
+		void Flush();
+
+		/*
+		* Translations of the blocks erased since
+		* the last call, they may still be running
+		* so the JIT frees them between two blocks
+		*/
+		std::vector<RetiredTranslation>& GetRetired() {
+			return m_retired;
+		}
+
+		/*
+		* True if the instruction never falls
+		* through to the next one. Ending a block
+		* early is always safe, this only avoids
+		* decoding data that follows branches
+		*/
+		static bool EndsArmBlock(u32 opcode) {
+			if ((opcode >> 28) != 0xE)
+				return false;
+
+			if ((opcode & 0x0E000000) == 0x0A000000) //B, BL
+				return true;
+
+			if ((opcode & 0x0FFFFFF0) == 0x012FFF10) //BX
+				return true;
+
+			if ((opcode & 0x0F000000) == 0x0F000000) //SWI
+				return true;
+
+			if ((opcode & 0x0E108000) == 0x08108000) //LDM with PC in the list
+				return true;
+
+			if ((opcode & 0x0C00F000) == 0x0000F000) //ALU with PC as destination
+				return true;
+
+			if ((opcode & 0x0C10F000) == 0x0410F000) //LDR PC
+				return true;
+
+			return false;
+		}
+
+		static bool EndsThumbBlock(u16 opcode) {
+			if ((opcode & 0xF800) == 0xE000) //B
+				return true;
+
+			if ((opcode & 0xFF00) == 0x4700) //BX
+				return true;
+
+			if ((opcode & 0xFF00) == 0xDF00) //SWI
+				return true;
+
+			if ((opcode & 0xF800) == 0xF800) //BL, second half
+				return true;
+
+			if ((opcode & 0xFF00) == 0xBD00) //POP with PC
+				return true;
+
+			if ((opcode & 0xFC87) == 0x4487) //Hi register op with PC as destination
+				return true;
+
+			return false;
+		}
+
+		/*
+		* True if the instruction can only change
+		* registers (but not PC) and flags, so it
+		* may be part of an idle loop
+		*/
+		static bool IsIdleSafeArm(u32 opcode) {
+			u32 rd = (opcode >> 12) & 0xF;
+
+			if ((opcode >> 28) == 0xF)
+				return false;
+
+			switch ((opcode >> 25) & 0x7)
+			{
+			case 0x0:
+				if ((opcode & 0x0FC000F0) == 0x00000090) //MUL, MLA
+					return ((opcode >> 16) & 0xF) != 15;
+
+				if ((opcode & 0x0F8000F0) == 0x00800090) //Long multiply
+					return true;
+
+				if ((opcode & 0x0FB00FF0) == 0x01000090) //SWP
+					return false;
+
+				if ((opcode & 0x90) == 0x90) //Halfword and signed loads
+					return ((opcode >> 20) & 1) && rd != 15;
+
+				if ((opcode & 0x0FBF0FFF) == 0x010F0000) //MRS
+					return true;
+
+				if ((opcode & 0x01900000) == 0x01000000) //MSR, BX
+					return false;
+
+				return rd != 15;
+
+			case 0x1:
+				if ((opcode & 0x01900000) == 0x01000000) //MSR
+					return false;
+
+				return rd != 15;
+
+			case 0x2:
+			case 0x3:
+				//LDR, LDRB
+				if ((opcode >> 25) & (opcode >> 4) & 1)
+					return false;
+
+				return ((opcode >> 20) & 1) && rd != 15;
+
+			case 0x4:
+				//LDM without PC and user bank
+				return (opcode & 0x00508000) == 0x00100000;
+
+			default:
+				return false;
+			}
+		}
+
+		static bool IsIdleSafeThumb(u16 opcode) {
+			if (opcode < 0x4400) //Formats 1-4
+				return true;
+
+			if (opcode < 0x4800) //Format 5, no BX or PC writes
+				return ((opcode >> 8) & 0x3) != 0x3 && (opcode & 0x87) != 0x87;
+
+			if (opcode < 0x5000) //LDR PC relative
+				return true;
+
+			if (opcode < 0x6000) //Register offset, stores are 0x5000-0x55FF
+				return opcode >= 0x5600;
+
+			if (opcode < 0xA000) //Immediate offset, SP relative
+				return (opcode >> 11) & 1;
+
+			if (opcode < 0xB100) //ADD PC/SP, ADD SP
+				return true;
+
+			if ((opcode & 0xFF00) == 0xBC00) //POP without PC
+				return true;
+
+			if ((opcode & 0xF800) == 0xC800) //LDMIA
+				return true;
+
+			return false;
+		}
+
+		/*
+		* Target of a branch without link at
+		* pc, returns false for other opcodes
+		*/
+		static bool GetArmBranchTarget(u32 opcode, u32 pc, u32& target) {
+			if ((opcode >> 28) == 0xF || (opcode & 0x0F000000) != 0x0A000000)
+				return false;
+
+			target = pc + 8 + (u32(i32(opcode << 8) >> 8) << 2);
+			return true;
+		}
+
+		static bool GetThumbBranchTarget(u16 opcode, u32 pc, u32& target) {
+			if ((opcode & 0xF000) == 0xD000 && (opcode & 0x0F00) < 0x0E00) {
+				target = pc + 4 + (u32(i32(i8(opcode & 0xFF))) << 1);
+				return true;
+			}
+
+			if ((opcode & 0xF800) == 0xE000) {
+				target = pc + 4 + (u32(i32(u32(opcode) << 21) >> 21) << 1);
+				return true;
+			}
+
+			return false;
+		}
+
+		static constexpr u32 MAX_BLOCK_SIZE = 64;
+		static constexpr u32 PAGE_SHIFT = 8;
+
+	private :
+		/*
+		* EWRAM and IWRAM share one address
+		* space, IWRAM comes after EWRAM
+		*/
+		template <bool Iwram>
+		static u32 GetOffset(u32 address) {
+			if constexpr (Iwram)
+				return EWRAM_SIZE + (address & (IWRAM_SIZE - 1));
+			else
+				return address & (EWRAM_SIZE - 1);
+		}
+
+		template <bool Iwram>
+		static u32 GetPageIndex(u32 address) {
+			return GetOffset<Iwram>(address) >> PAGE_SHIFT;
+		}
+
+		static u32 GetLookupIndex(u32 key) {
+			return (key ^ (key >> 16)) & (LOOKUP_SIZE - 1);
+		}
+
+		CachedInstruction const* Enter(u32 pc, u32 decoded, bool thumb);
+		CachedBlock* Build(u32 pc, bool thumb);
+
+		void InvalidatePage(u32 page, u32 offset, u32 len);
+		void Erase(u32 key);
+
+		static constexpr u32 EWRAM_SIZE = 0x40000;
+		static constexpr u32 IWRAM_SIZE = 0x8000;
+		static constexpr u32 LOOKUP_SIZE = 0x2000;
+
+		memory::Bus* m_bus;
+
+		std::unordered_map<u32, CachedBlock> m_blocks;
+
+		//Direct mapped table in front of m_blocks
+		std::array<CachedBlock*, LOOKUP_SIZE> m_lookup;
+
+		//Keys of the blocks that overlap
+		//each EWRAM/IWRAM page
+		std::array<std::vector<u32>,
+			((EWRAM_SIZE + IWRAM_SIZE) >> PAGE_SHIFT)> m_pages;
+
+		std::vector<RetiredTranslation> m_retired;
+
+		CachedBlock* m_curr_block;
+		u32 m_curr_index;
+		u32 m_next_pc;
+	};
+}
@@ -5,6 +5,27 @@
 #include "./Pipeline.hpp"
 
 namespace GBA::cpu {
+	/*
+	* Last flag setting ALU operation.
+	* LOGIC only sets N and Z, ADD and
+	* SUB set all of NZCV. carry is the
+	* carry in (ADC) or the borrow (SBC)
+	*/
+	enum class FlagOp : u8 {
+		NONE,
+		LOGIC,
+		ADD,
+		SUB
+	};
+
+	struct LazyFlags {
+		u32 first;
+		u32 second;
+		u32 result;
+		u32 carry;
+		FlagOp op;
+	};
+
 	struct CPUContext {
 		RegisterManager m_regs;
 		CPSR m_cpsr;
@@ -12,8 +33,100 @@ namespace GBA::cpu {
 		Pipeline m_pipeline;
 		u32 m_old_pc;
 
+		/*
+		* Flags are computed only when read,
+		* while m_flags.op != NONE the flags
+		* of m_cpsr that it sets are stale.
+		* Anything reading m_cpsr as a whole
+		* must call ResolveFlags first
+		*/
+		LazyFlags m_flags{};
+
 		void EnterException(ExceptionCode exc, u8 pc_offset);
 		void RestorePreviousMode(u32 old_pc);
 		void ChangeMode(Mode new_mode);
+
+		void SetLogicFlags(u32 result) {
+			//C and V of a previous arithmetic
+			//operation are still needed
+			if (m_flags.op > FlagOp::LOGIC)
+				ResolveFlags();
+
+			m_flags.result = result;
+			m_flags.op = FlagOp::LOGIC;
+		}
+
+		void SetAddFlags(u32 first, u32 second, u32 carry, u32 result) {
+			m_flags = { first, second, result, carry, FlagOp::ADD };
+		}
+
+		void SetSubFlags(u32 first, u32 second, u32 borrow, u32 result) {
+			m_flags = { first, second, result, borrow, FlagOp::SUB };
+		}
+
+		bool GetCarry() {
+			if (m_flags.op > FlagOp::LOGIC)
+				ResolveFlags();
+
+			return m_cpsr.carry;
+		}
+
+		bool CheckCondition(u8 cond) {
+			if (cond == 0xE)
+				return true;
+
+			//EQ, NE, MI and PL only need the result
+			if (m_flags.op != FlagOp::NONE) {
+				switch (cond)
+				{
+				case 0x0: return !m_flags.result;
+				case 0x1: return m_flags.result;
+				case 0x4: return m_flags.result >> 31;
+				case 0x5: return !(m_flags.result >> 31);
+				default: break;
+				}
+			}
+
+			ResolveFlags();
+			return m_cpsr.CheckCondition(cond);
+		}
+
+		void ResolveFlags() {
+			ApplyFlags(m_cpsr);
+			m_flags.op = FlagOp::NONE;
+		}
+
+		CPSR GetResolvedCPSR() const {
+			CPSR cpsr = m_cpsr;
+			ApplyFlags(cpsr);
+			return cpsr;
+		}
+
+	private :
+		void ApplyFlags(CPSR& cpsr) const {
+			switch (m_flags.op)
+			{
+			case FlagOp::NONE:
+				return;
+
+			case FlagOp::ADD:
+				cpsr.carry = ((uint64_t)m_flags.first + m_flags.second + m_flags.carry) >> 32;
+				cpsr.overflow = (~(m_flags.first ^ m_flags.second) &
+					(m_flags.second ^ m_flags.result)) >> 31;
+				break;
+
+			case FlagOp::SUB:
+				cpsr.carry = (uint64_t)m_flags.first >= (uint64_t)m_flags.second + m_flags.carry;
+				cpsr.overflow = ((m_flags.first ^ m_flags.second) &
+					(m_flags.first ^ m_flags.result)) >> 31;
+				break;
+
+			default:
+				break;
+			}
+
+			cpsr.zero = !m_flags.result;
+			cpsr.sign = m_flags.result >> 31;
+		}
 	};
-}
\ No newline at end of file
+}
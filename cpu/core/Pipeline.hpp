@@ -4,6 +4,8 @@
 #include "./Register.hpp"
 #include "../../memory/Bus.hpp"
 
+#include <type_traits>
+
 
 namespace GBA::cpu {
 	using namespace common;
@@ -34,18 +36,66 @@ namespace GBA::cpu {
 			Fetch<InstrSet>();
 		}
 
+		/*
+		* Fetches inside the window of the current
+		* code page read the host memory directly,
+		* anything else goes through the bus
+		*/
 		template <InstructionMode InstrSet>
 		void Fetch() {
+			using Type = std::conditional_t<InstrSet == InstructionMode::ARM, u32, u16>;
+
 			m_decoded = m_fetched;
 
-			if constexpr (InstrSet == InstructionMode::ARM) {
-				m_fetched = m_bus->Read<u32>(m_fetch_pc, true);
-				m_fetch_pc += 4;
+			memory::CodeWindow& window = m_windows[(u8)InstrSet];
+			u32 address = m_fetch_pc & ~(u32)(sizeof(Type) - 1);
+			u32 offset = address - window.start;
+
+			if (offset >= window.length || 
+				window.generation != m_bus->GetCodeGeneration()) [[unlikely]] {
+				if (!m_bus->GetCodeWindow(address, sizeof(Type), window)) {
+					m_fetched = m_bus->Read<Type>(m_fetch_pc, true);
+					m_fetch_pc += sizeof(Type);
+					return;
+				}
+
+				offset = address - window.start;
 			}
-			else {
-				m_fetched = m_bus->Read<u16>(m_fetch_pc, true);
+
+			m_fetched = *reinterpret_cast<Type const*>(window.host + offset);
+
+			m_bus->CachedFetch(m_fetch_pc, m_fetched,
+				window.cycles[(u8)m_bus->m_time.access]);
+
+			m_fetch_pc += sizeof(Type);
+		}
+
+		/*
+		* Same as Fetch, the opcode
+		* and the cost of the access
+		* come from the block cache
+		*/
+		template <InstructionMode InstrSet>
+		void FetchCached(u32 opcode, u32 cycles) {
+			m_decoded = m_fetched;
+			m_fetched = opcode;
+
+			m_bus->CachedFetch(m_fetch_pc, opcode, cycles);
+
+			if constexpr (InstrSet == InstructionMode::ARM)
+				m_fetch_pc += 4;
+			else
 				m_fetch_pc += 2;
-			}
+		}
+
+		/*
+		* Overwrite the pipeline state, used
+		* when leaving translated code
+		*/
+		void SetState(u32 fetch_pc, u32 fetched, u32 decoded) {
+			m_fetch_pc = fetch_pc;
+			m_fetched = fetched;
+			m_decoded = decoded;
 		}
 
 		template <InstructionMode InstrSet>
@@ -78,5 +128,9 @@ namespace GBA::cpu {
 		u32 m_decoded;
 
 		memory::Bus* m_bus;
+
+		//One per instruction set, the
+		//cost depends on the fetch size
+		memory::CodeWindow m_windows[2];
 	};
 }
\ No newline at end of file
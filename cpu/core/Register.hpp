@@ -7,80 +7,42 @@
 namespace GBA::cpu {
 	using namespace common;
 
-	union Bank {
-		struct {
-			u32 r0;
-			u32 r1;
-			u32 r2;
-			u32 r3;
-			u32 r4;
-			u32 r5;
-			u32 r6;
-			u32 r7;
-			u32 r8;
-			u32 r9;
-			u32 r10;
-			u32 r11;
-			u32 r12;
-			u32 r13;
-			u32 r14;
-			u32 r15;
-		};
-
-		u32 array[16];
-	};
-
 	class RegisterManager {
 	public :
 		RegisterManager();
 
 		u32 GetReg(u8 id) const {
-			return m_curr_regs.array[id];
+			return m_file[m_map[id]];
 		}
 
 		void SetReg(u8 id, u32 value) {
-			m_curr_regs.array[id] = value;
+			m_file[m_map[id]] = value;
 		}
 
-		u32 GetReg(Mode mode, u8 id) const {
-			u8 mode_id = GetModeFromID(mode);
-
-			if (id < 8 || id == 15 || mode_id == m_curr_mode)
-				return m_curr_regs.array[id];
-
-			if(id - 8 >= BANK_START[mode_id])
-				return m_banked_regs[mode_id][id - 8];
+		/*
+		* Every physical register, translated
+		* code accesses them directly through
+		* the index table of its mode
+		*/
+		u32* GetRegisterFile() {
+			return m_file;
+		}
 
-			if (m_curr_mode != GetModeFromID(Mode::FIQ))
-				return m_curr_regs.array[id];
+		u8 GetCurrentModeId() const {
+			return m_curr_mode;
+		}
 
-			return m_commonly_shared[id - 8];
+		u32 GetReg(Mode mode, u8 id) const {
+			return m_file[REG_INDEX[GetModeFromID(mode)][id]];
 		}
 
 		void SetReg(Mode mode, u8 id, u32 value) {
-			u8 mode_id = GetModeFromID(mode);
-
-			if (id < 8 || id == 15 || mode_id == m_curr_mode) {
-				m_curr_regs.array[id] = value; 
-				return;
-			}
-
-			if (id - 8 >= BANK_START[mode_id]) {
-				m_banked_regs[mode_id][id - 8] = value;
-				return;
-			}
-
-			if (m_curr_mode != GetModeFromID(Mode::FIQ)) {
-				m_curr_regs.array[id] = value;
-				return;
-			}
-
-			m_commonly_shared[id - 8] = value;
+			m_file[REG_INDEX[GetModeFromID(mode)][id]] = value;
 		}
 
 		void AddOffset(u8 id, i32 value) {
-			m_curr_regs.array[id] =
-				static_cast<i32>(m_curr_regs.array[id]) + value;
+			u32& reg = m_file[m_map[id]];
+			reg = static_cast<i32>(reg) + value;
 		}
 
 		void AddOffset(Mode mode, u8 id, i32 value) {
@@ -92,33 +54,90 @@ namespace GBA::cpu {
 			SetReg(mode, id, base_value);
 		}
 
-		void SwitchMode(Mode new_mode);
+		void SwitchMode(Mode new_mode) {
+			m_curr_mode = GetModeFromID(new_mode);
+			m_map = REG_INDEX[m_curr_mode];
+		}
 
 		static constexpr inline u8 BANK_START[] = {
 			5, 0, 5, 5, 5, 5
 		};
 
+		/*
+		* Physical register of r0-r15 for
+		* each mode. 0-15 are the User/SYS
+		* registers, followed by FIQ r8-r14
+		* and r13-r14 of IRQ, SWI, ABRT, UND
+		*/
+		static constexpr u8 REG_COUNT = 31;
+
+		static constexpr inline u8 REG_INDEX[6][16] = {
+			{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+			{ 0, 1, 2, 3, 4, 5, 6, 7, 16, 17, 18, 19, 20, 21, 22, 15 },
+			{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 23, 24, 15 },
+			{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 25, 26, 15 },
+			{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 27, 28, 15 },
+			{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 29, 30, 15 }
+		};
+
+		/*
+		* Savestates keep the layout of the
+		* copying implementation: the view of
+		* the current mode, User r8-r12 while
+		* in FIQ mode and the banked registers
+		*/
 		template <typename Ar>
 		void save(Ar& ar) const {
+			u32 curr_regs[16]{};
+			u32 commonly_shared[5]{};
+			u32 banked_regs[6][7]{};
+
+			for (u8 id = 0; id < 16; id++)
+				curr_regs[id] = GetReg(id);
+
+			for (u8 id = 0; id < 5; id++)
+				commonly_shared[id] = m_file[8 + id];
+
+			for (u8 mode = 0; mode < 6; mode++) {
+				for (u8 id = 0; id < 7; id++)
+					banked_regs[mode][id] = m_file[REG_INDEX[mode][8 + id]];
+			}
+
 			ar(m_curr_mode);
-			ar(m_curr_regs.array);
-			ar(m_commonly_shared);
-			ar(m_banked_regs);
+			ar(curr_regs);
+			ar(commonly_shared);
+			ar(banked_regs);
 		}
 
 		template <typename Ar>
 		void load(Ar& ar) {
+			u32 curr_regs[16]{};
+			u32 commonly_shared[5]{};
+			u32 banked_regs[6][7]{};
+
 			ar(m_curr_mode);
-			ar(m_curr_regs.array);
-			ar(m_commonly_shared);
-			ar(m_banked_regs);
+			ar(curr_regs);
+			ar(commonly_shared);
+			ar(banked_regs);
+
+			m_map = REG_INDEX[m_curr_mode];
+
+			for (u8 mode = 0; mode < 6; mode++) {
+				for (u8 id = BANK_START[mode]; id < 7; id++)
+					m_file[REG_INDEX[mode][8 + id]] = banked_regs[mode][id];
+			}
+
+			for (u8 id = 0; id < 5; id++)
+				m_file[8 + id] = commonly_shared[id];
+
+			for (u8 id = 0; id < 16; id++)
+				SetReg(id, curr_regs[id]);
 		}
 
 	private :
 		u8 m_curr_mode;
-		Bank m_curr_regs;
-		u32 m_commonly_shared[5];
-		u32 m_banked_regs[6][7];
+		u8 const* m_map;
+		u32 m_file[REG_COUNT];
 	};
 }
 
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "../../common/Defs.hpp"
+
+namespace GBA::memory {
+	class Bus;
+}
+
+namespace GBA::cpu {
+	struct CPUContext;
+}
+
+namespace GBA::cpu::hle {
+	using namespace common;
+
+	static constexpr u32 BIOS_SIZE = 16 * 1024;
+
+	/*
+	* Fill the BIOS region with a minimal image,
+	* used when no BIOS file is available. It only
+	* holds the exception vectors and the IRQ
+	* dispatcher of the original BIOS, SWIs are
+	* run natively and never reach it
+	*/
+	void LoadBiosImage(u8* bios);
+
+	/*
+	* Run the BIOS function number natively.
+	* Returns false if it is not implemented,
+	* the caller then takes the exception.
+	* Cycles spent in the BIOS code are charged
+	* as internal cycles, memory accesses go
+	* through the bus with their usual cost
+	*/
+	bool SoftwareInterrupt(u8 number, CPUContext& ctx, memory::Bus* bus, bool& branch);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "../../common/Defs.hpp"
+
+#include <cstddef>
+
+namespace GBA::cpu::jit {
+	using namespace common;
+
+	/*
+	* Fixed size executable memory
+	* region, code is appended until
+	* the buffer is full and then
+	* the whole buffer is dropped
+	*/
+	class CodeBuffer {
+	public :
+		explicit CodeBuffer(std::size_t size);
+		~CodeBuffer();
+
+		CodeBuffer(CodeBuffer const&) = delete;
+		CodeBuffer& operator=(CodeBuffer const&) = delete;
+
+		bool IsValid() const {
+			return m_base != nullptr;
+		}
+
+		/*
+		* Copy the code into the buffer,
+		* nullptr when there is no space
+		* left
+		*/
+		void const* Commit(u8 const* code, std::size_t size);
+
+		void Reset() {
+			m_used = 0;
+		}
+
+	private :
+		u8* m_base;
+		std::size_t m_size;
+		std::size_t m_used;
+	};
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "../../common/Defs.hpp"
+
+#include <vector>
+
+namespace GBA::cpu::jit {
+	using namespace common;
+
+	enum class Reg : u8 {
+		RAX, RCX, RDX, RBX,
+		RSP, RBP, RSI, RDI,
+		R8, R9, R10, R11,
+		R12, R13, R14, R15
+	};
+
+	/*
+	* Condition codes, in the
+	* same order as the encoding
+	*/
+	enum class Cond : u8 {
+		O, NO, C, NC,
+		Z, NZ, BE, A,
+		S, NS, P, NP,
+		L, GE, LE, G
+	};
+
+	enum class AluOp : u8 {
+		ADD, OR, ADC, SBB,
+		AND, SUB, XOR, CMP
+	};
+
+	enum class ShiftOp : u8 {
+		ROL = 0, ROR = 1,
+		SHL = 4, SHR = 5,
+		SAR = 7
+	};
+
+	/*
+	* Minimal x86-64 encoder, only
+	* the forms needed by the JIT.
+	* All memory operands are
+	* [base + disp32]
+	*/
+	class Emitter {
+	public :
+		Emitter();
+
+		std::vector<u8> const& GetCode() const {
+			return m_code;
+		}
+
+		std::size_t GetSize() const {
+			return m_code.size();
+		}
+
+		void Truncate(std::size_t size) {
+			m_code.resize(size);
+		}
+
+		void Push(Reg reg);
+		void Pop(Reg reg);
+
+		void Mov32(Reg dest, Reg source);
+		void Mov64(Reg dest, Reg source);
+		void MovImm32(Reg dest, u32 imm);
+		void MovImm64(Reg dest, uint64_t imm);
+
+		void Load32(Reg dest, Reg base, i32 disp);
+		void Store32(Reg base, i32 disp, Reg source);
+		void StoreImm32(Reg base, i32 disp, u32 imm);
+
+		void Alu32(AluOp op, Reg dest, Reg source);
+		void AluImm32(AluOp op, Reg dest, u32 imm);
+		void Test32(Reg first, Reg second);
+		void Not32(Reg reg);
+		void Neg32(Reg reg);
+		void Shift32(ShiftOp op, Reg reg, u8 amount);
+		void Shift64(ShiftOp op, Reg reg, u8 amount);
+
+		void BitTest32(Reg reg, u8 bit);
+		void BitTest32(Reg reg, Reg bit);
+		void Cmc();
+
+		void SetCC(Cond cond, Reg dest);
+		void MovZx8(Reg dest, Reg source);
+
+		void AddRsp(u8 amount);
+		void SubRsp(u8 amount);
+
+		void Call(void const* function);
+		void Ret();
+
+		/*
+		* Emit a jump with a rel32 placeholder,
+		* returns the position to patch
+		*/
+		std::size_t JumpIf(Cond cond);
+		std::size_t Jump();
+
+		//Make the jump at pos land here
+		void Bind(std::size_t pos);
+
+	private :
+		void Byte(u8 value);
+		void Dword(u32 value);
+		void Qword(uint64_t value);
+
+		void Rex(bool wide, Reg reg, Reg rm, bool force = false);
+		void ModRM(Reg reg, Reg rm);
+		void ModRM(u8 ext, Reg rm);
+		void Memory(Reg reg, Reg base, i32 disp);
+
+		std::vector<u8> m_code;
+	};
+}
@@ -0,0 +1,287 @@
+#pragma once
+
+#include "../core/CPUContext.hpp"
+#include "../core/BlockCache.hpp"
+#include "../aot/Abi.hpp"
+#include "../../memory/Bus.hpp"
+#include "CodeBuffer.hpp"
+
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace GBA::cpu {
+	class ARM7TDI;
+}
+
+namespace GBA::cpu::aot {
+	class Module;
+}
+
+namespace GBA::cpu::jit {
+	using namespace common;
+
+	class Emitter;
+
+	/*
+	* Static description of one guest
+	* instruction of a translated block.
+	* Instructions that are not translated
+	* are executed by calling the interpreter
+	* handler with this as argument.
+	* The pending_ fields describe the fetches
+	* of the translated instructions that
+	* precede this one, which are charged
+	* in bulk
+	*/
+	struct JitOp {
+		union {
+			ArmHandler arm;
+			ThumbHandler thumb;
+		} handler;
+
+		u32 opcode;
+		u32 pc;
+		u32 next_opcode;
+		u32 fetch_opcode;
+		u8 fetch_cycles[2];
+		u8 condition;
+
+		bool translated;
+		//Translated load or store, charges its
+		//own fetch and may leave the block like
+		//an interpreted instruction
+		bool memory;
+		bool last;
+		u32 index;
+
+		u32 pending_cycles;
+		u32 pending_address;
+		u32 pending_value;
+	};
+
+	//Same signature for emitted and precompiled code
+	using CompiledCode = aot::BlockFunction;
+
+	//Blocks that only access r0-r7 and r15
+	//run in every mode
+	static constexpr u8 ANY_MODE = 0xFF;
+
+	struct CompiledBlock {
+		CompiledCode code;
+		u32 size;
+		u32 first_fetched;
+		u8 mode;
+		std::vector<JitOp> ops;
+	};
+
+	/*
+	* Translates hot blocks of the block
+	* cache into x86-64 code.
+	* Data processing instructions that
+	* only touch registers are translated,
+	* loads and stores compute their address
+	* and write their registers in x86 code
+	* around a call to the bus. Everything
+	* else calls the interpreter handler.
+	* Fetch cycles of translated instructions
+	* are charged in bulk, before the next
+	* interpreted or memory one or when the
+	* block is left.
+	* Blocks found in a precompiled module
+	* are used from their first execution,
+	* with translate = false only those
+	* leave the interpreter
+	*/
+	class Jit {
+	public :
+		Jit(ARM7TDI* cpu, CPUContext* ctx, BlockCache* cache,
+			memory::Bus* bus, bool translate = true);
+
+		static bool IsSupported();
+
+		bool IsValid() const {
+			return m_buffer.IsValid();
+		}
+
+		void SetModule(aot::Module const* module) {
+			m_module = module;
+		}
+
+		//Callbacks used by precompiled modules
+		static aot::Api const* GetAotApi();
+
+		/*
+		* Also run every block through the
+		* interpreter and compare the results
+		*/
+		void SetLockstep(bool lockstep) {
+			m_lockstep = lockstep;
+		}
+
+		/*
+		* Execute block, which must start at the
+		* current PC. Leaves the CPU in the same
+		* state as the interpreter would after
+		* executing the last instruction of the
+		* run, without the PC update of Step.
+		* Returns false if the block has not been
+		* translated yet
+		*/
+		template <bool Thumb>
+		bool Run(CachedBlock& block, bool& branch);
+
+		void Flush();
+
+		/*
+		* Free the translations of erased blocks,
+		* no translated code may be running.
+		* Their machine code is only reclaimed
+		* when the buffer is reset
+		*/
+		void Release(std::vector<RetiredTranslation>& retired);
+
+		std::size_t GetBlockCount() const {
+			return m_blocks.size();
+		}
+
+		static constexpr u32 HOT_THRESHOLD = 32;
+		static constexpr u32 ROM_START = 0x08000000;
+		static constexpr std::size_t BUFFER_SIZE = 16 * 1024 * 1024;
+
+	private :
+		template <bool Thumb>
+		CompiledBlock* Compile(CachedBlock& block);
+
+		template <bool Thumb>
+		CompiledBlock* Precompiled(CachedBlock& block);
+
+		template <bool Thumb>
+		bool InitOp(CachedBlock const& block, u32 index, JitOp& op);
+
+		template <bool Thumb>
+		static void AssignPending(std::vector<JitOp>& ops);
+
+		CompiledBlock* Commit(CachedBlock& block, std::unique_ptr<CompiledBlock> compiled);
+
+		template <bool Thumb>
+		void RunLockstep(CompiledBlock* compiled, bool& branch);
+
+		bool ShouldExit(bool thumb);
+
+		template <bool Thumb>
+		void Sync(JitOp const* op);
+
+		/*
+		* Fetch after op, return true
+		* when the block must be left
+		*/
+		template <bool Thumb>
+		bool Finish(JitOp const* op, bool branch);
+
+		/*
+		* Called by translated code, return
+		* true when the block must be left
+		*/
+		template <bool Thumb>
+		static bool Interpret(Jit* jit, JitOp const* op);
+
+		template <bool Thumb>
+		static void ExitBlock(Jit* jit, JitOp const* op);
+
+		/*
+		* Called by translated loads and stores
+		* with the address, same bus accesses
+		* and timing as the interpreter. Loads
+		* return the value in the low half,
+		* rotated like the ARM7 does when the
+		* address is misaligned, and whether the
+		* block must be left in the high half
+		*/
+		template <bool Thumb, typename Type>
+		static uint64_t Load(Jit* jit, JitOp const* op, u32 address);
+
+		//LDRSH of an odd address loads a signed byte
+		template <bool Thumb, typename Type>
+		static uint64_t LoadSigned(Jit* jit, JitOp const* op, u32 address);
+
+		template <bool Thumb, typename Type>
+		static bool Store(Jit* jit, JitOp const* op, u32 address, u32 value);
+
+		//count words from address, the values
+		//go through m_transfer
+		template <bool Thumb>
+		static bool LoadMultiple(Jit* jit, JitOp const* op, u32 address, u32 count);
+
+		template <bool Thumb>
+		static bool StoreMultiple(Jit* jit, JitOp const* op, u32 address, u32 count);
+
+		//Next access of the reference run, for the
+		//translated instructions replayed in lockstep
+		u32 ReplayAccess(u32 address, u8 size, bool write, u32 value);
+
+		template <bool Thumb>
+		bool FinishReplay(JitOp const* op);
+
+		//Same as above, ops of the running block by index
+		template <bool Thumb>
+		static bool InterpretIndex(void* jit, u32 index);
+
+		template <bool Thumb>
+		static void ExitIndex(void* jit, u32 index);
+
+		static bool CompareContext(CPUContext const& first, CPUContext const& second);
+
+		ARM7TDI* m_cpu;
+		CPUContext* m_ctx;
+		BlockCache* m_cache;
+		memory::Bus* m_bus;
+
+		CodeBuffer m_buffer;
+		std::unordered_map<CompiledBlock*, std::unique_ptr<CompiledBlock>> m_blocks;
+		u32 m_generation;
+
+		aot::Module const* m_module;
+		CompiledBlock* m_current;
+		u8 m_entry_mode;
+
+		//Context used by the trampolines,
+		//the shadow copy in lockstep mode
+		CPUContext* m_active;
+
+		u32 m_executed;
+		bool m_branch;
+
+		bool m_lockstep;
+
+		/*
+		* Lockstep state, the interpreter
+		* runs first and records the state
+		* after every instruction and the bus
+		* accesses, the translated code then
+		* replays the interpreted instructions
+		* from the trace. Translated loads get
+		* their values from the accesses, which
+		* are also compared
+		*/
+		struct TraceEntry {
+			CPUContext ctx;
+			bool branch;
+			bool stop;
+			//Accesses made up to this instruction
+			u32 accesses;
+		};
+
+		bool m_reference;
+		bool m_replay;
+		CPUContext m_shadow;
+		std::array<TraceEntry, BlockCache::MAX_BLOCK_SIZE> m_trace;
+		std::vector<memory::LoggedAccess> m_accesses;
+		u32 m_access_pos;
+		bool m_access_mismatch;
+
+		//LDM/STM/PUSH/POP values
+		std::array<u32, 16> m_transfer;
+	};
+}
@@ -3,6 +3,8 @@
 #include "Instruction.hpp"
 #include "../core/CPUContext.hpp"
 
+#include <array>
+
 namespace GBA {
 	namespace memory {
 		class Bus;
@@ -36,7 +38,23 @@ namespace GBA::cpu::thumb{
 	using ThumbFunc = void(*)(THUMBInstruction instr,
 		memory::Bus* bus, CPUContext& ctx, bool& branch);
 
-	extern std::array<ThumbFunc, 1024> thumb_jump_table;
+	/*
+	* Handlers indexed by bits 6-15, or by the
+	* whole opcode when built with THUMB_FULL_DECODE
+	*/
+#ifdef THUMB_FULL_DECODE
+	static constexpr u32 THUMB_TABLE_SHIFT = 0;
+#else
+	static constexpr u32 THUMB_TABLE_SHIFT = 6;
+#endif
+
+	static constexpr u32 THUMB_TABLE_SIZE = 0x10000 >> THUMB_TABLE_SHIFT;
+
+	extern std::array<ThumbFunc, THUMB_TABLE_SIZE> thumb_jump_table;
+
+	inline ThumbFunc GetThumbHandler(THUMBInstruction instr) {
+		return thumb_jump_table[instr >> THUMB_TABLE_SHIFT];
+	}
 
 	THUMBInstructionType DecodeThumb(u16 opcode);
 
@@ -373,6 +373,8 @@ namespace GBA::debugger {
 		}
 
 		if (ImGui::BeginTabItem("CPSR")) {
+			ctx.ResolveFlags();
+
 			CPSR& cpsr = ctx.m_cpsr;
 
 			DrawCPSR(cpsr);
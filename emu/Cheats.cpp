@@ -293,9 +293,9 @@ namespace GBA::cheats {
 	}
 
 	bool RunCheatInterpreter(CheatSet& cheat_set, emulation::Emulator* emu) {
-		auto directive_iter = cheat_set.directives.begin();
+		auto directive_iter = cheat_set.directives.cbegin();
 
-		while(directive_iter != cheat_set.directives.end()) {
+		while(directive_iter != cheat_set.directives.cend()) {
 			InterpretDirective(directive_iter, emu);
 			directive_iter++;
 		}
@@ -335,6 +335,7 @@ namespace GBA::cheats {
 				rom_patch.applied = true;
 				rom_patch.old_value = emu->GetContext()
 					.pack.Patch(rom_patch.offset, rom_patch.value);
+				emu->GetContext().processor.FlushBlockCache();
 			}
 				break;
 			default:
@@ -365,6 +366,7 @@ namespace GBA::cheats {
 				rom_patch.applied = false;
 				emu->GetContext()
 					.pack.Patch(rom_patch.offset, rom_patch.old_value);
+				emu->GetContext().processor.FlushBlockCache();
 			}
 				break;
 			default:
@@ -51,6 +51,7 @@ namespace GBA::emulation {
 		);
 
 		m_ctx.processor.SetInterruptControl(m_ctx.int_controller);
+		m_ctx.processor.SetEventScheduler(&m_ctx.scheduler);
 		m_ctx.ppu.SetInterruptController(m_ctx.int_controller);
 		m_ctx.ppu.SetScheduler(&m_ctx.scheduler);
 		m_ctx.bus.SetEventScheduler(&m_ctx.scheduler);
@@ -85,11 +86,14 @@ namespace GBA::emulation {
 		m_ctx.all_dma[3]->SetMMIO(mmio);
 
 		m_ctx.apu.SetDma(m_ctx.all_dma[1], m_ctx.all_dma[2]);
+		m_ctx.apu.SetTimers(&m_ctx.timers);
 		m_ctx.apu.SetMMIO(mmio);
 		m_ctx.apu.SetScheduler(&m_ctx.scheduler);
 
 		m_ctx.timers.SetAPU(&m_ctx.apu);
 
+		m_ctx.processor.SetIdleLoops(m_ctx.pack.GetIdleLoops());
+
 		auto& db_cheats = m_ctx.pack.GetCheats();
 
 		for (auto& [cheat_name, cheat_entry] : db_cheats) {
@@ -115,16 +119,27 @@ namespace GBA::emulation {
 
 				m_ctx.all_dma[dma]->Step();
 			}
-
-			u32 cycles = m_ctx.bus.m_time.PopCycles();
 		}
+
+		m_ctx.bus.m_time.PopCycles();
 	}
 
 	void Emulator::UseBIOS() {
-		m_ctx.bus.LoadBIOS(m_bios_loc);
+		if (!m_ctx.bus.LoadBIOS(m_bios_loc)) {
+			//Nothing to boot, start from the ROM
+			LOG_INFO("Using HLE BIOS");
+			m_ctx.bus.LoadHleBios();
+			SkipBios();
+			return;
+		}
+
 		m_ctx.processor.GetContext().m_pipeline.Bubble<cpu::InstructionMode::ARM>(0x0);
 	}
 
+	void Emulator::SetHleBios(bool enable) {
+		m_ctx.bus.SetHleBios(enable);
+	}
+
 	void Emulator::SkipBios() {
 		m_ctx.processor.SkipBios();
 		m_ctx.bus.LoadBiosResetOpcode();
@@ -136,29 +151,36 @@ namespace GBA::emulation {
 		}
 
 		while (!m_ctx.ppu.HasFrame()) {
-			if (m_ctx.bus.GetActiveDma() == 4) {
-				m_ctx.processor.Step();
+			u8 dma = m_ctx.bus.GetActiveDma();
 
-				if (m_enable_hooks && !m_hooks.empty()) {
-					auto curr_pc = m_ctx.processor.GetContext()
-						.m_regs.GetReg(15);
-					auto hooks = m_hooks.equal_range(curr_pc);
-
-					for (; hooks.first != hooks.second; hooks.first++) {
-						auto const& hook = hooks.first->second;
-						auto& cheat_set = m_cheats[hook];
-						cheats::RunCheatInterpreter(cheat_set, this);
-					}
-				}
+			if (dma != 4) {
+				m_ctx.all_dma[dma]->Step();
+				continue;
 			}
-			else {
-				u8 dma = m_ctx.bus.GetActiveDma();
 
-				m_ctx.all_dma[dma]->Step();
+			//The frame can only end in an event
+			//callback, so run up to the next one.
+			//Hooks need to see every instruction
+			if (!m_enable_hooks || m_hooks.empty()) {
+				m_ctx.processor.Run(m_ctx.scheduler
+					.GetFirstEvent().trigger_timestamp);
+				continue;
 			}
 
-			u32 cycles = m_ctx.bus.m_time.PopCycles();
+			m_ctx.processor.Step();
+
+			auto curr_pc = m_ctx.processor.GetContext()
+				.m_regs.GetReg(15);
+			auto hooks = m_hooks.equal_range(curr_pc);
+
+			for (; hooks.first != hooks.second; hooks.first++) {
+				auto const& hook = hooks.first->second;
+				auto& cheat_set = m_cheats[hook];
+				cheats::RunCheatInterpreter(cheat_set, this);
+			}
 		}
+
+		m_ctx.bus.m_time.PopCycles();
 	}
 
 	void Emulator::StoreState(std::string const& path) {
@@ -47,9 +47,17 @@ namespace GBA::emulation {
 		void EmulateFor(common::u32 num_instructions);
 		void RunTillVblank();
 
+		/*
+		* Falls back to the HLE BIOS, which
+		* skips the boot, if the BIOS file
+		* cannot be loaded
+		*/
 		void UseBIOS();
 		void SkipBios();
 
+		//Run SWIs natively even with a BIOS file
+		void SetHleBios(bool enable);
+
 		bool LoadRom(std::string_view loc);
 		void Init();
 
@@ -25,6 +25,16 @@ namespace GBA::gamepack {
 		bool StoreBackup(fs::path const& to);
 
 		u16 Read(u32 address, u8 region = 0) const;
+
+		/*
+		* Pointer to the ROM halfword at address,
+		* nullptr if Read would not return plain
+		* ROM data (backup, GPIO, out of bounds)
+		*/
+		u8 const* GetRomPointer(u32 address, u8 region = 0) const;
+
+		//Same for all of the len bytes at address
+		u8 const* GetRomRange(u32 address, u32 len, u8 region = 0) const;
 		void Write(u32 address, u16 value, u8 region = 0);
 
 		u8 ReadSRAM(u32 address) const;
@@ -61,6 +71,10 @@ namespace GBA::gamepack {
 			return m_cheats;
 		}
 
+		std::vector<u32> const& GetIdleLoops() const {
+			return m_idle_loops;
+		}
+
 	private :
 		bool MapFile();
 		bool UnMapFile();
@@ -74,5 +88,6 @@ namespace GBA::gamepack {
 		gpio::Gpio* m_gpio;
 
 		std::unordered_map<std::string, backups::CheatEntry> m_cheats;
+		std::vector<u32> m_idle_loops;
 	};
 }
\ No newline at end of file
@@ -36,5 +36,6 @@ namespace GBA::gamepack::backups {
 		static BackupTypeSize GetBackupTypeAndSize(std::string_view db_path, std::string rom_name);
 		static std::map<GpioDevices, PinConnections> GetGpioDevices(std::string_view db_path, std::string rom_name);
 		static std::unordered_map<std::string, CheatEntry> GetCheats(std::string_view db_path, std::string rom_name);
+		static std::vector<uint32_t> GetIdleLoops(std::string_view db_path, std::string rom_name);
 	};
 }
\ No newline at end of file
@@ -78,6 +78,20 @@ int main(int argc, char* argv[]) {
 
 		emu->Init();
 
+		std::string const& cpu_backend = conf.data["EMU"]["cpu_backend"];
+
+		if (cpu_backend == "jit")
+			emu->GetContext().processor.SetExecutionMode(GBA::cpu::ExecutionMode::JIT);
+		else if (cpu_backend == "jit_lockstep")
+			emu->GetContext().processor.SetExecutionMode(GBA::cpu::ExecutionMode::JIT_LOCKSTEP);
+		else if (cpu_backend == "aot")
+			emu->GetContext().processor.SetExecutionMode(GBA::cpu::ExecutionMode::AOT);
+
+		if (conf.data["EMU"].has("aot_module") &&
+			!emu->GetContext().processor.LoadPrecompiled(conf.data["EMU"]["aot_module"])) {
+			std::cout << "Could not load precompiled module" << std::endl;
+		}
+
 		if (conf.data["EMU"]["startup_load_save"] == "true") {
 			std::string save_path = conf.data["EMU"].has("game_save_path") ?
 				conf.data["EMU"]["game_save_path"] : "./saves";
@@ -93,6 +107,19 @@ int main(int argc, char* argv[]) {
 		if (conf.data["BIOS"]["skip"] == "true")
 			emu->SkipBios();
 
+		if (conf.data["BIOS"]["hle"] == "true")
+			emu->SetHleBios(true);
+
+		if (conf.data["EMU"]["color_correction"] == "true")
+			emu->GetContext().ppu.SetColorCorrection(GBA::ppu::ColorCorrection::LCD);
+
+		if (conf.data["EMU"].has("render_threads")) {
+			int render_threads = parse_int(conf.data["EMU"]["render_threads"]).value_or(0);
+
+			if (render_threads > 0)
+				emu->GetContext().ppu.SetRenderThreads(unsigned(render_threads));
+		}
+
 		auto& ctx = emu->GetContext();
 
 		ctx.apu.SetCallback(
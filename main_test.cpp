@@ -1,7 +1,45 @@
 #include <iostream>
+#include <string_view>
 
 #include "./emu/Emulator.hpp"
+#include "./tests/Test.hpp"
 
+namespace GBA::test {
+	static int failed_checks = 0;
+
+	std::vector<TestCase>& GetTests() {
+		static std::vector<TestCase> tests{};
+		return tests;
+	}
+
+	void Fail(const char* file, int line, std::string const& message) {
+		std::cout << "  " << file << ":" << line << ": " << message << std::endl;
+		failed_checks++;
+	}
+}
+
+//Runs every test, or those whose name contains argv[1]
 int main(int argc, char* argv[]) {
-    std::cout << "Hello" << std::endl;
+	using namespace GBA::test;
+
+	std::string_view filter = argc > 1 ? argv[1] : "";
+	int failed_tests = 0, run_tests = 0;
+
+	for (auto const& test : GetTests()) {
+		if (std::string_view(test.name).find(filter) == std::string_view::npos)
+			continue;
+
+		int before = failed_checks;
+
+		std::cout << test.name << std::endl;
+		test.function();
+		run_tests++;
+
+		if (failed_checks != before)
+			failed_tests++;
+	}
+
+	std::cout << run_tests - failed_tests << "/" << run_tests << " tests passed" << std::endl;
+
+	return failed_tests ? 1 : 0;
 }
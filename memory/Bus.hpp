@@ -10,6 +10,7 @@
 #include "../gamepack/GamePack.hpp"
 #include "../common/Logger.hpp"
 #include "../memory/Timers.hpp"
+#include "../cpu/core/BlockCache.hpp"
 
 #include <algorithm>
 #include <vector>
@@ -56,6 +57,59 @@ namespace GBA::memory {
 
 	static constexpr u8 NUM_REGIONS = sizeof(REGIONS_LEN) / sizeof(u32);
 
+	static constexpr u32 PAGE_SHIFT = 14;
+	static constexpr u32 PAGE_SIZE = 1 << PAGE_SHIFT;
+	//Everything above is unused
+	static constexpr u32 PAGE_TABLE_END = 0x10000000;
+	static constexpr u32 NUM_PAGES = PAGE_TABLE_END >> PAGE_SHIFT;
+
+	/*
+	* Host memory behind a guest page, mirrors
+	* are resolved when the table is built.
+	* Host address is read/write + (address & mask)
+	*/
+	struct MemoryPage {
+		u8 const* read;
+		u8* write;
+		u32 mask;
+		//Cost of 1, 2 and 4 byte accesses, 0 when
+		//it is not fixed (ROM) or reads are not plain
+		u8 cycles[3];
+		//PAL and VRAM byte writes are mirrored,
+		//OAM ignores them
+		bool byte_write;
+	};
+
+	/*
+	* Data access of the CPU, recorded
+	* while an access log is set
+	*/
+	struct LoggedAccess {
+		u32 address;
+		u32 value;
+		u8 size;
+		bool write;
+	};
+
+	/*
+	* Plain memory around a code fetch, fetches
+	* inside cost the same as through Read.
+	* Stale once the bus code generation changes
+	*/
+	struct CodeWindow {
+		u8 const* host;
+		u32 start;
+		u32 length;
+		u32 generation;
+		//Indexed by Access
+		u8 cycles[2];
+	};
+
+	template <typename Type>
+	static constexpr u32 PageCyclesIndex() {
+		return sizeof(Type) == 4 ? 2 : sizeof(Type) - 1;
+	}
+
 	class Bus {
 	public :
 		Bus();
@@ -75,6 +129,25 @@ namespace GBA::memory {
 		*/
 		template <typename Type>
 		Type Read(u32 address, bool code = false) {
+			if (address < PAGE_TABLE_END) [[likely]] {
+				MemoryPage const& page = m_pages[address >> PAGE_SHIFT];
+				u32 num_cycles = page.cycles[PageCyclesIndex<Type>()];
+
+				if (num_cycles) [[likely]] {
+					u32 offset = address & page.mask & ~(sizeof(Type) - 1);
+					Type value = *reinterpret_cast<Type const*>(page.read + offset);
+
+					m_time.PushInternalCycles(num_cycles);
+
+					m_open_bus_value = value;
+					m_open_bus_address = address;
+
+					m_sched->Advance(num_cycles);
+
+					return value;
+				}
+			}
+
 			MEMORY_RANGE region = (MEMORY_RANGE)(address >> 24);
 			u32 addr_low = address & 0x00FFFFFF;
 
@@ -122,7 +195,12 @@ namespace GBA::memory {
 
 				if (addr_low < IO_SIZE && !UNUSED_REGISTERS_MAP[addr_low]
 					&& mmio->IsRegisterReadable(addr_low)) {
-					m_timers->Update();
+					//Counters are only computed when read
+					if ((addr_low & ~0xF) == 0x100) [[unlikely]] {
+						m_timers->Update();
+						m_timer_reads++;
+					}
+
 					return_value = mmio->Read<Type>(addr_low);
 				}
 				else {
@@ -154,7 +232,7 @@ namespace GBA::memory {
 					addr_low &= 0x1FFFF;
 
 					if (addr_low > 0x17FFF)
-						addr_low -= 0x7FFF;
+						addr_low -= 0x8000;
 				}
 
 				return_value = m_ppu->ReadVRAM<Type>(addr_low);
@@ -197,6 +275,9 @@ namespace GBA::memory {
 				break;
 			}
 
+			if (m_access_log && !code) [[unlikely]]
+				m_access_log->push_back({ address, u32(return_value), type_size, false });
+
 			m_open_bus_value = return_value;
 			m_open_bus_address = address;
 
@@ -207,6 +288,40 @@ namespace GBA::memory {
 
 		template <typename Type>
 		void Write(u32 address, Type value) {
+			if (address < PAGE_TABLE_END) [[likely]] {
+				MemoryPage const& page = m_pages[address >> PAGE_SHIFT];
+
+				if (page.write && (sizeof(Type) != 1 || page.byte_write)) [[likely]] {
+					u32 offset = address & page.mask & ~(sizeof(Type) - 1);
+					u32 num_cycles = page.cycles[PageCyclesIndex<Type>()];
+
+					*reinterpret_cast<Type*>(page.write + offset) = value;
+
+					m_time.PushInternalCycles(num_cycles);
+
+					MEMORY_RANGE region = (MEMORY_RANGE)(address >> 24);
+					u32 addr_low = address & 0x00FFFFFF & ~(sizeof(Type) - 1);
+
+					if (region == MEMORY_RANGE::IWRAM)
+						m_block_cache->InvalidateWrite<true>(addr_low & REGIONS_LEN[(u8)MEMORY_RANGE::IWRAM], sizeof(Type));
+					else if (region == MEMORY_RANGE::EWRAM)
+						m_block_cache->InvalidateWrite<false>(addr_low & REGIONS_LEN[(u8)MEMORY_RANGE::EWRAM], sizeof(Type));
+					else if (region == MEMORY_RANGE::VRAM)
+						m_ppu->InvalidateVRAM(u32(page.write + offset - m_ppu->GetVRAMMemory()), sizeof(Type));
+					else if (region == MEMORY_RANGE::PAL)
+						m_ppu->InvalidatePalette();
+					else if (region == MEMORY_RANGE::OAM)
+						m_ppu->InvalidateOAM();
+
+					m_open_bus_value = value;
+					m_open_bus_address = address;
+
+					m_sched->Advance(num_cycles);
+
+					return;
+				}
+			}
+
 			MEMORY_RANGE region = (MEMORY_RANGE)(address >> 24);
 			u32 addr_low = address & 0x00FFFFFF;
 
@@ -217,6 +332,9 @@ namespace GBA::memory {
 
 			constexpr const u8 type_size = sizeof(Type);
 
+			if (m_access_log) [[unlikely]]
+				m_access_log->push_back({ address, u32(value), type_size, true });
+
 			u32 num_cycles = 0;
 
 			switch (region) {
@@ -228,12 +346,14 @@ namespace GBA::memory {
 				num_cycles = m_time.PushCycles<MEMORY_RANGE::EWRAM, type_size>();
 				addr_low &= REGIONS_LEN[(u8)MEMORY_RANGE::EWRAM];
 				reinterpret_cast<Type*>(m_wram)[addr_low / type_size] = value;
+				m_block_cache->InvalidateWrite<false>(addr_low, type_size);
 				break;
 
 			case MEMORY_RANGE::IWRAM:
 				num_cycles = m_time.PushCycles<MEMORY_RANGE::IWRAM, type_size>();
 				addr_low &= REGIONS_LEN[(u8)MEMORY_RANGE::IWRAM];
 				reinterpret_cast<Type*>(m_iwram)[addr_low / type_size] = value;
+				m_block_cache->InvalidateWrite<true>(addr_low, type_size);
 				break;
 
 			case MEMORY_RANGE::IO:
@@ -268,7 +388,7 @@ namespace GBA::memory {
 					addr_low &= 0x1FFFF;
 
 					if (addr_low > 0x17FFF)
-						addr_low -= 0x7FFF;
+						addr_low -= 0x8000;
 				}
 
 				if constexpr (sizeof(Type) == 4)
@@ -319,6 +439,54 @@ namespace GBA::memory {
 			m_sched->Advance(num_cycles);
 		}
 
+		/*
+		* Bookkeeping of a code fetch whose
+		* value and cost are already known
+		* (see cpu::BlockCache)
+		*/
+		void CachedFetch(u32 address, u32 value, u32 cycles) {
+			m_time.PushInternalCycles(cycles);
+
+			m_open_bus_value = value;
+			m_open_bus_address = address;
+
+			m_sched->Advance(cycles);
+		}
+
+		/*
+		* Host memory backing a code fetch
+		* of the given size, nullptr when the
+		* fetch is not served by plain memory
+		*/
+		u8 const* GetCodePointer(u32 address, u32 size);
+
+		/*
+		* Fill the window holding a code fetch of
+		* the given size, false (and an empty window)
+		* when the fetch has to go through Read
+		*/
+		bool GetCodeWindow(u32 address, u32 size, CodeWindow& window) const;
+
+		//Changes with the page table and waitstates
+		u32 GetCodeGeneration() const {
+			return m_code_generation;
+		}
+
+		template <typename Type>
+		u32 GetCodeFetchCycles(u32 address, Access acc) const {
+			MEMORY_RANGE region = (MEMORY_RANGE)(address >> 24);
+
+			if (region >= MEMORY_RANGE::ROM_REG_1 && region <= MEMORY_RANGE::ROM_REG_3_SECOND
+				&& (address & 0x1FFFF & ~(sizeof(Type) - 1)) == 0)
+				acc = Access::NonSeq;
+
+			return m_time.GetAccessCycles<sizeof(Type)>(region, acc);
+		}
+
+		void AttachBlockCache(cpu::BlockCache* cache) {
+			m_block_cache = cache;
+		}
+
 		/*
 		* Read everything without
 		* changing cycle counts
@@ -354,15 +522,60 @@ namespace GBA::memory {
 
 		void SetPPU(ppu::PPU* ppu) {
 			m_ppu = ppu;
+			MapVideoPages();
 		}
 
 		void SetTimers(timers::TimerChain* timers) {
 			m_timers = timers;
 		}
 
-		void LoadBIOS(std::string const& location);
+		/*
+		* Number of reads of the timer registers,
+		* whose values change without events
+		*/
+		u32 GetTimerReads() const {
+			return m_timer_reads;
+		}
+
+		/*
+		* Record the data accesses in log until
+		* called with nullptr. Mapped pages are
+		* bypassed meanwhile, so that every access
+		* goes through the switch in Read/Write
+		*/
+		void SetAccessLog(std::vector<LoggedAccess>* log);
+
+		bool LoadBIOS(std::string const& location);
 		void LoadBiosResetOpcode();
 
+		//Minimal BIOS image, SWIs must run natively
+		void LoadHleBios();
+
+		/*
+		* SWIs implemented by cpu::hle run
+		* natively instead of in the BIOS
+		*/
+		void SetHleBios(bool enable) {
+			m_hle_bios = enable;
+		}
+
+		bool IsHleBios() const {
+			return m_hle_bios;
+		}
+
+		/*
+		* Set while the HLE BIOS is halted in
+		* IntrWait, the SWI runs again after each
+		* IRQ and must not start a new wait
+		*/
+		void SetHleWaiting(bool waiting) {
+			m_hle_waiting = waiting;
+		}
+
+		bool IsHleWaiting() const {
+			return m_hle_waiting;
+		}
+
 		MMIO* GetMMIO() {
 			return mmio;
 		}
@@ -410,6 +623,27 @@ namespace GBA::memory {
 
 		void TryTriggerDMA(DMAFireType trigger_type);
 
+		/*
+		* Run up to count DMA units at once when source
+		* and destination are plain memory. Stops at the
+		* end of a page and before the next event, so that
+		* anything able to preempt the transfer still sees
+		* it at the same point. Returns the number of units
+		* moved, 0 if they have to go through Read/Write
+		*/
+		template <typename Type>
+		u32 TransferBlock(u32 source, u32 dest, i32 source_inc, i32 dest_inc, u32 count);
+
+		/*
+		* Words of a LDM/STM in one go, when they all
+		* sit in one plain page and no event fires
+		* before the last access. Same cost and side
+		* effects as count Read/Write calls, false
+		* if the caller has to make them
+		*/
+		bool ReadMultiple(u32 address, u32* values, u32 count);
+		bool WriteMultiple(u32 address, u32 const* values, u32 count);
+
 		inline void ResetHalt() {
 			m_halt_cnt = 0;
 		}
@@ -447,6 +681,7 @@ namespace GBA::memory {
 			ar(m_post_boot);
 			ar(m_halt_cnt);
 			ar(m_mem_control);
+			ar(m_hle_waiting);
 		}
 
 		template <typename Ar>
@@ -477,14 +712,35 @@ namespace GBA::memory {
 			ar(m_post_boot);
 			ar(m_halt_cnt);
 			ar(m_mem_control);
+			ar(m_hle_waiting);
 
 			std::copy_n(wram_temp.begin(), 0x40000, m_wram);
 			std::copy_n(iram_temp.begin(), 0x8000, m_iwram);
+
+			m_code_generation++;
 		}
 
 	private :
+		void MapPages(u32 start, u32 end, u8* memory, u32 size,
+			u8 cycles16, u8 cycles32, bool byte_write);
+		void MapVideoPages();
+		void MapRomPages();
+
+		//Page holding count words at address, nullptr
+		//if the fast path cannot be used
+		MemoryPage const* GetMultiplePage(u32 address, u32 count, bool write) const;
+
 		gamepack::GamePack* m_pack;
 
+		//Accesses to unmapped pages take
+		//the switch in Read/Write
+		MemoryPage* m_page_table;
+		//m_page_table, or no page at all while
+		//accesses are logged
+		MemoryPage const* m_pages;
+		//Bumped when fetch windows become stale
+		u32 m_code_generation;
+
 		u8* m_wram;
 		u8* m_iwram;
 
@@ -512,6 +768,8 @@ namespace GBA::memory {
 		ppu::PPU* m_ppu;
 
 		u8* m_bios;
+		bool m_hle_bios;
+		bool m_hle_waiting;
 
 		EventScheduler* m_sched;
 
@@ -525,5 +783,9 @@ namespace GBA::memory {
 		u32 m_mem_control;
 
 		timers::TimerChain* m_timers;
+		u32 m_timer_reads;
+
+		cpu::BlockCache* m_block_cache;
+		std::vector<LoggedAccess>* m_access_log;
 	};
 }
\ No newline at end of file
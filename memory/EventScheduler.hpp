@@ -4,6 +4,7 @@
 
 #include <functional>
 #include <array>
+#include <algorithm>
 
 namespace GBA::memory {
 	//We could use an std::function
@@ -42,26 +43,53 @@ namespace GBA::memory {
 		void* userdata;
 	};
 
+	/*
+	* Every event type owns a slot, pending
+	* types are kept in a binary heap indexed
+	* by slot position, so nothing is ever
+	* searched. Events with the same trigger
+	* timestamp fire in scheduling order
+	*/
 	class EventScheduler {
 	public :
 		EventScheduler();
 
 		void SetEventTypeRodata(EventType ev_ty, Callback callback, void* data);
 
+		/*
+		* Fail if the type is already pending,
+		* unless recursive is set, in which case
+		* the pending event is moved
+		*/
 		bool Schedule(common::u32 cycles, EventType type, Callback callback, void* userdata, bool recursive = false);
 		bool ScheduleAbsolute(uint64_t timestamp, EventType type, Callback callback, void* userdata, bool recursive = false);
 		bool Deschedule(EventType type);
-		bool Reschedule(EventType type, common::u32 cycles, bool increment_event_count);
+		bool Reschedule(EventType type, common::u32 cycles);
 
+		bool IsScheduled(EventType type) const {
+			return m_position[std::size_t(type)] != NOT_SCHEDULED;
+		}
+
+		//Trigger timestamp is ~0 if nothing is pending
 		Event const& GetFirstEvent() const;
 
 		inline uint64_t GetTimestamp() const {
 			return m_timestamp;
 		}
 
-		void Advance(common::u32 cycles);
+		/*
+		* Called after every bus access, the
+		* common case only compares against the
+		* cached timestamp of the first event
+		*/
+		inline void Advance(common::u32 cycles) {
+			m_timestamp += cycles;
+
+			if (m_timestamp >= m_next_event) [[unlikely]]
+				RunEvents();
+		}
 
-		static constexpr std::size_t MAX_EVENTS = 30;
+		static constexpr std::size_t MAX_EVENTS = std::size_t(EventType::EVENT_MAX);
 
 		template <typename Ar>
 		void save(Ar& ar) const {
@@ -70,10 +98,22 @@ namespace GBA::memory {
 			ar(m_num_events);
 			ar(m_timestamp);
 
+			//In firing order, so that load
+			//keeps the order of ties
+			std::array<common::u8, MAX_EVENTS> order{};
+			std::copy_n(m_heap.begin(), m_num_events, order.begin());
+			std::sort(order.begin(), order.begin() + m_num_events,
+				[this](common::u8 first, common::u8 second) {
+					return Before(first, second);
+				}
+			);
+
 			for (u32 curr_event = 0; curr_event < m_num_events; curr_event++) {
-				ar(m_events[curr_event].base_timestamp);
-				ar(m_events[curr_event].trigger_timestamp);
-				ar(m_events[curr_event].type);
+				Event const& ev = m_events[order[curr_event]];
+
+				ar(ev.base_timestamp);
+				ar(ev.trigger_timestamp);
+				ar(ev.type);
 			}
 		}
 
@@ -87,6 +127,7 @@ namespace GBA::memory {
 			ar(m_timestamp);
 
 			m_num_events = 0;
+			m_position.fill(NOT_SCHEDULED);
 
 			for (u32 curr_event = 0; curr_event < old_ev_count; curr_event++) {
 				uint64_t base{}, trigger{};
@@ -101,14 +142,47 @@ namespace GBA::memory {
 
 				ScheduleAbsolute(trigger, ty, callback, data);
 			}
+
+			UpdateNextEvent();
 		}
 
 		using EvTypeData = std::pair<Callback, void*>;
 
 	private :
+		static constexpr common::u8 NOT_SCHEDULED = 0xFF;
+
+		void RunEvents();
+
+		bool Before(common::u8 first, common::u8 second) const {
+			Event const& ev1 = m_events[first];
+			Event const& ev2 = m_events[second];
+
+			if (ev1.trigger_timestamp != ev2.trigger_timestamp)
+				return ev1.trigger_timestamp < ev2.trigger_timestamp;
+
+			return m_order[first] < m_order[second];
+		}
+
+		void SiftUp(std::size_t pos);
+		void SiftDown(std::size_t pos);
+		void Remove(std::size_t pos);
+
+		void UpdateNextEvent() {
+			m_next_event = m_num_events ? m_events[m_heap[0]].trigger_timestamp :
+				~std::uint64_t(0);
+		}
+
 		std::array<EvTypeData, size_t(EventType::EVENT_MAX)> m_event_type_rodata;
-		Event m_events[MAX_EVENTS];
+		//Indexed by type
+		std::array<Event, MAX_EVENTS> m_events;
+		std::array<std::uint64_t, MAX_EVENTS> m_order;
+		std::array<common::u8, MAX_EVENTS> m_position;
+		//Pending types
+		std::array<common::u8, MAX_EVENTS> m_heap;
 		std::size_t m_num_events;
 		std::uint64_t m_timestamp;
+		//Trigger timestamp of the first event
+		std::uint64_t m_next_event;
+		std::uint64_t m_next_order;
 	};
 }
\ No newline at end of file
@@ -37,6 +37,19 @@ namespace GBA::memory {
 
 		void RequestInterrupt(InterruptType type);
 
+		/*
+		* IME set, line armed and IE & IF != 0.
+		* CPSR.I is checked by the processor
+		*/
+		inline bool IsPending() const {
+			return m_pending;
+		}
+
+		//IE & IF != 0, wakes up from HALT
+		inline bool IsRequested() const {
+			return m_requested;
+		}
+
 		template <typename Ar>
 		void save(Ar& ar) const {
 			ar(m_registers);
@@ -47,10 +60,18 @@ namespace GBA::memory {
 		void load(Ar& ar) {
 			ar(m_registers);
 			ar(m_irq_line);
+
+			UpdatePending();
 		}
 	private :
+		//Called every time IE, IF, IME
+		//or the line status change
+		void UpdatePending();
+
 		common::u8 m_registers[0xC];
 
 		bool m_irq_line;
+		bool m_requested;
+		bool m_pending;
 	};
 }
\ No newline at end of file
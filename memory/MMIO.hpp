@@ -3,56 +3,26 @@
 #include "../common/Logger.hpp"
 #include "../common/BitManip.hpp"
 #include "../common/Defs.hpp"
+#include "../common/Error.hpp"
 
 #include <functional>
 #include <array>
 #include <optional>
+#include <vector>
 
 namespace GBA::memory {
 	/*
-	TODO: Rewrite this mess
-
-	Why?? Well... The runtime cost
-	is not a problem. The problem
-	is another one, and it is
-	big
-
-	As an interface it is very nice and
-	easy to use. The implementation, 
-	however, is the opposite. 
-	Look at the PPU implementation
-	for details
-
-	You may ask: How can we improve this?
-	Isn't this implementation
-	needed for accuracy (e.g. writes
-	to parts of a register should not have
-	effect or similar things)?
-
-	The answer is yes and no. 
-
-	We could achieve a similar result
-	by storing pointers to the
-	registers themselves, and providing
-	a callback only if needed
-
-	For example:
-	- Writes to the first 3 bits of the
-	  dispstat register are ignored.
-	  So, we register a write handler
-	- The other registers (or most 
-	  of them) can be accessed freely.
-	  So we register a pointer 
-	  to each register. 
-	To verify if a callback is registered,
-	just create an array of std::optional, 
-	and if the optional contains a value,
-	we use the callback. Otherwise,
-	we go directly to the pointer
-
-	In Extreme cases, even this can become
-	messy. But it still should be better
-	than the current implementation
+	Registers are described byte by byte, with a
+	pointer to the backing memory, a write mask and
+	an optional callback for bytes with side effects.
+	Callbacks live out of line, so the register map
+	stays a dense array of small entries.
+
+	Aligned halfwords and words whose bytes are
+	contiguous and have no callback are marked as
+	plain in m_blocks: 16 and 32 bit accesses to
+	them are a single masked load or store instead
+	of a loop over the bytes
 	*/
 
 	using IOWriteFunction = std::function<void(common::u8, common::u16)>;
@@ -137,11 +107,23 @@ namespace GBA::memory {
 	} ();
 
 	struct IORegister {
-		bool readable;
-		bool writeable;
 		common::u8* pointer;
 		common::u8 mask;
-		std::optional<IOWriteFunction> write_callback;
+		bool readable;
+		bool writeable;
+		//Index in MMIO::m_callbacks
+		common::u16 callback;
+	};
+
+	static_assert(sizeof(IORegister) <= 16, "IORegister should stay small");
+
+	struct IOBlock {
+		//Low and high halfword
+		common::u8* pointer[2];
+		common::u32 read_mask;
+		common::u32 write_mask;
+		//Bit 0 and 1: halfwords, bit 2: word
+		common::u8 plain;
 	};
 
 	class MMIO {
@@ -152,13 +134,25 @@ namespace GBA::memory {
 		void AddRegister(common::u16 offset, bool readable, 
 			bool writeable, common::u8* pointer, Type mask, 
 			std::optional<IOWriteFunction> const& callback = std::nullopt) {
+			common::u16 callback_id = NO_CALLBACK;
+
+			if (callback.has_value()) {
+				error::Assert(m_callbacks.size() < NO_CALLBACK, "Too many MMIO callbacks");
+
+				callback_id = (common::u16)m_callbacks.size();
+				m_callbacks.push_back(callback.value());
+			}
+
 			for (uint8_t pos = 0; pos < sizeof(Type); pos++) {
 				m_registers[offset + pos] = IORegister{
-					readable, writeable, pointer + pos, (common::u8)mask, callback
+					pointer + pos, (common::u8)mask, readable, writeable, callback_id
 				};
 
 				mask >>= 8;
 			}
+
+			for (common::u16 block = offset / 4; block <= (offset + sizeof(Type) - 1) / 4; block++)
+				UpdateBlock(block);
 		}
 
 		template <typename Type>
@@ -172,6 +166,15 @@ namespace GBA::memory {
 				return *(reg.pointer);
 			}
 			else {
+				IOBlock const& block = m_blocks[offset / 4];
+
+				if (block.plain & PlainBit<Type>(offset)) [[likely]] {
+					common::u32 pos = offset % 4;
+					Type mask = Type(block.read_mask >> (pos * 8));
+
+					return *reinterpret_cast<Type const*>(block.pointer[pos / 2]) & mask;
+				}
+
 				Type value = 0;
 
 				for (uint8_t pos = 0; pos < sizeof(Type); pos++) {
@@ -193,8 +196,8 @@ namespace GBA::memory {
 				if (!reg.pointer || !reg.writeable)
 					return;
 
-				if (reg.write_callback.has_value()) {
-					reg.write_callback.value()(value, offset);
+				if (reg.callback != NO_CALLBACK) {
+					m_callbacks[reg.callback](value, offset);
 					return;
 				}
 
@@ -206,15 +209,25 @@ namespace GBA::memory {
 				*(reg.pointer) = value;
 			}
 			else {
-				for (uint8_t pos = 0; pos < sizeof(Type); pos++) {
+				IOBlock const& block = m_blocks[offset / 4];
+
+				if (block.plain & PlainBit<Type>(offset)) [[likely]] {
+					common::u32 pos = offset % 4;
+					Type mask = Type(block.write_mask >> (pos * 8));
+					Type* ptr = reinterpret_cast<Type*>(block.pointer[pos / 2]);
+
+					*ptr = (value & mask) | (*ptr & ~mask);
+					return;
+				}
+
+				for (uint8_t pos = 0; pos < sizeof(Type); pos++, value >>= 8) {
 					auto& reg = m_registers[offset + pos];
 
 					if (!reg.pointer || !reg.writeable)
 						continue;
 
-					if (reg.write_callback.has_value()) {
-						reg.write_callback.value()((common::u8)value, offset + pos);
-						value >>= 8;
+					if (reg.callback != NO_CALLBACK) {
+						m_callbacks[reg.callback]((common::u8)value, offset + pos);
 						continue;
 					}
 
@@ -226,8 +239,6 @@ namespace GBA::memory {
 					set_val &= mask;
 					set_val |= curr_value & ~mask;
 					*(reg.pointer) = set_val;
-
-					value >>= 8;
 				}
 			}
 		}
@@ -239,6 +250,20 @@ namespace GBA::memory {
 		common::u8 DebuggerReadIO(common::u16 offset);
 
 	private:
+		static constexpr common::u16 NO_CALLBACK = 0xFFFF;
+
+		template <typename Type>
+		static constexpr common::u8 PlainBit(common::u16 offset) {
+			if constexpr (sizeof(Type) == 4)
+				return 0b100;
+			else
+				return (offset & 2) ? 0b10 : 0b01;
+		}
+
+		void UpdateBlock(common::u16 block);
+
 		IORegister m_registers[IO_SIZE];
+		IOBlock m_blocks[IO_SIZE / 4];
+		std::vector<IOWriteFunction> m_callbacks;
 	};
 }
\ No newline at end of file
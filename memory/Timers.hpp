@@ -13,6 +13,15 @@ namespace GBA::apu {
 }
 
 namespace GBA::timers {
+	/*
+	* Timers are not clocked. Each one keeps the
+	* timestamp and counter value of its last rebase,
+	* the current value and the number of overflows
+	* since then are computed when needed, count up
+	* timers in closed form from the overflows of the
+	* previous one. Only timers that raise an IRQ or
+	* feed a FIFO have an overflow event
+	*/
 	class TimerChain {
 	public :
 		TimerChain();
@@ -22,8 +31,18 @@ namespace GBA::timers {
 		void SetEventScheduler(memory::EventScheduler* ev_sched);
 		void SetAPU(apu::APU* apu);
 
+		/*
+		* Store the current counter values in
+		* the registers, called before reading them
+		*/
 		void Update();
 
+		/*
+		* Reschedule the overflow events, called
+		* when the FIFO timer selection changes
+		*/
+		void UpdateEvents();
+
 		static constexpr common::u32 TIMER_REG_BASE = 0x100;
 		static constexpr common::u32 CPU_FREQ = 16'780'000;
 
@@ -36,8 +55,8 @@ namespace GBA::timers {
 			ar(m_registers);
 			ar(m_timer_reload_val);
 			ar(m_timer_internal_counter);
-			ar(m_last_read_timestamp);
-			ar(m_last_event_timestamp);
+			ar(m_start_timestamp);
+			ar(m_event_timestamp);
 		}
 
 		template <typename Ar>
@@ -45,8 +64,8 @@ namespace GBA::timers {
 			ar(m_registers);
 			ar(m_timer_reload_val);
 			ar(m_timer_internal_counter);
-			ar(m_last_read_timestamp);
-			ar(m_last_event_timestamp);
+			ar(m_start_timestamp);
+			ar(m_event_timestamp);
 		}
 
 	private :
@@ -56,18 +75,33 @@ namespace GBA::timers {
 		common::u8 m_registers[0x10];
 
 		common::u16 m_timer_reload_val[4];
+		//Unused, kept for the savestate layout
 		common::u32 m_timer_internal_counter[4];
 
 		apu::APU* m_apu;
 
-		uint64_t m_last_read_timestamp[4];
-		uint64_t m_last_event_timestamp[4];
+		//When the counter had the value in m_registers
+		uint64_t m_start_timestamp[4];
+		uint64_t m_event_timestamp[4];
+
+		bool IsEnabled(common::u8 timer_id) const;
+		bool IsCountUp(common::u8 timer_id) const;
+
+		uint64_t GetTicks(common::u8 timer_id, uint64_t timestamp) const;
+		uint64_t GetOverflows(common::u8 timer_id, uint64_t timestamp) const;
+		common::u16 GetValue(common::u8 timer_id, uint64_t timestamp) const;
+
+		//Timestamp of the count-th overflow since the last rebase
+		uint64_t GetOverflowTimestamp(common::u8 timer_id, uint64_t count) const;
+
+		void ScheduleEvent(common::u8 timer_id, uint64_t timestamp);
 
+		void WriteReload(common::u8 timer_id, common::u8 value, common::u16 offset);
 		void RecalculateEvents(common::u8 timer_id, common::u8 new_cnt);
 
 		template <common::u8 Id>
-		friend void TimerIncremented(void* _timers);
+		friend void TimerOverflowed(void* _timers);
 
-		void TimerOverfow(common::u8 timer_id);
+		void TimerOverflow(common::u8 timer_id);
 	};
 }
\ No newline at end of file
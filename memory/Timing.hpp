@@ -30,6 +30,8 @@ namespace GBA::memory {
 
 	class TimeManager {
 	public :
+		static constexpr u8 NUM_TIMING_REGIONS = 16;
+
 		Access access;
 
 		TimeManager();
@@ -46,92 +48,32 @@ namespace GBA::memory {
 		
 		template <MEMORY_RANGE range, unsigned Size>
 		u32 PushCycles() {
-			constexpr u32 multiplier = []() {
-				static_assert(Size == 1 || 
-					Size == 2 || Size == 4);
-
-				if constexpr (Size == 1 || Size == 2)
-					return 1;
-				else
-					return 2;
-			}();
-
-			u32 original_value = m_curr_cycles;
-
-			if constexpr (range == MEMORY_RANGE::EWRAM)
-				m_curr_cycles += 3 * multiplier;
-			else if constexpr (range == MEMORY_RANGE::SRAM)
-				m_curr_cycles += m_wait_config.sram * multiplier + 1;
-			else if constexpr (range == MEMORY_RANGE::ROM_REG_1) {
-				if constexpr (multiplier == 1)
-					m_curr_cycles += m_wait_config.rom0[(u8)access] + 1;
-				else
-					m_curr_cycles += m_wait_config.rom0[(u8)access]
-					+ m_wait_config.rom0[1] + 2;
-			}
-			else if constexpr (range == MEMORY_RANGE::ROM_REG_2) {
-				if constexpr (multiplier == 1)
-					m_curr_cycles += m_wait_config.rom1[(u8)access] + 1;
-				else
-					m_curr_cycles += m_wait_config.rom1[(u8)access]
-					+ m_wait_config.rom1[1] + 2;
-			}
-			else if constexpr (range == MEMORY_RANGE::ROM_REG_3) {
-				if constexpr (multiplier == 1)
-					m_curr_cycles += m_wait_config.rom2[(u8)access] + 1;
-				else
-					m_curr_cycles += m_wait_config.rom2[(u8)access]
-					+ m_wait_config.rom2[1] + 2;
-			}
-			else
-				m_curr_cycles += 1;
-
-			return m_curr_cycles - original_value;
+			return PushCycles<range, Size>(access);
 		}
 
 		template <MEMORY_RANGE range, unsigned Size>
 		u32 PushCycles(Access acc) {
-			constexpr u32 multiplier = []() {
-				static_assert(Size == 1 ||
-					Size == 2 || Size == 4);
-
-				if constexpr (Size == 1 || Size == 2)
-					return 1;
-				else
-					return 2;
-			}();
-
-			u32 original_value = m_curr_cycles;
-
-			if constexpr (range == MEMORY_RANGE::EWRAM)
-				m_curr_cycles += 3 * multiplier;
-			else if constexpr (range == MEMORY_RANGE::SRAM)
-				m_curr_cycles += m_wait_config.sram * multiplier + 1;
-			else if constexpr (range == MEMORY_RANGE::ROM_REG_1) {
-				if constexpr (multiplier == 1)
-					m_curr_cycles += m_wait_config.rom0[(u8)acc] + 1;
-				else
-					m_curr_cycles += m_wait_config.rom0[(u8)acc]
-					+ m_wait_config.rom0[1] + 2;
-			}
-			else if constexpr (range == MEMORY_RANGE::ROM_REG_2) {
-				if constexpr (multiplier == 1)
-					m_curr_cycles += m_wait_config.rom1[(u8)acc] + 1;
-				else
-					m_curr_cycles += m_wait_config.rom1[(u8)acc]
-					+ m_wait_config.rom1[1] + 2;
-			}
-			else if constexpr (range == MEMORY_RANGE::ROM_REG_3) {
-				if constexpr (multiplier == 1)
-					m_curr_cycles += m_wait_config.rom2[(u8)acc] + 1;
-				else
-					m_curr_cycles += m_wait_config.rom2[(u8)acc]
-					+ m_wait_config.rom2[1] + 2;
-			}
-			else
-				m_curr_cycles += 1;
+			u32 cycles = m_access_cycles[(u8)range][SizeIndex<Size>()][(u8)acc];
+			m_curr_cycles += cycles;
+			return cycles;
+		}
 
-			return m_curr_cycles - original_value;
+		template <unsigned Size>
+		u32 PushCycles(MEMORY_RANGE range, Access acc) {
+			u32 cycles = GetAccessCycles<Size>(range, acc);
+			m_curr_cycles += cycles;
+			return cycles;
+		}
+
+		/*
+		* Same as PushCycles, without
+		* touching the cycle counter
+		*/
+		template <unsigned Size>
+		u32 GetAccessCycles(MEMORY_RANGE range, Access acc) const {
+			//Everything past SRAM is unused
+			u8 region = (u8)range < NUM_TIMING_REGIONS ? (u8)range : NUM_TIMING_REGIONS - 1;
+			return m_access_cycles[region][SizeIndex<Size>()][(u8)acc];
 		}
 
 		void PushInternalCycles(u32 count) {
@@ -198,12 +140,24 @@ namespace GBA::memory {
 			ar(m_wait_config.rom0);
 			ar(m_wait_config.rom1);
 			ar(m_wait_config.rom2);
+
+			BuildAccessCycles();
 		}
 
 	public :
 		u32 m_config_raw;
 
 	private :
+		template <unsigned Size>
+		static constexpr u32 SizeIndex() {
+			static_assert(Size == 1 ||
+				Size == 2 || Size == 4);
+
+			return Size == 4 ? 2 : Size - 1;
+		}
+
+		void BuildAccessCycles();
+
 		u32 m_curr_cycles;
 
 		struct {
@@ -213,5 +167,9 @@ namespace GBA::memory {
 			u32 rom1[2];
 			u32 rom2[2];
 		} m_wait_config;
+
+		//Total cost of an access, [region][1, 2, 4 bytes][NonSeq, Seq],
+		//rebuilt from m_wait_config on every WAITCNT write
+		u8 m_access_cycles[NUM_TIMING_REGIONS][3][2];
 	};
 }
\ No newline at end of file
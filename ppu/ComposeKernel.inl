@@ -0,0 +1,166 @@
+//Included once per instruction set by Compositor.cpp,
+//no include guard on purpose
+
+/*
+* Same result as ComposePixel, a vector at a time. The second
+* target of a pixel only changes along the line when blending
+* drops a layer still in the mask, those vectors run ComposePixel
+* one pixel at a time instead
+*/
+TARGET(KERNEL_ISA) static void Compose(Layers const& layers, u16* colors) {
+	Vec const hidden = Set(HIDDEN);
+	Vec const zero = Set(0);
+	Vec const channel = Set(0x1F);
+
+	Vec const first_target = Set(layers.first_target);
+	Vec const backdrop = Set(layers.backdrop);
+	Vec const effects_bit = Set(1 << 5);
+
+	u16 second_mask = layers.second_target;
+
+	for (u32 x = 0; x < LINE_SIZE; x += WIDTH) {
+		Vec window_mask = LoadMasks(layers.window_masks + x);
+
+		Vec keys[5];
+		Vec pixel_colors[5];
+		Vec semi_transparent[5];
+
+		for (u32 layer = 0; layer < 4; layer++) {
+			if (layers.keys[layer] == HIDDEN) {
+				keys[layer] = hidden;
+				pixel_colors[layer] = zero;
+				semi_transparent[layer] = zero;
+				continue;
+			}
+
+			Planes pixels = LoadPixels(layers.backgrounds[layer] + x);
+
+			Vec not_drawn = Or(
+				Equal(pixels.palette, zero),
+				Equal(And(window_mask, Set(1 << layer)), zero)
+			);
+
+			keys[layer] = Select(Set(layers.keys[layer]), hidden, not_drawn);
+			pixel_colors[layer] = pixels.color;
+			semi_transparent[layer] = ShiftRight(pixels.flags, 8);
+		}
+
+		{
+			Planes pixels = LoadPixels(layers.sprites + x);
+
+			Vec not_drawn = Or(
+				Or(Equal(And(pixels.flags, Set(0xFF)), zero), Equal(pixels.palette, zero)),
+				Equal(And(window_mask, Set(1 << 4)), zero)
+			);
+
+			keys[4] = Select(ShiftLeft(And(pixels.priority, Set(0xFF)), 3), hidden, not_drawn);
+			pixel_colors[4] = pixels.color;
+			semi_transparent[4] = ShiftRight(pixels.flags, 8);
+		}
+
+		Vec top = hidden;
+
+		for (u32 layer = 0; layer < 5; layer++)
+			top = Min(top, keys[layer]);
+
+		//Keys of drawn layers are all different
+		Vec is_backdrop = Equal(top, hidden);
+
+		Vec color = backdrop;
+		Vec top_bit = effects_bit;
+		Vec top_semi = zero;
+
+		for (u32 layer = 0; layer < 5; layer++) {
+			Vec on_top = AndNot(Equal(keys[layer], top), is_backdrop);
+
+			color = Select(color, pixel_colors[layer], on_top);
+			top_bit = Select(top_bit, Set(1 << layer), on_top);
+			top_semi = Select(top_semi, semi_transparent[layer], on_top);
+		}
+
+		Vec semi = AndNot(hidden, Equal(top_semi, zero));
+		Vec enters = Or(
+			AndNot(hidden, Or(
+				Equal(And(window_mask, effects_bit), zero),
+				Equal(And(top_bit, first_target), zero)
+			)),
+			semi
+		);
+
+		if (IsZero(enters)) {
+			Store(colors + x, color);
+			continue;
+		}
+
+		Vec blending = layers.effect == 1 ? enters : semi;
+
+		if (OrLanes(And(blending, top_bit)) & second_mask) {
+			for (u32 offset = 0; offset < WIDTH; offset++)
+				colors[x + offset] = ComposePixel(layers, x + offset, second_mask);
+
+			continue;
+		}
+
+		//The top layer is not a second target
+		//in any of the blending pixels here
+		Vec second = hidden;
+
+		for (u32 layer = 0; layer < 5; layer++) {
+			if (CHECK_BIT(second_mask, layer))
+				second = Min(second, keys[layer]);
+		}
+
+		Vec has_second = AndNot(hidden, Equal(second, hidden));
+		Vec lower = backdrop;
+
+		for (u32 layer = 0; layer < 5; layer++) {
+			if (CHECK_BIT(second_mask, layer))
+				lower = Select(lower, pixel_colors[layer], And(Equal(keys[layer], second), has_second));
+		}
+
+		Vec can_blend = CHECK_BIT(second_mask, 5) ? hidden : has_second;
+		Vec blend = AndNot(And(blending, can_blend), is_backdrop);
+		Vec brightness = layers.effect >= 2 ? AndNot(enters, blend) : zero;
+
+		Vec result = color;
+
+		if (!IsZero(blend)) {
+			Vec eva = Set(layers.eva);
+			Vec evb = Set(layers.evb);
+			Vec blended = zero;
+
+			for (int shift = 0; shift < 15; shift += 5) {
+				Vec first = And(ShiftRight(color, shift), channel);
+				Vec below = And(ShiftRight(lower, shift), channel);
+
+				//I = MIN ( 31, I1st*EVA + I2nd*EVB )
+				Vec value = Add(Add(Mul(first, eva), Mul(below, evb)), Set(8));
+				value = Min(ShiftRight(value, 4), channel);
+
+				blended = Or(blended, ShiftLeft(value, shift));
+			}
+
+			result = Select(result, blended, blend);
+		}
+
+		if (!IsZero(brightness)) {
+			Vec evy = Set(layers.evy);
+			Vec adjusted = zero;
+
+			for (int shift = 0; shift < 15; shift += 5) {
+				Vec value = And(ShiftRight(color, shift), channel);
+
+				if (layers.effect == 2)
+					value = Add(value, ShiftRight(Add(Mul(Sub(channel, value), evy), Set(8)), 4));
+				else
+					value = Sub(value, ShiftRight(Add(Mul(value, evy), Set(7)), 4));
+
+				adjusted = Or(adjusted, ShiftLeft(value, shift));
+			}
+
+			result = Select(result, adjusted, brightness);
+		}
+
+		Store(colors + x, result);
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "../common/Defs.hpp"
+
+#include <vector>
+
+namespace GBA::ppu {
+	struct Pixel;
+}
+
+namespace GBA::ppu::compositor {
+	static constexpr common::u32 LINE_SIZE = 240;
+
+	//Key of a layer not drawn on a pixel
+	static constexpr common::u16 HIDDEN = 0xFFFF;
+
+	/*
+	* One scanline of BG0-3 and OBJ. The drawn layer
+	* with the smallest key is on top: BG keys are
+	* priority << 3 | (place among sorted BGs + 1),
+	* OBJ keys priority << 3 so that OBJ wins ties
+	*/
+	struct Layers {
+		Pixel const* backgrounds[4];
+		Pixel const* sprites;
+
+		//Per pixel, layers (bits 0-4) and
+		//effects (bit 5) let through by windows
+		common::u8 const* window_masks;
+
+		//HIDDEN when the BG is off
+		common::u16 keys[4];
+
+		common::u16 first_target;
+		common::u16 second_target;
+		common::u16 effect;
+		common::u16 backdrop;
+
+		common::u16 eva;
+		common::u16 evb;
+		common::u16 evy;
+	};
+
+	/*
+	* Resolve priorities, windows and color
+	* effects of a scanline into RGB555 colors
+	*/
+	using Compose = void(*)(Layers const& layers, common::u16* colors);
+
+	//AVX2, SSE4.1 or plain C++, picked on first use
+	Compose GetComposer();
+
+	//Plain C++ first, then every kernel the host runs
+	std::vector<Compose> GetSupportedComposers();
+}
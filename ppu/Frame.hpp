@@ -0,0 +1,37 @@
+#pragma once
+
+#include "../common/Defs.hpp"
+
+namespace GBA::ppu {
+	/*
+	* RGB555 keeps the GBA layout (red in the low bits,
+	* bit 15 clear), RGBA8888 is R, G, B, A in memory
+	*/
+	enum class FrameFormat : common::u8 {
+		RGB555,
+		RGBA8888
+	};
+
+	/*
+	* LCD approximates the colors of the GBA
+	* screen, None outputs the raw values
+	*/
+	enum class ColorCorrection : common::u8 {
+		None,
+		LCD
+	};
+
+	constexpr common::u32 GetPixelSize(FrameFormat format) {
+		return format == FrameFormat::RGB555 ? 2 : 4;
+	}
+
+	/*
+	* 240x160 frame produced by the PPU,
+	* stride is the distance between lines in bytes
+	*/
+	struct Frame {
+		common::u8 const* data;
+		FrameFormat format;
+		common::u32 stride;
+	};
+}
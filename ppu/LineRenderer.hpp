@@ -0,0 +1,80 @@
+#pragma once
+
+#include "PPU.hpp"
+#include "TileCache.hpp"
+
+#include <array>
+
+namespace GBA::ppu {
+	/*
+	* Registers and memory a line is drawn
+	* from, as they were at its HBLANK
+	*/
+	struct LineSnapshot {
+		PPUContext registers;
+
+		common::u32 reference_x[2];
+		common::u32 reference_y[2];
+
+		common::u8 const* palette_ram;
+		common::u8 const* vram;
+		common::u32 const* vram_writes;
+		common::u8 const* oam;
+	};
+
+	/*
+	* Draws lines into the frame of the PPU. Line
+	* data is kept here, so one renderer per thread
+	* can draw different lines at the same time
+	*/
+	class LineRenderer {
+	public :
+		LineRenderer(PPU& ppu);
+
+		void Render(LineSnapshot const& line);
+
+	private :
+		common::u32 ReadRegister32(common::u8 offset) const;
+		common::u16 ReadRegister16(common::u8 offset) const;
+
+		void Mode0();
+		void Mode1();
+		void Mode2();
+		void Mode3();
+		void Mode4();
+		void Mode5();
+
+		void DrawSprites(int lcd_y);
+
+		void OutputLine(unsigned y, std::array<Pixel, 240> const& pixels);
+		void OutputLine(unsigned y, std::array<common::u16, 240> const& colors);
+		void OutputBlankLine(unsigned y);
+
+#include "ModeUtils.inl"
+
+		PPU& m_ppu;
+
+		PPUContext m_ctx;
+
+		common::u32 m_internal_reference_x[2];
+		common::u32 m_internal_reference_y[2];
+
+		common::u8 const* m_palette_ram;
+		common::u8 const* m_vram;
+		common::u8 const* m_oam;
+
+		TileCache m_tile_cache;
+
+		common::u16 line_sprites_ids[128];
+		common::u8 line_sprites_count;
+
+		std::array<Pixel, 240> m_line_data[5];
+		std::array<bool, 240> m_obj_window_pixels;
+		std::array<std::array<Pixel, 240>, 5> m_backgrounds;
+
+		static constexpr common::u32 PALETTE_SIZE = 512;
+
+		static constexpr common::u32 BG_PALETTE_START = 0x0;
+		static constexpr common::u32 OBJ_PALETTE_START = 0x200;
+	};
+}
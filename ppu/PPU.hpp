@@ -4,7 +4,11 @@
 #include "../common/BitManip.hpp"
 #include "../common/Defs.hpp"
 
+#include "Frame.hpp"
+#include "TileCache.hpp"
+
 #include <array>
+#include <memory>
 #include <vector>
 
 namespace GBA::memory {
@@ -47,6 +51,34 @@ namespace GBA::ppu {
 		HBLANK
 	};
 
+#pragma pack(push, 1)
+	union PPUContext {
+		struct {
+			common::u16 m_control;
+			common::u16 m_green_swap;
+			common::u16 m_status;
+			common::u16 m_vcount;
+			common::u16 m_bg0_cnt;
+			common::u16 m_bg1_cnt;
+			common::u16 m_bg2_cnt;
+			common::u16 m_bg3_cnt;
+		};
+		
+		common::u8 array[0x58];
+	};
+#pragma pack(pop)
+
+	//Video memory written since the previous line
+	namespace memory_changes {
+		static constexpr common::u8 PALETTE = 1;
+		static constexpr common::u8 VRAM = 2;
+		static constexpr common::u8 OAM = 4;
+		static constexpr common::u8 ALL = PALETTE | VRAM | OAM;
+	}
+
+	class LineRenderer;
+	class RenderPool;
+
 	class PPU {
 	public :
 		PPU();
@@ -62,13 +94,6 @@ namespace GBA::ppu {
 
 		void ClockCycles(common::u32 num_cycles);
 
-		void Mode0();
-		void Mode1();
-		void Mode2();
-		void Mode3();
-		void Mode4();
-		void Mode5();
-
 		void VBlank();
 		void HBlank();
 		void Normal();
@@ -98,6 +123,8 @@ namespace GBA::ppu {
 			else {
 				reinterpret_cast<Type*>(m_palette_ram)[address] = value;
 			}
+
+			m_memory_changes |= memory_changes::PALETTE;
 		}
 
 		template <typename Type>
@@ -120,13 +147,33 @@ namespace GBA::ppu {
 					address &= ~1;
 					common::u16 new_val = value * 0x101;
 					*reinterpret_cast<common::u16*>(m_vram + address) = new_val;
+					InvalidateVRAM(address, 2);
 				}
 			}
 			else {
 				reinterpret_cast<Type*>(m_vram)[address] = value;
+				InvalidateVRAM(address * sizeof(Type), sizeof(Type));
 			}
 		}
 
+		/*
+		* For writes to VRAM that do not go
+		* through WriteVRAM (offset in bytes)
+		*/
+		void InvalidateVRAM(common::u32 offset, common::u32 size) {
+			m_vram_writes.Invalidate(offset, size);
+			m_memory_changes |= memory_changes::VRAM;
+		}
+
+		//Same, for palette and OAM writes
+		void InvalidatePalette() {
+			m_memory_changes |= memory_changes::PALETTE;
+		}
+
+		void InvalidateOAM() {
+			m_memory_changes |= memory_changes::OAM;
+		}
+
 		template <typename Type>
 		Type ReadOAM(common::u32 address) {
 			address /= sizeof(Type);
@@ -140,6 +187,7 @@ namespace GBA::ppu {
 
 			if constexpr (sizeof(Type) != 1) {
 				reinterpret_cast<Type*>(m_oam)[address] = value;
+				m_memory_changes |= memory_changes::OAM;
 			}
 			
 			//Else ignore writes
@@ -149,11 +197,34 @@ namespace GBA::ppu {
 			return m_frame_ok;
 		}
 
-		float* GetFrame() {
+		Frame GetFrame() {
+			WaitForLines();
+
 			m_frame_ok = false;
-			return m_framebuffer;
+			return Frame{ m_framebuffer, m_frame_format, m_frame_stride };
 		}
 
+		/*
+		* Select how lines are written from now on, a
+		* stride of 0 (or too small) packs the lines.
+		* The current frame is converted
+		*/
+		void SetFrameFormat(FrameFormat format, common::u32 stride = 0);
+
+		/*
+		* Colors go through one lookup table from
+		* RGB555 to the frame format, correction
+		* is folded in. The current frame is converted
+		*/
+		void SetColorCorrection(ColorCorrection correction);
+
+		/*
+		* Draw lines on this many worker threads
+		* while the emulation goes on, 0 draws
+		* them at HBLANK on the calling thread
+		*/
+		void SetRenderThreads(unsigned num_threads);
+
 		void SetInterruptController(memory::InterruptController* int_controller);
 		void SetScheduler(memory::EventScheduler* sched);
 
@@ -164,29 +235,48 @@ namespace GBA::ppu {
 		friend void VblankHblankCallback(void* ppu_ptr);
 		friend void VblankEndCallback(void* ppu_ptr);
 
+		friend class LineRenderer;
+
 		~PPU();
 
 		common::u8* DebuggerGetPalette();
 		common::u8* DebuggerGetVRAM();
 
+		/*
+		* Backing memory, mapped by the bus
+		* for plain halfword and word accesses
+		*/
+		common::u8* GetPaletteMemory() {
+			return m_palette_ram;
+		}
+
+		common::u8* GetVRAMMemory() {
+			return m_vram;
+		}
+
+		common::u8* GetOAMMemory() {
+			return m_oam;
+		}
+
 		template <typename Ar>
 		void save(Ar& ar) const {
 			using namespace common;
+
+			WaitForLines();
 			
 			std::vector<u8> palette_temp{};
 			std::vector<u8> vram_temp{};
 			std::vector<u8> oam_temp{};
-			std::vector<float> framebuf_temp{};
+			std::vector<u16> framebuf_temp{};
 
 			palette_temp.resize(0x400);
 			vram_temp.resize(0x18000);
 			oam_temp.resize(0x400);
-			framebuf_temp.resize(size_t(240) * 160 * 3);
 
 			std::copy_n(m_palette_ram, 0x400, palette_temp.begin());
 			std::copy_n(m_vram, 0x18000, vram_temp.begin());
 			std::copy_n(m_oam, 0x400, oam_temp.begin());
-			std::copy_n(m_framebuffer, framebuf_temp.size(), framebuf_temp.begin());
+			StoreFrame(framebuf_temp);
 
 			ar(m_ctx.array);
 			ar(m_mode_cycles);
@@ -203,11 +293,6 @@ namespace GBA::ppu {
 			ar(m_frame_ok);
 
 			ar(m_last_event_timestamp);
-
-			ar(line_sprites_ids);
-			ar(line_sprites_count);
-			ar(m_line_data);
-			ar(m_obj_window_pixels);
 		}
 
 		template <typename Ar>
@@ -217,12 +302,13 @@ namespace GBA::ppu {
 			std::vector<u8> palette_temp{};
 			std::vector<u8> vram_temp{};
 			std::vector<u8> oam_temp{};
-			std::vector<float> framebuf_temp{};
+			std::vector<u16> framebuf_temp{};
 
 			palette_temp.resize(0x400);
 			vram_temp.resize(0x18000);
 			oam_temp.resize(0x400);
-			framebuf_temp.resize(size_t(240) * 160 * 3);
+
+			WaitForLines();
 
 			ar(m_ctx.array);
 			ar(m_mode_cycles);
@@ -240,15 +326,13 @@ namespace GBA::ppu {
 
 			ar(m_last_event_timestamp);
 
-			ar(line_sprites_ids);
-			ar(line_sprites_count);
-			ar(m_line_data);
-			ar(m_obj_window_pixels);
-
 			std::copy_n(palette_temp.begin(), 0x400, m_palette_ram);
 			std::copy_n(vram_temp.begin(), 0x18000, m_vram);
 			std::copy_n(oam_temp.begin(), 0x400, m_oam);
-			std::copy_n(framebuf_temp.begin(), framebuf_temp.size(), m_framebuffer);
+			RestoreFrame(framebuf_temp);
+
+			m_vram_writes.InvalidateAll();
+			m_memory_changes = memory_changes::ALL;
 		}
 
 	private:
@@ -256,28 +340,34 @@ namespace GBA::ppu {
 
 		void ResetFrameData();
 
-		void DrawSprites(int lcd_y);
+		//Lines still drawn by workers are done on return
+		void WaitForLines() const;
+
+		/*
+		* Write 240 RGB555 colors as line y of
+		* the frame, in the selected format
+		*/
+		void OutputLine(unsigned y, std::array<Pixel, 240> const& pixels);
+		void OutputLine(unsigned y, std::array<common::u16, 240> const& colors);
+		void OutputBlankLine(unsigned y);
+
+		//Savestates keep the frame as RGB555
+		void StoreFrame(std::vector<common::u16>& frame) const;
+		void RestoreFrame(std::vector<common::u16> const& frame);
+
+		//Uncorrected RGB555 lines are written as
+		//they are, without lookup or a second copy
+		bool IsDirectOutput() const {
+			return m_frame_format == FrameFormat::RGB555 &&
+				m_color_correction == ColorCorrection::None;
+		}
+
+		void BuildColorLut();
 
-#include "ModeUtils.inl"
+		//Step the affine references as drawing the line does
+		void AdvanceReferences();
 
 	private :
-#pragma pack(push, 1)
-		union PPUContext {
-			struct {
-				common::u16 m_control;
-				common::u16 m_green_swap;
-				common::u16 m_status;
-				common::u16 m_vcount;
-				common::u16 m_bg0_cnt;
-				common::u16 m_bg1_cnt;
-				common::u16 m_bg2_cnt;
-				common::u16 m_bg3_cnt;
-			};
-			
-			common::u8 array[0x58];
-		};
-#pragma pack(pop)
-		
 		PPUContext m_ctx;
 
 		common::u32 m_mode_cycles;
@@ -288,7 +378,20 @@ namespace GBA::ppu {
 		common::u8* m_vram;
 		common::u8* m_oam;
 
-		float* m_framebuffer;
+		TileWrites m_vram_writes;
+		common::u8 m_memory_changes;
+
+		common::u8* m_framebuffer;
+		FrameFormat m_frame_format;
+		common::u32 m_frame_stride;
+		ColorCorrection m_color_correction;
+
+		//RGB555 to frame format
+		std::vector<common::u32> m_color_lut;
+
+		//Frame before the lookup, RGB555,
+		//not kept up to date with direct output
+		std::vector<common::u16> m_frame_colors;
 
 		common::u32 m_internal_reference_x[2];
 		common::u32 m_internal_reference_y[2];
@@ -302,11 +405,8 @@ namespace GBA::ppu {
 
 		memory::Bus* m_bus;
 
-		common::u16 line_sprites_ids[128];
-		common::u8 line_sprites_count;
-
-		std::array<Pixel, 240> m_line_data[5];
-		std::array<bool, 240> m_obj_window_pixels;
+		std::unique_ptr<LineRenderer> m_renderer;
+		std::unique_ptr<RenderPool> m_render_pool;
 
 		static constexpr common::u32 CYCLES_PER_PIXEL = 4;
 		static constexpr common::u32 CYCLES_PER_SCANLINE = 960;
@@ -317,10 +417,5 @@ namespace GBA::ppu {
 
 		static constexpr common::u32 VISIBLE_LINES = 160;
 		static constexpr common::u32 TOTAL_LINES = 228;
-
-		static constexpr common::u32 PALETTE_SIZE = 512;
-
-		static constexpr common::u32 BG_PALETTE_START = 0x0;
-		static constexpr common::u32 OBJ_PALETTE_START = 0x200;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "LineRenderer.hpp"
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace GBA::ppu {
+	/*
+	* Draws lines on worker threads while the
+	* emulation goes on. Every line reads its
+	* own copy of video memory, taken only
+	* when written since the previous line
+	*/
+	class RenderPool {
+	public :
+		RenderPool(PPU& ppu, unsigned num_threads);
+		~RenderPool();
+
+		/*
+		* Queue a line taken from live memory,
+		* changes as in memory_changes
+		*/
+		void Submit(LineSnapshot line, common::u8 changes);
+
+		//Returns once every queued line is drawn
+		void Wait();
+
+	private :
+		struct VramCopy {
+			std::vector<common::u8> data;
+			std::vector<common::u32> writes;
+		};
+
+		using MemoryCopy = std::array<common::u8, 0x400>;
+
+		//Copies stay in use until Wait()
+		template <typename Copy>
+		struct Copies {
+			std::deque<Copy> items;
+			std::size_t used = 0;
+
+			Copy& Next() {
+				if (used == items.size())
+					items.emplace_back();
+
+				return items[used++];
+			}
+		};
+
+		void Work(LineRenderer& renderer);
+
+		common::u8 const* CopyMemory(Copies<MemoryCopy>& copies, common::u8 const* memory);
+		VramCopy const& CopyVRAM(common::u8 const* vram, common::u32 const* writes);
+
+		std::vector<std::unique_ptr<LineRenderer>> m_renderers;
+		std::vector<std::thread> m_threads;
+
+		std::mutex m_mutex;
+		std::condition_variable m_work;
+		std::condition_variable m_finished;
+		bool m_stop;
+
+		//Lines since the last Wait(), the
+		//next one to draw and the drawn ones
+		std::array<LineSnapshot, 228> m_lines;
+		common::u32 m_queued;
+		common::u32 m_next;
+		common::u32 m_done;
+
+		Copies<MemoryCopy> m_palettes;
+		Copies<MemoryCopy> m_oams;
+		Copies<VramCopy> m_vrams;
+
+		common::u8 const* m_palette;
+		common::u8 const* m_oam;
+		VramCopy const* m_vram;
+	};
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "../common/Defs.hpp"
+
+#include <vector>
+
+namespace GBA::ppu {
+	namespace tiles {
+		static constexpr common::u32 VRAM_SIZE = 0x18000;
+		static constexpr common::u32 SLOT_SIZE = 0x20;
+		static constexpr common::u32 SLOT_COUNT = VRAM_SIZE / SLOT_SIZE;
+	}
+
+	/*
+	* Write count of every 32 bytes of VRAM,
+	* caches decode a tile again once the
+	* count they saw no longer matches
+	*/
+	class TileWrites {
+	public :
+		TileWrites();
+
+		void Invalidate(common::u32 offset, common::u32 size) {
+			common::u32 first = offset / tiles::SLOT_SIZE;
+			common::u32 last = (offset + size - 1) / tiles::SLOT_SIZE;
+
+			for (common::u32 slot = first; slot <= last && slot < tiles::SLOT_COUNT; slot++)
+				m_counts[slot]++;
+		}
+
+		void InvalidateAll();
+
+		common::u32 const* GetCounts() const {
+			return m_counts.data();
+		}
+
+	private :
+		std::vector<common::u32> m_counts;
+	};
+
+	/*
+	* VRAM tile rows expanded to one palette index
+	* per byte, as stored and mirrored. Tiles are
+	* kept per 32 bytes of VRAM and decoded again
+	* on use after a write to them
+	*/
+	class TileCache {
+	public :
+		TileCache();
+
+		//VRAM read from now on, writes
+		//counted per tile as TileWrites
+		void Attach(common::u8 const* vram, common::u32 const* writes) {
+			m_vram = vram;
+			m_writes = writes;
+		}
+
+		//4bpp row starting at address, 8 indices
+		common::u8 const* GetRow4(common::u32 address, bool hflip) {
+			if (address >= tiles::VRAM_SIZE)
+				return EMPTY_ROW;
+
+			return GetSlot(address / tiles::SLOT_SIZE).rows4[hflip][(address % tiles::SLOT_SIZE) / 4];
+		}
+
+		//8bpp row starting at address, already
+		//one index per byte unless mirrored
+		common::u8 const* GetRow8(common::u32 address, bool hflip) {
+			if (address >= tiles::VRAM_SIZE)
+				return EMPTY_ROW;
+
+			if (!hflip)
+				return m_vram + address;
+
+			return GetSlot(address / tiles::SLOT_SIZE).mirrored_rows8[(address % tiles::SLOT_SIZE) / 8];
+		}
+
+	private :
+		static constexpr common::u8 EMPTY_ROW[8] = {};
+
+		struct Slot {
+			//As stored, mirrored
+			common::u8 rows4[2][8][8];
+			common::u8 mirrored_rows8[4][8];
+		};
+
+		Slot const& GetSlot(common::u32 index) {
+			if (m_decoded[index] != m_writes[index]) [[unlikely]]
+				Decode(index);
+
+			return m_slots[index];
+		}
+
+		void Decode(common::u32 index);
+
+		common::u8 const* m_vram;
+		common::u32 const* m_writes;
+
+		std::vector<Slot> m_slots;
+
+		//Write count each slot was decoded at
+		std::vector<common::u32> m_decoded;
+	};
+}
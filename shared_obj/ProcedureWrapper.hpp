@@ -1,9 +1,16 @@
 #pragma once
 
 #include <typeinfo>
+#include <utility>
 #include <vector>
 #include <any>
 
+//Calling conventions only matter on Windows
+#if !defined(WIN32) && !defined(__WIN32__) && !defined(_WIN32)
+	#define __stdcall
+	#define __cdecl
+#endif
+
 namespace GBA::shared_object {
 	enum class CallConvetion {
 		STCALL,
@@ -47,7 +54,7 @@ namespace GBA::shared_object {
 		struct templated_wrapper<ReturnType(*)(Args...), convetion> {
 			static constexpr ReturnType call(void* fptr, std::vector<std::any> args) {
 				return 
-					templated_wrapper_impl<ReturnType(*)(Args...), CallConvetion::STCALL,
+					templated_wrapper_impl<ReturnType(*)(Args...), convetion,
 					ReturnType, Args...>::template call(fptr, args, std::make_index_sequence<sizeof...(Args)>{});
 			}
 		};
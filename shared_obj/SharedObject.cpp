@@ -3,6 +3,8 @@
 #if defined(WIN32) || defined(__WIN32__) || defined(_WIN32)
 	#include <intrin.h>
 	#include <Windows.h>
+#else
+	#include <dlfcn.h>
 #endif
 
 namespace GBA::shared_object {
@@ -14,6 +16,8 @@ namespace GBA::shared_object {
 	bool SharedObject::Load(std::string_view location) {
 #ifdef WINDOWS_DLL
 		m_handle = (ObjectHandle)LoadLibraryA(location.data());
+#else
+		m_handle = (ObjectHandle)dlopen(std::string(location).c_str(), RTLD_NOW | RTLD_LOCAL);
 #endif 
 		
 		m_module_name = location;
@@ -22,18 +26,30 @@ namespace GBA::shared_object {
 	}
 
 	bool SharedObject::Unload() {
+		if (m_handle == nullptr)
+			return true;
+
 #ifdef WINDOWS_DLL
 		FreeLibrary((HMODULE)m_handle);
+#else
+		dlclose(m_handle);
 #endif 
 
+		m_handle = nullptr;
+
 		return true;
 	}
 
 	Procedure SharedObject::GetProcAddress(std::string_view name) {
 		Procedure procedure{nullptr};
 
+		if (m_handle == nullptr)
+			return procedure;
+
 #ifdef WINDOWS_DLL
 		procedure = ::GetProcAddress((HMODULE)m_handle, name.data());
+#else
+		procedure = dlsym(m_handle, std::string(name).c_str());
 #endif // WINDOWS_DLL
 
 		return procedure;
@@ -5,6 +5,7 @@
 
 #include "../../memory/DirectMemoryAccess.hpp"
 #include "../../memory/EventScheduler.hpp"
+#include "../../memory/Timers.hpp"
 
 #include "../../common/Error.hpp"
 #include "../../common/Logger.hpp"
@@ -26,6 +27,7 @@ namespace GBA::apu {
 
 	APU::APU() :
 		m_dma1{nullptr}, m_dma2{nullptr},
+		m_timers{nullptr},
 		m_buffer_callback{},
 		m_curr_samples{}, m_req_samples{}, 
 		m_internal_A_buffer{}, m_internal_B_buffer{},
@@ -51,6 +53,10 @@ namespace GBA::apu {
 		m_dma2 = _2;
 	}
 
+	void APU::SetTimers(timers::TimerChain* timers) {
+		m_timers = timers;
+	}
+
 	void APU::SetCallback(SampleCallback callback, u32 required_samples) {
 		m_buffer_callback = callback;
 		m_req_samples = required_samples;
@@ -123,6 +129,10 @@ namespace GBA::apu {
 					m_soundcnt_h.fifo_b_reset = 0;
 					m_B_pos = 0;
 				}
+
+				//FIFO timers need their overflow events
+				if (offset && m_timers)
+					m_timers->UpdateEvents();
 			});
 
 		u8* master_control = std::bit_cast<u8*>(&m_soundcnt_x);
@@ -135,6 +145,9 @@ namespace GBA::apu {
 					std::fill_n(m_curr_ch_samples, 6, 0x0);
 					std::fill_n(m_curr_ch_sample_accum, 6, 0x0);
 				}
+
+				if (m_timers)
+					m_timers->UpdateEvents();
 			});
 
 		u8* bias_cnt = std::bit_cast<u8*>(&m_soundbias);
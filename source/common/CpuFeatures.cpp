@@ -0,0 +1,43 @@
+#include "../../common/CpuFeatures.hpp"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_AMD64))
+	#include <intrin.h>
+	#include <immintrin.h>
+#endif
+
+namespace GBA::common {
+	static CpuFeatures DetectCpuFeatures() {
+		CpuFeatures features{};
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_AMD64))
+		int regs[4]{};
+
+		__cpuid(regs, 0);
+		int max_leaf = regs[0];
+
+		__cpuid(regs, 1);
+		features.sse41 = (regs[2] >> 19) & 1;
+
+		bool osxsave = (regs[2] >> 27) & 1;
+		bool avx = (regs[2] >> 28) & 1;
+
+		//The OS has to save the YMM registers too
+		if (max_leaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+			__cpuidex(regs, 7, 0);
+			features.avx2 = (regs[1] >> 5) & 1;
+		}
+#elif defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+		__builtin_cpu_init();
+
+		features.sse41 = __builtin_cpu_supports("sse4.1");
+		features.avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+		return features;
+	}
+
+	CpuFeatures const& GetCpuFeatures() {
+		static CpuFeatures const features = DetectCpuFeatures();
+		return features;
+	}
+}
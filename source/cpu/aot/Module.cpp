@@ -0,0 +1,55 @@
+#include "../../../cpu/aot/Module.hpp"
+
+#include "../../../shared_obj/ProcedureWrapper.hpp"
+
+#include "../../../common/Logger.hpp"
+
+namespace GBA::cpu::aot {
+	LOG_CONTEXT(AOT);
+
+	Module::Module() :
+		m_object{}, m_entries{}
+	{}
+
+	bool Module::Load(std::string_view path, Api const* api) {
+		if (!m_object.Load(path)) {
+			LOG_ERROR("Could not load {}", path);
+			return false;
+		}
+
+		auto version = reinterpret_cast<VersionFunction>(m_object.GetProcAddress(VERSION_SYMBOL));
+		auto entries = reinterpret_cast<EntriesFunction>(m_object.GetProcAddress(ENTRIES_SYMBOL));
+		shared_object::Procedure init = m_object.GetProcAddress(INIT_SYMBOL);
+
+		if (!version || !entries || !init) {
+			LOG_ERROR("{} is not a precompiled ROM module", path);
+			m_object.Unload();
+			return false;
+		}
+
+		if (version() != ABI_VERSION) {
+			LOG_ERROR("{} was generated for ABI version {}, expected {}",
+				path, version(), ABI_VERSION);
+			m_object.Unload();
+			return false;
+		}
+
+		shared_object::FunctionWrapperImpl<InitFunction, shared_object::CallConvetion::_CDECL>
+			init_wrapper{ init };
+
+		init_wrapper.call<void>(api);
+
+		u32 count = 0;
+		Entry const* table = entries(&count);
+
+		m_entries.clear();
+		m_entries.reserve(count);
+
+		for (u32 index = 0; index < count; index++)
+			m_entries[table[index].address | table[index].thumb] = &table[index];
+
+		LOG_INFO("Loaded {} precompiled blocks from {}", count, path);
+
+		return true;
+	}
+}
@@ -0,0 +1,609 @@
+#include "../../../cpu/aot/Recompiler.hpp"
+#include "../../../cpu/core/BlockCache.hpp"
+
+#include <fmt/format.h>
+
+#include <array>
+#include <bit>
+
+namespace GBA::cpu::aot {
+	namespace {
+		/*
+		* C++ translation of the data processing
+		* instructions that only touch registers,
+		* the same subset as the JIT. r is the
+		* register file, f the raw CPSR.
+		* Returns false if the interpreter must
+		* execute the instruction
+		*/
+		bool TranslateThumb(u16 instr, std::string& out) {
+			u32 rd = instr & 0x7;
+			u32 rs = (instr >> 3) & 0x7;
+
+			if (instr < 0x1800) {
+				//Format 1, move shifted register
+				u32 type = (instr >> 11) & 0x3;
+				u32 amount = (instr >> 6) & 0x1F;
+
+				out += fmt::format("\t\t{{ u32 c = GetCarry(f); r[{}] = ShiftImm(r[{}], {}, {}, c); "
+					"SetNZ(f, r[{}]); SetC(f, c); }}\n", rd, rs, type, amount, rd);
+				return true;
+			}
+
+			if (instr < 0x2000) {
+				//Format 2, add/subtract
+				u32 opcode = (instr >> 9) & 0x3;
+				u32 operand = (instr >> 6) & 0x7;
+
+				std::string second = (opcode & 2) ? fmt::format("{}", operand) :
+					fmt::format("r[{}]", operand);
+
+				out += fmt::format("\t\tr[{}] = {}(f, r[{}], {}, {}, true);\n", rd,
+					(opcode & 1) ? "Sub" : "Add", rs, second, (opcode & 1) ? 1 : 0);
+				return true;
+			}
+
+			if (instr < 0x4000) {
+				//Format 3, move/compare/add/subtract immediate
+				u32 opcode = (instr >> 11) & 0x3;
+				u32 imm = instr & 0xFF;
+
+				rd = (instr >> 8) & 0x7;
+
+				switch (opcode)
+				{
+				case 0:
+					//N comes from bit 7 of the
+					//immediate, as in the interpreter
+					out += fmt::format("\t\tr[{}] = {}; f = (f & ~(N_FLAG | Z_FLAG)) | 0x{:x}u;\n",
+						rd, imm, ((imm >> 7) << 31) | (u32(imm == 0) << 30));
+					break;
+				case 1:
+					out += fmt::format("\t\tSub(f, r[{}], {}, 1, true);\n", rd, imm);
+					break;
+				case 2:
+					out += fmt::format("\t\tr[{}] = Add(f, r[{}], {}, 0, true);\n", rd, rd, imm);
+					break;
+				default:
+					out += fmt::format("\t\tr[{}] = Sub(f, r[{}], {}, 1, true);\n", rd, rd, imm);
+					break;
+				}
+
+				return true;
+			}
+
+			if (instr < 0x4400) {
+				//Format 4, ALU operations. Shifts by
+				//register and MUL add internal cycles
+				//and stay in the interpreter
+				u32 opcode = (instr >> 6) & 0xF;
+
+				switch (opcode)
+				{
+				case 0x0:
+					out += fmt::format("\t\tr[{}] &= r[{}]; SetNZ(f, r[{}]);\n", rd, rs, rd);
+					return true;
+				case 0x1:
+					out += fmt::format("\t\tr[{}] ^= r[{}]; SetNZ(f, r[{}]);\n", rd, rs, rd);
+					return true;
+				case 0x5:
+					out += fmt::format("\t\tr[{}] = Add(f, r[{}], r[{}], GetCarry(f), true);\n", rd, rd, rs);
+					return true;
+				case 0x6:
+					out += fmt::format("\t\tr[{}] = Sub(f, r[{}], r[{}], GetCarry(f), true);\n", rd, rd, rs);
+					return true;
+				case 0x8:
+					out += fmt::format("\t\tSetNZ(f, r[{}] & r[{}]);\n", rd, rs);
+					return true;
+				case 0x9:
+					out += fmt::format("\t\tr[{}] = Sub(f, 0, r[{}], 1, true);\n", rd, rs);
+					return true;
+				case 0xA:
+					out += fmt::format("\t\tSub(f, r[{}], r[{}], 1, true);\n", rd, rs);
+					return true;
+				case 0xB:
+					out += fmt::format("\t\tAdd(f, r[{}], r[{}], 0, true);\n", rd, rs);
+					return true;
+				case 0xC:
+					out += fmt::format("\t\tr[{}] |= r[{}]; SetNZ(f, r[{}]);\n", rd, rs, rd);
+					return true;
+				case 0xE:
+					out += fmt::format("\t\tr[{}] &= ~r[{}]; SetNZ(f, r[{}]);\n", rd, rs, rd);
+					return true;
+				case 0xF:
+					out += fmt::format("\t\tr[{}] = ~r[{}]; SetNZ(f, r[{}]);\n", rd, rs, rd);
+					return true;
+				default:
+					return false;
+				}
+			}
+
+			if (instr < 0x4800) {
+				//Format 5, hi register operations
+				//without PC and BX
+				u32 opcode = (instr >> 8) & 0x3;
+
+				rs = (instr >> 3) & 0xF;
+				rd = (instr & 0x7) | ((instr >> 4) & 0x8);
+
+				if (opcode == 3 || rs == 15 || rd == 15)
+					return false;
+
+				if (opcode == 0)
+					out += fmt::format("\t\tr[{}] += r[{}];\n", rd, rs);
+				else if (opcode == 1)
+					out += fmt::format("\t\tSub(f, r[{}], r[{}], 1, true);\n", rd, rs);
+				else
+					out += fmt::format("\t\tr[{}] = r[{}];\n", rd, rs);
+
+				return true;
+			}
+
+			return false;
+		}
+
+		bool TranslateArm(u32 instr, std::string& out) {
+			u32 cond = instr >> 28;
+
+			//Data processing only, no shift by register
+			if (cond == 0xF || (instr & 0x0C000000) != 0)
+				return false;
+
+			bool imm = (instr >> 25) & 1;
+
+			if (!imm && (instr & 0x10))
+				return false;
+
+			u32 opcode = (instr >> 21) & 0xF;
+			bool s_bit = (instr >> 20) & 1;
+			u32 rn = (instr >> 16) & 0xF;
+			u32 rd = (instr >> 12) & 0xF;
+			u32 rm = instr & 0xF;
+			u32 shift_type = (instr >> 5) & 0x3;
+			u32 shift_amount = (instr >> 7) & 0x1F;
+
+			bool compare = opcode >= 0x8 && opcode <= 0xB;
+			bool move = opcode == 0xD || opcode == 0xF;
+
+			//PSR transfers, PC writes/reads, RRX and
+			//the MOV/MVN encodings the interpreter reports
+			if ((compare && !s_bit) || rd == 15 || rn == 15 ||
+				(move && rn != 0))
+				return false;
+
+			if (!imm && (rm == 15 || (shift_type == 3 && !shift_amount)))
+				return false;
+
+			std::string indent = "\t\t";
+
+			if (cond != 0xE) {
+				out += fmt::format("\t\tif (CheckCondition(f, {})) {{\n", cond);
+				indent += '\t';
+			}
+
+			std::string op = "op";
+			char const* carry = "c";
+
+			out += indent + "{ ";
+
+			if (imm) {
+				u32 value = instr & 0xFF;
+				u32 rotate = ((instr >> 8) & 0xF) * 2;
+
+				op = fmt::format("0x{:x}u", std::rotr(value, rotate));
+				carry = (rotate && ((value >> (rotate - 1)) & 1)) ? "1" : "0";
+			}
+			else
+				out += fmt::format("u32 c = GetCarry(f); u32 op = ShiftImm(r[{}], {}, {}, c); ",
+					rm, shift_type, shift_amount);
+
+			char const* flags = s_bit ? "true" : "false";
+
+			std::string result{};
+
+			switch (opcode)
+			{
+			case 0x0:
+			case 0x8:
+				result = fmt::format("r[{}] & {}", rn, op);
+				break;
+			case 0x1:
+			case 0x9:
+				result = fmt::format("r[{}] ^ {}", rn, op);
+				break;
+			case 0x2:
+			case 0xA:
+				result = fmt::format("Sub(f, r[{}], {}, 1, {})", rn, op, flags);
+				break;
+			case 0x3:
+				result = fmt::format("Sub(f, {}, r[{}], 1, {})", op, rn, flags);
+				break;
+			case 0x4:
+			case 0xB:
+				result = fmt::format("Add(f, r[{}], {}, 0, {})", rn, op, flags);
+				break;
+			case 0x5:
+				result = fmt::format("Add(f, r[{}], {}, GetCarry(f), {})", rn, op, flags);
+				break;
+			case 0x6:
+				result = fmt::format("Sub(f, r[{}], {}, GetCarry(f), {})", rn, op, flags);
+				break;
+			case 0x7:
+				result = fmt::format("Sub(f, {}, r[{}], GetCarry(f), {})", op, rn, flags);
+				break;
+			case 0xC:
+				result = fmt::format("r[{}] | {}", rn, op);
+				break;
+			case 0xD:
+				result = op;
+				break;
+			case 0xE:
+				result = fmt::format("r[{}] & ~{}", rn, op);
+				break;
+			default:
+				result = "~" + op;
+				break;
+			}
+
+			bool logical = opcode < 0x2 || opcode == 0x8 ||
+				opcode == 0x9 || opcode >= 0xC;
+
+			if (compare && logical)
+				out += fmt::format("SetNZ(f, {}); SetC(f, {}); ", result, carry);
+			else if (compare)
+				out += result + "; ";
+			else {
+				out += fmt::format("r[{}] = {}; ", rd, result);
+
+				if (s_bit && logical)
+					out += fmt::format("SetNZ(f, r[{}]); SetC(f, {}); ", rd, carry);
+			}
+
+			out += "}\n";
+
+			if (cond != 0xE)
+				out += "\t\t}\n";
+
+			return true;
+		}
+
+		/*
+		* Conservative, tells if a translated
+		* instruction may access r8-r14, whose
+		* slots in r depend on the mode
+		*/
+		bool UsesBanked(u32 opcode, bool thumb) {
+			auto banked = [](u32 reg) {
+				return reg >= 8 && reg < 15;
+			};
+
+			if (thumb) {
+				//Only format 5 reaches the hi registers
+				if ((opcode & 0xFC00) != 0x4400)
+					return false;
+
+				return banked((opcode >> 3) & 0xF) ||
+					banked((opcode & 0x7) | ((opcode >> 4) & 0x8));
+			}
+
+			bool imm = (opcode >> 25) & 1;
+
+			return banked((opcode >> 16) & 0xF) ||
+				banked((opcode >> 12) & 0xF) ||
+				(!imm && banked(opcode & 0xF));
+		}
+
+		i32 SignExtend(u32 value, u32 bits) {
+			return i32(value << (32 - bits)) >> (32 - bits);
+		}
+	}
+
+	Recompiler::Recompiler(std::vector<u8> rom) :
+		m_rom(std::move(rom)), m_blocks{},
+		m_pending{}, m_seen{}
+	{}
+
+	bool Recompiler::Read(u32 address, u32 size, u32& value) const {
+		if (address < ROM_START || address - ROM_START + size > m_rom.size())
+			return false;
+
+		u32 offset = address - ROM_START;
+
+		value = 0;
+
+		for (u32 i = 0; i < size; i++)
+			value |= u32(m_rom[offset + i]) << (i * 8);
+
+		return true;
+	}
+
+	bool Recompiler::IsCode(u32 address, bool thumb) const {
+		return address >= ROM_START &&
+			address - ROM_START < m_rom.size() &&
+			(address & (thumb ? 1 : 3)) == 0;
+	}
+
+	void Recompiler::AddEntry(u32 address, bool thumb) {
+		if (!IsCode(address, thumb))
+			return;
+
+		u32 key = GetKey(address, thumb);
+
+		if (m_seen.insert(key).second)
+			m_pending.push_back(key);
+	}
+
+	void Recompiler::Explore() {
+		while (!m_pending.empty()) {
+			u32 key = m_pending.back();
+			m_pending.pop_back();
+
+			if (key & 1)
+				Walk<true>(key & ~1);
+			else
+				Walk<false>(key);
+		}
+	}
+
+	template <bool Thumb>
+	void Recompiler::Walk(u32 address) {
+		constexpr u32 size = Thumb ? 2 : 4;
+
+		Block block{};
+
+		block.address = address;
+		block.thumb = Thumb;
+
+		/*
+		* Register values loaded from literal
+		* pools or computed from PC, used to
+		* resolve BX targets. Never invalidated,
+		* a stale value only adds a useless entry
+		*/
+		std::array<u32, 16> values{};
+		std::array<bool, 16> known{};
+
+		u32 pc = address;
+		bool ended = false;
+
+		while (block.opcodes.size() < BlockCache::MAX_BLOCK_SIZE) {
+			u32 opcode = 0;
+			u32 fetched = 0;
+
+			//The runtime block needs the opcode
+			//fetched two slots ahead too
+			if (!Read(pc, size, opcode) || !Read(pc + 2 * size, size, fetched))
+				break;
+
+			block.opcodes.push_back(opcode);
+
+			if constexpr (Thumb) {
+				if ((opcode & 0xF000) == 0xD000 && (opcode & 0x0F00) < 0x0E00)
+					AddEntry(pc + 4 + SignExtend(opcode & 0xFF, 8) * 2, true);
+				else if ((opcode & 0xF800) == 0xE000)
+					AddEntry(pc + 4 + SignExtend(opcode & 0x7FF, 11) * 2, true);
+				else if ((opcode & 0xF800) == 0xF000) {
+					u32 second = 0;
+
+					if (Read(pc + 2, 2, second) && (second & 0xF800) == 0xF800) {
+						AddEntry(pc + 4 + SignExtend(opcode & 0x7FF, 11) * 4096 +
+							(second & 0x7FF) * 2, true);
+						AddEntry(pc + 4, true);
+					}
+				}
+				else if ((opcode & 0xFF00) == 0xDF00)
+					AddEntry(pc + 2, true);
+				else if ((opcode & 0xF800) == 0x4800) {
+					u32 rd = (opcode >> 8) & 0x7;
+
+					known[rd] = Read(((pc + 4) & ~3) + (opcode & 0xFF) * 4, 4, values[rd]);
+				}
+				else if ((opcode & 0xF800) == 0xA000) {
+					u32 rd = (opcode >> 8) & 0x7;
+
+					values[rd] = ((pc + 4) & ~3) + (opcode & 0xFF) * 4;
+					known[rd] = true;
+				}
+				else if ((opcode & 0xFF87) == 0x4700) {
+					u32 rm = (opcode >> 3) & 0xF;
+
+					if (known[rm])
+						AddEntry(values[rm] & ~1, values[rm] & 1);
+				}
+
+				pc += size;
+
+				if (BlockCache::EndsThumbBlock(u16(opcode))) {
+					ended = true;
+					break;
+				}
+			}
+			else {
+				u32 rd = (opcode >> 12) & 0xF;
+
+				if ((opcode >> 28) == 0xF) {}
+				else if ((opcode & 0x0E000000) == 0x0A000000) {
+					AddEntry(pc + 8 + SignExtend(opcode & 0xFFFFFF, 24) * 4, false);
+
+					if (opcode & (1 << 24))
+						AddEntry(pc + 4, false);
+				}
+				else if ((opcode & 0x0F000000) == 0x0F000000)
+					AddEntry(pc + 4, false);
+				else if ((opcode & 0x0F7F0000) == 0x051F0000) {
+					u32 offset = opcode & 0xFFF;
+					u32 literal = (opcode & (1 << 23)) ? pc + 8 + offset : pc + 8 - offset;
+
+					known[rd] = Read(literal, 4, values[rd]);
+
+					//LDR PC, =target after MOV LR, PC
+					if (rd == 15 && known[rd]) {
+						AddEntry(values[rd] & ~3, false);
+						AddEntry(pc + 4, false);
+					}
+				}
+				else if ((opcode & 0x0FEF0000) == 0x028F0000 ||
+					(opcode & 0x0FEF0000) == 0x024F0000) {
+					u32 value = std::rotr(opcode & 0xFF, ((opcode >> 8) & 0xF) * 2);
+					bool add = ((opcode >> 21) & 0xF) == 0x4;
+
+					values[rd] = add ? pc + 8 + value : pc + 8 - value;
+					known[rd] = true;
+				}
+				else if ((opcode & 0x0FFFFFF0) == 0x012FFF10) {
+					u32 rm = opcode & 0xF;
+
+					if (known[rm])
+						AddEntry(values[rm] & ~1, values[rm] & 1);
+				}
+
+				pc += size;
+
+				if (BlockCache::EndsArmBlock(opcode)) {
+					ended = true;
+					break;
+				}
+			}
+		}
+
+		//The runtime splits long runs
+		//in the same way
+		if (!ended && block.opcodes.size() == BlockCache::MAX_BLOCK_SIZE)
+			AddEntry(pc, Thumb);
+
+		if (block.opcodes.empty())
+			return;
+
+		std::string dummy{};
+
+		for (u32 opcode : block.opcodes) {
+			bool translated = Thumb ? TranslateThumb(u16(opcode), dummy) :
+				TranslateArm(opcode, dummy);
+
+			block.translated.push_back(u8(translated));
+			block.banked |= translated && UsesBanked(opcode, Thumb);
+		}
+
+		m_blocks[GetKey(address, Thumb)] = std::move(block);
+	}
+
+	std::size_t Recompiler::GetInstructionCount() const {
+		std::size_t count = 0;
+
+		for (auto const& [key, block] : m_blocks)
+			count += block.opcodes.size();
+
+		return count;
+	}
+
+	std::size_t Recompiler::GetTranslatedCount() const {
+		std::size_t count = 0;
+
+		for (auto const& [key, block] : m_blocks) {
+			for (u8 translated : block.translated)
+				count += translated;
+		}
+
+		return count;
+	}
+
+	std::string Recompiler::Generate(std::string_view rom_name) const {
+		std::string out{};
+
+		out += fmt::format("//Generated by gba_aot from {}, do not edit\n\n", rom_name);
+		out += "#include \"cpu/aot/Runtime.hpp\"\n\n";
+		out += "using namespace GBA::cpu::aot;\n\n";
+		out += "namespace {\n";
+		out += "\tApi const* api = nullptr;\n";
+
+		for (auto const& [key, block] : m_blocks) {
+			char const* set = block.thumb ? "thumb" : "arm";
+			std::string name = fmt::format("{:08x}_{}", block.address, block.thumb ? 't' : 'a');
+
+			u32 size = block.thumb ? 2 : 4;
+			u32 count = u32(block.opcodes.size());
+
+			bool any_translated = false;
+
+			for (u8 translated : block.translated)
+				any_translated |= translated != 0;
+
+			if (any_translated) {
+				out += fmt::format("\n\tvoid block_{}(void* jit, u32* r, void* cpsr) {{\n", name);
+				out += "\t\tu32& f = *static_cast<u32*>(cpsr);\n";
+			}
+			else
+				out += fmt::format("\n\tvoid block_{}(void* jit, u32*, void*) {{\n", name);
+
+			for (u32 index = 0; index < count; index++) {
+				u32 opcode = block.opcodes[index];
+				bool last = index == count - 1;
+
+				out += fmt::format("\n\t\t//0x{:08x}: 0x{:x}\n", block.address + index * size, opcode);
+
+				if (block.translated[index]) {
+					if (block.thumb)
+						TranslateThumb(u16(opcode), out);
+					else
+						TranslateArm(opcode, out);
+
+					if (last)
+						out += fmt::format("\t\tapi->exit_{}(jit, {});\n", set, index);
+				}
+				else if (last)
+					out += fmt::format("\t\tapi->interpret_{}(jit, {});\n", set, index);
+				else
+					out += fmt::format("\t\tif (api->interpret_{}(jit, {}))\n\t\t\treturn;\n", set, index);
+			}
+
+			out += "\t}\n\n";
+
+			out += fmt::format("\tconstexpr u32 opcodes_{}[] = {{", name);
+
+			for (u32 index = 0; index < count; index++)
+				out += fmt::format("{}0x{:x}", index % 8 ? ", " : (index ? ",\n\t\t" : "\n\t\t"),
+					block.opcodes[index]);
+
+			out += "\n\t};\n\n";
+
+			out += fmt::format("\tconstexpr u8 translated_{}[] = {{", name);
+
+			for (u32 index = 0; index < count; index++)
+				out += fmt::format("{}{}", index % 16 ? ", " : (index ? ",\n\t\t" : "\n\t\t"),
+					block.translated[index]);
+
+			out += "\n\t};\n";
+		}
+
+		out += "\n\tEntry const entries[] = {\n";
+
+		for (auto const& [key, block] : m_blocks) {
+			std::string name = fmt::format("{:08x}_{}", block.address, block.thumb ? 't' : 'a');
+
+			out += fmt::format("\t\t{{ 0x{:08x}, {}, {}, {}, opcodes_{}, translated_{}, &block_{} }},\n",
+				block.address, u32(block.thumb), block.opcodes.size(), u32(block.banked),
+				name, name, name);
+		}
+
+		out += "\t};\n";
+		out += "}\n\n";
+
+		out += "AOT_EXPORT u32 gba_aot_version() {\n";
+		out += "\treturn ABI_VERSION;\n";
+		out += "}\n\n";
+
+		out += "AOT_EXPORT void gba_aot_init(Api const* emu_api) {\n";
+		out += "\tapi = emu_api;\n";
+		out += "}\n\n";
+
+		out += "AOT_EXPORT Entry const* gba_aot_entries(u32* count) {\n";
+		out += "\t*count = u32(sizeof(entries) / sizeof(entries[0]));\n";
+		out += "\treturn entries;\n";
+		out += "}\n";
+
+		return out;
+	}
+
+	template void Recompiler::Walk<false>(u32 address);
+	template void Recompiler::Walk<true>(u32 address);
+}
@@ -9,6 +9,7 @@
 #include "../../../common/BitManip.hpp"
 
 #include "../../../cpu/arm/TableGen.hpp"
+#include "../../../cpu/hle/Bios.hpp"
 
 #include <utility>
 
@@ -22,8 +23,7 @@ namespace GBA::cpu::arm{
 			ctx.m_regs.SetReg(dest, res);
 
 			if (s_bit) {
-				ctx.m_cpsr.zero = !res;
-				ctx.m_cpsr.sign = CHECK_BIT(res, 31);
+				ctx.SetLogicFlags(res);
 			}
 		}
 
@@ -33,8 +33,7 @@ namespace GBA::cpu::arm{
 			ctx.m_regs.SetReg(dest, res);
 
 			if (s_bit) {
-				ctx.m_cpsr.zero = !res;
-				ctx.m_cpsr.sign = CHECK_BIT(res, 31);
+				ctx.SetLogicFlags(res);
 			}
 		}
 
@@ -44,10 +43,7 @@ namespace GBA::cpu::arm{
 			ctx.m_regs.SetReg(dest, res);
 
 			if (s_bit) {
-				ctx.m_cpsr.zero = !res;
-				ctx.m_cpsr.sign = CHECK_BIT(res, 31);
-				ctx.m_cpsr.CarrySubtract(first_op, value);
-				ctx.m_cpsr.OverflowSubtract(first_op, value);
+				ctx.SetSubFlags(first_op, value, 0, res);
 			}
 		}
 
@@ -57,10 +53,7 @@ namespace GBA::cpu::arm{
 			ctx.m_regs.SetReg(dest, res);
 
 			if (s_bit) {
-				ctx.m_cpsr.zero = !res;
-				ctx.m_cpsr.sign = CHECK_BIT(res, 31);
-				ctx.m_cpsr.CarrySubtract(value, first_op);
-				ctx.m_cpsr.OverflowSubtract(value, first_op);
+				ctx.SetSubFlags(value, first_op, 0, res);
 			}
 		}
 
@@ -70,89 +63,65 @@ namespace GBA::cpu::arm{
 			ctx.m_regs.SetReg(dest, res);
 
 			if (s_bit) {
-				ctx.m_cpsr.zero = !res;
-				ctx.m_cpsr.sign = CHECK_BIT(res, 31);
-				ctx.m_cpsr.CarryAdd(first_op, value);
-				ctx.m_cpsr.OverflowAdd(first_op, value);
+				ctx.SetAddFlags(first_op, value, 0, res);
 			}
 		}
 
 		void ADC(u8 dest, u32 first_op, u32 value, bool s_bit, CPUContext& ctx) {
-			u8 carry_val = ctx.m_cpsr.carry;
+			u8 carry_val = ctx.GetCarry();
 
-			uint64_t res = (uint64_t)first_op + value + carry_val;
-			u32 res32 = (u32)res;
+			u32 res = first_op + value + carry_val;
 
-			ctx.m_regs.SetReg(dest, res32);
+			ctx.m_regs.SetReg(dest, res);
 
-			if (s_bit) {
-				ctx.m_cpsr.zero = !res32;
-				ctx.m_cpsr.sign = CHECK_BIT(res, 31);
-				ctx.m_cpsr.carry = res >> 32;
-				ctx.m_cpsr.overflow = (~(first_op ^ value) & (value ^ (u32)res32)) >> 31;
-			}
+			if (s_bit)
+				ctx.SetAddFlags(first_op, value, carry_val, res);
 		}
 
 		void SBC(u8 dest, u32 first_op, u32 value, bool s_bit, CPUContext& ctx) {
-			u8 carry_val = ctx.m_cpsr.carry ^ 1;
+			u8 carry_val = ctx.GetCarry() ^ 1;
 
 			u32 res = first_op - value - carry_val;
 
 			ctx.m_regs.SetReg(dest, res);
 
-			if (s_bit) {
-				ctx.m_cpsr.zero = !res;
-				ctx.m_cpsr.sign = CHECK_BIT(res, 31);
-				ctx.m_cpsr.carry = (uint64_t)first_op >= (uint64_t)value + (uint64_t)carry_val;
-				ctx.m_cpsr.overflow = ((first_op ^ value) & (first_op ^ res)) >> 31;
-			}
+			if (s_bit)
+				ctx.SetSubFlags(first_op, value, carry_val, res);
 		}
 
 		void RSC(u8 dest, u32 first_op, u32 value, bool s_bit, CPUContext& ctx) {
-			u8 carry_val = ctx.m_cpsr.carry ^ 1;
+			u8 carry_val = ctx.GetCarry() ^ 1;
 
 			u32 res = value - first_op - carry_val;
 
 			ctx.m_regs.SetReg(dest, res);
 
-			if (s_bit) {
-				ctx.m_cpsr.zero = !res;
-				ctx.m_cpsr.sign = CHECK_BIT(res, 31);
-				ctx.m_cpsr.carry = (uint64_t)value >= (uint64_t)first_op + (uint64_t)carry_val;
-				ctx.m_cpsr.overflow = ((value ^ first_op) & (value ^ res)) >> 31;
-			}
+			if (s_bit)
+				ctx.SetSubFlags(value, first_op, carry_val, res);
 		}
 
 		void TST(u8 dest, u32 first_op, u32 value, bool s_bit, CPUContext& ctx) {
 			u32 res = first_op & value;
 
-			ctx.m_cpsr.zero = !res;
-			ctx.m_cpsr.sign = CHECK_BIT(res, 31);
+			ctx.SetLogicFlags(res);
 		}
 
 		void TEQ(u8 dest, u32 first_op, u32 value, bool s_bit, CPUContext& ctx) {
 			u32 res = first_op ^ value;
 
-			ctx.m_cpsr.zero = !res;
-			ctx.m_cpsr.sign = CHECK_BIT(res, 31);
+			ctx.SetLogicFlags(res);
 		}
 
 		void CMP(u8 dest, u32 first_op, u32 value, bool s_bit, CPUContext& ctx) {
 			u32 res = first_op - value;
 
-			ctx.m_cpsr.zero = !res;
-			ctx.m_cpsr.sign = CHECK_BIT(res, 31);
-			ctx.m_cpsr.CarrySubtract(first_op, value);
-			ctx.m_cpsr.OverflowSubtract(first_op, value);
+			ctx.SetSubFlags(first_op, value, 0, res);
 		}
 
 		void CMN(u8 dest, u32 first_op, u32 value, bool s_bit, CPUContext& ctx) {
 			u32 res = first_op + value;
 
-			ctx.m_cpsr.zero = !res;
-			ctx.m_cpsr.sign = CHECK_BIT(res, 31);
-			ctx.m_cpsr.CarryAdd(first_op, value);
-			ctx.m_cpsr.OverflowAdd(first_op, value);
+			ctx.SetAddFlags(first_op, value, 0, res);
 		}
 
 		void ORR(u8 dest, u32 first_op, u32 value, bool s_bit, CPUContext& ctx) {
@@ -161,8 +130,7 @@ namespace GBA::cpu::arm{
 			ctx.m_regs.SetReg(dest, res);
 
 			if (s_bit) {
-				ctx.m_cpsr.zero = !res;
-				ctx.m_cpsr.sign = CHECK_BIT(res, 31);
+				ctx.SetLogicFlags(res);
 			}
 		}
 
@@ -172,8 +140,7 @@ namespace GBA::cpu::arm{
 			ctx.m_regs.SetReg(dest, value);
 
 			if (s_bit) {
-				ctx.m_cpsr.zero = !value;
-				ctx.m_cpsr.sign = CHECK_BIT(value, 31);
+				ctx.SetLogicFlags(value);
 			}
 		}
 
@@ -183,8 +150,7 @@ namespace GBA::cpu::arm{
 			ctx.m_regs.SetReg(dest, res);
 
 			if (s_bit) {
-				ctx.m_cpsr.zero = !res;
-				ctx.m_cpsr.sign = CHECK_BIT(res, 31);
+				ctx.SetLogicFlags(res);
 			}
 		}
 
@@ -194,11 +160,19 @@ namespace GBA::cpu::arm{
 			ctx.m_regs.SetReg(dest, value);
 
 			if (s_bit) {
-				ctx.m_cpsr.zero = !value;
-				ctx.m_cpsr.sign = CHECK_BIT(value, 31);
+				ctx.SetLogicFlags(value);
 			}
 		}
 
+		/*
+		* Only flag setting logical operations
+		* (and RRX) use the carry, the others
+		* do not resolve the pending flags
+		*/
+		constexpr bool IsLogical(u8 opcode) {
+			return opcode <= 1 || opcode == 8 || opcode == 9 || opcode >= 0xC;
+		}
+
 		template <u8 Opcode, bool S>
 		void DataProcessingCommon(u8 dest, u32 first_op, u8 opcode, u32 value, bool s_bit,
 			CPUContext& ctx, bool& branch, bool shift_carry) {
@@ -457,6 +431,8 @@ namespace GBA::cpu::arm{
 
 			bus->m_time.access = Access::Seq;
 
+			ctx.ResolveFlags();
+
 			if constexpr (Spsr) {
 				if (ctx.m_cpsr.mode == Mode::User ||
 					ctx.m_cpsr.mode == Mode::SYS) [[unlikely]] {
@@ -519,6 +495,8 @@ namespace GBA::cpu::arm{
 				ctx.m_spsr[mode_id - 1] = psr;
 			}
 			else {
+				ctx.ResolveFlags();
+
 				u32 psr = ctx.m_cpsr;
 				psr &= ~mask;
 				psr |= value;
@@ -730,6 +708,9 @@ namespace GBA::cpu::arm{
 
 		u8 first_reg_id = reg_id;
 
+		u32 values[16];
+		u32 count = 0;
+
 		if constexpr (Psr) {
 			if constexpr (Writeback) {
 				//Writeback with S bit set is not allowed
@@ -738,17 +719,8 @@ namespace GBA::cpu::arm{
 			}
 
 			while (list) {
-				if (list & 1) {
-					reg_value = ctx.m_regs.GetReg(Mode::User, reg_id) + 12 * (reg_id == 15);
-
-					base += pre_increment;
-
-					bus->Write<u32>(base, reg_value);
-
-					base += post_increment;
-
-					bus->m_time.access = Access::Seq;
-				}
+				if (list & 1)
+					values[count++] = ctx.m_regs.GetReg(Mode::User, reg_id) + 12 * (reg_id == 15);
 
 				list >>= 1;
 				reg_id++;
@@ -766,13 +738,7 @@ namespace GBA::cpu::arm{
 					else 
 						reg_value = ctx.m_regs.GetReg(reg_id) + 12 * (reg_id == 15);
 
-					base += pre_increment;
-
-					bus->Write<u32>(base, reg_value);
-
-					base += post_increment;
-
-					bus->m_time.access = Access::Seq;
+					values[count++] = reg_value;
 				}
 
 				list >>= 1;
@@ -780,6 +746,18 @@ namespace GBA::cpu::arm{
 			}
 		}
 
+		if (!bus->WriteMultiple(base + pre_increment, values, count)) {
+			for (u32 index = 0; index < count; index++) {
+				base += pre_increment;
+
+				bus->Write<u32>(base, values[index]);
+
+				base += post_increment;
+
+				bus->m_time.access = Access::Seq;
+			}
+		}
+
 		bus->m_time.access = Access::NonSeq;
 	}
 
@@ -831,37 +809,35 @@ namespace GBA::cpu::arm{
 		u8 pre_increment = PreInc ? 4 : 0;
 		u8 post_increment = !PreInc ? 4 : 0;
 
-		if constexpr (Psr) {
-			while (list) {
-				if (list & 1) {
-					base += pre_increment;
+		u32 values[16];
+		u32 count = std::popcount(list);
 
-					ctx.m_regs.SetReg(Mode::User ,reg_id, bus->Read<u32>(base));
+		if (!bus->ReadMultiple(base + pre_increment, values, count)) {
+			for (u32 index = 0; index < count; index++) {
+				base += pre_increment;
 
-					base += post_increment;
+				values[index] = bus->Read<u32>(base);
 
-					bus->m_time.access = Access::Seq;
-				}
+				base += post_increment;
 
-				list >>= 1;
-				reg_id++;
+				bus->m_time.access = Access::Seq;
 			}
 		}
-		else {
-			while (list) {
-				if (list & 1) {
-					base += pre_increment;
-
-					ctx.m_regs.SetReg(reg_id, bus->Read<u32>(base));
-
-					base += post_increment;
+		else
+			bus->m_time.access = Access::Seq;
 
-					bus->m_time.access = Access::Seq;
-				}
+		u32 index = 0;
 
-				list >>= 1;
-				reg_id++;
+		while (list) {
+			if (list & 1) {
+				if constexpr (Psr)
+					ctx.m_regs.SetReg(Mode::User, reg_id, values[index++]);
+				else
+					ctx.m_regs.SetReg(reg_id, values[index++]);
 			}
+
+			list >>= 1;
+			reg_id++;
 		}
 
 		if (CHECK_BIT(instr.rlist, 15)) {
@@ -1010,19 +986,22 @@ namespace GBA::cpu::arm{
 		u32 second_op = ctx.m_regs.GetReg(instr.second_operand_reg) + 12 * (instr.second_operand_reg == 15);
 		u32 shift_val = ctx.m_regs.GetReg(instr.shift_reg) & 0xFF;
 
+		bool carry = (S && detail::IsLogical(Opcode)) || ShiftType == 3 ?
+			ctx.GetCarry() : false;
+
 		std::pair<u32, bool> res{};
 
 		if constexpr (ShiftType == 0) {
-			res = detail::LSL<false>(second_op, shift_val, ctx.m_cpsr.carry);
+			res = detail::LSL<false>(second_op, shift_val, carry);
 		}
 		else if constexpr (ShiftType == 1) {
-			res = detail::LSR<false>(second_op, shift_val, ctx.m_cpsr.carry);
+			res = detail::LSR<false>(second_op, shift_val, carry);
 		}
 		else if constexpr (ShiftType == 2) {
-			res = detail::ASR<false>(second_op, shift_val, ctx.m_cpsr.carry);
+			res = detail::ASR<false>(second_op, shift_val, carry);
 		}
 		else if constexpr (ShiftType == 3) {
-			res = detail::ROR<false>(second_op, shift_val, ctx.m_cpsr.carry);
+			res = detail::ROR<false>(second_op, shift_val, carry);
 		}
 
 		u32 first_op = ctx.m_regs.GetReg(first_op_reg) + 12 * (first_op_reg == 15);
@@ -1057,19 +1036,22 @@ namespace GBA::cpu::arm{
 		//u8 shift_type = instr.shift_type;
 		u32 second_op = ctx.m_regs.GetReg( instr.second_operand_reg ) + 8 * (instr.second_operand_reg == 15);
 
+		bool carry = (S && detail::IsLogical(Opcode)) || ShiftType == 3 ?
+			ctx.GetCarry() : false;
+
 		std::pair<u32, bool> res{};
 
 		if constexpr (ShiftType == 0) {
-			res = detail::LSL<true>(second_op, shift_amount, ctx.m_cpsr.carry);
+			res = detail::LSL<true>(second_op, shift_amount, carry);
 		}
 		else if constexpr (ShiftType == 1) {
-			res = detail::LSR<true>(second_op, shift_amount, ctx.m_cpsr.carry);
+			res = detail::LSR<true>(second_op, shift_amount, carry);
 		}
 		else if constexpr (ShiftType == 2) {
-			res = detail::ASR<true>(second_op, shift_amount, ctx.m_cpsr.carry);
+			res = detail::ASR<true>(second_op, shift_amount, carry);
 		}
 		else if constexpr (ShiftType == 3) {
-			res = detail::ROR<true>(second_op, shift_amount, ctx.m_cpsr.carry);
+			res = detail::ROR<true>(second_op, shift_amount, carry);
 		}
 
 		u32 first_op = ctx.m_regs.GetReg(first_op_reg) + 8 * (first_op_reg == 15);
@@ -1170,7 +1152,13 @@ namespace GBA::cpu::arm{
 		* 1S -> Prefetch
 		* 1S + 1N -> Pipeline flush
 		*/
-		//u32 argument = instr.data & 0xFFFFFF;
+		//The BIOS only looks at bits 16-23
+		u8 number = (instr.data >> 16) & 0xFF;
+
+		if (bus->IsHleBios() && hle::SoftwareInterrupt(number, ctx, bus, branch)) {
+			bus->m_time.access = Access::Seq;
+			return;
+		}
 
 		ctx.EnterException(ExceptionCode::SOFTI, 4);
 
@@ -1343,6 +1331,7 @@ namespace GBA::cpu::arm{
 
 		if constexpr (S) {
 			//ctx.m_cpsr.carry = false;
+			ctx.ResolveFlags();
 			ctx.m_cpsr.zero = (instr.opcode == 0 || instr.opcode == 1) ? !(u32)res : !res;
 			ctx.m_cpsr.sign = (instr.opcode == 0 || instr.opcode == 1) ? 
 				CHECK_BIT(res, 31) : CHECK_BIT(res, 63);
@@ -1392,19 +1381,20 @@ namespace GBA::cpu::arm{
 
 			if constexpr (ShiftType == 0) {
 				offset = detail::LSL<true>(offset, shift_amount,
-					ctx.m_cpsr.carry).first;
+					false).first;
 			}
 			else if constexpr (ShiftType == 1) {
 				offset = detail::LSR<true>(offset, shift_amount,
-					ctx.m_cpsr.carry).first;
+					false).first;
 			}
 			else if constexpr (ShiftType == 2) {
 				offset = detail::ASR<true>(offset, shift_amount,
-					ctx.m_cpsr.carry).first;
+					false).first;
 			}
 			else if constexpr (ShiftType == 3) {
+				//Only RRX needs the carry
 				offset = detail::ROR<true>(offset, shift_amount,
-					ctx.m_cpsr.carry).first;
+					ctx.GetCarry()).first;
 			}
 		}
 		else {
@@ -1635,7 +1625,7 @@ namespace GBA::cpu::arm{
 	void ExecuteArm(ARMInstruction instr, CPUContext& ctx, memory::Bus* bus, bool& branch) {
 		static_assert(sizeof(ARMInstruction) == 4);
 		
-		if (!ctx.m_cpsr.CheckCondition(instr.condition)) // The instruction takes one S cycle (caused by the fetch process)
+		if (!ctx.CheckCondition(instr.condition)) // The instruction takes one S cycle (caused by the fetch process)
 		{
 			bus->m_time.access = Access::Seq; //Set the access to sequential
 			//Since no memory address was read/written
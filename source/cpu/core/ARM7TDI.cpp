@@ -1,17 +1,24 @@
 #include "../../../cpu/core/ARM7TDI.hpp"
 #include "../../../cpu/arm/ARM_Implementation.hpp"
 #include "../../../cpu/thumb/THUMB_Implementation.hpp"
+#include "../../../cpu/jit/Jit.hpp"
+#include "../../../cpu/aot/Module.hpp"
 
+#include <algorithm>
 #include <cassert>
 
 #include "../../../memory/InterruptController.hpp"
+#include "../../../memory/EventScheduler.hpp"
 
 #include "../../../common/Logger.hpp"
 
 namespace GBA::cpu {
+	LOG_CONTEXT(ARM7TDI);
 
 	ARM7TDI::ARM7TDI() :
-		m_ctx{}, m_bus(nullptr), m_int_controller(nullptr), m_halt(false) {
+		m_ctx{}, m_bus(nullptr), m_int_controller(nullptr), m_sched(nullptr), m_halt(false),
+		m_block_cache{}, m_exec_mode{ExecutionMode::INTERPRETER}, m_jit{},
+		m_aot_module{}, m_idle{ NO_IDLE_LOOP }, m_idle_loops{} {
 		m_ctx.m_cpsr.instr_state = InstructionMode::ARM;
 		m_ctx.ChangeMode(Mode::SYS);
 
@@ -20,12 +27,71 @@ namespace GBA::cpu {
 		m_ctx.m_regs.SetReg(Mode::User, 13, 0x03007F00);
 	}
 
+	ARM7TDI::~ARM7TDI() = default;
+
 	void ARM7TDI::AttachBus(memory::Bus* bus) {
 		m_bus = bus;
+		m_block_cache.AttachBus(bus);
+		m_bus->AttachBlockCache(&m_block_cache);
 		m_ctx.m_pipeline.AttachBus(bus);
 		m_ctx.m_pipeline.Bubble<InstructionMode::ARM>(0x00);
 	}
 
+	void ARM7TDI::SetExecutionMode(ExecutionMode mode) {
+		bool translate = mode == ExecutionMode::JIT ||
+			mode == ExecutionMode::JIT_LOCKSTEP;
+
+		if (translate && !jit::Jit::IsSupported()) {
+			LOG_INFO("JIT not supported on this host, using the interpreter");
+			mode = ExecutionMode::INTERPRETER;
+			translate = false;
+		}
+
+		//Blocks keep pointers to the translations
+		//of the Jit, which is recreated when
+		//switching to or from AOT
+		if (m_jit && (mode == ExecutionMode::INTERPRETER ||
+			m_jit->IsValid() != translate)) {
+			m_block_cache.Flush();
+			m_jit->Release(m_block_cache.GetRetired());
+			m_jit.reset();
+		}
+
+		if (mode != ExecutionMode::INTERPRETER && !m_jit) {
+			m_jit = std::make_unique<jit::Jit>(this, &m_ctx, &m_block_cache, m_bus, translate);
+			m_jit->SetModule(m_aot_module.get());
+
+			if (translate && !m_jit->IsValid()) {
+				LOG_INFO("Could not allocate JIT memory, using the interpreter");
+				mode = ExecutionMode::INTERPRETER;
+				m_jit.reset();
+			}
+		}
+
+		m_exec_mode = mode;
+
+		if (m_jit)
+			m_jit->SetLockstep(mode == ExecutionMode::JIT_LOCKSTEP);
+	}
+
+	bool ARM7TDI::LoadPrecompiled(std::string_view path) {
+		auto module = std::make_unique<aot::Module>();
+
+		if (!module->Load(path, jit::Jit::GetAotApi()))
+			return false;
+
+		m_aot_module = std::move(module);
+
+		//Blocks that already missed the
+		//lookup must be looked up again
+		m_block_cache.Flush();
+
+		if (m_jit)
+			m_jit->SetModule(m_aot_module.get());
+
+		return true;
+	}
+
 	void ARM7TDI::SkipBios() {
 		m_ctx.m_regs.SetReg(15, 0x08000000);
 		m_ctx.m_regs.SwitchMode(Mode::User);
@@ -97,6 +163,8 @@ namespace GBA::cpu {
 	}
 
 	void CPUContext::ChangeMode(Mode new_mode) {
+		ResolveFlags();
+
 		m_regs.SwitchMode(new_mode);
 		u8 mode_id = GetModeFromID(new_mode);
 		m_spsr[mode_id - 1] = m_cpsr;
@@ -106,6 +174,8 @@ namespace GBA::cpu {
 	void CPUContext::EnterException(ExceptionCode exc, u8 pc_offset) {
 		Mode mode = ARM7TDI::GetModeFromExcept(exc);
 
+		ResolveFlags();
+
 		m_regs.SwitchMode(mode);
 
 		u8 mode_id = GetModeFromID(mode);
@@ -144,24 +214,23 @@ namespace GBA::cpu {
 		m_regs.SetReg(15, old_pc);
 
 		m_cpsr = m_spsr[curr_mode_id - 1];
+		m_flags.op = FlagOp::NONE;
 	}
 
 	void ARM7TDI::SetInterruptControl(memory::InterruptController* control) {
 		m_int_controller = control;
 	}
 
-	bool ARM7TDI::CheckIRQ() {
-		if (m_int_controller->GetLineStatus())
-			return false; //So an interrupt is triggered
-		//only once and not every time we check 
-		//IE and IF registers
-
-		bool cpsr_ime = !m_ctx.m_cpsr.irq_disable;
-		bool ime = m_int_controller->GetIME();
-		u16 ie = m_int_controller->GetIE();
-		u16 _if = m_int_controller->GetIF();
+	bool ARM7TDI::InterruptPending() {
+		//The line is armed only once per request,
+		//so an interrupt is triggered once and not
+		//every time IE and IF are checked
+		return m_int_controller->IsPending() &&
+			!m_ctx.m_cpsr.irq_disable;
+	}
 
-		if (cpsr_ime && ime && (ie & _if)) {
+	bool ARM7TDI::CheckIRQ() {
+		if (InterruptPending()) {
 			m_int_controller->ResetLineStatus();
 			return true;
 		}
@@ -169,48 +238,56 @@ namespace GBA::cpu {
 		return false;
 	}
 
-	u8 ARM7TDI::Step() {
-		//Check if IRQ occurred
-		//Check halt status
-		if (m_halt) [[unlikely]] {
-			u16 ie = m_int_controller->GetIE();
-			u16 _if = m_int_controller->GetIF();
+	template <InstructionMode InstrSet>
+	void ARM7TDI::Execute(bool& branch) {
+		constexpr bool thumb = InstrSet == InstructionMode::THUMB;
 
-			if (ie & _if) {
-				m_halt = false;
-				m_bus->ResetHalt();
-			}
-			else {
-				m_bus->InternalCycles(1);
-				return 0;
-			}
-		}
+		CachedInstruction const* cached = m_block_cache.Next<thumb>(
+			m_ctx.m_regs.GetReg(15),
+			m_ctx.m_pipeline.GetDecoded()
+		);
 
-		if (CheckIRQ()) {
-			m_ctx.EnterException(ExceptionCode::IRQ, 4);
+		if (cached == nullptr) [[unlikely]] {
+			if constexpr (thumb)
+				thumb::ExecuteThumb(m_ctx.m_pipeline.Pop<InstrSet>(), m_bus, m_ctx, branch);
+			else
+				arm::ExecuteArm(m_ctx.m_pipeline.Pop<InstrSet>(), m_ctx, m_bus, branch);
 
-			m_ctx.m_pipeline.Bubble<InstructionMode::ARM>(
-				m_ctx.m_regs.GetReg(15)
-			);
+			m_ctx.m_pipeline.Fetch<InstrSet>();
+			return;
 		}
 
-		bool branch = false;
-
-		if (m_ctx.m_cpsr.instr_state == InstructionMode::ARM) {
-			u32 opcode = m_ctx.m_pipeline.Pop<InstructionMode::ARM>();
-
-			arm::ExecuteArm(opcode, m_ctx, m_bus, branch);
+		if (m_jit) {
+			//Translated code is entered only
+			//at the start of a block
+			CachedBlock* block = m_block_cache.GetCurrentBlock();
 
-			m_ctx.m_pipeline.Fetch<InstructionMode::ARM>();
+			if (cached == block->instructions.data() &&
+				m_jit->Run<thumb>(*block, branch))
+				return;
 		}
-		else {
-			u16 opcode = m_ctx.m_pipeline.Pop<InstructionMode::THUMB>();
 
-			thumb::ExecuteThumb(opcode, m_bus, m_ctx, branch);
+		//The instruction may overwrite its own
+		//block, so work on a copy
+		CachedInstruction instr = *cached;
 
-			m_ctx.m_pipeline.Fetch<InstructionMode::THUMB>();
+		if constexpr (thumb)
+			instr.handler.thumb(static_cast<u16>(instr.opcode), m_bus, m_ctx, branch);
+		else {
+			if (m_ctx.CheckCondition(instr.condition))
+				instr.handler.arm(instr.opcode, m_ctx, m_bus, branch);
+			else
+				m_bus->m_time.access = Access::Seq;
 		}
 
+		if (m_block_cache.IsCurrentValid()) [[likely]]
+			m_ctx.m_pipeline.FetchCached<InstrSet>(instr.fetch_opcode,
+				instr.fetch_cycles[(u8)m_bus->m_time.access]);
+		else
+			m_ctx.m_pipeline.Fetch<InstrSet>();
+	}
+
+	void ARM7TDI::AdvancePC(bool branch) {
 		if (branch) {
 			u32 pc = m_ctx.m_regs.GetReg(15);
 
@@ -237,6 +314,136 @@ namespace GBA::cpu {
 		}
 
 		m_ctx.m_old_pc = m_ctx.m_regs.GetReg(15);
+	}
+
+	template <InstructionMode InstrSet>
+	void ARM7TDI::RunLoop(uint64_t deadline) {
+		constexpr u32 size = InstrSet == InstructionMode::THUMB ? 2 : 4;
+
+		do {
+			bool branch = false;
+
+			Execute<InstrSet>(branch);
+
+			if (branch || m_ctx.m_cpsr.instr_state != InstrSet) [[unlikely]] {
+				AdvancePC(branch);
+
+				if (branch)
+					CheckIdleLoop(deadline);
+			}
+			else {
+				m_ctx.m_regs.AddOffset(15, size);
+				m_ctx.m_old_pc = m_ctx.m_regs.GetReg(15);
+			}
+		} while (m_sched->GetTimestamp() < deadline &&
+			m_bus->GetActiveDma() == 4 &&
+			m_ctx.m_cpsr.instr_state == InstrSet &&
+			!m_halt && !InterruptPending());
+	}
+
+	void ARM7TDI::CheckIdleLoop(uint64_t deadline) {
+		u32 pc = m_ctx.m_regs.GetReg(15);
+		uint64_t now = m_sched->GetTimestamp();
+
+		//Never skip past an event, it may
+		//change what the loop waits for, and
+		//let a pending IRQ be taken first
+		deadline = std::min(deadline, m_sched->GetFirstEvent().trigger_timestamp);
+
+		if (InterruptPending())
+			deadline = now;
+
+		if (!m_idle_loops.empty() && deadline > now &&
+			std::find(m_idle_loops.begin(), m_idle_loops.end(), pc) != m_idle_loops.end()) [[unlikely]] {
+			m_bus->InternalCycles(u32(deadline - now));
+			return;
+		}
+
+		CachedBlock const* block = m_block_cache.GetCurrentBlock();
+
+		if (block == nullptr || block->idle_end != m_block_cache.GetPosition() ||
+			block->start != pc) [[likely]] {
+			m_idle.address = NO_IDLE_LOOP;
+			return;
+		}
+
+		u32 cpsr = (u32)m_ctx.GetResolvedCPSR();
+		u32 timer_reads = m_bus->GetTimerReads();
+
+		bool same = m_idle.address == pc && m_idle.cpsr == cpsr &&
+			m_idle.timer_reads == timer_reads;
+
+		for (u8 id = 0; same && id < 15; id++)
+			same = m_idle.regs[id] == m_ctx.m_regs.GetReg(id);
+
+		if (same && deadline > now) {
+			//The loop only reads memory that no
+			//event changed, so every iteration
+			//takes the same time as the last one
+			uint64_t period = now - m_idle.timestamp;
+			uint64_t skipped = (deadline - now - 1) / period * period;
+
+			if (skipped) {
+				m_bus->InternalCycles(u32(skipped));
+				now += skipped;
+			}
+		}
+
+		m_idle.address = pc;
+		m_idle.cpsr = cpsr;
+		m_idle.timer_reads = timer_reads;
+		m_idle.timestamp = now;
+
+		for (u8 id = 0; id < 15; id++)
+			m_idle.regs[id] = m_ctx.m_regs.GetReg(id);
+	}
+
+	void ARM7TDI::Run(uint64_t deadline) {
+		//No translated code runs between two calls
+		if (m_jit && !m_block_cache.GetRetired().empty()) [[unlikely]]
+			m_jit->Release(m_block_cache.GetRetired());
+
+		while (m_sched->GetTimestamp() < deadline &&
+			m_bus->GetActiveDma() == 4) {
+			if (m_halt) [[unlikely]] {
+				if (!m_int_controller->IsRequested()) {
+					//Only an event can request an interrupt,
+					//so nothing happens until the next one
+					uint64_t now = m_sched->GetTimestamp();
+					uint64_t wake = std::min(deadline,
+						m_sched->GetFirstEvent().trigger_timestamp);
+
+					m_bus->InternalCycles(wake > now ? u32(wake - now) : 1);
+					continue;
+				}
+
+				m_halt = false;
+				m_bus->ResetHalt();
+			}
+
+			if (CheckIRQ()) {
+				m_ctx.EnterException(ExceptionCode::IRQ, 4);
+
+				m_ctx.m_pipeline.Bubble<InstructionMode::ARM>(
+					m_ctx.m_regs.GetReg(15)
+				);
+			}
+
+			//Iterations are only compared inside
+			//one run, where no event can happen
+			m_idle.address = NO_IDLE_LOOP;
+
+			if (m_ctx.m_cpsr.instr_state == InstructionMode::ARM)
+				RunLoop<InstructionMode::ARM>(deadline);
+			else
+				RunLoop<InstructionMode::THUMB>(deadline);
+		}
+	}
+
+	u8 ARM7TDI::Step() {
+		//Every instruction takes at least
+		//one cycle, as does a halted step
+		Run(m_sched->GetTimestamp() + 1);
 
 		return 0;
 	}
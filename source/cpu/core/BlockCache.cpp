@@ -0,0 +1,242 @@
+#include "../../../cpu/core/BlockCache.hpp"
+#include "../../../cpu/arm/ARM_Implementation.hpp"
+#include "../../../cpu/thumb/THUMB_Implementation.hpp"
+
+#include "../../../memory/Bus.hpp"
+
+#include <algorithm>
+
+namespace GBA::cpu {
+	using memory::MEMORY_RANGE;
+	using memory::Access;
+
+	namespace {
+		bool IsCacheable(u32 pc) {
+			MEMORY_RANGE region = (MEMORY_RANGE)(pc >> 24);
+
+			return region == MEMORY_RANGE::EWRAM ||
+				region == MEMORY_RANGE::IWRAM ||
+				(region >= MEMORY_RANGE::ROM_REG_1 &&
+					region <= MEMORY_RANGE::ROM_REG_3_SECOND);
+		}
+	}
+
+	BlockCache::BlockCache() :
+		m_bus(nullptr), m_blocks{}, m_lookup{},
+		m_pages{}, m_retired{}, m_curr_block(nullptr),
+		m_curr_index{}, m_next_pc{}
+	{}
+
+	CachedInstruction const* BlockCache::Enter(u32 pc, u32 decoded, bool thumb) {
+		m_curr_block = nullptr;
+
+		if (!IsCacheable(pc))
+			return nullptr;
+
+		u32 key = pc | u32(thumb);
+
+		CachedBlock*& slot = m_lookup[GetLookupIndex(key)];
+		CachedBlock* block = slot;
+
+		if (block == nullptr || block->start != pc || block->thumb != thumb) {
+			auto it = m_blocks.find(key);
+
+			if (it != m_blocks.end())
+				block = &it->second;
+			else
+				block = Build(pc, thumb);
+
+			slot = block;
+		}
+
+		if (block->instructions.empty() ||
+			block->instructions[0].opcode != decoded)
+			return nullptr;
+
+		m_curr_block = block;
+		m_curr_index = 1;
+		m_next_pc = pc + (thumb ? 2 : 4);
+
+		return &block->instructions[0];
+	}
+
+	CachedBlock* BlockCache::Build(u32 pc, bool thumb) {
+		u32 key = pc | u32(thumb);
+
+		CachedBlock& block = m_blocks[key];
+
+		block.start = pc;
+		block.thumb = thumb;
+		block.instructions.clear();
+		block.idle_end = 0;
+		block.exec_count = 0;
+		block.translation = nullptr;
+
+		u32 size = thumb ? 2 : 4;
+		u32 address = pc;
+
+		MEMORY_RANGE region = (MEMORY_RANGE)(pc >> 24);
+		bool is_ram = region == MEMORY_RANGE::EWRAM || region == MEMORY_RANGE::IWRAM;
+
+		//Blocks never wrap around RAM mirrors
+		u32 region_end = region == MEMORY_RANGE::EWRAM ?
+			(pc | (EWRAM_SIZE - 1)) + 1 : (pc | (IWRAM_SIZE - 1)) + 1;
+
+		block.instructions.reserve(16);
+
+		bool idle_safe = true;
+
+		while (block.instructions.size() < MAX_BLOCK_SIZE) {
+			u32 fetch_address = address + 2 * size;
+
+			if (is_ram && fetch_address + size > region_end)
+				break;
+
+			u8 const* instr_ptr = m_bus->GetCodePointer(address, size);
+			u8 const* fetch_ptr = m_bus->GetCodePointer(fetch_address, size);
+
+			if (!instr_ptr || !fetch_ptr)
+				break;
+
+			CachedInstruction instr{};
+
+			bool ends_block = false;
+			bool loops_back = false;
+			u32 target = 0;
+
+			if (thumb) {
+				u16 opcode = *reinterpret_cast<u16 const*>(instr_ptr);
+
+				instr.handler.thumb = thumb::GetThumbHandler(opcode);
+				instr.opcode = opcode;
+				instr.fetch_opcode = *reinterpret_cast<u16 const*>(fetch_ptr);
+				instr.condition = 0xE;
+
+				instr.fetch_cycles[(u8)Access::NonSeq] = (u8)m_bus->GetCodeFetchCycles<u16>(fetch_address, Access::NonSeq);
+				instr.fetch_cycles[(u8)Access::Seq] = (u8)m_bus->GetCodeFetchCycles<u16>(fetch_address, Access::Seq);
+
+				ends_block = EndsThumbBlock(opcode);
+
+				loops_back = GetThumbBranchTarget(opcode, address, target) && target == pc;
+				idle_safe = idle_safe && (loops_back || IsIdleSafeThumb(opcode));
+			}
+			else {
+				u32 opcode = *reinterpret_cast<u32 const*>(instr_ptr);
+				u16 hash = ((opcode >> 16) & 0xFF0) | ((opcode >> 4) & 0xF);
+
+				instr.handler.arm = arm::arm_jump_table[hash];
+				instr.opcode = opcode;
+				instr.fetch_opcode = *reinterpret_cast<u32 const*>(fetch_ptr);
+				instr.condition = u8(opcode >> 28);
+
+				instr.fetch_cycles[(u8)Access::NonSeq] = (u8)m_bus->GetCodeFetchCycles<u32>(fetch_address, Access::NonSeq);
+				instr.fetch_cycles[(u8)Access::Seq] = (u8)m_bus->GetCodeFetchCycles<u32>(fetch_address, Access::Seq);
+
+				ends_block = EndsArmBlock(opcode);
+
+				loops_back = GetArmBranchTarget(opcode, address, target) && target == pc;
+				idle_safe = idle_safe && (loops_back || IsIdleSafeArm(opcode));
+			}
+
+			block.instructions.push_back(instr);
+
+			if (idle_safe && loops_back && !block.idle_end)
+				block.idle_end = u32(block.instructions.size());
+
+			address += size;
+
+			if (ends_block)
+				break;
+		}
+
+		//The block covers its instructions and
+		//the two opcodes fetched ahead of the last one
+		block.end = block.instructions.empty() ? pc : address + 2 * size;
+
+		//Register the block in every RAM page it touches
+		if (is_ram && !block.instructions.empty()) {
+			bool iwram = region == MEMORY_RANGE::IWRAM;
+
+			u32 first_page = iwram ? GetPageIndex<true>(pc) : GetPageIndex<false>(pc);
+			u32 last_page = iwram ? GetPageIndex<true>(block.end - 1) : GetPageIndex<false>(block.end - 1);
+
+			for (u32 page = first_page; page <= last_page; page++) {
+				auto& keys = m_pages[page];
+
+				if (std::find(keys.begin(), keys.end(), key) == keys.end())
+					keys.push_back(key);
+			}
+		}
+
+		return &block;
+	}
+
+	void BlockCache::InvalidatePage(u32 page, u32 offset, u32 len) {
+		auto& keys = m_pages[page];
+
+		//Only blocks that overlap the written
+		//range are dropped, data living next to
+		//code does not cause rebuilds
+		for (std::size_t i = 0; i < keys.size();) {
+			auto it = m_blocks.find(keys[i]);
+
+			if (it == m_blocks.end()) {
+				keys[i] = keys.back();
+				keys.pop_back();
+				continue;
+			}
+
+			CachedBlock const& block = it->second;
+
+			u32 block_offset = (MEMORY_RANGE)(block.start >> 24) == MEMORY_RANGE::IWRAM ?
+				GetOffset<true>(block.start) : GetOffset<false>(block.start);
+			u32 block_len = block.end - block.start;
+
+			if (offset < block_offset + block_len && block_offset < offset + len) {
+				Erase(keys[i]);
+				keys[i] = keys.back();
+				keys.pop_back();
+				continue;
+			}
+
+			i++;
+		}
+	}
+
+	void BlockCache::Erase(u32 key) {
+		auto it = m_blocks.find(key);
+
+		if (it == m_blocks.end())
+			return;
+
+		CachedBlock* block = &it->second;
+
+		if (block == m_curr_block)
+			m_curr_block = nullptr;
+
+		CachedBlock*& slot = m_lookup[GetLookupIndex(key)];
+
+		if (slot == block)
+			slot = nullptr;
+
+		if (block->translation != nullptr)
+			m_retired.push_back({ block->translation, block->generation });
+
+		m_blocks.erase(it);
+	}
+
+	void BlockCache::Flush() {
+		for (auto const& [key, block] : m_blocks) {
+			if (block.translation != nullptr)
+				m_retired.push_back({ block.translation, block.generation });
+		}
+
+		m_blocks.clear();
+		m_lookup.fill(nullptr);
+
+		for (auto& page : m_pages)
+			page.clear();
+
+		m_curr_block = nullptr;
+	}
+}
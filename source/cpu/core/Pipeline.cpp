@@ -3,7 +3,8 @@
 namespace GBA::cpu {
 	Pipeline::Pipeline() :
 		m_fetch_pc(0x0), m_fetched(0x0),
-		m_decoded(0x0), m_bus(nullptr)
+		m_decoded(0x0), m_bus(nullptr),
+		m_windows{}
 	{}
 
 	u32 Pipeline::GetFetchPC() const {
@@ -0,0 +1,804 @@
+#include "../../../cpu/hle/Bios.hpp"
+
+#include "../../../cpu/core/CPUContext.hpp"
+#include "../../../memory/Bus.hpp"
+#include "../../../common/Logger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <vector>
+
+namespace GBA::cpu::hle {
+	LOG_CONTEXT(HLE_BIOS);
+
+	namespace {
+		/*
+		* Approximate cost of the BIOS code
+		* itself, memory accesses are charged
+		* by the bus
+		*/
+		static constexpr u32 CALL_CYCLES = 30;
+		static constexpr u32 COPY_CYCLES = 3;
+		static constexpr u32 FAST_COPY_CYCLES = 4;
+		static constexpr u32 UNPACK_CYCLES = 6;
+		static constexpr u32 AFFINE_CYCLES = 50;
+
+		//Interrupts acknowledged by the game handler
+		static constexpr u32 BIOS_IF = 0x03007FF8;
+		static constexpr u32 RESET_FLAG = 0x03007FFA;
+
+		static constexpr u32 REG_DISPCNT = 0x04000000;
+		static constexpr u32 REG_SOUNDBIAS = 0x04000088;
+		static constexpr u32 REG_IME = 0x04000208;
+		static constexpr u32 REG_HALTCNT = 0x04000301;
+
+		//Reads from the BIOS region are refused
+		static constexpr u32 PROTECTED_MASK = 0x0E000000;
+
+		static constexpr std::array<u32, 8> VECTORS = {
+			0xE3A0F302, //mov pc, #0x08000000
+			0xE1B0F00E, //movs pc, lr
+			0xE1B0F00E, //movs pc, lr (unimplemented SWI)
+			0xE25EF004, //subs pc, lr, #4
+			0xE25EF008, //subs pc, lr, #8
+			0xE1A00000, //nop
+			0xEA000042, //b 0x128
+			0xE25EF004  //subs pc, lr, #4
+		};
+
+		//Same address and code as the original
+		static constexpr u32 IRQ_HANDLER = 0x128;
+
+		static constexpr std::array<u32, 6> IRQ_DISPATCHER = {
+			0xE92D500F, //stmfd sp!, {r0-r3, r12, lr}
+			0xE3A00301, //mov r0, #0x04000000
+			0xE28FE000, //add lr, pc, #0
+			0xE510F004, //ldr pc, [r0, #-4]
+			0xE8BD500F, //ldmfd sp!, {r0-r3, r12, lr}
+			0xE25EF004  //subs pc, lr, #4
+		};
+
+		//Open bus value after startup
+		static constexpr u32 STARTUP_LATCH_ADDRESS = 0xE4;
+		static constexpr u32 STARTUP_LATCH = 0xE129F000;
+
+		//sin(2 * pi * i / 256) in 2.14 fixed point
+		std::array<i32, 256> const SINE_TABLE = []() {
+			std::array<i32, 256> table{};
+
+			for (u32 index = 0; index < table.size(); index++)
+				table[index] = i32(std::lround(std::sin(
+					index * 2 * std::numbers::pi / table.size()) * 0x4000));
+
+			return table;
+		}();
+
+		u32 Reg(CPUContext& ctx, u8 id) {
+			return ctx.m_regs.GetReg(id);
+		}
+
+		void SetReg(CPUContext& ctx, u8 id, u32 value) {
+			ctx.m_regs.SetReg(id, value);
+		}
+
+		void Div(CPUContext& ctx, memory::Bus* bus, i32 num, i32 den) {
+			i32 quot{}, rem{};
+
+			if (!den) {
+				//The BIOS never returns
+				LOG_ERROR("Division by zero");
+				quot = num < 0 ? -1 : 1;
+				rem = num;
+			}
+			else if (num == std::numeric_limits<i32>::min() && den == -1) {
+				quot = num;
+				rem = 0;
+			}
+			else {
+				quot = num / den;
+				rem = num % den;
+			}
+
+			u32 abs_num = num < 0 ? 0u - u32(num) : u32(num);
+			u32 abs_den = den < 0 ? 0u - u32(den) : u32(den);
+
+			SetReg(ctx, 0, u32(quot));
+			SetReg(ctx, 1, u32(rem));
+			SetReg(ctx, 3, quot < 0 ? 0u - u32(quot) : u32(quot));
+
+			//One iteration for each bit of the quotient
+			int loops = std::countl_zero(abs_den) - std::countl_zero(abs_num);
+
+			bus->InternalCycles(CALL_CYCLES + 13 * u32(std::max(loops, 1)) + 11);
+		}
+
+		void Sqrt(CPUContext& ctx, memory::Bus* bus) {
+			u32 value = Reg(ctx, 0);
+			u32 root = 0;
+			u32 bit = 1u << 30;
+
+			while (bit > value)
+				bit >>= 2;
+
+			while (bit) {
+				if (value >= root + bit) {
+					value -= root + bit;
+					root = (root >> 1) + bit;
+				}
+				else {
+					root >>= 1;
+				}
+
+				bit >>= 2;
+			}
+
+			SetReg(ctx, 0, root);
+
+			bus->InternalCycles(CALL_CYCLES + 60);
+		}
+
+		//Polynomial of the BIOS, tan in 1.14 fixed point
+		i32 ArcTan(i32 tan, i32& a, i32& b) {
+			a = -((tan * tan) >> 14);
+			b = ((0xA9 * a) >> 14) + 0x390;
+			b = ((b * a) >> 14) + 0x91C;
+			b = ((b * a) >> 14) + 0xFB6;
+			b = ((b * a) >> 14) + 0x16AA;
+			b = ((b * a) >> 14) + 0x2081;
+			b = ((b * a) >> 14) + 0x3651;
+			b = ((b * a) >> 14) + 0xA2F9;
+
+			return (tan * b) >> 16;
+		}
+
+		u16 ArcTan2(i32 x, i32 y, i32& a) {
+			i32 b{};
+
+			if (!y)
+				return x >= 0 ? 0 : 0x8000;
+
+			if (!x)
+				return y >= 0 ? 0x4000 : 0xC000;
+
+			if (y >= 0) {
+				if (x >= 0) {
+					if (x >= y)
+						return u16(ArcTan((y << 14) / x, a, b));
+				}
+				else if (-x >= y) {
+					return u16(ArcTan((y << 14) / x, a, b) + 0x8000);
+				}
+
+				return u16(0x4000 - ArcTan((x << 14) / y, a, b));
+			}
+
+			if (x <= 0) {
+				if (-x > -y)
+					return u16(ArcTan((y << 14) / x, a, b) + 0x8000);
+			}
+			else if (x >= -y) {
+				return u16(ArcTan((y << 14) / x, a, b) + 0x10000);
+			}
+
+			return u16(0xC000 - ArcTan((x << 14) / y, a, b));
+		}
+
+		void CpuSet(CPUContext& ctx, memory::Bus* bus) {
+			u32 src = Reg(ctx, 0);
+			u32 dst = Reg(ctx, 1);
+			u32 control = Reg(ctx, 2);
+
+			u32 count = control & 0x1FFFFF;
+			bool fill = control & (1 << 24);
+
+			if (!(src & PROTECTED_MASK))
+				return;
+
+			if (control & (1 << 26)) {
+				src &= ~3;
+				dst &= ~3;
+
+				u32 value = fill ? bus->Read<u32>(src) : 0;
+
+				for (u32 unit = 0; unit < count; unit++) {
+					if (!fill)
+						value = bus->Read<u32>(src + unit * 4);
+
+					bus->Write<u32>(dst + unit * 4, value);
+				}
+			}
+			else {
+				src &= ~1;
+				dst &= ~1;
+
+				u16 value = fill ? bus->Read<u16>(src) : 0;
+
+				for (u32 unit = 0; unit < count; unit++) {
+					if (!fill)
+						value = bus->Read<u16>(src + unit * 2);
+
+					bus->Write<u16>(dst + unit * 2, value);
+				}
+			}
+
+			bus->InternalCycles(CALL_CYCLES + count * COPY_CYCLES);
+		}
+
+		void CpuFastSet(CPUContext& ctx, memory::Bus* bus) {
+			u32 src = Reg(ctx, 0) & ~3;
+			u32 dst = Reg(ctx, 1) & ~3;
+			u32 control = Reg(ctx, 2);
+
+			//Always blocks of 8 words
+			u32 count = ((control & 0x1FFFFF) + 7) & ~7;
+			bool fill = control & (1 << 24);
+
+			if (!(src & PROTECTED_MASK))
+				return;
+
+			u32 value = fill ? bus->Read<u32>(src) : 0;
+
+			for (u32 unit = 0; unit < count; unit++) {
+				if (!fill)
+					value = bus->Read<u32>(src + unit * 4);
+
+				bus->Write<u32>(dst + unit * 4, value);
+			}
+
+			bus->InternalCycles(CALL_CYCLES + count / 8 * FAST_COPY_CYCLES);
+		}
+
+		void BgAffineSet(CPUContext& ctx, memory::Bus* bus) {
+			u32 src = Reg(ctx, 0);
+			u32 dst = Reg(ctx, 1);
+			u32 count = Reg(ctx, 2);
+
+			for (u32 entry = 0; entry < count; entry++) {
+				i32 ox = i32(bus->Read<u32>(src));
+				i32 oy = i32(bus->Read<u32>(src + 4));
+				i32 cx = i16(bus->Read<u16>(src + 8));
+				i32 cy = i16(bus->Read<u16>(src + 10));
+				i32 sx = i16(bus->Read<u16>(src + 12));
+				i32 sy = i16(bus->Read<u16>(src + 14));
+				u8 angle = bus->Read<u16>(src + 16) >> 8;
+
+				i32 sin = SINE_TABLE[angle];
+				i32 cos = SINE_TABLE[u8(angle + 0x40)];
+
+				i32 pa = (sx * cos) >> 14;
+				i32 pb = (-sx * sin) >> 14;
+				i32 pc = (sy * sin) >> 14;
+				i32 pd = (sy * cos) >> 14;
+
+				bus->Write<u16>(dst, u16(pa));
+				bus->Write<u16>(dst + 2, u16(pb));
+				bus->Write<u16>(dst + 4, u16(pc));
+				bus->Write<u16>(dst + 6, u16(pd));
+				bus->Write<u32>(dst + 8, u32(ox - (pa * cx + pb * cy)));
+				bus->Write<u32>(dst + 12, u32(oy - (pc * cx + pd * cy)));
+
+				src += 20;
+				dst += 16;
+			}
+
+			bus->InternalCycles(CALL_CYCLES + count * AFFINE_CYCLES);
+		}
+
+		void ObjAffineSet(CPUContext& ctx, memory::Bus* bus) {
+			u32 src = Reg(ctx, 0);
+			u32 dst = Reg(ctx, 1);
+			u32 count = Reg(ctx, 2);
+			u32 stride = Reg(ctx, 3);
+
+			for (u32 entry = 0; entry < count; entry++) {
+				i32 sx = i16(bus->Read<u16>(src));
+				i32 sy = i16(bus->Read<u16>(src + 2));
+				u8 angle = bus->Read<u16>(src + 4) >> 8;
+
+				i32 sin = SINE_TABLE[angle];
+				i32 cos = SINE_TABLE[u8(angle + 0x40)];
+
+				bus->Write<u16>(dst, u16((sx * cos) >> 14));
+				bus->Write<u16>(dst + stride, u16((-sx * sin) >> 14));
+				bus->Write<u16>(dst + stride * 2, u16((sy * sin) >> 14));
+				bus->Write<u16>(dst + stride * 3, u16((sy * cos) >> 14));
+
+				src += 8;
+				dst += stride * 4;
+			}
+
+			bus->InternalCycles(CALL_CYCLES + count * AFFINE_CYCLES);
+		}
+
+		void BitUnPack(CPUContext& ctx, memory::Bus* bus) {
+			u32 src = Reg(ctx, 0);
+			u32 dst = Reg(ctx, 1) & ~3;
+			u32 info = Reg(ctx, 2);
+
+			u16 len = bus->Read<u16>(info);
+			u8 src_width = bus->Read<u8>(info + 2);
+			u8 dst_width = bus->Read<u8>(info + 3);
+			u32 offset = bus->Read<u32>(info + 4);
+
+			bool zero_data = offset >> 31;
+			offset &= 0x7FFFFFFF;
+
+			if (!std::has_single_bit(src_width) || src_width > 8 ||
+				!std::has_single_bit(dst_width) || dst_width > 32) {
+				LOG_ERROR("Invalid BitUnPack widths {} -> {}", src_width, dst_width);
+				return;
+			}
+
+			u32 src_mask = (1u << src_width) - 1;
+			u32 dst_mask = dst_width == 32 ? 0xFFFFFFFF : (1u << dst_width) - 1;
+
+			u32 out = 0;
+			u32 out_bits = 0;
+
+			for (u32 pos = 0; pos < len; pos++) {
+				u8 value = bus->Read<u8>(src + pos);
+
+				for (u32 bit = 0; bit < 8; bit += src_width) {
+					u32 unit = (value >> bit) & src_mask;
+
+					if (unit || zero_data)
+						unit += offset;
+
+					out |= (unit & dst_mask) << out_bits;
+					out_bits += dst_width;
+
+					if (out_bits == 32) {
+						bus->Write<u32>(dst, out);
+						dst += 4;
+						out = 0;
+						out_bits = 0;
+					}
+				}
+			}
+
+			bus->InternalCycles(CALL_CYCLES + len * UNPACK_CYCLES);
+		}
+
+		/*
+		* Decompressors produce the whole output
+		* first, VRAM variants write halfwords
+		* since VRAM ignores byte writes
+		*/
+		void StoreOutput(memory::Bus* bus, u32 dst, std::vector<u8> const& data, bool vram) {
+			u32 size = u32(data.size());
+
+			if (vram) {
+				u32 pos = 0;
+
+				for (; pos + 1 < size; pos += 2)
+					bus->Write<u16>(dst + pos, u16(data[pos] | (data[pos + 1] << 8)));
+
+				//Odd sizes keep the upper byte of the last halfword
+				if (pos < size)
+					bus->Write<u16>(dst + pos, u16((bus->Read<u16>(dst + pos) & 0xFF00) | data[pos]));
+			}
+			else {
+				for (u32 pos = 0; pos < size; pos++)
+					bus->Write<u8>(dst + pos, data[pos]);
+			}
+
+			bus->InternalCycles(CALL_CYCLES + size * UNPACK_CYCLES);
+		}
+
+		void LZ77UnComp(CPUContext& ctx, memory::Bus* bus, bool vram) {
+			u32 src = Reg(ctx, 0);
+			u32 dst = Reg(ctx, 1);
+
+			if (!(src & PROTECTED_MASK))
+				return;
+
+			u32 size = bus->Read<u32>(src) >> 8;
+			src += 4;
+
+			std::vector<u8> out{};
+			out.reserve(size);
+
+			while (out.size() < size) {
+				u8 flags = bus->Read<u8>(src++);
+
+				for (u8 block = 0; block < 8 && out.size() < size; block++, flags <<= 1) {
+					if (!(flags & 0x80)) {
+						out.push_back(bus->Read<u8>(src++));
+						continue;
+					}
+
+					u8 first = bus->Read<u8>(src++);
+					u8 second = bus->Read<u8>(src++);
+
+					u32 len = (first >> 4) + 3;
+					u32 disp = (((first & 0xF) << 8) | second) + 1;
+
+					while (len-- && out.size() < size) {
+						u32 pos = u32(out.size());
+
+						//Data before the output is
+						//read back from memory
+						out.push_back(disp <= pos ? out[pos - disp] :
+							bus->Read<u8>(dst + pos - disp));
+					}
+				}
+			}
+
+			StoreOutput(bus, dst, out, vram);
+		}
+
+		void HuffUnComp(CPUContext& ctx, memory::Bus* bus) {
+			u32 src = Reg(ctx, 0);
+			u32 dst = Reg(ctx, 1) & ~3;
+
+			if (!(src & PROTECTED_MASK))
+				return;
+
+			u32 header = bus->Read<u32>(src);
+			u32 data_bits = header & 0xF;
+			u32 size = header >> 8;
+
+			if (data_bits != 4 && data_bits != 8) {
+				LOG_ERROR("Invalid Huffman data size {}", data_bits);
+				return;
+			}
+
+			u32 tree = src + 4;
+			u32 root = tree + 1;
+			u32 stream = tree + (bus->Read<u8>(tree) + 1) * 2;
+
+			u32 node_address = root;
+			u8 node = bus->Read<u8>(root);
+
+			u32 out = 0;
+			u32 out_bits = 0;
+			u32 written = 0;
+
+			while (written < size) {
+				u32 word = bus->Read<u32>(stream);
+				stream += 4;
+
+				for (int bit = 31; bit >= 0 && written < size; bit--) {
+					bool right = (word >> bit) & 1;
+					u32 child = (node_address & ~1) + (node & 0x3F) * 2 + 2 + right;
+
+					if (!(node & (right ? 0x40 : 0x80))) {
+						node_address = child;
+						node = bus->Read<u8>(child);
+						continue;
+					}
+
+					out |= (bus->Read<u8>(child) & ((1u << data_bits) - 1)) << out_bits;
+					out_bits += data_bits;
+
+					if (out_bits == 32) {
+						bus->Write<u32>(dst + written, out);
+						written += 4;
+						out = 0;
+						out_bits = 0;
+					}
+
+					node_address = root;
+					node = bus->Read<u8>(root);
+				}
+			}
+
+			bus->InternalCycles(CALL_CYCLES + size * 2 * UNPACK_CYCLES);
+		}
+
+		void RLUnComp(CPUContext& ctx, memory::Bus* bus, bool vram) {
+			u32 src = Reg(ctx, 0);
+			u32 dst = Reg(ctx, 1);
+
+			if (!(src & PROTECTED_MASK))
+				return;
+
+			u32 size = bus->Read<u32>(src) >> 8;
+			src += 4;
+
+			std::vector<u8> out{};
+			out.reserve(size);
+
+			while (out.size() < size) {
+				u8 flag = bus->Read<u8>(src++);
+
+				if (flag & 0x80) {
+					u32 len = (flag & 0x7F) + 3;
+					u8 value = bus->Read<u8>(src++);
+
+					while (len-- && out.size() < size)
+						out.push_back(value);
+				}
+				else {
+					u32 len = (flag & 0x7F) + 1;
+
+					while (len-- && out.size() < size)
+						out.push_back(bus->Read<u8>(src++));
+				}
+			}
+
+			StoreOutput(bus, dst, out, vram);
+		}
+
+		void DiffUnFilter(CPUContext& ctx, memory::Bus* bus, bool halfwords, bool vram) {
+			u32 src = Reg(ctx, 0);
+			u32 dst = Reg(ctx, 1);
+
+			if (!(src & PROTECTED_MASK))
+				return;
+
+			u32 size = bus->Read<u32>(src) >> 8;
+			src += 4;
+
+			std::vector<u8> out(size);
+
+			if (halfwords) {
+				u16 value = 0;
+
+				for (u32 pos = 0; pos + 1 < size; pos += 2) {
+					value += bus->Read<u16>(src + pos);
+					out[pos] = u8(value);
+					out[pos + 1] = u8(value >> 8);
+				}
+			}
+			else {
+				u8 value = 0;
+
+				for (u32 pos = 0; pos < size; pos++) {
+					value += bus->Read<u8>(src + pos);
+					out[pos] = value;
+				}
+			}
+
+			StoreOutput(bus, dst, out, vram);
+		}
+
+		void Fill(memory::Bus* bus, u32 address, u32 size) {
+			for (u32 offset = 0; offset < size; offset += 4)
+				bus->Write<u32>(address + offset, 0);
+		}
+
+		void RegisterRamReset(CPUContext& ctx, memory::Bus* bus) {
+			u32 flags = Reg(ctx, 0);
+
+			bus->Write<u16>(REG_DISPCNT, 0x80);
+
+			if (flags & (1 << 0))
+				Fill(bus, 0x02000000, 0x40000);
+
+			//The last 0x200 bytes are used by the BIOS
+			if (flags & (1 << 1))
+				Fill(bus, 0x03000000, 0x7E00);
+
+			if (flags & (1 << 2))
+				Fill(bus, 0x05000000, 0x400);
+
+			if (flags & (1 << 3))
+				Fill(bus, 0x06000000, 0x18000);
+
+			if (flags & (1 << 4))
+				Fill(bus, 0x07000000, 0x400);
+
+			if (flags & 0xE0)
+				LOG_INFO("RegisterRamReset of IO registers not implemented");
+
+			bus->InternalCycles(CALL_CYCLES);
+		}
+
+		void SoftReset(CPUContext& ctx, memory::Bus* bus, bool& branch) {
+			bool ram_start = bus->Read<u8>(RESET_FLAG);
+
+			Fill(bus, 0x03007E00, 0x200);
+
+			ctx.ResolveFlags();
+
+			ctx.m_regs.SetReg(Mode::IRQ, 13, 0x03007FA0);
+			ctx.m_regs.SetReg(Mode::IRQ, 14, 0);
+			ctx.m_regs.SetReg(Mode::SWI, 13, 0x03007FE0);
+			ctx.m_regs.SetReg(Mode::SWI, 14, 0);
+			ctx.m_regs.SetReg(Mode::SYS, 13, 0x03007F00);
+			ctx.m_regs.SwitchMode(Mode::SYS);
+
+			for (u8 id = 0; id < 13; id++)
+				SetReg(ctx, id, 0);
+
+			SetReg(ctx, 14, 0);
+			SetReg(ctx, 15, ram_start ? 0x02000000 : 0x08000000);
+
+			ctx.m_cpsr = CPSR{};
+			ctx.m_cpsr.mode = Mode::SYS;
+
+			branch = true;
+		}
+
+		/*
+		* Checks the flags once, otherwise halts
+		* and executes the SWI again when woken up
+		* (after the IRQ handler returns)
+		*/
+		void IntrWait(CPUContext& ctx, memory::Bus* bus, bool& branch) {
+			u32 wanted = Reg(ctx, 1) & 0x3FFF;
+			u16 flags = bus->Read<u16>(BIOS_IF);
+
+			//Only discard old flags when the wait starts
+			if (!bus->IsHleWaiting() && Reg(ctx, 0)) {
+				flags &= ~wanted;
+				bus->Write<u16>(BIOS_IF, flags);
+				SetReg(ctx, 0, 0);
+			}
+
+			bus->InternalCycles(CALL_CYCLES);
+
+			if (flags & wanted) {
+				bus->Write<u16>(BIOS_IF, flags & ~wanted);
+				bus->SetHleWaiting(false);
+				return;
+			}
+
+			bus->Write<u16>(REG_IME, 1);
+			bus->Write<u8>(REG_HALTCNT, 0);
+			bus->SetHleWaiting(true);
+
+			branch = true;
+		}
+
+		void MidiKey2Freq(CPUContext& ctx, memory::Bus* bus) {
+			u32 wave = Reg(ctx, 0);
+			u8 key = u8(Reg(ctx, 1));
+			u8 fine = u8(Reg(ctx, 2));
+
+			double exponent = (180.0 - key - fine / 256.0) / 12.0;
+
+			SetReg(ctx, 0, u32(bus->Read<u32>(wave + 4) / std::exp2(exponent)));
+
+			bus->InternalCycles(CALL_CYCLES + 100);
+		}
+	}
+
+	void LoadBiosImage(u8* bios) {
+		std::fill_n(bios, BIOS_SIZE, 0);
+
+		u32* words = reinterpret_cast<u32*>(bios);
+
+		std::copy(VECTORS.begin(), VECTORS.end(), words);
+		std::copy(IRQ_DISPATCHER.begin(), IRQ_DISPATCHER.end(), words + IRQ_HANDLER / 4);
+
+		words[STARTUP_LATCH_ADDRESS / 4] = STARTUP_LATCH;
+	}
+
+	bool SoftwareInterrupt(u8 number, CPUContext& ctx, memory::Bus* bus, bool& branch) {
+		switch (number)
+		{
+		case 0x00:
+			SoftReset(ctx, bus, branch);
+			break;
+
+		case 0x01:
+			RegisterRamReset(ctx, bus);
+			break;
+
+		case 0x02:
+			bus->Write<u8>(REG_HALTCNT, 0);
+			break;
+
+		case 0x03:
+			bus->Write<u8>(REG_HALTCNT, 0x80);
+			break;
+
+		case 0x04:
+			IntrWait(ctx, bus, branch);
+			break;
+
+		case 0x05:
+			if (!bus->IsHleWaiting()) {
+				SetReg(ctx, 0, 1);
+				SetReg(ctx, 1, 1);
+			}
+
+			IntrWait(ctx, bus, branch);
+			break;
+
+		case 0x06:
+			Div(ctx, bus, i32(Reg(ctx, 0)), i32(Reg(ctx, 1)));
+			break;
+
+		case 0x07:
+			Div(ctx, bus, i32(Reg(ctx, 1)), i32(Reg(ctx, 0)));
+			break;
+
+		case 0x08:
+			Sqrt(ctx, bus);
+			break;
+
+		case 0x09: {
+			i32 a{}, b{};
+			SetReg(ctx, 0, u32(ArcTan(i16(Reg(ctx, 0)), a, b)));
+			SetReg(ctx, 1, u32(a));
+			SetReg(ctx, 3, u32(b));
+			bus->InternalCycles(CALL_CYCLES + 40);
+		}
+		break;
+
+		case 0x0A: {
+			i32 a{};
+			SetReg(ctx, 0, ArcTan2(i16(Reg(ctx, 0)), i16(Reg(ctx, 1)), a));
+			SetReg(ctx, 1, u32(a));
+			SetReg(ctx, 3, 0x170);
+			bus->InternalCycles(CALL_CYCLES + 80);
+		}
+		break;
+
+		case 0x0B:
+			CpuSet(ctx, bus);
+			break;
+
+		case 0x0C:
+			CpuFastSet(ctx, bus);
+			break;
+
+		case 0x0D:
+			SetReg(ctx, 0, 0xBAAE187F);
+			break;
+
+		case 0x0E:
+			BgAffineSet(ctx, bus);
+			break;
+
+		case 0x0F:
+			ObjAffineSet(ctx, bus);
+			break;
+
+		case 0x10:
+			BitUnPack(ctx, bus);
+			break;
+
+		case 0x11:
+		case 0x12:
+			LZ77UnComp(ctx, bus, number == 0x12);
+			break;
+
+		case 0x13:
+			HuffUnComp(ctx, bus);
+			break;
+
+		case 0x14:
+		case 0x15:
+			RLUnComp(ctx, bus, number == 0x15);
+			break;
+
+		case 0x16:
+		case 0x17:
+			DiffUnFilter(ctx, bus, false, number == 0x17);
+			break;
+
+		case 0x18:
+			DiffUnFilter(ctx, bus, true, true);
+			break;
+
+		case 0x19: {
+			u16 bias = bus->Read<u16>(REG_SOUNDBIAS) & ~0x3FF;
+			bus->Write<u16>(REG_SOUNDBIAS, bias | (Reg(ctx, 0) ? 0x200 : 0));
+		}
+		break;
+
+		case 0x1F:
+			MidiKey2Freq(ctx, bus);
+			break;
+
+		case 0x27:
+			bus->Write<u8>(REG_HALTCNT, u8(Reg(ctx, 2)));
+			break;
+
+		default:
+			//Sound driver, multiboot and
+			//HardReset are left to the BIOS
+			return false;
+		}
+
+		return true;
+	}
+}
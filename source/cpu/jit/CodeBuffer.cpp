@@ -0,0 +1,49 @@
+#include "../../../cpu/jit/CodeBuffer.hpp"
+
+#include <cstring>
+
+#if defined(WIN32) || defined(__WIN32__) || defined(_WIN32)
+	#include <Windows.h>
+#else
+	#include <sys/mman.h>
+#endif
+
+namespace GBA::cpu::jit {
+	CodeBuffer::CodeBuffer(std::size_t size) :
+		m_base(nullptr), m_size(size), m_used(0) {
+#if defined(WIN32) || defined(__WIN32__) || defined(_WIN32)
+		m_base = (u8*)VirtualAlloc(nullptr, size,
+			MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+#else
+		void* map = mmap(nullptr, size, PROT_READ | PROT_WRITE | PROT_EXEC,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (map != MAP_FAILED)
+			m_base = (u8*)map;
+#endif
+	}
+
+	CodeBuffer::~CodeBuffer() {
+		if (!m_base)
+			return;
+
+#if defined(WIN32) || defined(__WIN32__) || defined(_WIN32)
+		VirtualFree(m_base, 0, MEM_RELEASE);
+#else
+		munmap(m_base, m_size);
+#endif
+	}
+
+	void const* CodeBuffer::Commit(u8 const* code, std::size_t size) {
+		//Keep every entry point 16 byte aligned
+		std::size_t start = (m_used + 15) & ~std::size_t(15);
+
+		if (!m_base || start + size > m_size)
+			return nullptr;
+
+		std::memcpy(m_base + start, code, size);
+		m_used = start + size;
+
+		return m_base + start;
+	}
+}
@@ -0,0 +1,237 @@
+#include "../../../cpu/jit/Emitter.hpp"
+
+namespace GBA::cpu::jit {
+	namespace {
+		constexpr u8 Low(Reg reg) {
+			return u8(reg) & 7;
+		}
+
+		constexpr bool High(Reg reg) {
+			return u8(reg) >= 8;
+		}
+	}
+
+	Emitter::Emitter() :
+		m_code{} {
+		m_code.reserve(1024);
+	}
+
+	void Emitter::Byte(u8 value) {
+		m_code.push_back(value);
+	}
+
+	void Emitter::Dword(u32 value) {
+		for (u32 i = 0; i < 4; i++)
+			Byte(u8(value >> (i * 8)));
+	}
+
+	void Emitter::Qword(uint64_t value) {
+		for (u32 i = 0; i < 8; i++)
+			Byte(u8(value >> (i * 8)));
+	}
+
+	void Emitter::Rex(bool wide, Reg reg, Reg rm, bool force) {
+		u8 rex = 0x40 | (u8(wide) << 3) |
+			(u8(High(reg)) << 2) | u8(High(rm));
+
+		if (rex != 0x40 || force)
+			Byte(rex);
+	}
+
+	void Emitter::ModRM(Reg reg, Reg rm) {
+		Byte(0xC0 | (Low(reg) << 3) | Low(rm));
+	}
+
+	void Emitter::ModRM(u8 ext, Reg rm) {
+		Byte(0xC0 | (ext << 3) | Low(rm));
+	}
+
+	void Emitter::Memory(Reg reg, Reg base, i32 disp) {
+		//Always mod = 10 (disp32), rsp/r12
+		//as base need a SIB byte
+		Byte(0x80 | (Low(reg) << 3) | Low(base));
+
+		if (Low(base) == 4)
+			Byte(0x24);
+
+		Dword(u32(disp));
+	}
+
+	void Emitter::Push(Reg reg) {
+		if (High(reg))
+			Byte(0x41);
+		Byte(0x50 + Low(reg));
+	}
+
+	void Emitter::Pop(Reg reg) {
+		if (High(reg))
+			Byte(0x41);
+		Byte(0x58 + Low(reg));
+	}
+
+	void Emitter::Mov32(Reg dest, Reg source) {
+		Rex(false, source, dest);
+		Byte(0x89);
+		ModRM(source, dest);
+	}
+
+	void Emitter::Mov64(Reg dest, Reg source) {
+		Rex(true, source, dest);
+		Byte(0x89);
+		ModRM(source, dest);
+	}
+
+	void Emitter::MovImm32(Reg dest, u32 imm) {
+		Rex(false, Reg::RAX, dest);
+		Byte(0xB8 + Low(dest));
+		Dword(imm);
+	}
+
+	void Emitter::MovImm64(Reg dest, uint64_t imm) {
+		Rex(true, Reg::RAX, dest);
+		Byte(0xB8 + Low(dest));
+		Qword(imm);
+	}
+
+	void Emitter::Load32(Reg dest, Reg base, i32 disp) {
+		Rex(false, dest, base);
+		Byte(0x8B);
+		Memory(dest, base, disp);
+	}
+
+	void Emitter::Store32(Reg base, i32 disp, Reg source) {
+		Rex(false, source, base);
+		Byte(0x89);
+		Memory(source, base, disp);
+	}
+
+	void Emitter::StoreImm32(Reg base, i32 disp, u32 imm) {
+		Rex(false, Reg::RAX, base);
+		Byte(0xC7);
+		Memory(Reg::RAX, base, disp);
+		Dword(imm);
+	}
+
+	void Emitter::Alu32(AluOp op, Reg dest, Reg source) {
+		Rex(false, source, dest);
+		Byte((u8(op) << 3) | 0x1);
+		ModRM(source, dest);
+	}
+
+	void Emitter::AluImm32(AluOp op, Reg dest, u32 imm) {
+		Rex(false, Reg::RAX, dest);
+		Byte(0x81);
+		ModRM(u8(op), dest);
+		Dword(imm);
+	}
+
+	void Emitter::Test32(Reg first, Reg second) {
+		Rex(false, second, first);
+		Byte(0x85);
+		ModRM(second, first);
+	}
+
+	void Emitter::Not32(Reg reg) {
+		Rex(false, Reg::RAX, reg);
+		Byte(0xF7);
+		ModRM(u8(2), reg);
+	}
+
+	void Emitter::Neg32(Reg reg) {
+		Rex(false, Reg::RAX, reg);
+		Byte(0xF7);
+		ModRM(u8(3), reg);
+	}
+
+	void Emitter::Shift32(ShiftOp op, Reg reg, u8 amount) {
+		Rex(false, Reg::RAX, reg);
+		Byte(0xC1);
+		ModRM(u8(op), reg);
+		Byte(amount);
+	}
+
+	void Emitter::Shift64(ShiftOp op, Reg reg, u8 amount) {
+		Rex(true, Reg::RAX, reg);
+		Byte(0xC1);
+		ModRM(u8(op), reg);
+		Byte(amount);
+	}
+
+	void Emitter::BitTest32(Reg reg, u8 bit) {
+		Rex(false, Reg::RAX, reg);
+		Byte(0x0F);
+		Byte(0xBA);
+		ModRM(u8(4), reg);
+		Byte(bit);
+	}
+
+	void Emitter::BitTest32(Reg reg, Reg bit) {
+		Rex(false, bit, reg);
+		Byte(0x0F);
+		Byte(0xA3);
+		ModRM(bit, reg);
+	}
+
+	void Emitter::Cmc() {
+		Byte(0xF5);
+	}
+
+	void Emitter::SetCC(Cond cond, Reg dest) {
+		//spl, bpl, sil and dil need a REX prefix
+		Rex(false, Reg::RAX, dest, u8(dest) >= 4);
+		Byte(0x0F);
+		Byte(0x90 + u8(cond));
+		ModRM(u8(0), dest);
+	}
+
+	void Emitter::MovZx8(Reg dest, Reg source) {
+		Rex(false, dest, source, u8(source) >= 4);
+		Byte(0x0F);
+		Byte(0xB6);
+		ModRM(dest, source);
+	}
+
+	void Emitter::AddRsp(u8 amount) {
+		Byte(0x48);
+		Byte(0x83);
+		Byte(0xC4);
+		Byte(amount);
+	}
+
+	void Emitter::SubRsp(u8 amount) {
+		Byte(0x48);
+		Byte(0x83);
+		Byte(0xEC);
+		Byte(amount);
+	}
+
+	void Emitter::Call(void const* function) {
+		MovImm64(Reg::RAX, reinterpret_cast<uint64_t>(function));
+		Byte(0xFF);
+		ModRM(u8(2), Reg::RAX);
+	}
+
+	void Emitter::Ret() {
+		Byte(0xC3);
+	}
+
+	std::size_t Emitter::JumpIf(Cond cond) {
+		Byte(0x0F);
+		Byte(0x80 + u8(cond));
+		Dword(0);
+		return m_code.size() - 4;
+	}
+
+	std::size_t Emitter::Jump() {
+		Byte(0xE9);
+		Dword(0);
+		return m_code.size() - 4;
+	}
+
+	void Emitter::Bind(std::size_t pos) {
+		u32 rel = u32(m_code.size() - (pos + 4));
+
+		for (u32 i = 0; i < 4; i++)
+			m_code[pos + i] = u8(rel >> (i * 8));
+	}
+}
@@ -0,0 +1,1646 @@
+#include "../../../cpu/jit/Jit.hpp"
+#include "../../../cpu/jit/Emitter.hpp"
+#include "../../../cpu/core/ARM7TDI.hpp"
+#include "../../../cpu/aot/Module.hpp"
+
+#include "../../../memory/Bus.hpp"
+
+#include "../../../common/Logger.hpp"
+#include "../../../common/Error.hpp"
+#include "../../../common/BitManip.hpp"
+
+#include <bit>
+
+namespace GBA::cpu::jit {
+	LOG_CONTEXT(JIT);
+
+	using memory::Access;
+
+	namespace {
+#if defined(WIN32) || defined(__WIN32__) || defined(_WIN32)
+		constexpr Reg ARG0 = Reg::RCX;
+		constexpr Reg ARG1 = Reg::RDX;
+		constexpr Reg ARG2 = Reg::R8;
+		constexpr Reg ARG3 = Reg::R9;
+		constexpr u8 SHADOW_SPACE = 32;
+#else
+		constexpr Reg ARG0 = Reg::RDI;
+		constexpr Reg ARG1 = Reg::RSI;
+		constexpr Reg ARG2 = Reg::RDX;
+		constexpr Reg ARG3 = Reg::RCX;
+		constexpr u8 SHADOW_SPACE = 0;
+#endif
+
+		/*
+		* Callee saved registers holding the
+		* Jit, the current register bank and
+		* the CPSR for the whole block.
+		* eax and ecx hold the operands,
+		* r8b-r11b the captured C, V, N, Z
+		*/
+		constexpr Reg JIT_PTR = Reg::RBX;
+		constexpr Reg REGS_PTR = Reg::R12;
+		constexpr Reg CPSR_PTR = Reg::R13;
+
+		constexpr u8 N_BIT = 31;
+		constexpr u8 Z_BIT = 30;
+		constexpr u8 C_BIT = 29;
+		constexpr u8 V_BIT = 28;
+
+		enum class Carry {
+			NONE,
+			HOST,
+			SET,
+			CLEAR
+		};
+
+		enum class Arith {
+			ADD, SUB, RSB,
+			ADC, SBC, RSC
+		};
+
+		/*
+		* Guest registers of the mode the block
+		* is compiled for, banked is set when
+		* r8-r14 are accessed and the code is
+		* only valid in that mode
+		*/
+		struct GuestRegs {
+			u8 const* index;
+			bool banked;
+		};
+
+		void LoadReg(Emitter& e, GuestRegs& regs, Reg host, u8 guest) {
+			regs.banked |= guest >= 8 && guest < 15;
+			e.Load32(host, REGS_PTR, regs.index[guest] * 4);
+		}
+
+		void StoreReg(Emitter& e, GuestRegs& regs, u8 guest, Reg host) {
+			regs.banked |= guest >= 8 && guest < 15;
+			e.Store32(REGS_PTR, regs.index[guest] * 4, host);
+		}
+
+		void CaptureNZ(Emitter& e) {
+			e.Test32(Reg::RAX, Reg::RAX);
+			e.SetCC(Cond::S, Reg::R10);
+			e.SetCC(Cond::Z, Reg::R11);
+		}
+
+		void MergeFlag(Emitter& e, Reg flag, u8 bit) {
+			e.MovZx8(flag, flag);
+			e.Shift32(ShiftOp::SHL, flag, bit);
+			e.Alu32(AluOp::OR, Reg::RDX, flag);
+		}
+
+		//Write back N and Z, plus C and V when requested
+		void StoreFlags(Emitter& e, Carry carry, bool overflow) {
+			u32 mask = (1u << N_BIT) | (1u << Z_BIT);
+
+			if (carry != Carry::NONE)
+				mask |= 1u << C_BIT;
+
+			if (overflow)
+				mask |= 1u << V_BIT;
+
+			e.Load32(Reg::RDX, CPSR_PTR, 0);
+			e.AluImm32(AluOp::AND, Reg::RDX, ~mask);
+
+			MergeFlag(e, Reg::R10, N_BIT);
+			MergeFlag(e, Reg::R11, Z_BIT);
+
+			if (carry == Carry::HOST)
+				MergeFlag(e, Reg::R8, C_BIT);
+			else if (carry == Carry::SET)
+				e.AluImm32(AluOp::OR, Reg::RDX, 1u << C_BIT);
+
+			if (overflow)
+				MergeFlag(e, Reg::R9, V_BIT);
+
+			e.Store32(CPSR_PTR, 0, Reg::RDX);
+		}
+
+		/*
+		* eax = eax op ecx, with all four flags
+		* captured. ARM carry on subtraction is
+		* the inverse of the x86 borrow
+		*/
+		void EmitArith(Emitter& e, Arith kind) {
+			bool reverse = kind == Arith::RSB || kind == Arith::RSC;
+			bool subtract = kind != Arith::ADD && kind != Arith::ADC;
+			bool carry_in = kind == Arith::ADC || kind == Arith::SBC || kind == Arith::RSC;
+
+			AluOp op{};
+
+			switch (kind)
+			{
+			case Arith::ADD: op = AluOp::ADD; break;
+			case Arith::ADC: op = AluOp::ADC; break;
+			case Arith::SUB:
+			case Arith::RSB: op = AluOp::SUB; break;
+			case Arith::SBC:
+			case Arith::RSC: op = AluOp::SBB; break;
+			}
+
+			if (carry_in) {
+				e.Load32(Reg::RDX, CPSR_PTR, 0);
+				e.BitTest32(Reg::RDX, C_BIT);
+
+				if (subtract)
+					e.Cmc();
+			}
+
+			if (reverse)
+				e.Alu32(op, Reg::RCX, Reg::RAX);
+			else
+				e.Alu32(op, Reg::RAX, Reg::RCX);
+
+			e.SetCC(subtract ? Cond::NC : Cond::C, Reg::R8);
+			e.SetCC(Cond::O, Reg::R9);
+			e.SetCC(Cond::S, Reg::R10);
+			e.SetCC(Cond::Z, Reg::R11);
+
+			if (reverse)
+				e.Mov32(Reg::RAX, Reg::RCX);
+		}
+
+		/*
+		* Immediate shifts of the value in reg,
+		* same results as the interpreter with
+		* Imm = true. Returns where the carry is
+		*/
+		Carry EmitShiftImm(Emitter& e, Reg reg, u8 type, u8 amount) {
+			switch (type)
+			{
+			case 0:
+				if (!amount)
+					return Carry::NONE;
+
+				e.Shift32(ShiftOp::SHL, reg, amount);
+				break;
+
+			case 1:
+				if (!amount) {
+					e.BitTest32(reg, 31);
+					e.SetCC(Cond::C, Reg::R8);
+					e.Alu32(AluOp::XOR, reg, reg);
+					return Carry::HOST;
+				}
+
+				e.Shift32(ShiftOp::SHR, reg, amount);
+				break;
+
+			case 2:
+				if (!amount) {
+					e.BitTest32(reg, 31);
+					e.SetCC(Cond::C, Reg::R8);
+					e.Shift32(ShiftOp::SAR, reg, 31);
+					return Carry::HOST;
+				}
+
+				e.Shift32(ShiftOp::SAR, reg, amount);
+				break;
+
+			default:
+				e.Shift32(ShiftOp::ROR, reg, amount);
+				break;
+			}
+
+			e.SetCC(Cond::C, Reg::R8);
+			return Carry::HOST;
+		}
+
+		bool EmitThumb(Emitter& e, GuestRegs& regs, u16 instr) {
+			u8 rd = instr & 0x7;
+			u8 rs = (instr >> 3) & 0x7;
+
+			if (instr < 0x1800) {
+				//Format 1, move shifted register
+				u8 type = (instr >> 11) & 0x3;
+				u8 amount = (instr >> 6) & 0x1F;
+
+				LoadReg(e, regs, Reg::RAX, rs);
+
+				Carry carry = EmitShiftImm(e, Reg::RAX, type, amount);
+
+				StoreReg(e, regs, rd, Reg::RAX);
+				CaptureNZ(e);
+				StoreFlags(e, carry, false);
+
+				return true;
+			}
+
+			if (instr < 0x2000) {
+				//Format 2, add/subtract
+				u8 opcode = (instr >> 9) & 0x3;
+				u8 operand = (instr >> 6) & 0x7;
+
+				LoadReg(e, regs, Reg::RAX, rs);
+
+				if (opcode & 2)
+					e.MovImm32(Reg::RCX, operand);
+				else
+					LoadReg(e, regs, Reg::RCX, operand);
+
+				EmitArith(e, (opcode & 1) ? Arith::SUB : Arith::ADD);
+
+				StoreReg(e, regs, rd, Reg::RAX);
+				StoreFlags(e, Carry::HOST, true);
+
+				return true;
+			}
+
+			if (instr < 0x4000) {
+				//Format 3, move/compare/add/subtract immediate
+				u8 opcode = (instr >> 11) & 0x3;
+				u8 imm = instr & 0xFF;
+
+				rd = (instr >> 8) & 0x7;
+
+				if (opcode == 0) {
+					//N comes from bit 7 of the
+					//immediate, as in the interpreter
+					u32 flags = (u32(imm >> 7) << N_BIT) |
+						(u32(imm == 0) << Z_BIT);
+
+					e.StoreImm32(REGS_PTR, rd * 4, imm);
+					e.Load32(Reg::RDX, CPSR_PTR, 0);
+					e.AluImm32(AluOp::AND, Reg::RDX, ~((1u << N_BIT) | (1u << Z_BIT)));
+
+					if (flags)
+						e.AluImm32(AluOp::OR, Reg::RDX, flags);
+
+					e.Store32(CPSR_PTR, 0, Reg::RDX);
+
+					return true;
+				}
+
+				LoadReg(e, regs, Reg::RAX, rd);
+				e.MovImm32(Reg::RCX, imm);
+
+				EmitArith(e, opcode == 2 ? Arith::ADD : Arith::SUB);
+
+				if (opcode != 1)
+					StoreReg(e, regs, rd, Reg::RAX);
+
+				StoreFlags(e, Carry::HOST, true);
+
+				return true;
+			}
+
+			if (instr < 0x4400) {
+				//Format 4, ALU operations. Shifts by
+				//register and MUL add internal cycles
+				//and stay in the interpreter
+				u8 opcode = (instr >> 6) & 0xF;
+
+				LoadReg(e, regs, Reg::RAX, rd);
+				LoadReg(e, regs, Reg::RCX, rs);
+
+				switch (opcode)
+				{
+				case 0x0:
+				case 0x1:
+				case 0xC:
+				case 0xE:
+				case 0xF:
+					if (opcode == 0x0)
+						e.Alu32(AluOp::AND, Reg::RAX, Reg::RCX);
+					else if (opcode == 0x1)
+						e.Alu32(AluOp::XOR, Reg::RAX, Reg::RCX);
+					else if (opcode == 0xC)
+						e.Alu32(AluOp::OR, Reg::RAX, Reg::RCX);
+					else if (opcode == 0xE) {
+						e.Not32(Reg::RCX);
+						e.Alu32(AluOp::AND, Reg::RAX, Reg::RCX);
+					}
+					else {
+						e.Mov32(Reg::RAX, Reg::RCX);
+						e.Not32(Reg::RAX);
+					}
+
+					StoreReg(e, regs, rd, Reg::RAX);
+					CaptureNZ(e);
+					StoreFlags(e, Carry::NONE, false);
+					return true;
+
+				case 0x8:
+					e.Alu32(AluOp::AND, Reg::RAX, Reg::RCX);
+					CaptureNZ(e);
+					StoreFlags(e, Carry::NONE, false);
+					return true;
+
+				case 0x5:
+				case 0x6:
+				case 0x9:
+					if (opcode == 0x9)
+						e.MovImm32(Reg::RAX, 0);
+
+					EmitArith(e, opcode == 0x5 ? Arith::ADC :
+						opcode == 0x6 ? Arith::SBC : Arith::SUB);
+
+					StoreReg(e, regs, rd, Reg::RAX);
+					StoreFlags(e, Carry::HOST, true);
+					return true;
+
+				case 0xA:
+				case 0xB:
+					EmitArith(e, opcode == 0xA ? Arith::SUB : Arith::ADD);
+					StoreFlags(e, Carry::HOST, true);
+					return true;
+
+				default:
+					return false;
+				}
+			}
+
+			if (instr < 0x4800) {
+				//Format 5, hi register operations
+				//without PC and BX
+				u8 opcode = (instr >> 8) & 0x3;
+
+				rs = (instr >> 3) & 0xF;
+				rd = (instr & 0x7) | ((instr >> 4) & 0x8);
+
+				if (opcode == 3 || rs == 15 || rd == 15)
+					return false;
+
+				LoadReg(e, regs, Reg::RCX, rs);
+
+				if (opcode == 0) {
+					LoadReg(e, regs, Reg::RAX, rd);
+					e.Alu32(AluOp::ADD, Reg::RAX, Reg::RCX);
+					StoreReg(e, regs, rd, Reg::RAX);
+				}
+				else if (opcode == 1) {
+					LoadReg(e, regs, Reg::RAX, rd);
+					EmitArith(e, Arith::SUB);
+					StoreFlags(e, Carry::HOST, true);
+				}
+				else
+					StoreReg(e, regs, rd, Reg::RCX);
+
+				return true;
+			}
+
+			return false;
+		}
+
+		//Bit n is set if the condition passes with NZCV = n
+		u32 ConditionMask(u8 cond) {
+			u32 mask = 0;
+
+			for (u32 flags = 0; flags < 16; flags++) {
+				CPSR cpsr{};
+				cpsr = flags << 28;
+
+				if (cpsr.CheckCondition(cond))
+					mask |= 1u << flags;
+			}
+
+			return mask;
+		}
+
+		//Returns the jump taken when cond fails
+		std::size_t EmitCondition(Emitter& e, u8 cond) {
+			e.Load32(Reg::RDX, CPSR_PTR, 0);
+			e.Shift32(ShiftOp::SHR, Reg::RDX, 28);
+			e.MovImm32(Reg::RAX, ConditionMask(cond));
+			e.BitTest32(Reg::RAX, Reg::RDX);
+			return e.JumpIf(Cond::NC);
+		}
+
+		bool EmitArm(Emitter& e, GuestRegs& regs, u32 instr) {
+			u8 cond = u8(instr >> 28);
+
+			//Data processing only, no shift by register
+			if (cond == 0xF || (instr & 0x0C000000) != 0)
+				return false;
+
+			bool imm = (instr >> 25) & 1;
+
+			if (!imm && (instr & 0x10))
+				return false;
+
+			u8 opcode = (instr >> 21) & 0xF;
+			bool s_bit = (instr >> 20) & 1;
+			u8 rn = (instr >> 16) & 0xF;
+			u8 rd = (instr >> 12) & 0xF;
+			u8 rm = instr & 0xF;
+			u8 shift_type = (instr >> 5) & 0x3;
+			u8 shift_amount = (instr >> 7) & 0x1F;
+
+			bool compare = opcode >= 0x8 && opcode <= 0xB;
+			bool move = opcode == 0xD || opcode == 0xF;
+
+			//PSR transfers, PC writes/reads, RRX and
+			//the MOV/MVN encodings the interpreter reports
+			if ((compare && !s_bit) || rd == 15 || rn == 15 ||
+				(move && rn != 0))
+				return false;
+
+			if (!imm && (rm == 15 || (shift_type == 3 && !shift_amount)))
+				return false;
+
+			std::size_t skip = 0;
+
+			if (cond != 0xE)
+				skip = EmitCondition(e, cond);
+
+			Carry carry = Carry::NONE;
+
+			if (imm) {
+				u32 value = instr & 0xFF;
+				u8 rotate = ((instr >> 8) & 0xF) * 2;
+
+				e.MovImm32(Reg::RCX, std::rotr(value, rotate));
+
+				carry = (rotate && CHECK_BIT(value, (rotate - 1))) ?
+					Carry::SET : Carry::CLEAR;
+			}
+			else {
+				LoadReg(e, regs, Reg::RCX, rm);
+				carry = EmitShiftImm(e, Reg::RCX, shift_type, shift_amount);
+			}
+
+			if (!move)
+				LoadReg(e, regs, Reg::RAX, rn);
+
+			bool logical = true;
+
+			switch (opcode)
+			{
+			case 0x0:
+			case 0x8:
+				e.Alu32(AluOp::AND, Reg::RAX, Reg::RCX);
+				break;
+			case 0x1:
+			case 0x9:
+				e.Alu32(AluOp::XOR, Reg::RAX, Reg::RCX);
+				break;
+			case 0xC:
+				e.Alu32(AluOp::OR, Reg::RAX, Reg::RCX);
+				break;
+			case 0xD:
+				e.Mov32(Reg::RAX, Reg::RCX);
+				break;
+			case 0xE:
+				e.Not32(Reg::RCX);
+				e.Alu32(AluOp::AND, Reg::RAX, Reg::RCX);
+				break;
+			case 0xF:
+				e.Mov32(Reg::RAX, Reg::RCX);
+				e.Not32(Reg::RAX);
+				break;
+			default:
+				logical = false;
+				break;
+			}
+
+			if (!logical) {
+				static constexpr Arith kinds[] = {
+					Arith::ADD, Arith::ADD, Arith::SUB, Arith::RSB,
+					Arith::ADD, Arith::ADC, Arith::SBC, Arith::RSC,
+					Arith::ADD, Arith::ADD, Arith::SUB, Arith::ADD
+				};
+
+				EmitArith(e, kinds[opcode]);
+			}
+
+			if (!compare)
+				StoreReg(e, regs, rd, Reg::RAX);
+
+			if (s_bit) {
+				if (logical) {
+					CaptureNZ(e);
+					StoreFlags(e, carry, false);
+				}
+				else
+					StoreFlags(e, Carry::HOST, true);
+			}
+
+			if (cond != 0xE)
+				e.Bind(skip);
+
+			return true;
+		}
+
+		/*
+		* Jit functions called by translated
+		* loads and stores, indexed by log2
+		* of the access size
+		*/
+		struct MemoryCalls {
+			void const* load[3];
+			void const* load_signed[2];
+			void const* store[3];
+			void const* load_multiple;
+			void const* store_multiple;
+			void const* interpret;
+			u32* transfer;
+		};
+
+		//function(jit, op, eax, r11d), the eax
+		//and r11d it gets are not preserved
+		void EmitCall(Emitter& e, JitOp const& op, void const* function) {
+			e.Mov32(ARG3, Reg::R11);
+			e.Mov32(ARG2, Reg::RAX);
+			e.MovImm64(ARG1, reinterpret_cast<uint64_t>(&op));
+			e.Mov64(ARG0, JIT_PTR);
+			e.Call(function);
+		}
+
+		/*
+		* Access at the address in eax, stores
+		* take the value from r11d. Leaves in
+		* eax whether the block must be left
+		*/
+		void EmitSingle(Emitter& e, GuestRegs& regs, JitOp const& op,
+			MemoryCalls const& calls, bool load, u8 size, bool sign, u8 rd) {
+			u32 index = u32(std::countr_zero(size));
+
+			if (!load) {
+				EmitCall(e, op, calls.store[index]);
+				return;
+			}
+
+			EmitCall(e, op, sign ? calls.load_signed[index] : calls.load[index]);
+
+			StoreReg(e, regs, rd, Reg::RAX);
+			e.Shift64(ShiftOp::SHR, Reg::RAX, 32);
+		}
+
+		/*
+		* Registers of list, in ascending order,
+		* from or to the words at the address
+		* in eax
+		*/
+		void EmitMultiple(Emitter& e, GuestRegs& regs, JitOp const& op,
+			MemoryCalls const& calls, bool load, u16 list) {
+			e.MovImm64(Reg::R11, reinterpret_cast<uint64_t>(calls.transfer));
+
+			if (!load) {
+				u32 index = 0;
+
+				for (u8 reg = 0; reg < 16; reg++) {
+					if (!CHECK_BIT(list, reg))
+						continue;
+
+					LoadReg(e, regs, Reg::RCX, reg);
+					e.Store32(Reg::R11, index++ * 4, Reg::RCX);
+				}
+			}
+
+			e.MovImm32(Reg::R11, u32(std::popcount(list)));
+
+			EmitCall(e, op, load ? calls.load_multiple : calls.store_multiple);
+
+			if (!load)
+				return;
+
+			e.MovZx8(Reg::R10, Reg::RAX);
+			e.MovImm64(Reg::R11, reinterpret_cast<uint64_t>(calls.transfer));
+
+			u32 index = 0;
+
+			for (u8 reg = 0; reg < 16; reg++) {
+				if (!CHECK_BIT(list, reg))
+					continue;
+
+				e.Load32(Reg::RCX, Reg::R11, index++ * 4);
+				StoreReg(e, regs, reg, Reg::RCX);
+			}
+
+			e.Mov32(Reg::RAX, Reg::R10);
+		}
+
+		/*
+		* THUMB formats 6 to 11, 14 and 15, without
+		* PC loads and with the base out of the
+		* register list
+		*/
+		bool EmitThumbTransfer(Emitter& e, GuestRegs& regs, JitOp const& op,
+			MemoryCalls const& calls) {
+			u16 instr = u16(op.opcode);
+
+			u8 rd = instr & 0x7;
+			u8 rb = (instr >> 3) & 0x7;
+
+			if (instr < 0x4800)
+				return false;
+
+			if (instr < 0x5000) {
+				//Format 6, PC relative load
+				u32 pc = (op.pc + 4) & ~2;
+
+				e.MovImm32(Reg::RAX, pc + (instr & 0xFF) * 4);
+				EmitSingle(e, regs, op, calls, true, 4, false, (instr >> 8) & 0x7);
+
+				return true;
+			}
+
+			if (instr < 0x6000) {
+				//Formats 7 and 8, register offset
+				static constexpr u8 sizes[2][4] = {
+					{ 4, 1, 4, 1 },
+					{ 2, 1, 2, 2 }
+				};
+
+				u8 opcode = (instr >> 10) & 0x3;
+				bool format8 = CHECK_BIT(instr, 9);
+				bool load = format8 ? opcode != 0 : opcode >= 2;
+				bool sign = format8 && (opcode & 1);
+
+				if (!load)
+					LoadReg(e, regs, Reg::R11, rd);
+
+				LoadReg(e, regs, Reg::RAX, rb);
+				LoadReg(e, regs, Reg::RCX, (instr >> 6) & 0x7);
+				e.Alu32(AluOp::ADD, Reg::RAX, Reg::RCX);
+
+				EmitSingle(e, regs, op, calls, load, sizes[format8][opcode], sign, rd);
+
+				return true;
+			}
+
+			if (instr < 0xA000) {
+				//Formats 9 to 11, immediate offset
+				u32 offset = (instr >> 6) & 0x1F;
+				bool load = CHECK_BIT(instr, 11);
+				u8 size = 4;
+
+				if (instr < 0x8000) {
+					if (CHECK_BIT(instr, 12))
+						size = 1;
+					else
+						offset *= 4;
+				}
+				else if (instr < 0x9000) {
+					size = 2;
+					offset *= 2;
+				}
+				else {
+					rd = (instr >> 8) & 0x7;
+					rb = 13;
+					offset = (instr & 0xFF) * 4;
+				}
+
+				if (!load)
+					LoadReg(e, regs, Reg::R11, rd);
+
+				LoadReg(e, regs, Reg::RAX, rb);
+
+				if (offset)
+					e.AluImm32(AluOp::ADD, Reg::RAX, offset);
+
+				EmitSingle(e, regs, op, calls, load, size, false, rd);
+
+				return true;
+			}
+
+			u16 list = instr & 0xFF;
+			bool load = CHECK_BIT(instr, 11);
+
+			if ((instr & 0xF600) == 0xB400) {
+				//Format 14, PUSH with LR, POP without PC
+				if (CHECK_BIT(instr, 8)) {
+					if (load)
+						return false;
+
+					list |= 1 << 14;
+				}
+
+				if (!list)
+					return false;
+
+				u32 size = u32(std::popcount(list)) * 4;
+
+				LoadReg(e, regs, Reg::RAX, 13);
+
+				if (load) {
+					e.Mov32(Reg::RCX, Reg::RAX);
+					e.AluImm32(AluOp::ADD, Reg::RCX, size);
+					StoreReg(e, regs, 13, Reg::RCX);
+				}
+				else {
+					e.AluImm32(AluOp::SUB, Reg::RAX, size);
+					StoreReg(e, regs, 13, Reg::RAX);
+				}
+
+				EmitMultiple(e, regs, op, calls, load, list);
+
+				return true;
+			}
+
+			if (instr >= 0xC000 && instr < 0xD000) {
+				//Format 15, LDMIA/STMIA
+				rb = (instr >> 8) & 0x7;
+
+				if (!list || CHECK_BIT(list, rb))
+					return false;
+
+				LoadReg(e, regs, Reg::RAX, rb);
+				e.Mov32(Reg::RCX, Reg::RAX);
+				e.AluImm32(AluOp::ADD, Reg::RCX, u32(std::popcount(list)) * 4);
+				StoreReg(e, regs, rb, Reg::RCX);
+
+				EmitMultiple(e, regs, op, calls, load, list);
+
+				return true;
+			}
+
+			return false;
+		}
+
+		/*
+		* Single, halfword/signed and block data
+		* transfers, without PC loads, stores of
+		* the PC, PC writeback or block transfers,
+		* RRX offsets, user bank transfers or the
+		* base in the list.
+		* When the condition fails the interpreter
+		* handler runs instead
+		*/
+		bool EmitArmTransfer(Emitter& e, GuestRegs& regs, JitOp const& op,
+			MemoryCalls const& calls) {
+			u32 instr = op.opcode;
+			u8 cond = u8(instr >> 28);
+
+			bool pre = CHECK_BIT(instr, 24);
+			bool up = CHECK_BIT(instr, 23);
+			bool writeback = CHECK_BIT(instr, 21);
+			bool load = CHECK_BIT(instr, 20);
+			u8 rn = (instr >> 16) & 0xF;
+			u8 rd = (instr >> 12) & 0xF;
+			u8 rm = instr & 0xF;
+
+			bool block = (instr & 0x0E000000) == 0x08000000;
+			bool single = (instr & 0x0C000000) == 0x04000000;
+			bool half = (instr & 0x0E000090) == 0x00000090 && (instr & 0x60);
+
+			u8 size = 4;
+			bool sign = false;
+			bool imm = true;
+			u32 offset = 0;
+			u8 shift_type = (instr >> 5) & 0x3;
+			u8 shift_amount = (instr >> 7) & 0x1F;
+
+			if (cond == 0xF || (rn == 15 && (block || writeback || !pre)))
+				return false;
+
+			if (block) {
+				u16 list = instr & 0xFFFF;
+
+				if (CHECK_BIT(instr, 22) || !list || CHECK_BIT(list, 15) ||
+					CHECK_BIT(list, rn))
+					return false;
+			}
+			else if (single) {
+				imm = !CHECK_BIT(instr, 25);
+				size = CHECK_BIT(instr, 22) ? 1 : 4;
+				offset = instr & 0xFFF;
+
+				//T variant, undefined and RRX
+				if ((!pre && writeback) || (!imm && (instr & 0x10)) ||
+					(!imm && shift_type == 3 && !shift_amount))
+					return false;
+
+				shift_type = imm ? 0 : shift_type;
+				shift_amount = imm ? 0 : shift_amount;
+			}
+			else if (half) {
+				u8 opcode = (instr >> 5) & 0x3;
+
+				//LDRD and STRD
+				if (!load && opcode != 1)
+					return false;
+
+				imm = CHECK_BIT(instr, 22);
+				size = opcode == 2 ? 1 : 2;
+				sign = opcode != 1;
+				offset = (instr & 0xF) | ((instr >> 4) & 0xF0);
+				shift_amount = 0;
+			}
+			else
+				return false;
+
+			if (!block && (rd == 15 || (!imm && rm == 15)))
+				return false;
+
+			std::size_t skip = 0;
+
+			if (cond != 0xE)
+				skip = EmitCondition(e, cond);
+
+			if (block) {
+				u16 list = instr & 0xFFFF;
+				u32 size = u32(std::popcount(list)) * 4;
+
+				LoadReg(e, regs, Reg::RAX, rn);
+
+				if (writeback) {
+					e.Mov32(Reg::RCX, Reg::RAX);
+					e.AluImm32(up ? AluOp::ADD : AluOp::SUB, Reg::RCX, size);
+					StoreReg(e, regs, rn, Reg::RCX);
+				}
+
+				//Lowest address first
+				if (up && pre)
+					e.AluImm32(AluOp::ADD, Reg::RAX, 4);
+				else if (!up)
+					e.AluImm32(AluOp::SUB, Reg::RAX, pre ? size : size - 4);
+
+				EmitMultiple(e, regs, op, calls, load, list);
+			}
+			else {
+				AluOp add = up ? AluOp::ADD : AluOp::SUB;
+
+				if (!load)
+					LoadReg(e, regs, Reg::R11, rd);
+
+				if (!imm) {
+					LoadReg(e, regs, Reg::RCX, rm);
+					EmitShiftImm(e, Reg::RCX, shift_type, shift_amount);
+				}
+
+				if (rn == 15)
+					e.MovImm32(Reg::RAX, op.pc + 8);
+				else
+					LoadReg(e, regs, Reg::RAX, rn);
+
+				//Loads into the base skip the writeback
+				bool update = !(load && rn == rd);
+
+				if (pre) {
+					if (!imm)
+						e.Alu32(add, Reg::RAX, Reg::RCX);
+					else if (offset)
+						e.AluImm32(add, Reg::RAX, offset);
+
+					if (writeback && update)
+						StoreReg(e, regs, rn, Reg::RAX);
+				}
+				else if (update) {
+					e.Mov32(Reg::R10, Reg::RAX);
+
+					if (!imm)
+						e.Alu32(add, Reg::R10, Reg::RCX);
+					else if (offset)
+						e.AluImm32(add, Reg::R10, offset);
+
+					StoreReg(e, regs, rn, Reg::R10);
+				}
+
+				EmitSingle(e, regs, op, calls, load, size, sign, rd);
+			}
+
+			if (cond != 0xE) {
+				std::size_t done = e.Jump();
+
+				e.Bind(skip);
+
+				e.MovImm64(ARG1, reinterpret_cast<uint64_t>(&op));
+				e.Mov64(ARG0, JIT_PTR);
+				e.Call(calls.interpret);
+
+				e.Bind(done);
+			}
+
+			return true;
+		}
+	}
+
+	Jit::Jit(ARM7TDI* cpu, CPUContext* ctx, BlockCache* cache,
+		memory::Bus* bus, bool translate) :
+		m_cpu(cpu), m_ctx(ctx), m_cache(cache), m_bus(bus),
+		m_buffer((translate && IsSupported()) ? BUFFER_SIZE : 0), m_blocks{},
+		m_generation{}, m_module(nullptr), m_current(nullptr), m_entry_mode{},
+		m_active(ctx), m_executed{},
+		m_branch{}, m_lockstep{false}, m_reference{false},
+		m_replay{false}, m_shadow{}, m_trace{}, m_accesses{},
+		m_access_pos{}, m_access_mismatch{false}, m_transfer{}
+	{}
+
+	bool Jit::IsSupported() {
+#if defined(__x86_64__) || defined(_M_X64) || defined(_M_AMD64)
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	aot::Api const* Jit::GetAotApi() {
+		static constexpr aot::Api api{
+			&Jit::InterpretIndex<false>,
+			&Jit::InterpretIndex<true>,
+			&Jit::ExitIndex<false>,
+			&Jit::ExitIndex<true>
+		};
+
+		return &api;
+	}
+
+	void Jit::Flush() {
+		m_buffer.Reset();
+		m_blocks.clear();
+		m_generation++;
+	}
+
+	void Jit::Release(std::vector<RetiredTranslation>& retired) {
+		//Translations of older generations
+		//were freed by Flush
+		for (auto const& entry : retired) {
+			if (entry.generation == m_generation)
+				m_blocks.erase(static_cast<CompiledBlock*>(entry.translation));
+		}
+
+		retired.clear();
+	}
+
+	template <bool Thumb>
+	bool Jit::Run(CachedBlock& block, bool& branch) {
+		CompiledBlock* compiled = static_cast<CompiledBlock*>(block.translation);
+
+		if (compiled == nullptr || block.generation != m_generation) {
+			//Look up precompiled code the first time
+			//and whenever a translation was dropped,
+			//modules only contain ROM code
+			bool dropped = compiled != nullptr;
+
+			compiled = nullptr;
+
+			if (m_module != nullptr && block.start >= ROM_START &&
+				(block.exec_count == 0 || dropped))
+				compiled = Precompiled<Thumb>(block);
+
+			block.exec_count++;
+
+			if (compiled == nullptr) {
+				if (block.exec_count < HOT_THRESHOLD || !m_buffer.IsValid())
+					return false;
+
+				compiled = Compile<Thumb>(block);
+
+				if (compiled == nullptr) {
+					block.exec_count = 1;
+					return false;
+				}
+			}
+		}
+
+		//The second opcode may have been
+		//overwritten after being fetched
+		if (m_ctx->m_pipeline.GetFetched() != compiled->first_fetched)
+			return false;
+
+		//Code accessing r8-r14 reads the slots
+		//of the mode it was compiled for
+		u8 mode = m_ctx->m_regs.GetCurrentModeId();
+
+		if (compiled->mode != ANY_MODE && compiled->mode != mode)
+			return false;
+
+		//Translated code works on the flags
+		//in m_cpsr
+		m_ctx->ResolveFlags();
+
+		m_current = compiled;
+		m_entry_mode = mode;
+
+		if (m_lockstep)
+			RunLockstep<Thumb>(compiled, branch);
+		else {
+			compiled->code(this, m_ctx->m_regs.GetRegisterFile(), &m_ctx->m_cpsr);
+			branch = m_branch;
+		}
+
+		m_cache->SetPosition(m_executed);
+
+		return true;
+	}
+
+	template <bool Thumb>
+	bool Jit::InitOp(CachedBlock const& block, u32 index, JitOp& op) {
+		constexpr u32 size = Thumb ? 2 : 4;
+
+		CachedInstruction const& instr = block.instructions[index];
+
+		if constexpr (Thumb)
+			op.handler.thumb = instr.handler.thumb;
+		else
+			op.handler.arm = instr.handler.arm;
+
+		op.opcode = instr.opcode;
+		op.pc = block.start + index * size;
+		op.fetch_opcode = instr.fetch_opcode;
+		op.fetch_cycles[0] = instr.fetch_cycles[0];
+		op.fetch_cycles[1] = instr.fetch_cycles[1];
+		op.condition = instr.condition;
+		op.index = index;
+		op.last = index == block.instructions.size() - 1;
+
+		u8 const* next = m_bus->GetCodePointer(op.pc + size, size);
+
+		if (next == nullptr)
+			return false;
+
+		if constexpr (Thumb)
+			op.next_opcode = *reinterpret_cast<u16 const*>(next);
+		else
+			op.next_opcode = *reinterpret_cast<u32 const*>(next);
+
+		return true;
+	}
+
+	/*
+	* Every interpreted or memory instruction
+	* and the last one of the block charge the
+	* fetches of the translated run that
+	* precedes them
+	*/
+	template <bool Thumb>
+	void Jit::AssignPending(std::vector<JitOp>& ops) {
+		constexpr u32 size = Thumb ? 2 : 4;
+
+		u32 pending = 0;
+		u32 pending_address = 0;
+		u32 pending_value = 0;
+
+		for (JitOp& op : ops) {
+			if (op.translated && !op.memory) {
+				pending += op.fetch_cycles[(u8)Access::Seq];
+				pending_address = op.pc + 2 * size;
+				pending_value = op.fetch_opcode;
+
+				if (!op.last)
+					continue;
+			}
+
+			op.pending_cycles = pending;
+			op.pending_address = pending_address;
+			op.pending_value = pending_value;
+
+			pending = 0;
+		}
+	}
+
+	CompiledBlock* Jit::Commit(CachedBlock& block, std::unique_ptr<CompiledBlock> compiled) {
+		compiled->first_fetched = compiled->ops[0].next_opcode;
+
+		CompiledBlock* result = compiled.get();
+		m_blocks.emplace(result, std::move(compiled));
+
+		block.translation = result;
+		block.generation = m_generation;
+
+		return result;
+	}
+
+	template <bool Thumb>
+	CompiledBlock* Jit::Compile(CachedBlock& block) {
+		if (!m_buffer.IsValid())
+			return nullptr;
+
+		u32 count = u32(block.instructions.size());
+
+		auto compiled = std::make_unique<CompiledBlock>();
+		compiled->ops.resize(count);
+
+		Emitter e{};
+
+		e.Push(JIT_PTR);
+		e.Push(REGS_PTR);
+		e.Push(CPSR_PTR);
+
+		if constexpr (SHADOW_SPACE != 0)
+			e.SubRsp(SHADOW_SPACE);
+
+		e.Mov64(JIT_PTR, ARG0);
+		e.Mov64(REGS_PTR, ARG1);
+		e.Mov64(CPSR_PTR, ARG2);
+
+		std::vector<std::size_t> exits{};
+
+		u8 mode = m_ctx->m_regs.GetCurrentModeId();
+		GuestRegs regs{ RegisterManager::REG_INDEX[mode], false };
+
+		MemoryCalls calls{
+			{
+				reinterpret_cast<void const*>(&Jit::Load<Thumb, u8>),
+				reinterpret_cast<void const*>(&Jit::Load<Thumb, u16>),
+				reinterpret_cast<void const*>(&Jit::Load<Thumb, u32>)
+			},
+			{
+				reinterpret_cast<void const*>(&Jit::LoadSigned<Thumb, u8>),
+				reinterpret_cast<void const*>(&Jit::LoadSigned<Thumb, u16>)
+			},
+			{
+				reinterpret_cast<void const*>(&Jit::Store<Thumb, u8>),
+				reinterpret_cast<void const*>(&Jit::Store<Thumb, u16>),
+				reinterpret_cast<void const*>(&Jit::Store<Thumb, u32>)
+			},
+			reinterpret_cast<void const*>(&Jit::LoadMultiple<Thumb>),
+			reinterpret_cast<void const*>(&Jit::StoreMultiple<Thumb>),
+			reinterpret_cast<void const*>(&Jit::Interpret<Thumb>),
+			m_transfer.data()
+		};
+
+		for (u32 index = 0; index < count; index++) {
+			JitOp& op = compiled->ops[index];
+
+			if (!InitOp<Thumb>(block, index, op))
+				return nullptr;
+
+			std::size_t mark = e.GetSize();
+
+			if constexpr (Thumb)
+				op.translated = EmitThumb(e, regs, u16(op.opcode));
+			else
+				op.translated = EmitArm(e, regs, op.opcode);
+
+			if (!op.translated) {
+				e.Truncate(mark);
+
+				if constexpr (Thumb)
+					op.memory = EmitThumbTransfer(e, regs, op, calls);
+				else
+					op.memory = EmitArmTransfer(e, regs, op, calls);
+
+				op.translated = op.memory;
+			}
+
+			if (op.translated && !op.memory) {
+				if (!op.last)
+					continue;
+
+				e.Mov64(ARG0, JIT_PTR);
+				e.MovImm64(ARG1, reinterpret_cast<uint64_t>(&op));
+				e.Call(reinterpret_cast<void const*>(&Jit::ExitBlock<Thumb>));
+				break;
+			}
+
+			if (!op.memory) {
+				e.Truncate(mark);
+
+				e.Mov64(ARG0, JIT_PTR);
+				e.MovImm64(ARG1, reinterpret_cast<uint64_t>(&op));
+				e.Call(reinterpret_cast<void const*>(&Jit::Interpret<Thumb>));
+			}
+
+			if (!op.last) {
+				e.MovZx8(Reg::RAX, Reg::RAX);
+				e.Test32(Reg::RAX, Reg::RAX);
+				exits.push_back(e.JumpIf(Cond::NZ));
+			}
+		}
+
+		AssignPending<Thumb>(compiled->ops);
+
+		for (std::size_t pos : exits)
+			e.Bind(pos);
+
+		if constexpr (SHADOW_SPACE != 0)
+			e.AddRsp(SHADOW_SPACE);
+
+		e.Pop(CPSR_PTR);
+		e.Pop(REGS_PTR);
+		e.Pop(JIT_PTR);
+		e.Ret();
+
+		void const* code = m_buffer.Commit(e.GetCode().data(), e.GetSize());
+
+		if (code == nullptr) {
+			Flush();
+
+			code = m_buffer.Commit(e.GetCode().data(), e.GetSize());
+
+			if (code == nullptr)
+				return nullptr;
+		}
+
+		compiled->code = reinterpret_cast<CompiledCode>(const_cast<void*>(code));
+		compiled->size = u32(e.GetSize());
+		compiled->mode = regs.banked ? mode : ANY_MODE;
+
+		return Commit(block, std::move(compiled));
+	}
+
+	template <bool Thumb>
+	CompiledBlock* Jit::Precompiled(CachedBlock& block) {
+		aot::Entry const* entry = m_module->Find(block.start, Thumb);
+
+		u32 count = u32(block.instructions.size());
+
+		//The module may come from another revision
+		//of the ROM, or the code may be in RAM
+		if (entry == nullptr || entry->count != count)
+			return nullptr;
+
+		for (u32 index = 0; index < count; index++) {
+			if (entry->opcodes[index] != block.instructions[index].opcode)
+				return nullptr;
+		}
+
+		auto compiled = std::make_unique<CompiledBlock>();
+		compiled->ops.resize(count);
+
+		for (u32 index = 0; index < count; index++) {
+			JitOp& op = compiled->ops[index];
+
+			if (!InitOp<Thumb>(block, index, op))
+				return nullptr;
+
+			op.translated = entry->translated[index];
+		}
+
+		AssignPending<Thumb>(compiled->ops);
+
+		compiled->code = entry->function;
+		compiled->size = 0;
+
+		//Modules are generated for User/SYS mode
+		compiled->mode = entry->banked ? 0 : ANY_MODE;
+
+		return Commit(block, std::move(compiled));
+	}
+
+	template <bool Thumb>
+	void Jit::RunLockstep(CompiledBlock* compiled, bool& branch) {
+		m_shadow = *m_ctx;
+
+		//Reference run, every instruction
+		//goes through the interpreter
+		m_reference = true;
+		m_accesses.clear();
+		m_bus->SetAccessLog(&m_accesses);
+
+		u32 count = u32(compiled->ops.size());
+
+		for (u32 index = 0; index < count; index++) {
+			bool stop = Interpret<Thumb>(this, &compiled->ops[index]);
+
+			m_trace[index] = { *m_ctx, m_branch, stop, u32(m_accesses.size()) };
+
+			if (stop)
+				break;
+		}
+
+		m_bus->SetAccessLog(nullptr);
+		m_reference = false;
+
+		u32 executed = m_executed;
+		bool reference_branch = m_branch;
+
+		//Translated run on the saved context,
+		//interpreted instructions are replayed
+		m_active = &m_shadow;
+		m_replay = true;
+		m_access_pos = 0;
+		m_access_mismatch = false;
+
+		compiled->code(this, m_shadow.m_regs.GetRegisterFile(), &m_shadow.m_cpsr);
+
+		m_active = m_ctx;
+		m_replay = false;
+
+		if (m_executed != executed || m_branch != reference_branch ||
+			m_access_mismatch || !CompareContext(*m_ctx, m_shadow)) {
+			LOG_ERROR("Lockstep mismatch in block at 0x{:x}, {} instructions executed",
+				compiled->ops[0].pc, executed);
+
+			if (m_access_mismatch)
+				LOG_ERROR("Translated memory accesses differ from the interpreter");
+
+			LOG_ERROR("Interpreter r0-r7: {:x} {:x} {:x} {:x} {:x} {:x} {:x} {:x} CPSR {:x}",
+				m_ctx->m_regs.GetReg(0), m_ctx->m_regs.GetReg(1), m_ctx->m_regs.GetReg(2),
+				m_ctx->m_regs.GetReg(3), m_ctx->m_regs.GetReg(4), m_ctx->m_regs.GetReg(5),
+				m_ctx->m_regs.GetReg(6), m_ctx->m_regs.GetReg(7), (u32)m_ctx->GetResolvedCPSR());
+			LOG_ERROR("JIT         r0-r7: {:x} {:x} {:x} {:x} {:x} {:x} {:x} {:x} CPSR {:x}",
+				m_shadow.m_regs.GetReg(0), m_shadow.m_regs.GetReg(1), m_shadow.m_regs.GetReg(2),
+				m_shadow.m_regs.GetReg(3), m_shadow.m_regs.GetReg(4), m_shadow.m_regs.GetReg(5),
+				m_shadow.m_regs.GetReg(6), m_shadow.m_regs.GetReg(7), (u32)m_shadow.GetResolvedCPSR());
+			error::DebugBreak();
+		}
+
+		m_executed = executed;
+		branch = reference_branch;
+	}
+
+	bool Jit::ShouldExit(bool thumb) {
+		return m_cpu->m_halt ||
+			m_bus->GetActiveDma() != 4 ||
+			bool(m_ctx->m_cpsr.instr_state) != thumb ||
+			m_ctx->m_regs.GetCurrentModeId() != m_entry_mode ||
+			!m_cache->IsCurrentValid() ||
+			m_cpu->InterruptPending();
+	}
+
+	template <bool Thumb>
+	void Jit::Sync(JitOp const* op) {
+		constexpr u32 size = Thumb ? 2 : 4;
+
+		CPUContext& ctx = *m_active;
+
+		if (!m_reference && op->pending_cycles) {
+			m_bus->m_time.access = Access::Seq;
+			m_bus->CachedFetch(op->pending_address, op->pending_value, op->pending_cycles);
+		}
+
+		ctx.m_regs.SetReg(15, op->pc);
+		ctx.m_old_pc = op->pc;
+		ctx.m_pipeline.SetState(op->pc + 2 * size, op->next_opcode, op->opcode);
+	}
+
+	template <bool Thumb>
+	bool Jit::Interpret(Jit* jit, JitOp const* op) {
+		if (jit->m_replay) {
+			TraceEntry const& entry = jit->m_trace[op->index];
+
+			*jit->m_active = entry.ctx;
+			jit->m_access_pos = entry.accesses;
+			jit->m_executed = op->index + 1;
+			jit->m_branch = entry.branch;
+
+			return entry.stop;
+		}
+
+		jit->Sync<Thumb>(op);
+
+		CPUContext& ctx = *jit->m_active;
+		memory::Bus* bus = jit->m_bus;
+
+		bool branch = false;
+
+		if constexpr (Thumb)
+			op->handler.thumb(static_cast<u16>(op->opcode), bus, ctx, branch);
+		else {
+			if (ctx.CheckCondition(op->condition))
+				op->handler.arm(op->opcode, ctx, bus, branch);
+			else
+				bus->m_time.access = Access::Seq;
+		}
+
+		ctx.ResolveFlags();
+
+		return jit->Finish<Thumb>(op, branch);
+	}
+
+	template <bool Thumb>
+	bool Jit::Finish(JitOp const* op, bool branch) {
+		constexpr InstructionMode mode = Thumb ? InstructionMode::THUMB
+			: InstructionMode::ARM;
+
+		CPUContext& ctx = *m_active;
+
+		if (m_cache->IsCurrentValid()) [[likely]]
+			ctx.m_pipeline.FetchCached<mode>(op->fetch_opcode,
+				op->fetch_cycles[(u8)m_bus->m_time.access]);
+		else
+			ctx.m_pipeline.Fetch<mode>();
+
+		m_executed = op->index + 1;
+		m_branch = branch;
+
+		if (branch || op->last)
+			return true;
+
+		//Translated instructions that do not
+		//access memory never change what is
+		//checked here
+		return (!op->translated || op->memory) && ShouldExit(Thumb);
+	}
+
+	template <bool Thumb, typename Type>
+	uint64_t Jit::Load(Jit* jit, JitOp const* op, u32 address) {
+		u32 value = 0;
+		bool exit = false;
+
+		if (jit->m_replay) {
+			value = jit->ReplayAccess(address, sizeof(Type), false, 0);
+			exit = jit->FinishReplay<Thumb>(op);
+		}
+		else {
+			memory::Bus* bus = jit->m_bus;
+
+			jit->Sync<Thumb>(op);
+
+			bus->m_time.access = Access::NonSeq;
+			value = bus->Read<Type>(address);
+			bus->InternalCycles(1);
+
+			exit = jit->Finish<Thumb>(op, false);
+		}
+
+		if constexpr (sizeof(Type) != 1)
+			value = std::rotr(value, (address & (sizeof(Type) - 1)) * 8);
+
+		return value | (uint64_t(exit) << 32);
+	}
+
+	template <bool Thumb, typename Type>
+	uint64_t Jit::LoadSigned(Jit* jit, JitOp const* op, u32 address) {
+		bool byte = sizeof(Type) == 1 || (address & 1);
+
+		u32 value = 0;
+		bool exit = false;
+
+		if (jit->m_replay) {
+			value = jit->ReplayAccess(address, byte ? 1 : 2, false, 0);
+			exit = jit->FinishReplay<Thumb>(op);
+		}
+		else {
+			memory::Bus* bus = jit->m_bus;
+
+			jit->Sync<Thumb>(op);
+
+			bus->m_time.access = Access::NonSeq;
+
+			if (byte)
+				value = bus->Read<u8>(address);
+			else
+				value = bus->Read<u16>(address);
+
+			bus->InternalCycles(1);
+
+			exit = jit->Finish<Thumb>(op, false);
+		}
+
+		value = byte ? u32(i32(i8(value))) : u32(i32(i16(value)));
+
+		return value | (uint64_t(exit) << 32);
+	}
+
+	template <bool Thumb, typename Type>
+	bool Jit::Store(Jit* jit, JitOp const* op, u32 address, u32 value) {
+		if (jit->m_replay) {
+			jit->ReplayAccess(address, sizeof(Type), true, Type(value));
+			return jit->FinishReplay<Thumb>(op);
+		}
+
+		memory::Bus* bus = jit->m_bus;
+
+		jit->Sync<Thumb>(op);
+
+		bus->m_time.access = Access::NonSeq;
+		bus->Write<Type>(address, Type(value));
+
+		return jit->Finish<Thumb>(op, false);
+	}
+
+	template <bool Thumb>
+	bool Jit::LoadMultiple(Jit* jit, JitOp const* op, u32 address, u32 count) {
+		u32* values = jit->m_transfer.data();
+
+		if (jit->m_replay) {
+			for (u32 index = 0; index < count; index++)
+				values[index] = jit->ReplayAccess(address + index * 4, 4, false, 0);
+
+			return jit->FinishReplay<Thumb>(op);
+		}
+
+		memory::Bus* bus = jit->m_bus;
+
+		jit->Sync<Thumb>(op);
+
+		bus->m_time.access = Access::NonSeq;
+
+		if (!bus->ReadMultiple(address, values, count)) {
+			for (u32 index = 0; index < count; index++) {
+				values[index] = bus->Read<u32>(address + index * 4);
+				bus->m_time.access = Access::Seq;
+			}
+		}
+
+		//Only LDM goes on sequentially
+		bus->m_time.access = Thumb ? Access::NonSeq : Access::Seq;
+		bus->InternalCycles(1);
+
+		return jit->Finish<Thumb>(op, false);
+	}
+
+	template <bool Thumb>
+	bool Jit::StoreMultiple(Jit* jit, JitOp const* op, u32 address, u32 count) {
+		u32 const* values = jit->m_transfer.data();
+
+		if (jit->m_replay) {
+			for (u32 index = 0; index < count; index++)
+				jit->ReplayAccess(address + index * 4, 4, true, values[index]);
+
+			return jit->FinishReplay<Thumb>(op);
+		}
+
+		memory::Bus* bus = jit->m_bus;
+
+		jit->Sync<Thumb>(op);
+
+		bus->m_time.access = Access::NonSeq;
+
+		if (!bus->WriteMultiple(address, values, count)) {
+			for (u32 index = 0; index < count; index++) {
+				bus->Write<u32>(address + index * 4, values[index]);
+				bus->m_time.access = Access::Seq;
+			}
+		}
+
+		bus->m_time.access = Access::NonSeq;
+
+		return jit->Finish<Thumb>(op, false);
+	}
+
+	u32 Jit::ReplayAccess(u32 address, u8 size, bool write, u32 value) {
+		if (m_access_pos >= m_accesses.size()) {
+			m_access_mismatch = true;
+			return 0;
+		}
+
+		memory::LoggedAccess const& access = m_accesses[m_access_pos++];
+
+		if (access.address != address || access.size != size ||
+			access.write != write || (write && access.value != value))
+			m_access_mismatch = true;
+
+		return access.value;
+	}
+
+	template <bool Thumb>
+	bool Jit::FinishReplay(JitOp const* op) {
+		TraceEntry const& entry = m_trace[op->index];
+		CPUContext& ctx = *m_active;
+
+		//Every access of the reference
+		//run must have been made
+		if (m_access_pos != entry.accesses)
+			m_access_mismatch = true;
+
+		m_access_pos = entry.accesses;
+
+		//The fetch state is the interpreter's,
+		//the registers come from translated code
+		ctx.m_regs.SetReg(15, entry.ctx.m_regs.GetReg(15));
+		ctx.m_old_pc = entry.ctx.m_old_pc;
+		ctx.m_pipeline = entry.ctx.m_pipeline;
+
+		m_executed = op->index + 1;
+		m_branch = entry.branch;
+
+		return entry.stop;
+	}
+
+	template <bool Thumb>
+	void Jit::ExitBlock(Jit* jit, JitOp const* op) {
+		constexpr u32 size = Thumb ? 2 : 4;
+
+		CPUContext& ctx = *jit->m_active;
+
+		if (!jit->m_replay) {
+			jit->m_bus->m_time.access = Access::Seq;
+			jit->m_bus->CachedFetch(op->pending_address, op->pending_value, op->pending_cycles);
+		}
+
+		ctx.m_regs.SetReg(15, op->pc);
+		ctx.m_old_pc = op->pc;
+		ctx.m_pipeline.SetState(op->pc + 3 * size, op->fetch_opcode, op->next_opcode);
+
+		jit->m_executed = op->index + 1;
+		jit->m_branch = false;
+	}
+
+	template <bool Thumb>
+	bool Jit::InterpretIndex(void* jit, u32 index) {
+		Jit* self = static_cast<Jit*>(jit);
+		return Interpret<Thumb>(self, &self->m_current->ops[index]);
+	}
+
+	template <bool Thumb>
+	void Jit::ExitIndex(void* jit, u32 index) {
+		Jit* self = static_cast<Jit*>(jit);
+		ExitBlock<Thumb>(self, &self->m_current->ops[index]);
+	}
+
+	bool Jit::CompareContext(CPUContext const& first, CPUContext const& second) {
+		static constexpr Mode modes[] = {
+			Mode::User, Mode::FIQ, Mode::IRQ,
+			Mode::SWI, Mode::ABRT, Mode::UND
+		};
+
+		for (Mode mode : modes) {
+			for (u8 id = 0; id < 16; id++) {
+				if (first.m_regs.GetReg(mode, id) != second.m_regs.GetReg(mode, id))
+					return false;
+			}
+		}
+
+		for (u32 index = 0; index < 5; index++) {
+			if ((u32)first.m_spsr[index] != (u32)second.m_spsr[index])
+				return false;
+		}
+
+		return (u32)first.GetResolvedCPSR() == (u32)second.GetResolvedCPSR() &&
+			first.m_old_pc == second.m_old_pc &&
+			first.m_pipeline.GetFetchPC() == second.m_pipeline.GetFetchPC() &&
+			first.m_pipeline.GetFetched() == second.m_pipeline.GetFetched() &&
+			first.m_pipeline.GetDecoded() == second.m_pipeline.GetDecoded();
+	}
+
+	template bool Jit::Run<false>(CachedBlock& block, bool& branch);
+	template bool Jit::Run<true>(CachedBlock& block, bool& branch);
+}
@@ -5,9 +5,25 @@
 #include "../../../common/Error.hpp"
 
 #include "../../../cpu/thumb/TableGen2.hpp"
+#include "../../../cpu/hle/Bios.hpp"
 
 #include <bit>
 
+/*
+* With THUMB_FULL_DECODE every opcode has its
+* own handler, which inlines the generic one
+* so that registers and immediates are folded
+*/
+#ifdef THUMB_FULL_DECODE
+	#if defined(_MSC_VER)
+		#define THUMB_INLINE __forceinline
+	#else
+		#define THUMB_INLINE inline __attribute__((always_inline))
+	#endif
+#else
+	#define THUMB_INLINE
+#endif
+
 namespace GBA::cpu::thumb{
 	LOG_CONTEXT(THUMB_Interpreter);
 
@@ -124,8 +140,7 @@ namespace GBA::cpu::thumb{
 
 			ctx.m_regs.SetReg(dest_reg, reg_value);
 
-			ctx.m_cpsr.zero = !reg_value;
-			ctx.m_cpsr.sign = CHECK_BIT(reg_value, 31);
+			ctx.SetLogicFlags(reg_value);
 		}
 
 		void EOR(u8 dest_reg, u32 source, CPUContext& ctx) {
@@ -135,8 +150,7 @@ namespace GBA::cpu::thumb{
 
 			ctx.m_regs.SetReg(dest_reg, reg_value);
 
-			ctx.m_cpsr.zero = !reg_value;
-			ctx.m_cpsr.sign = CHECK_BIT(reg_value, 31);
+			ctx.SetLogicFlags(reg_value);
 		}
 
 		void ADC(u8 dest_reg, u32 source, CPUContext& ctx) {
@@ -149,37 +163,27 @@ namespace GBA::cpu::thumb{
 			ctx.m_regs.SetReg(dest, res32);*/
 
 			u32 reg_value = ctx.m_regs.GetReg(dest_reg);
-			u32 original = reg_value;
-
-			u8 carry = ctx.m_cpsr.carry;
 
-			uint64_t res = (uint64_t)reg_value + source + carry;
-			u32 res32 = (u32)res;
+			u8 carry = ctx.GetCarry();
 
-			//reg_value += source + carry;
+			u32 res = reg_value + source + carry;
 
-			ctx.m_regs.SetReg(dest_reg, res32);
+			ctx.m_regs.SetReg(dest_reg, res);
 
-			ctx.m_cpsr.zero = !res32;
-			ctx.m_cpsr.sign = CHECK_BIT(res32, 31);
-			ctx.m_cpsr.carry = (res >> 32);
-			ctx.m_cpsr.overflow = (~(reg_value ^ source) & (source ^ (u32)res32)) >> 31;
+			ctx.SetAddFlags(reg_value, source, carry, res);
 		}
 
 		void SBC(u8 dest_reg, u32 source, CPUContext& ctx) {
 			u32 reg_value = ctx.m_regs.GetReg(dest_reg);
 			u32 original = reg_value;
 
-			u8 carry = ctx.m_cpsr.carry ^ 1;
+			u8 carry = ctx.GetCarry() ^ 1;
 
 			reg_value = reg_value - source - carry;
 
 			ctx.m_regs.SetReg(dest_reg, reg_value);
 
-			ctx.m_cpsr.zero = !reg_value;
-			ctx.m_cpsr.sign = CHECK_BIT(reg_value, 31);
-			ctx.m_cpsr.carry = (uint64_t)original >= (uint64_t)source + (uint64_t)carry;
-			ctx.m_cpsr.overflow = ((original ^ source) & (original ^ reg_value)) >> 31;
+			ctx.SetSubFlags(original, source, carry, reg_value);
 
 			//ctx.m_cpsr.CarrySubtract(original, (uint64_t)source + !carry);
 			//ctx.m_cpsr.OverflowSubtract(original, (uint64_t)source + !carry);
@@ -190,8 +194,7 @@ namespace GBA::cpu::thumb{
 
 			reg_value &= source;
 
-			ctx.m_cpsr.zero = !reg_value;
-			ctx.m_cpsr.sign = CHECK_BIT(reg_value, 31);
+			ctx.SetLogicFlags(reg_value);
 		}
 
 		void NEG(u8 dest_reg, u32 source, CPUContext& ctx) {
@@ -201,11 +204,7 @@ namespace GBA::cpu::thumb{
 
 			ctx.m_regs.SetReg(dest_reg, reg_value);
 
-			ctx.m_cpsr.zero = !reg_value;
-			ctx.m_cpsr.sign = CHECK_BIT(reg_value, 31);
-
-			ctx.m_cpsr.CarrySubtract(0, original);
-			ctx.m_cpsr.OverflowSubtract(0, original);
+			ctx.SetSubFlags(0, original, 0, reg_value);
 		}
 
 		void CMP(u8 dest_reg, u32 source, CPUContext& ctx) {
@@ -214,10 +213,7 @@ namespace GBA::cpu::thumb{
 
 			reg_value = reg_value - source;
 
-			ctx.m_cpsr.zero = !reg_value;
-			ctx.m_cpsr.sign = CHECK_BIT(reg_value, 31);
-			ctx.m_cpsr.CarrySubtract(original, source);
-			ctx.m_cpsr.OverflowSubtract(original, source);
+			ctx.SetSubFlags(original, source, 0, reg_value);
 		}
 
 		void CMN(u8 dest_reg, u32 source, CPUContext& ctx) {
@@ -226,10 +222,7 @@ namespace GBA::cpu::thumb{
 
 			reg_value = reg_value + source;
 
-			ctx.m_cpsr.zero = !reg_value;
-			ctx.m_cpsr.sign = CHECK_BIT(reg_value, 31);
-			ctx.m_cpsr.CarryAdd(original, source);
-			ctx.m_cpsr.OverflowAdd(original, source);
+			ctx.SetAddFlags(original, source, 0, reg_value);
 		}
 
 		void ORR(u8 dest_reg, u32 source, CPUContext& ctx) {
@@ -239,8 +232,7 @@ namespace GBA::cpu::thumb{
 
 			ctx.m_regs.SetReg(dest_reg, reg_value);
 
-			ctx.m_cpsr.zero = !reg_value;
-			ctx.m_cpsr.sign = CHECK_BIT(reg_value, 31);
+			ctx.SetLogicFlags(reg_value);
 		}
 
 		void MUL(u8 dest_reg, u32 source, CPUContext& ctx) {
@@ -250,8 +242,7 @@ namespace GBA::cpu::thumb{
 
 			ctx.m_regs.SetReg(dest_reg, reg_value);
 
-			ctx.m_cpsr.zero = !reg_value;
-			ctx.m_cpsr.sign = CHECK_BIT(reg_value, 31);
+			ctx.SetLogicFlags(reg_value);
 			//ctx.m_cpsr.carry = false;
 		}
 
@@ -262,8 +253,7 @@ namespace GBA::cpu::thumb{
 
 			ctx.m_regs.SetReg(dest_reg, reg_value);
 
-			ctx.m_cpsr.zero = !reg_value;
-			ctx.m_cpsr.sign = CHECK_BIT(reg_value, 31);
+			ctx.SetLogicFlags(reg_value);
 		}
 
 		void MVN(u8 dest_reg, u32 source, CPUContext& ctx) {
@@ -273,12 +263,11 @@ namespace GBA::cpu::thumb{
 
 			ctx.m_regs.SetReg(dest_reg, reg_value);
 
-			ctx.m_cpsr.zero = !reg_value;
-			ctx.m_cpsr.sign = CHECK_BIT(reg_value, 31);
+			ctx.SetLogicFlags(reg_value);
 		}
 
 		template <bool LrPc>
-		void Push(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool&) {
+		THUMB_INLINE void Push(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool&) {
 			//bool lr_pc = CHECK_BIT(instr, 8);
 			u8 rlist = instr & 0xFF;
 
@@ -293,22 +282,28 @@ namespace GBA::cpu::thumb{
 			u32 new_base = base;
 			u8 reg_id = 0;
 
+			u32 values[9];
+			u32 count = 0;
+
 			bus->m_time.access = Access::NonSeq;
 
 			while (rlist) {
-				if (rlist & 1) {
-					bus->Write<u32>(base, ctx.m_regs.GetReg(reg_id));
-					base += 4;
-					bus->m_time.access = Access::Seq;
-				}
+				if (rlist & 1)
+					values[count++] = ctx.m_regs.GetReg(reg_id);
 
 				reg_id++;
 				rlist >>= 1;
 			}
 
-			if constexpr (LrPc) {
-				bus->Write<u32>(base, ctx.m_regs.GetReg(14));
-				base += 4;
+			if constexpr (LrPc)
+				values[count++] = ctx.m_regs.GetReg(14);
+
+			if (count && !bus->WriteMultiple(base, values, count)) {
+				for (u32 index = 0; index < count; index++) {
+					bus->Write<u32>(base, values[index]);
+					base += 4;
+					bus->m_time.access = Access::Seq;
+				}
 			}
 
 			bus->m_time.access = Access::NonSeq;
@@ -317,31 +312,39 @@ namespace GBA::cpu::thumb{
 		}
 
 		template <bool LrPc>
-		void Pop(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+		THUMB_INLINE void Pop(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
 			//bool lr_pc = CHECK_BIT(instr, 8);
 
 			u8 rlist = instr & 0xFF;
 			u32 base = ctx.m_regs.GetReg(13);
 			u8 reg_id = 0;
 
+			u32 values[9];
+			u32 count = std::popcount(rlist) + LrPc;
+
 			bus->m_time.access = Access::NonSeq;
 
-			while (rlist) {
-				if (rlist & 1) {
-					u32 value = bus->Read<u32>(base);
-					ctx.m_regs.SetReg(reg_id, value);
-					base += 4;
+			if (count && !bus->ReadMultiple(base, values, count)) {
+				for (u32 index = 0; index < count; index++) {
+					values[index] = bus->Read<u32>(base + index * 4);
 					bus->m_time.access = Access::Seq;
 				}
+			}
+
+			u32 index = 0;
+
+			while (rlist) {
+				if (rlist & 1)
+					ctx.m_regs.SetReg(reg_id, values[index++]);
 
 				reg_id++;
 				rlist >>= 1;
 			}
 
+			base += count * 4;
+
 			if constexpr (LrPc) {
-				u32 value = bus->Read<u32>(base);
-				ctx.m_regs.SetReg(15, value);
-				base += 4;
+				ctx.m_regs.SetReg(15, values[index]);
 				branch = true;
 			}
 
@@ -352,7 +355,7 @@ namespace GBA::cpu::thumb{
 			ctx.m_regs.SetReg(13, base);
 		}
 
-		void StoreMultiple(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+		THUMB_INLINE void StoreMultiple(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
 			u8 base_reg = (instr >> 8) & 0x7;
 
 			u8 rlist = instr & 0xFF;
@@ -373,32 +376,40 @@ namespace GBA::cpu::thumb{
 			
 			u8 reg_id = 0;
 
+			u32 values[8];
+			u32 count = 0;
+
 			while (rlist) {
 				if (rlist & 1) {
-					if (reg_id == base_reg) {
-						if (base == orig_base)
-							bus->Write<u32>(base, orig_base);
-						else
-							bus->Write<u32>(base, new_base);
-					}
+					//The base is stored unchanged
+					//only if it comes first
+					if (reg_id == base_reg)
+						values[count] = count ? new_base : orig_base;
 					else
-						bus->Write<u32>(base, ctx.m_regs.GetReg(reg_id));
+						values[count] = ctx.m_regs.GetReg(reg_id);
 
-					base += 4;
-
-					bus->m_time.access = Access::Seq;
+					count++;
 				}
 
 				reg_id++;
 				rlist >>= 1;
 			}
 
+			if (!bus->WriteMultiple(base, values, count)) {
+				for (u32 index = 0; index < count; index++) {
+					bus->Write<u32>(base + index * 4, values[index]);
+					bus->m_time.access = Access::Seq;
+				}
+			}
+
+			base += count * 4;
+
 			bus->m_time.access = Access::NonSeq;
 
 			ctx.m_regs.SetReg(base_reg, base);
 		}
 
-		void LoadMultiple(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+		THUMB_INLINE void LoadMultiple(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
 			u8 base_reg = (instr >> 8) & 0x7;
 
 			u8 rlist = instr & 0xFF;
@@ -419,21 +430,28 @@ namespace GBA::cpu::thumb{
 
 			u8 reg_id = 0;
 
-			while (rlist) {
-				if (rlist & 1) {
-					u32 value = bus->Read<u32>(base);
-
-					ctx.m_regs.SetReg(reg_id, value);
-
-					base += 4;
+			u32 values[8];
+			u32 count = std::popcount(rlist);
 
+			if (!bus->ReadMultiple(base, values, count)) {
+				for (u32 index = 0; index < count; index++) {
+					values[index] = bus->Read<u32>(base + index * 4);
 					bus->m_time.access = Access::Seq;
 				}
+			}
+
+			u32 index = 0;
+
+			while (rlist) {
+				if (rlist & 1)
+					ctx.m_regs.SetReg(reg_id, values[index++]);
 
 				reg_id++;
 				rlist >>= 1;
 			}
 
+			base += count * 4;
+
 			rlist = instr & 0xFF;
 
 			bus->m_time.access = Access::NonSeq;
@@ -447,7 +465,7 @@ namespace GBA::cpu::thumb{
 
 	ThumbFunc THUMB_JUMP_TABLE[20] = {};
 
-	void ThumbUndefined(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+	THUMB_INLINE void ThumbUndefined(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
 		ctx.EnterException(ExceptionCode::UNDEF, 2);
 
 		branch = true;
@@ -456,13 +474,14 @@ namespace GBA::cpu::thumb{
 	}
 
 	template <u8 Opcode>
-	void ThumbFormat3(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool&) {
+	THUMB_INLINE void ThumbFormat3(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool&) {
 		//Execution time : 1S
 		u8 immediate = instr & 0xFF;
 		u8 dest_reg = (instr >> 8) & 0x7;
 
 		if constexpr (Opcode == 0) {
 			ctx.m_regs.SetReg(dest_reg, immediate);
+			ctx.ResolveFlags();
 			ctx.m_cpsr.sign = CHECK_BIT(immediate, 7);
 			ctx.m_cpsr.zero = !immediate;
 		}
@@ -470,19 +489,13 @@ namespace GBA::cpu::thumb{
 			u32 reg_val = ctx.m_regs.GetReg(dest_reg);
 			u32 res = reg_val - immediate;
 			
-			ctx.m_cpsr.sign = CHECK_BIT(res, 31);
-			ctx.m_cpsr.zero = !res;
-			ctx.m_cpsr.CarrySubtract(reg_val, immediate);
-			ctx.m_cpsr.OverflowSubtract(reg_val, immediate);
+			ctx.SetSubFlags(reg_val, immediate, 0, res);
 		}
 		else if constexpr (Opcode == 2) {
 			u32 reg_val = ctx.m_regs.GetReg(dest_reg);
 			u32 res = reg_val + immediate;
 
-			ctx.m_cpsr.sign = CHECK_BIT(res, 31);
-			ctx.m_cpsr.zero = !res;
-			ctx.m_cpsr.CarryAdd(reg_val, immediate);
-			ctx.m_cpsr.OverflowAdd(reg_val, immediate);
+			ctx.SetAddFlags(reg_val, immediate, 0, res);
 
 			ctx.m_regs.SetReg(dest_reg, res);
 		}
@@ -490,10 +503,7 @@ namespace GBA::cpu::thumb{
 			u32 reg_val = ctx.m_regs.GetReg(dest_reg);
 			u32 res = reg_val - immediate;
 
-			ctx.m_cpsr.sign = CHECK_BIT(res, 31);
-			ctx.m_cpsr.zero = !res;
-			ctx.m_cpsr.CarrySubtract(reg_val, immediate);
-			ctx.m_cpsr.OverflowSubtract(reg_val, immediate);
+			ctx.SetSubFlags(reg_val, immediate, 0, res);
 
 			ctx.m_regs.SetReg(dest_reg, res);
 		}
@@ -502,7 +512,7 @@ namespace GBA::cpu::thumb{
 	}
 
 	template <u8 Opcode>
-	void ThumbFormat5(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+	THUMB_INLINE void ThumbFormat5(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
 		//Execution time :
 		//1S for normal
 		//2S + 1N for branches
@@ -527,10 +537,7 @@ namespace GBA::cpu::thumb{
 
 			u32 res = first_op - source;
 
-			ctx.m_cpsr.sign = CHECK_BIT(res, 31);
-			ctx.m_cpsr.zero = !res;
-			ctx.m_cpsr.CarrySubtract(first_op, source);
-			ctx.m_cpsr.OverflowSubtract(first_op, source);
+			ctx.SetSubFlags(first_op, source, 0, res);
 		}
 		else if constexpr (Opcode == 2) {
 			ctx.m_regs.SetReg(dest_reg, source);
@@ -563,7 +570,7 @@ namespace GBA::cpu::thumb{
 	}
 
 	template <bool Sp>
-	void ThumbFormat12(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+	THUMB_INLINE void ThumbFormat12(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
 		//Execution time : 1S
 		u32 source = 0;
 
@@ -581,73 +588,20 @@ namespace GBA::cpu::thumb{
 	}
 
 	template <u8 Cond>
-	void ThumbFormat16(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+	THUMB_INLINE void ThumbFormat16(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
 		//Execution time :
 		//1S if cond is false
 		//2S + 1N if cond is true
 
 		bus->m_time.access = Access::Seq;
 
-		if constexpr (Cond == 0) {
-			if (!ctx.m_cpsr.zero)
-				return;
-		} 
-		else if constexpr (Cond == 1) {
-			if (ctx.m_cpsr.zero)
-				return;
-		}
-		else if constexpr (Cond == 2) {
-			if (!ctx.m_cpsr.carry)
-				return;
-		}
-		else if constexpr (Cond == 3) {
-			if (ctx.m_cpsr.carry)
-				return;
-		}
-		else if constexpr (Cond == 4) {
-			if (!ctx.m_cpsr.sign)
-				return;
-		}
-		else if constexpr (Cond == 5) {
-			if (ctx.m_cpsr.sign)
-				return;
-		}
-		else if constexpr (Cond == 6) {
-			if (!ctx.m_cpsr.overflow)
-				return;
-		}
-		else if constexpr (Cond == 7) {
-			if (ctx.m_cpsr.overflow)
-				return;
-		}
-		else if constexpr (Cond == 8) {
-			if (!(ctx.m_cpsr.carry && !ctx.m_cpsr.zero))
-				return;
-		}
-		else if constexpr (Cond == 9) {
-			if (!(!ctx.m_cpsr.carry || ctx.m_cpsr.zero))
-				return;
-		}
-		else if constexpr (Cond == 0xA) {
-			if (!(ctx.m_cpsr.sign == ctx.m_cpsr.overflow))
-				return;
-		}
-		else if constexpr (Cond == 0xB) {
-			if (!(ctx.m_cpsr.sign != ctx.m_cpsr.overflow))
-				return;
-		}
-		else if constexpr (Cond == 0xC) {
-			if (!(!ctx.m_cpsr.zero && ctx.m_cpsr.sign == ctx.m_cpsr.overflow))
-				return;
+		if constexpr (Cond == 0xF) {
+			return;
 		}
-		else if constexpr (Cond == 0xD) {
-			if (!(ctx.m_cpsr.zero || ctx.m_cpsr.sign != ctx.m_cpsr.overflow))
+		else if constexpr (Cond != 0xE) {
+			if (!ctx.CheckCondition(Cond))
 				return;
 		}
-		else if constexpr (Cond == 0xE) { }
-		else if constexpr (Cond == 0xF) {
-			return;
-		}
 
 		i16 offset = instr & 0xFF;
 
@@ -661,7 +615,7 @@ namespace GBA::cpu::thumb{
 		branch = true;
 	}
 
-	void ThumbFormat18(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+	THUMB_INLINE void ThumbFormat18(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
 		//Execution time : 2S + 1N
 		i16 offset = instr & 0b11111111111;
 
@@ -678,7 +632,7 @@ namespace GBA::cpu::thumb{
 	}
 
 	template <u8 ShiftType>
-	void ThumbFormat1(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+	THUMB_INLINE void ThumbFormat1(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
 		//Execution time : 1S
 		u8 opcode = (instr >> 11) & 0x3;
 
@@ -686,7 +640,8 @@ namespace GBA::cpu::thumb{
 		u8 source = (instr >> 3) & 0x7;
 		u8 dest = instr & 0x7;
 
-		bool carry = ctx.m_cpsr.carry;
+		//Only LSL #0 keeps the old carry
+		bool carry = ShiftType == 0 && !shift ? ctx.GetCarry() : false;
 
 		std::pair<u32, bool> res{};
 
@@ -707,15 +662,14 @@ namespace GBA::cpu::thumb{
 
 		ctx.m_regs.SetReg(dest, res.first);
 
-		ctx.m_cpsr.zero = !res.first;
-		ctx.m_cpsr.sign = CHECK_BIT(res.first, 31);
+		ctx.SetLogicFlags(res.first);
 		ctx.m_cpsr.carry = res.second;
 
 		bus->m_time.access = Access::Seq;
 	}
 
 	template <u8 Opcode>
-	void ThumbFormat2(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+	THUMB_INLINE void ThumbFormat2(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
 		//Execution time : 1S
 		u8 opcode = (instr >> 9) & 0x3;
 
@@ -731,31 +685,24 @@ namespace GBA::cpu::thumb{
 		if constexpr (Opcode == 0) {
 			u32 operand = ctx.m_regs.GetReg(reg_or_imm);
 			res = source + operand;
-			ctx.m_cpsr.CarryAdd(source, operand);
-			ctx.m_cpsr.OverflowAdd(source, operand);
+			ctx.SetAddFlags(source, operand, 0, res);
 		} 
 		else if constexpr (Opcode == 1) {
 			u32 operand = ctx.m_regs.GetReg(reg_or_imm);
 			res = source - operand;
-			ctx.m_cpsr.CarrySubtract(source, operand);
-			ctx.m_cpsr.OverflowSubtract(source, operand);
+			ctx.SetSubFlags(source, operand, 0, res);
 		}
 		else if constexpr (Opcode == 2) {
 			u32 operand = reg_or_imm;
 			res = source + operand;
-			ctx.m_cpsr.CarryAdd(source, operand);
-			ctx.m_cpsr.OverflowAdd(source, operand);
+			ctx.SetAddFlags(source, operand, 0, res);
 		}
 		else if constexpr (Opcode == 3) {
 			u32 operand = reg_or_imm;
 			res = source - operand;
-			ctx.m_cpsr.CarrySubtract(source, operand);
-			ctx.m_cpsr.OverflowSubtract(source, operand);
+			ctx.SetSubFlags(source, operand, 0, res);
 		}
 
-		ctx.m_cpsr.zero = !res;
-		ctx.m_cpsr.sign = CHECK_BIT(res, 31);
-
 		ctx.m_regs.SetReg(dest_reg, res);
 
 		bus->m_time.access = Access::Seq;
@@ -781,7 +728,7 @@ namespace GBA::cpu::thumb{
 	}
 
 	template <u8 Opcode>
-	void ThumbFormat4(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+	THUMB_INLINE void ThumbFormat4(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
 		//Execution time :
 		//1S +
 		//1I if shift
@@ -797,7 +744,9 @@ namespace GBA::cpu::thumb{
 
 		std::pair<u32, bool> shift_res{};
 
-		bool carry = ctx.m_cpsr.carry;
+		//Shifts by 0 keep the old carry
+		bool carry = (Opcode == 2 || Opcode == 3 || Opcode == 4 || Opcode == 7) ?
+			ctx.GetCarry() : false;
 
 		u32 dest_val = ctx.m_regs.GetReg(dest_reg);
 
@@ -812,9 +761,8 @@ namespace GBA::cpu::thumb{
 
 			ctx.m_regs.SetReg(dest_reg, shift_res.first);
 
+			ctx.SetLogicFlags(shift_res.first);
 			ctx.m_cpsr.carry = shift_res.second;
-			ctx.m_cpsr.zero = !shift_res.first;
-			ctx.m_cpsr.sign = CHECK_BIT(shift_res.first, 31);
 
 			bus->InternalCycles(1);
 		}
@@ -823,9 +771,8 @@ namespace GBA::cpu::thumb{
 
 			ctx.m_regs.SetReg(dest_reg, shift_res.first);
 
+			ctx.SetLogicFlags(shift_res.first);
 			ctx.m_cpsr.carry = shift_res.second;
-			ctx.m_cpsr.zero = !shift_res.first;
-			ctx.m_cpsr.sign = CHECK_BIT(shift_res.first, 31);
 
 			bus->InternalCycles(1);
 		}
@@ -834,9 +781,8 @@ namespace GBA::cpu::thumb{
 
 			ctx.m_regs.SetReg(dest_reg, shift_res.first);
 
+			ctx.SetLogicFlags(shift_res.first);
 			ctx.m_cpsr.carry = shift_res.second;
-			ctx.m_cpsr.zero = !shift_res.first;
-			ctx.m_cpsr.sign = CHECK_BIT(shift_res.first, 31);
 
 			bus->InternalCycles(1);
 		}
@@ -851,9 +797,8 @@ namespace GBA::cpu::thumb{
 
 			ctx.m_regs.SetReg(dest_reg, shift_res.first);
 
+			ctx.SetLogicFlags(shift_res.first);
 			ctx.m_cpsr.carry = shift_res.second;
-			ctx.m_cpsr.zero = !shift_res.first;
-			ctx.m_cpsr.sign = CHECK_BIT(shift_res.first, 31);
 
 			bus->InternalCycles(1);
 		}
@@ -892,7 +837,7 @@ namespace GBA::cpu::thumb{
 	}
 
 	template <bool Subtract>
-	void ThumbFormat13(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+	THUMB_INLINE void ThumbFormat13(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
 		u16 offset = (instr & 0x7F) * 4;
 
 		if constexpr (Subtract)
@@ -903,7 +848,7 @@ namespace GBA::cpu::thumb{
 		bus->m_time.access = Access::Seq;
 	}
 
-	void ThumbFormat19(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+	THUMB_INLINE void ThumbFormat19(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
 		u32 curr_opcode = (instr >> 11) & 0x1F;
 
 		if (curr_opcode == 0x1E) {
@@ -942,7 +887,7 @@ namespace GBA::cpu::thumb{
 		bus->m_time.access = Access::Seq;
 	}
 
-	void ThumbFormat6(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+	THUMB_INLINE void ThumbFormat6(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
 		u8 dest_reg = (instr >> 8) & 0x7;
 
 		u16 offset = (instr & 0xFF) * 4;
@@ -963,7 +908,7 @@ namespace GBA::cpu::thumb{
 	}
 
 	template <u8 Opcode>
-	void ThumbFormat7(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+	THUMB_INLINE void ThumbFormat7(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
 		//u8 type = (instr >> 10) & 0x3;
 
 		u8 offset_reg = (instr >> 6) & 0x7;
@@ -997,7 +942,7 @@ namespace GBA::cpu::thumb{
 	}
 
 	template <u8 Opcode>
-	void ThumbFormat8(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+	THUMB_INLINE void ThumbFormat8(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
 		//u8 type = (instr >> 10) & 0x3;
 
 		u8 offset_reg = (instr >> 6) & 0x7;
@@ -1038,7 +983,7 @@ namespace GBA::cpu::thumb{
 	}
 
 	template <u8 Opcode>
-	void ThumbFormat9(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+	THUMB_INLINE void ThumbFormat9(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
 		//u8 type = (instr >> 11) & 0x3;
 
 		u32 offset = (instr >> 6) & 0x1F;
@@ -1074,7 +1019,7 @@ namespace GBA::cpu::thumb{
 	}
 
 	template <bool Load>
-	void ThumbFormat10(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+	THUMB_INLINE void ThumbFormat10(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
 		u32 offset = ((instr >> 6) & 0x1F) * 2;
 
 		u8 base_reg = (instr >> 3) & 0x7;
@@ -1098,7 +1043,7 @@ namespace GBA::cpu::thumb{
 	}
 
 	template <bool Load>
-	void ThumbFormat11(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+	THUMB_INLINE void ThumbFormat11(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
 		u8 rd = (instr >> 8) & 0x7;
 
 		u16 offset = (instr & 0xFF) * 4;
@@ -1121,14 +1066,14 @@ namespace GBA::cpu::thumb{
 	}
 
 	template <bool Pop, bool PcLr>
-	void ThumbFormat14(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+	THUMB_INLINE void ThumbFormat14(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
 		if constexpr (Pop)
 			detail::Pop<PcLr>(instr, bus, ctx, branch);
 		else
 			detail::Push<PcLr>(instr, bus, ctx, branch);
 	}
 
-	void ThumbFormat15(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+	THUMB_INLINE void ThumbFormat15(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
 		bool type = CHECK_BIT(instr, 11);
 
 
@@ -1138,7 +1083,12 @@ namespace GBA::cpu::thumb{
 			detail::StoreMultiple(instr, bus, ctx, branch);
 	}
 
-	void ThumbFormat17(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+	THUMB_INLINE void ThumbFormat17(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+		if (bus->IsHleBios() && hle::SoftwareInterrupt(instr & 0xFF, ctx, bus, branch)) {
+			bus->m_time.access = Access::Seq;
+			return;
+		}
+
 		ctx.EnterException(ExceptionCode::SOFTI, 2);
 
 		branch = true;
@@ -1150,7 +1100,7 @@ namespace GBA::cpu::thumb{
 	struct Decoder {
 		static constexpr THUMBInstructionType type = detail::DecodeThumbConstexpr(Instr << 6);
 
-		static ThumbFunc GetFunctionPointer() {
+		static constexpr ThumbFunc GetFunctionPointer() {
 			constexpr u16 ShiftedInstr = (Instr << 6);
 
 			switch (type)
@@ -1282,25 +1232,37 @@ namespace GBA::cpu::thumb{
 		}
 	};
 
+#ifdef THUMB_FULL_DECODE
+	template <u16 Opcode>
+	void ThumbOpcode(THUMBInstruction, memory::Bus* bus, CPUContext& ctx, bool& branch) {
+		constexpr ThumbFunc handler = Decoder<(Opcode >> 6)>::GetFunctionPointer();
+		handler(Opcode, bus, ctx, branch);
+	}
+#endif
+
 	struct DecodeSeqHelper {
 		template <std::size_t... Seq>
 		static std::array<ThumbFunc, sizeof...(Seq)> GetTable(std::index_sequence<Seq...>) {
 			return {
+#ifdef THUMB_FULL_DECODE
+				ThumbOpcode<Seq>...
+#else
 				Decoder<Seq>::GetFunctionPointer()...
+#endif
 			};
 		}
 	};
 
 	template <std::size_t Max>
 	struct DecodeSeq {
-		static std::array<ThumbFunc, 1024> CreateTable() {
+		static std::array<ThumbFunc, Max> CreateTable() {
 			return DecodeSeqHelper::GetTable(
 				std::make_index_sequence<Max>{}
 			);
 		}
 	};
 
-	std::array<ThumbFunc, 1024> thumb_jump_table = DecodeSeq<1024>::CreateTable();
+	std::array<ThumbFunc, THUMB_TABLE_SIZE> thumb_jump_table = DecodeSeq<THUMB_TABLE_SIZE>::CreateTable();
 
 	THUMBInstructionType DecodeThumb(u16 opcode) {
 		for (u8 i = 0; i < 19; i++) {
@@ -1320,8 +1282,6 @@ namespace GBA::cpu::thumb{
 	}
 
 	void ExecuteThumb(THUMBInstruction instr, memory::Bus* bus, CPUContext& ctx, bool& branch) {
-		u16 hash = (instr >> 6) & 0b1111111111;
-
-		thumb_jump_table[hash](instr, bus, ctx, branch);
+		GetThumbHandler(instr)(instr, bus, ctx, branch);
 	}
 }
\ No newline at end of file
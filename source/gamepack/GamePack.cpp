@@ -24,7 +24,7 @@ namespace GBA::gamepack {
 		m_rom(nullptr), m_backup(nullptr),
 		m_path(), m_info{}, m_head{},
 		m_backup_address_start{}, m_gpio(nullptr),
-		m_cheats{} 
+		m_cheats{}, m_idle_loops{}
 	{}
 
 	bool GamePack::LoadFrom(fs::path const& path) {
@@ -98,6 +98,8 @@ namespace GBA::gamepack {
 
 		m_cheats = backups::BackupDatabase::GetCheats("cheats.txt", game_name);
 
+		m_idle_loops = backups::BackupDatabase::GetIdleLoops("rom_db.txt", game_name);
+
 		return true;
 	}
 
@@ -151,6 +153,29 @@ namespace GBA::gamepack {
 		return *reinterpret_cast<u16*>(m_rom + address);
 	}
 
+	u8 const* GamePack::GetRomPointer(u32 address, u8 region) const {
+		if (region == 0x5 && address + 0xC000000 >= m_backup_address_start)
+			return nullptr;
+
+		if (address >= 0x00000C4 && address <= 0x00000C9 && m_gpio)
+			return nullptr;
+
+		if (address + 1 >= m_info.file_size)
+			return nullptr;
+
+		return m_rom + address;
+	}
+
+	u8 const* GamePack::GetRomRange(u32 address, u32 len, u8 region) const {
+		if (!GetRomPointer(address, region) || !GetRomPointer(address + len - 2, region))
+			return nullptr;
+
+		if (m_gpio && address <= 0x00000C9 && address + len > 0x00000C4)
+			return nullptr;
+
+		return m_rom + address;
+	}
+
 	void GamePack::Write(u32 address, u16 value, u8 region) {
 		if (address >= m_backup_address_start)
 			m_backup->Write(address - m_backup_address_start, value);
@@ -84,6 +84,36 @@ namespace GBA::gamepack::backups {
 		return devs;
 	}
 
+	std::vector<uint32_t> BackupDatabase::GetIdleLoops(std::string_view db_path, std::string rom_name) {
+		if (!std::filesystem::exists(db_path) || !std::filesystem::is_regular_file(db_path))
+			return {};
+
+		mINI::INIFile db_file(db_path.data());
+
+		mINI::INIStructure database;
+
+		db_file.read(database);
+
+		if (!database.has(rom_name) || !database.get(rom_name).has("idle_loop"))
+			return {};
+
+		std::istringstream stream{ database.get(rom_name).get("idle_loop") };
+		std::string address = "";
+
+		std::vector<uint32_t> loops{};
+
+		while (std::getline(stream, address, ',')) {
+			try {
+				loops.push_back(uint32_t(std::stoul(address, nullptr, 16)) & ~1);
+			}
+			catch (std::exception&) {
+				continue;
+			}
+		}
+
+		return loops;
+	}
+
 	std::unordered_map<std::string, CheatEntry> BackupDatabase::GetCheats(std::string_view db_path,
 		std::string rom_name) {
 		std::unordered_map<std::string, CheatEntry> game_cheats{};
@@ -5,6 +5,7 @@
 #include "../../common/Error.hpp"
 
 #include "../../cpu/core/ARM7TDI.hpp"
+#include "../../cpu/hle/Bios.hpp"
 
 #include "../../ppu/PPU.hpp"
 
@@ -12,20 +13,30 @@
 
 #include <filesystem>
 #include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
 
 namespace GBA::memory {
 	LOG_CONTEXT(Memory_bus);
 
+	namespace {
+		//Page table seen while accesses are logged
+		MemoryPage NO_PAGES[NUM_PAGES]{};
+	}
+
 	Bus::Bus() :
-		m_pack(nullptr), m_wram(nullptr),
+		m_pack(nullptr), m_page_table(nullptr), m_pages(nullptr),
+		m_code_generation(0), m_wram(nullptr),
 		m_iwram(nullptr), m_prefetch{}, 
 		m_time{}, m_enable_prefetch(false), 
 		m_bios_latch{0x00}, m_open_bus_value{0x00},
 		m_open_bus_address{0x00}, m_ppu(nullptr), 
-		m_bios(nullptr), m_sched(nullptr),
+		m_bios(nullptr), m_hle_bios(false), m_hle_waiting(false), m_sched(nullptr),
 		active_dmas_count{}, active_dmas{},
 		dmas{}, m_post_boot{}, m_halt_cnt{},
-		m_mem_control{}, m_timers(nullptr)
+		m_mem_control{}, m_timers(nullptr),
+		m_timer_reads{}, m_block_cache(nullptr), m_access_log(nullptr)
 	{
 		m_wram = new u8[0x40000];
 		m_iwram = new u8[0x8000];
@@ -33,6 +44,12 @@ namespace GBA::memory {
 		std::fill_n(m_wram, 0x40000, 0x00);
 		std::fill_n(m_iwram, 0x8000, 0x00);
 
+		m_page_table = new MemoryPage[NUM_PAGES]{};
+		m_pages = m_page_table;
+
+		MapPages(0x02000000, 0x03000000, m_wram, 0x40000, 3, 6, true);
+		MapPages(0x03000000, 0x04000000, m_iwram, 0x8000, 1, 1, true);
+
 		mmio = new MMIO();
 
 		m_bios = new u8[16 * 1024];
@@ -43,8 +60,12 @@ namespace GBA::memory {
 			m_time.m_config_raw &= ~((u16)0xFF << (pos * 8));
 			m_time.m_config_raw |= ((u16)value << (pos * 8));
 
-			if(pos == 0x1)
+			if (pos == 0x1) {
 				m_time.UpdateWaitstate(m_time.m_config_raw);
+				//Cached fetch costs depend on waitstates
+				m_block_cache->Flush();
+				m_code_generation++;
+			}
 			//error::DebugBreak();
 		});
 
@@ -78,6 +99,85 @@ namespace GBA::memory {
 
 	void Bus::ConnectGamepack(gamepack::GamePack* pack) {
 		m_pack = pack;
+		MapRomPages();
+	}
+
+	void Bus::SetAccessLog(std::vector<LoggedAccess>* log) {
+		m_access_log = log;
+		m_pages = log ? NO_PAGES : m_page_table;
+		m_code_generation++;
+	}
+
+	void Bus::MapPages(u32 start, u32 end, u8* memory, u32 size,
+		u8 cycles16, u8 cycles32, bool byte_write) {
+		m_code_generation++;
+
+		for (u32 address = start; address < end; address += PAGE_SIZE) {
+			MemoryPage& page = m_page_table[address >> PAGE_SHIFT];
+
+			if (size >= PAGE_SIZE) {
+				page.write = memory + ((address - start) & (size - 1));
+				page.mask = PAGE_SIZE - 1;
+			}
+			else {
+				page.write = memory;
+				page.mask = size - 1;
+			}
+
+			page.read = page.write;
+			page.cycles[0] = cycles16;
+			page.cycles[1] = cycles16;
+			page.cycles[2] = cycles32;
+			page.byte_write = byte_write;
+		}
+	}
+
+	void Bus::MapVideoPages() {
+		m_code_generation++;
+
+		//Byte writes have special
+		//behaviour, see ppu::PPU
+		MapPages(0x05000000, 0x06000000, m_ppu->GetPaletteMemory(), 0x400, 1, 2, false);
+		MapPages(0x07000000, 0x08000000, m_ppu->GetOAMMemory(), 0x400, 1, 1, false);
+
+		u8* vram = m_ppu->GetVRAMMemory();
+
+		//VRAM is mirrored every 128 KB,
+		//the last 32 KB mirror OBJ VRAM
+		for (u32 address = 0x06000000; address < 0x07000000; address += PAGE_SIZE) {
+			MemoryPage& page = m_page_table[address >> PAGE_SHIFT];
+			u32 offset = address & 0x1FFFF;
+
+			if (offset >= 0x18000)
+				offset -= 0x8000;
+
+			page.write = vram + offset;
+			page.read = page.write;
+			page.mask = PAGE_SIZE - 1;
+			page.cycles[0] = 1;
+			page.cycles[1] = 1;
+			page.cycles[2] = 2;
+			page.byte_write = false;
+		}
+	}
+
+	void Bus::MapRomPages() {
+		m_code_generation++;
+
+		//Cycles are left to 0, ROM timing
+		//goes through Prefetch
+		for (u32 address = 0x08000000; address < 0x0E000000; address += PAGE_SIZE) {
+			MemoryPage& page = m_page_table[address >> PAGE_SHIFT];
+			u8 rom_region = (u8)(address >> 24) - 8;
+			u32 offset = address & 0x00FFFFFF;
+
+			if (rom_region & 1)
+				offset += 0x01000000;
+
+			page = MemoryPage{};
+			page.read = m_pack ? m_pack->GetRomRange(offset, PAGE_SIZE, rom_region) : nullptr;
+			page.mask = PAGE_SIZE - 1;
+		}
 	}
 
 	void Bus::InternalCycles(u32 count) {
@@ -89,6 +189,292 @@ namespace GBA::memory {
 		m_sched->Advance(count);
 	}
 
+	template <typename Type>
+	u32 Bus::TransferBlock(u32 source, u32 dest, i32 source_inc, i32 dest_inc, u32 count) {
+		constexpr u32 size = sizeof(Type);
+
+		if (source >= PAGE_TABLE_END || dest >= PAGE_TABLE_END)
+			return 0;
+
+		MemoryPage const& src_page = m_pages[source >> PAGE_SHIFT];
+		MemoryPage const& dst_page = m_pages[dest >> PAGE_SHIFT];
+
+		if (!src_page.read || !dst_page.write)
+			return 0;
+
+		MEMORY_RANGE src_region = (MEMORY_RANGE)(source >> 24);
+		u32 read_cycles = src_page.cycles[PageCyclesIndex<Type>()];
+		u32 first_read_cycles = read_cycles;
+
+		//ROM pages carry no cycles, the cost is the same
+		//as in Prefetch. Only the first unit of a page can
+		//be on a 128 KB boundary
+		if (!read_cycles) {
+			if (src_region < MEMORY_RANGE::ROM_REG_1 || src_region > MEMORY_RANGE::ROM_REG_3_SECOND ||
+				source_inc != (i32)size)
+				return 0;
+
+			Access acc = (source & ~(size - 1) & 0x1FFFF) ? m_time.access : Access::NonSeq;
+
+			read_cycles = m_time.GetAccessCycles<size>(src_region, Access::Seq);
+			first_read_cycles = m_time.GetAccessCycles<size>(src_region, acc);
+		}
+
+		u32 write_cycles = dst_page.cycles[PageCyclesIndex<Type>()];
+
+		//Units left before the end of the
+		//contiguous part of the page
+		auto units_in_page = [](u32 address, u32 mask, i32 inc) -> u32 {
+			u32 offset = address & mask & ~(size - 1);
+
+			if (!inc)
+				return ~0u;
+
+			return inc > 0 ? (mask + 1 - offset) / size : offset / size + 1;
+		};
+
+		count = std::min({ count, units_in_page(source, src_page.mask, source_inc),
+			units_in_page(dest, dst_page.mask, dest_inc) });
+
+		uint64_t now = m_sched->GetTimestamp();
+		uint64_t next_event = m_sched->GetFirstEvent().trigger_timestamp;
+
+		u32 unit_cycles = read_cycles + write_cycles;
+		u32 first_cycles = first_read_cycles + write_cycles;
+
+		if (now + first_cycles >= next_event)
+			return 0;
+
+		//No event can fire before the last unit is done
+		uint64_t max_units = 1 + (next_event - 1 - now - first_cycles) / unit_cycles;
+
+		if (max_units < count)
+			count = (u32)max_units;
+
+		if (count < 2)
+			return 0;
+
+		u8 const* src = src_page.read + (source & src_page.mask & ~(size - 1));
+		u8* dst = dst_page.write + (dest & dst_page.mask & ~(size - 1));
+
+		u8 const* src_low = source_inc < 0 ? src + (count - 1) * source_inc : src;
+		u8 const* src_high = src_low + (count - 1) * (u32)std::abs(source_inc) + size;
+		u8 const* dst_low = dest_inc < 0 ? dst + (count - 1) * dest_inc : dst;
+		u8 const* dst_high = dst_low + (count - 1) * (u32)std::abs(dest_inc) + size;
+
+		bool overlap = src_low < dst_high && dst_low < src_high;
+
+		Type value{};
+
+		if (!overlap && source_inc == (i32)size && dest_inc == (i32)size) {
+			std::memcpy(dst, src, count * size);
+			value = *reinterpret_cast<Type const*>(src + (count - 1) * size);
+		}
+		else if (!overlap && !source_inc && dest_inc == (i32)size) {
+			value = *reinterpret_cast<Type const*>(src);
+			std::fill_n(reinterpret_cast<Type*>(dst), count, value);
+		}
+		else {
+			//Same order as the hardware, overlapping
+			//transfers see their own writes
+			for (u32 unit = 0; unit < count; unit++) {
+				value = *reinterpret_cast<Type const*>(src + (i32)unit * source_inc);
+				*reinterpret_cast<Type*>(dst + (i32)unit * dest_inc) = value;
+			}
+		}
+
+		if (src_region >= MEMORY_RANGE::ROM_REG_1)
+			StopPrefetch();
+
+		MEMORY_RANGE dst_region = (MEMORY_RANGE)(dest >> 24);
+		u32 dst_address = (dest & ~(size - 1)) + (u32)(dst_low - dst);
+		u32 dst_len = (u32)(dst_high - dst_low);
+
+		if (dst_region == MEMORY_RANGE::IWRAM)
+			m_block_cache->InvalidateRange<true>(dst_address & REGIONS_LEN[(u8)MEMORY_RANGE::IWRAM], dst_len);
+		else if (dst_region == MEMORY_RANGE::EWRAM)
+			m_block_cache->InvalidateRange<false>(dst_address & REGIONS_LEN[(u8)MEMORY_RANGE::EWRAM], dst_len);
+		else if (dst_region == MEMORY_RANGE::VRAM)
+			m_ppu->InvalidateVRAM(u32(dst_low - m_ppu->GetVRAMMemory()), dst_len);
+		else if (dst_region == MEMORY_RANGE::PAL)
+			m_ppu->InvalidatePalette();
+		else if (dst_region == MEMORY_RANGE::OAM)
+			m_ppu->InvalidateOAM();
+
+		m_open_bus_value = value;
+		m_open_bus_address = dest + (count - 1) * dest_inc;
+
+		u32 total_cycles = first_cycles + (count - 1) * unit_cycles;
+
+		m_time.PushInternalCycles(total_cycles);
+		m_sched->Advance(total_cycles);
+
+		return count;
+	}
+
+	template u32 Bus::TransferBlock<u16>(u32, u32, i32, i32, u32);
+	template u32 Bus::TransferBlock<u32>(u32, u32, i32, i32, u32);
+
+	MemoryPage const* Bus::GetMultiplePage(u32 address, u32 count, bool write) const {
+		if (address >= PAGE_TABLE_END)
+			return nullptr;
+
+		MemoryPage const& page = m_pages[address >> PAGE_SHIFT];
+		u32 cycles = page.cycles[PageCyclesIndex<u32>()];
+
+		if (!cycles || (write && !page.write))
+			return nullptr;
+
+		u32 offset = address & page.mask & ~3;
+
+		if (offset + count * 4 > page.mask + 1)
+			return nullptr;
+
+		//Events see the same timestamp
+		//as with one access at a time
+		uint64_t last_access = m_sched->GetTimestamp() + (count - 1) * cycles;
+
+		if (last_access >= m_sched->GetFirstEvent().trigger_timestamp)
+			return nullptr;
+
+		return &page;
+	}
+
+	bool Bus::ReadMultiple(u32 address, u32* values, u32 count) {
+		MemoryPage const* page = GetMultiplePage(address, count, false);
+
+		if (!page)
+			return false;
+
+		std::memcpy(values, page->read + (address & page->mask & ~3), count * 4);
+
+		u32 num_cycles = count * page->cycles[PageCyclesIndex<u32>()];
+
+		m_time.PushInternalCycles(num_cycles);
+
+		m_open_bus_value = values[count - 1];
+		m_open_bus_address = address + (count - 1) * 4;
+
+		m_sched->Advance(num_cycles);
+
+		return true;
+	}
+
+	bool Bus::WriteMultiple(u32 address, u32 const* values, u32 count) {
+		MemoryPage const* page = GetMultiplePage(address, count, true);
+
+		if (!page)
+			return false;
+
+		u32 offset = address & page->mask & ~3;
+
+		std::memcpy(page->write + offset, values, count * 4);
+
+		u32 num_cycles = count * page->cycles[PageCyclesIndex<u32>()];
+
+		m_time.PushInternalCycles(num_cycles);
+
+		MEMORY_RANGE region = (MEMORY_RANGE)(address >> 24);
+		u32 addr_low = (address & 0x00FFFFFF & ~3);
+
+		if (region == MEMORY_RANGE::IWRAM)
+			m_block_cache->InvalidateRange<true>(addr_low & REGIONS_LEN[(u8)MEMORY_RANGE::IWRAM], count * 4);
+		else if (region == MEMORY_RANGE::EWRAM)
+			m_block_cache->InvalidateRange<false>(addr_low & REGIONS_LEN[(u8)MEMORY_RANGE::EWRAM], count * 4);
+		else if (region == MEMORY_RANGE::VRAM)
+			m_ppu->InvalidateVRAM(u32(page->write + offset - m_ppu->GetVRAMMemory()), count * 4);
+		else if (region == MEMORY_RANGE::PAL)
+			m_ppu->InvalidatePalette();
+		else if (region == MEMORY_RANGE::OAM)
+			m_ppu->InvalidateOAM();
+
+		m_open_bus_value = values[count - 1];
+		m_open_bus_address = address + (count - 1) * 4;
+
+		m_sched->Advance(num_cycles);
+
+		return true;
+	}
+
+	bool Bus::GetCodeWindow(u32 address, u32 size, CodeWindow& window) const {
+		window.length = 0;
+
+		if (address >= PAGE_TABLE_END)
+			return false;
+
+		MemoryPage const& page = m_pages[address >> PAGE_SHIFT];
+		MEMORY_RANGE region = (MEMORY_RANGE)(address >> 24);
+		u32 cycles = page.cycles[size == 4 ? PageCyclesIndex<u32>() : PageCyclesIndex<u16>()];
+		bool rom = region >= MEMORY_RANGE::ROM_REG_1 && region <= MEMORY_RANGE::ROM_REG_3_SECOND;
+
+		if (!page.read || (!cycles && !rom))
+			return false;
+
+		window.host = page.read;
+		window.start = address & ~page.mask;
+		window.length = page.mask + 1;
+		window.generation = m_code_generation;
+
+		if (!rom) {
+			window.cycles[(u8)Access::NonSeq] = (u8)cycles;
+			window.cycles[(u8)Access::Seq] = (u8)cycles;
+			return true;
+		}
+
+		window.cycles[(u8)Access::NonSeq] = (u8)(size == 4 ?
+			m_time.GetAccessCycles<4>(region, Access::NonSeq) :
+			m_time.GetAccessCycles<2>(region, Access::NonSeq));
+		window.cycles[(u8)Access::Seq] = (u8)(size == 4 ?
+			m_time.GetAccessCycles<4>(region, Access::Seq) :
+			m_time.GetAccessCycles<2>(region, Access::Seq));
+
+		//The first fetch of a 128 KB
+		//block is never sequential
+		if (!(window.start & 0x1FFFF)) {
+			if (address == window.start) {
+				window.length = 0;
+				return false;
+			}
+
+			window.host += size;
+			window.start += size;
+			window.length -= size;
+		}
+
+		return true;
+	}
+
+	u8 const* Bus::GetCodePointer(u32 address, u32 size) {
+		MEMORY_RANGE region = (MEMORY_RANGE)(address >> 24);
+
+		if (region != MEMORY_RANGE::EWRAM && region != MEMORY_RANGE::IWRAM &&
+			(region < MEMORY_RANGE::ROM_REG_1 || region > MEMORY_RANGE::ROM_REG_3_SECOND))
+			return nullptr;
+
+		MemoryPage const& page = m_page_table[address >> PAGE_SHIFT];
+
+		if (page.read)
+			return page.read + (address & page.mask & ~(size - 1));
+
+		if (region < MEMORY_RANGE::ROM_REG_1)
+			return nullptr;
+
+		//Partially mapped ROM page (end of
+		//the ROM, GPIO or backup)
+		u8 rom_region = (u8)region - 8;
+		u32 addr_low = address & 0x00FFFFFF & ~(size - 1);
+
+		if (rom_region & 1)
+			addr_low += 0x01000000;
+
+		u8 const* ptr = m_pack->GetRomPointer(addr_low, rom_region);
+
+		if (size == 4 && !m_pack->GetRomPointer(addr_low + 2, rom_region))
+			return nullptr;
+
+		return ptr;
+	}
+
 	u32 Bus::DebuggerRead32(u32 address) {
 		MEMORY_RANGE region = (MEMORY_RANGE)(address >> 24);
 		u32 addr_low = address & 0x00FFFFFF;
@@ -246,15 +632,15 @@ namespace GBA::memory {
 	}
 
 
-	void Bus::LoadBIOS(std::string const& location) {
+	bool Bus::LoadBIOS(std::string const& location) {
 		if (!std::filesystem::exists(location)) {
 			LOG_ERROR(" Could not load bios from path {}", location);
-			return;
+			return false;
 		}
 		
 		if (!std::filesystem::is_regular_file(location)) {
 			LOG_ERROR(" Could not load bios from path {}", location);
-			return;
+			return false;
 		}
 
 		constexpr std::size_t bios_size = (std::size_t)16 * 1024;
@@ -263,7 +649,7 @@ namespace GBA::memory {
 
 		if (file_size != bios_size) {
 			LOG_ERROR(" Invalid bios file size, expected exactly 16 KB, got {} bytes", file_size);
-			return;
+			return false;
 		}
 
 		std::ifstream bios_file(location, std::ios::in | std::ios::binary);
@@ -273,6 +659,15 @@ namespace GBA::memory {
 		bios_file.close();
 
 		m_bios_latch = *reinterpret_cast<u32*>(m_bios + 0xDC + 8);
+
+		return true;
+	}
+
+	void Bus::LoadHleBios() {
+		cpu::hle::LoadBiosImage(m_bios);
+
+		m_bios_latch = *reinterpret_cast<u32*>(m_bios + 0xDC + 8);
+		m_hle_bios = true;
 	}
 
 	bool Bus::CheckBiosAccess(u32 address) {
@@ -303,5 +698,8 @@ namespace GBA::memory {
 
 		if (m_bios)
 			delete[] m_bios;
+
+		if (m_page_table)
+			delete[] m_page_table;
 	}
 }
\ No newline at end of file
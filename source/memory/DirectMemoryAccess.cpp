@@ -172,7 +172,25 @@ namespace GBA::memory {
 		bool repeat = CHECK_BIT(m_control, 9);
 		bool issue_irq = CHECK_BIT(m_control, 14);
 
+		//Plain memory on both sides is moved in
+		//blocks, up to the next event
+		u32 block_units = 0;
+
 		if (m_curr_word_count) {
+			block_units = m_curr_word_sz == 2 ?
+				m_bus->TransferBlock<u16>(m_curr_source, m_curr_dest, m_sad_inc, m_dad_inc, m_curr_word_count) :
+				m_bus->TransferBlock<u32>(m_curr_source, m_curr_dest, m_sad_inc, m_dad_inc, m_curr_word_count);
+		}
+
+		if (block_units) {
+			m_bus->m_time.access = Access::Seq;
+
+			m_curr_address += block_units * m_curr_word_sz;
+			m_curr_source += block_units * m_sad_inc;
+			m_curr_dest += block_units * m_dad_inc;
+			m_curr_word_count -= block_units;
+		}
+		else if (m_curr_word_count) {
 			if (m_curr_word_sz == 2) {
 				u16 read = m_bus->Read<u16>(m_curr_source);
 				m_bus->Write<u16>(m_curr_dest, read);
@@ -6,12 +6,17 @@ namespace GBA::memory {
 	using namespace common;
 
 	EventScheduler::EventScheduler() :
-		m_event_type_rodata{}, m_events{}, 
-		m_num_events{0}, m_timestamp{0}
-	{}
+		m_event_type_rodata{}, m_events{},
+		m_order{}, m_position{}, m_heap{},
+		m_num_events{0}, m_timestamp{0},
+		m_next_event{~std::uint64_t(0)},
+		m_next_order{0}
+	{
+		m_position.fill(NOT_SCHEDULED);
+	}
 
 	void EventScheduler::SetEventTypeRodata(EventType ev_ty, Callback callback, void* data) {
-		if (ev_ty > EventType::EVENT_MAX)
+		if (ev_ty >= EventType::EVENT_MAX)
 			return;
 
 		m_event_type_rodata[u32(ev_ty)].first = callback;
@@ -25,108 +30,151 @@ namespace GBA::memory {
 	}
 
 	bool EventScheduler::ScheduleAbsolute(uint64_t timestamp, EventType type, Callback callback, void* userdata, bool recursive) {
-		if (!recursive && std::find_if(m_events, m_events + m_num_events,
-			[type](Event const& ev) {
-				return ev.type == type;
-			}
-		) != m_events + m_num_events)
-			return false;
+		u8 slot = u8(type);
 
-		if (m_num_events == MAX_EVENTS)
+		if (type >= EventType::EVENT_MAX)
 			return false;
 
-		uint64_t next_timestamp = timestamp;
+		if (m_position[slot] != NOT_SCHEDULED) {
+			if (!recursive)
+				return false;
+
+			Remove(m_position[slot]);
+		}
 
-		m_events[m_num_events++] = Event{
-			m_timestamp, next_timestamp, type, callback, userdata
+		m_events[slot] = Event{
+			m_timestamp, timestamp, type, callback, userdata
 		};
 
-		std::push_heap(m_events, m_events + m_num_events,
-			[](Event const& ev1, Event const& ev2) {
-				return ev1.trigger_timestamp > ev2.trigger_timestamp;
-			}
-		);
+		m_order[slot] = m_next_order++;
+
+		m_heap[m_num_events] = slot;
+		m_position[slot] = u8(m_num_events);
+		m_num_events++;
+
+		SiftUp(m_num_events - 1);
+		UpdateNextEvent();
 
 		return true;
 	}
 
 	bool EventScheduler::Deschedule(EventType type) {
-		Event* ev = std::find_if(m_events, m_events + m_num_events,
-			[type](Event const& ev) {
-				return ev.type == type;
-			});
-
-		if (ev == m_events + m_num_events)
+		if (type >= EventType::EVENT_MAX)
 			return false;
 
-		std::swap(*ev, m_events[m_num_events - 1]);
+		u8 pos = m_position[u8(type)];
 
-		m_num_events--;
+		if (pos == NOT_SCHEDULED)
+			return false;
 
-		std::make_heap(m_events, m_events + m_num_events,
-			[](Event const& ev1, Event const& ev2) {
-				return ev1.trigger_timestamp > ev2.trigger_timestamp;
-			}
-		);
+		Remove(pos);
+		UpdateNextEvent();
 
 		return true;
 	}
 
-	bool EventScheduler::Reschedule(EventType type, u32 cycles, bool increment_event_count) {
-		Event* ev = std::find_if(m_events, m_events + m_num_events,
-			[type](Event const& ev) {
-				return ev.type == type;
-			});
-
-		if (ev == m_events + m_num_events)
+	bool EventScheduler::Reschedule(EventType type, u32 cycles) {
+		if (type >= EventType::EVENT_MAX)
 			return false;
 
-		ev->trigger_timestamp = m_timestamp + cycles;
+		u8 slot = u8(type);
+		u8 pos = m_position[slot];
 
-		std::make_heap(m_events, m_events + m_num_events,
-			[](Event const& ev1, Event const& ev2) {
-				return ev1.trigger_timestamp > ev2.trigger_timestamp;
-			}
-		);
+		if (pos == NOT_SCHEDULED)
+			return false;
+
+		m_events[slot].trigger_timestamp = m_timestamp + cycles;
+		m_order[slot] = m_next_order++;
 
-		if (increment_event_count)
-			m_num_events++;
+		SiftUp(pos);
+		SiftDown(m_position[slot]);
+		UpdateNextEvent();
 
 		return true;
 	}
 
 	Event const& EventScheduler::GetFirstEvent() const {
-		return m_events[0];
+		static constexpr Event NO_EVENT{
+			0, ~std::uint64_t(0), EventType::EVENT_MAX, nullptr, nullptr
+		};
+
+		return m_num_events ? m_events[m_heap[0]] : NO_EVENT;
 	}
 
-	void EventScheduler::Advance(common::u32 cycles) {
-		m_timestamp += cycles;
+	void EventScheduler::SiftUp(std::size_t pos) {
+		u8 slot = m_heap[pos];
 
-		bool _cont = true;
+		while (pos > 0) {
+			std::size_t parent = (pos - 1) / 2;
+
+			if (!Before(slot, m_heap[parent]))
+				break;
+
+			m_heap[pos] = m_heap[parent];
+			m_position[m_heap[pos]] = u8(pos);
+			pos = parent;
+		}
+
+		m_heap[pos] = slot;
+		m_position[slot] = u8(pos);
+	}
+
+	void EventScheduler::SiftDown(std::size_t pos) {
+		u8 slot = m_heap[pos];
+
+		while (true) {
+			std::size_t child = pos * 2 + 1;
+
+			if (child >= m_num_events)
+				break;
+
+			if (child + 1 < m_num_events && Before(m_heap[child + 1], m_heap[child]))
+				child++;
+
+			if (!Before(m_heap[child], slot))
+				break;
+
+			m_heap[pos] = m_heap[child];
+			m_position[m_heap[pos]] = u8(pos);
+			pos = child;
+		}
+
+		m_heap[pos] = slot;
+		m_position[slot] = u8(pos);
+	}
+
+	void EventScheduler::Remove(std::size_t pos) {
+		m_position[m_heap[pos]] = NOT_SCHEDULED;
+		m_num_events--;
+
+		if (pos == m_num_events)
+			return;
+
+		u8 moved = m_heap[m_num_events];
+
+		m_heap[pos] = moved;
+		m_position[moved] = u8(pos);
+
+		SiftUp(pos);
+		SiftDown(m_position[moved]);
+	}
 
-		do {
-			if (!m_num_events) {
-				_cont = false;
-				continue;
-			}
+	void EventScheduler::RunEvents() {
+		while (m_num_events) {
+			u8 slot = m_heap[0];
 
-			Event const& ev = m_events[0];
+			if (m_events[slot].trigger_timestamp > m_timestamp)
+				break;
 
-			if (ev.trigger_timestamp > m_timestamp) {
-				_cont = false;
-			}
-			else {
-				if(ev.callback)
-					ev.callback(ev.userdata);
+			//Out of the heap before running, the
+			//callback is free to schedule it again
+			Event ev = m_events[slot];
+			Remove(0);
 
-				std::pop_heap(m_events, m_events + m_num_events,
-					[](Event const& ev1, Event const& ev2) {
-						return ev1.trigger_timestamp > ev2.trigger_timestamp;
-					}
-				);
+			if (ev.callback)
+				ev.callback(ev.userdata);
+		}
 
-				m_num_events--;
-			}
-		} while (_cont);
+		UpdateNextEvent();
 	}
-}
\ No newline at end of file
+}
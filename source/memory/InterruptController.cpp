@@ -6,10 +6,18 @@ namespace GBA::memory {
 	using namespace common;
 
 	InterruptController::InterruptController(MMIO* mmio) :
-		m_registers{}, m_irq_line(true)
+		m_registers{}, m_irq_line(true), m_requested(false), m_pending(false)
 	{
-		mmio->AddRegister<u16>(INTERRUPT_REG_BASE, true, true, &m_registers[0], 0xFFFF);
-		mmio->AddRegister<u32>(INTERRUPT_REG_BASE + 0x8, true, true, &m_registers[0x8], 0xFFFFFFFF);
+		mmio->AddRegister<u16>(INTERRUPT_REG_BASE, true, true, &m_registers[0], 0xFFFF,
+			[this](common::u8 value, common::u16 offset) {
+				m_registers[offset - INTERRUPT_REG_BASE] = value;
+				UpdatePending();
+			});
+		mmio->AddRegister<u32>(INTERRUPT_REG_BASE + 0x8, true, true, &m_registers[0x8], 0xFFFFFFFF,
+			[this](common::u8 value, common::u16 offset) {
+				m_registers[offset - INTERRUPT_REG_BASE] = value;
+				UpdatePending();
+			});
 		mmio->AddRegister<u16>(INTERRUPT_REG_BASE + 0x2, true, true, &m_registers[0x2], 0xFFFF, 
 			[this](common::u8 value, common::u16 offset) {
 				common::u8 shift_amount = offset % 2;
@@ -24,6 +32,7 @@ namespace GBA::memory {
 				}
 
 				m_registers[0x2 + shift_amount] = reg_val;
+				UpdatePending();
 			});
 	}
 
@@ -42,6 +51,7 @@ namespace GBA::memory {
 	void InterruptController::RequestInterrupt(InterruptType type) {
 		*reinterpret_cast<u16*>(m_registers + 0x2) |= (u16)type;
 		m_irq_line = false;
+		UpdatePending();
 	}
 
 	bool InterruptController::GetLineStatus() {
@@ -50,5 +60,11 @@ namespace GBA::memory {
 
 	void InterruptController::ResetLineStatus() {
 		m_irq_line = true;
+		m_pending = false;
+	}
+
+	void InterruptController::UpdatePending() {
+		m_requested = GetIE() & GetIF();
+		m_pending = m_requested && GetIME() && !m_irq_line;
 	}
 }
\ No newline at end of file
@@ -4,13 +4,45 @@ namespace GBA::memory {
 	using namespace common;
 
 	MMIO::MMIO() :
-		m_registers{} {
+		m_registers{}, m_blocks{},
+		m_callbacks{} {
 
 		for (auto& reg : m_registers) {
 			reg.pointer = nullptr;
+			reg.callback = NO_CALLBACK;
 		}
 	}
 
+	void MMIO::UpdateBlock(u16 block) {
+		IOBlock& info = m_blocks[block];
+		IORegister const* regs = &m_registers[block * 4];
+
+		info = IOBlock{};
+
+		for (u8 pos = 0; pos < 4; pos++) {
+			if (regs[pos].readable)
+				info.read_mask |= 0xFF << (pos * 8);
+
+			if (regs[pos].writeable)
+				info.write_mask |= regs[pos].mask << (pos * 8);
+		}
+
+		for (u8 half = 0; half < 2; half++) {
+			IORegister const& low = regs[half * 2];
+			IORegister const& high = regs[half * 2 + 1];
+
+			if (!low.pointer || high.pointer != low.pointer + 1 ||
+				low.callback != NO_CALLBACK || high.callback != NO_CALLBACK)
+				continue;
+
+			info.pointer[half] = low.pointer;
+			info.plain |= 1 << half;
+		}
+
+		if (info.plain == 0b11 && info.pointer[1] == info.pointer[0] + 2)
+			info.plain |= 0b100;
+	}
+
 	u8 MMIO::DebuggerReadIO(u16 offset) {
 		auto& reg = m_registers[offset];
 
@@ -19,4 +51,4 @@ namespace GBA::memory {
 
 		return *(reg.pointer);
 	}
-}
\ No newline at end of file
+}
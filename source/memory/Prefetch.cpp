@@ -15,6 +15,12 @@ namespace GBA::memory {
 			)
 			? 0x01000000 : 0x0;
 
+		MemoryPage const& page = m_pages[address >> PAGE_SHIFT];
+
+		u16 value = page.read ?
+			*reinterpret_cast<u16 const*>(page.read + (address & page.mask & ~1)) :
+			m_pack->Read(addr_low, (u8)region - 8);
+
 		if (!code || !m_enable_prefetch) {
 			StopPrefetch();
 
@@ -23,17 +29,12 @@ namespace GBA::memory {
 			if ((addr_low & 0x1ffff) == 0)
 				acc = Access::NonSeq;
 
-			if (region == MEMORY_RANGE::ROM_REG_1 || region == MEMORY_RANGE::ROM_REG_1_SECOND)
-				cycles = m_time.PushCycles<MEMORY_RANGE::ROM_REG_1, 2>(acc);
-			else if (region == MEMORY_RANGE::ROM_REG_2 || region == MEMORY_RANGE::ROM_REG_2_SECOND)
-				cycles = m_time.PushCycles<MEMORY_RANGE::ROM_REG_2, 2>(acc);
-			else 
-				cycles = m_time.PushCycles<MEMORY_RANGE::ROM_REG_3, 2>(acc);
+			cycles = m_time.PushCycles<2>(region, acc);
 
-			return m_pack->Read(addr_low, (u8)region - 8);
+			return value;
 		}
 
-		return m_pack->Read(addr_low, (u8)region - 8);
+		return value;
 	}
 
 	template <>
@@ -48,8 +49,16 @@ namespace GBA::memory {
 			)
 			? 0x01000000 : 0x0;
 
-		u32 value = m_pack->Read(addr_low, (u8)region - 8);
-		value |= (m_pack->Read(addr_low + 2, (u8)region - 8) << 16);
+		MemoryPage const& page = m_pages[address >> PAGE_SHIFT];
+		u32 value;
+
+		if (page.read) {
+			value = *reinterpret_cast<u32 const*>(page.read + (address & page.mask & ~3));
+		}
+		else {
+			value = m_pack->Read(addr_low, (u8)region - 8);
+			value |= (m_pack->Read(addr_low + 2, (u8)region - 8) << 16);
+		}
 
 		if (!code || !m_enable_prefetch) {
 			StopPrefetch();
@@ -59,12 +68,7 @@ namespace GBA::memory {
 			if ((addr_low & 0x1ffff) == 0)
 				acc = Access::NonSeq;
 
-			if (region == MEMORY_RANGE::ROM_REG_1 || region == MEMORY_RANGE::ROM_REG_1_SECOND)
-				cycles = m_time.PushCycles<MEMORY_RANGE::ROM_REG_1, 4>(acc);
-			else if (region == MEMORY_RANGE::ROM_REG_2 || region == MEMORY_RANGE::ROM_REG_2_SECOND)
-				cycles = m_time.PushCycles<MEMORY_RANGE::ROM_REG_2, 4>(acc);
-			else
-				cycles = m_time.PushCycles<MEMORY_RANGE::ROM_REG_3, 4>(acc);
+			cycles = m_time.PushCycles<4>(region, acc);
 
 			return value;
 		}
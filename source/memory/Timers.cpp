@@ -8,8 +8,6 @@
 
 #include "../../common/Logger.hpp"
 
-#include "../../common/Error.hpp"
-
 #include "../../apu/APU.hpp"
 
 namespace GBA::timers {
@@ -17,142 +15,132 @@ namespace GBA::timers {
 
 	using namespace common;
 
+	static constexpr uint64_t NEVER = ~uint64_t(0);
+
 	TimerChain::TimerChain() :
 		m_int_controller(nullptr), m_sched(nullptr), 
 		m_registers{}, m_timer_reload_val{},
 		m_timer_internal_counter{}, m_apu(nullptr),
-		m_last_read_timestamp{},
-		m_last_event_timestamp{}
+		m_start_timestamp{},
+		m_event_timestamp{}
 	{}
 
-	void TimerChain::TimerOverfow(common::u8 timer_id) {
-		u16 cnt_pos = 0x2 + 4 * timer_id;
-		u16 val_pos = 4 * timer_id;
-
-		u8 control = m_registers[cnt_pos];
-
-		if (CHECK_BIT(control, 6)) {
-			using memory::InterruptType;
-
-			u16 int_id = (u16)8 << timer_id;
-
-			m_int_controller->RequestInterrupt((InterruptType)int_id);
-		}
-
-		u32 curr_timer_val = m_timer_reload_val[timer_id];
-
-		*reinterpret_cast<u16*>(m_registers + val_pos) = curr_timer_val;
+	bool TimerChain::IsEnabled(u8 timer_id) const {
+		return CHECK_BIT(m_registers[0x2 + 4 * timer_id], 7);
+	}
 
-		if (timer_id == 3)
-			return;
+	//Timer 0 ignores the count up bit
+	bool TimerChain::IsCountUp(u8 timer_id) const {
+		return timer_id && CHECK_BIT(m_registers[0x2 + 4 * timer_id], 2);
+	}
 
-		u16 cnt_pos2 = cnt_pos + 0x4;
-		u16 val_pos2 = val_pos + 0x4;
+	uint64_t TimerChain::GetTicks(u8 timer_id, uint64_t timestamp) const {
+		if (!IsEnabled(timer_id))
+			return 0;
 
-		if (!CHECK_BIT(m_registers[cnt_pos2], 2))
-			return;
+		if (IsCountUp(timer_id))
+			return GetOverflows(timer_id - 1, timestamp);
 
-		//Next Timer is count up
-		u32 next_val = *reinterpret_cast<u16*>(m_registers + val_pos2);
+		if (timestamp < m_start_timestamp[timer_id])
+			return 0;
 
-		next_val++;
+		u8 prescaler = m_registers[0x2 + 4 * timer_id] & 3;
 
-		if (next_val > 0xFFFF) {
-			TimerOverfow(timer_id + 1);
-		}
-		else {
-			*reinterpret_cast<u16*>(m_registers + val_pos2) = next_val;
-		}
+		return (timestamp - m_start_timestamp[timer_id]) / PRESCALERS[prescaler];
 	}
 
-	/*
-	TODO: Rename this, since it is called when
-	an overflow happens (not an increment)
-	*/
+	uint64_t TimerChain::GetOverflows(u8 timer_id, uint64_t timestamp) const {
+		uint64_t count = *reinterpret_cast<u16 const*>(m_registers + 4 * timer_id) +
+			GetTicks(timer_id, timestamp);
 
-	template <u8 Id>
-	void TimerIncremented(void* _timers);
-
-	template <>
-	void TimerIncremented<0>(void* _timers) {
-		TimerChain* timers = std::bit_cast<TimerChain*>(_timers);
-		timers->TimerOverfow(0);
-		timers->m_apu->TimerOverflow(0);
+		if (count < 0x10000)
+			return 0;
 
-		u8 prescaler = timers->m_registers[0x2] & 3;
+		return 1 + (count - 0x10000) / (0x10000 - m_timer_reload_val[timer_id]);
+	}
 
-		u32 time_till_ov = ((u32)0x10000 - timers->m_timer_reload_val[0]) * TimerChain::PRESCALERS[prescaler];
+	u16 TimerChain::GetValue(u8 timer_id, uint64_t timestamp) const {
+		uint64_t count = *reinterpret_cast<u16 const*>(m_registers + 4 * timer_id) +
+			GetTicks(timer_id, timestamp);
 
-		uint64_t now = timers->m_last_event_timestamp[0];
+		if (count < 0x10000)
+			return (u16)count;
 
-		timers->m_last_read_timestamp[0] = now;
-		timers->m_last_event_timestamp[0] = now + time_till_ov;
+		u32 reload = m_timer_reload_val[timer_id];
 
-		timers->m_sched->ScheduleAbsolute(
-			timers->m_last_event_timestamp[0], memory::EventType::TIMER_0_INC,
-			TimerIncremented<0>, _timers, true
-		);
+		return (u16)(reload + (count - 0x10000) % (0x10000 - reload));
 	}
 
-	template <>
-	void TimerIncremented<1>(void* _timers) {
-		TimerChain* timers = std::bit_cast<TimerChain*>(_timers);
-		timers->TimerOverfow(1);
-		timers->m_apu->TimerOverflow(1);
+	uint64_t TimerChain::GetOverflowTimestamp(u8 timer_id, uint64_t count) const {
+		if (!IsEnabled(timer_id))
+			return NEVER;
 
-		u8 prescaler = timers->m_registers[0x6] & 3;
+		u32 curr_val = *reinterpret_cast<u16 const*>(m_registers + 4 * timer_id);
 
-		u32 time_till_ov = ((u32)0x10000 - timers->m_timer_reload_val[1]) * TimerChain::PRESCALERS[prescaler];
+		uint64_t ticks = (0x10000 - curr_val) +
+			(count - 1) * (0x10000 - m_timer_reload_val[timer_id]);
 
-		uint64_t now = timers->m_last_event_timestamp[1];
+		if (IsCountUp(timer_id))
+			return GetOverflowTimestamp(timer_id - 1, ticks);
 
-		timers->m_last_read_timestamp[1] = now;
-		timers->m_last_event_timestamp[1] = now + time_till_ov;
+		u8 prescaler = m_registers[0x2 + 4 * timer_id] & 3;
 
-		timers->m_sched->ScheduleAbsolute(
-			timers->m_last_event_timestamp[1], memory::EventType::TIMER_1_INC,
-			TimerIncremented<1>, _timers, true
-		);
+		return m_start_timestamp[timer_id] + ticks * PRESCALERS[prescaler];
 	}
 
-	template <>
-	void TimerIncremented<2>(void* _timers) {
-		TimerChain* timers = std::bit_cast<TimerChain*>(_timers);
-		timers->TimerOverfow(2);
+	void TimerChain::TimerOverflow(u8 timer_id) {
+		uint64_t timestamp = m_event_timestamp[timer_id];
 
-		u8 prescaler = timers->m_registers[0xA] & 3;
+		if (CHECK_BIT(m_registers[0x2 + 4 * timer_id], 6)) {
+			using memory::InterruptType;
 
-		u32 time_till_ov = ((u32)0x10000 - timers->m_timer_reload_val[2]) * TimerChain::PRESCALERS[prescaler];
+			u16 int_id = (u16)8 << timer_id;
 
-		uint64_t now = timers->m_last_event_timestamp[2];
+			m_int_controller->RequestInterrupt((InterruptType)int_id);
+		}
 
-		timers->m_last_read_timestamp[2] = now;
-		timers->m_last_event_timestamp[2] = now + time_till_ov;
+		if (timer_id < 2)
+			m_apu->TimerOverflow(timer_id);
 
-		timers->m_sched->ScheduleAbsolute(
-			timers->m_last_event_timestamp[2], memory::EventType::TIMER_2_INC,
-			TimerIncremented<2>, _timers, true
-		);
+		ScheduleEvent(timer_id, timestamp);
+
+		//Savestates made before the timers were lazy
+		//have no event for count up timers
+		if (timer_id < 3 && IsCountUp(timer_id + 1) && !m_sched->IsScheduled(
+			memory::EventType(u32(memory::EventType::TIMER_0_INC) + timer_id + 1)))
+			ScheduleEvent(timer_id + 1, timestamp);
 	}
 
-	template <>
-	void TimerIncremented<3>(void* _timers) {
+	template <u8 Id>
+	void TimerOverflowed(void* _timers) {
 		TimerChain* timers = std::bit_cast<TimerChain*>(_timers);
-		timers->TimerOverfow(3);
+		timers->TimerOverflow(Id);
+	}
 
-		u8 prescaler = timers->m_registers[0xE] & 3;
+	static constexpr memory::Callback OVERFLOW_CALLBACKS[] = {
+		TimerOverflowed<0>, TimerOverflowed<1>,
+		TimerOverflowed<2>, TimerOverflowed<3>
+	};
 
-		u32 time_till_ov = ((u32)0x10000 - timers->m_timer_reload_val[3]) * TimerChain::PRESCALERS[prescaler];
+	void TimerChain::ScheduleEvent(u8 timer_id, uint64_t timestamp) {
+		auto type = memory::EventType(u32(memory::EventType::TIMER_0_INC) + timer_id);
 
-		uint64_t now = timers->m_last_event_timestamp[3];
+		bool needs_event = IsEnabled(timer_id) &&
+			(CHECK_BIT(m_registers[0x2 + 4 * timer_id], 6) || 
+				(timer_id < 2 && m_apu->IsFifoTimer(timer_id)));
 
-		timers->m_last_read_timestamp[3] = now;
-		timers->m_last_event_timestamp[3] = now + time_till_ov;
+		uint64_t next = needs_event ? 
+			GetOverflowTimestamp(timer_id, GetOverflows(timer_id, timestamp) + 1) : NEVER;
 
-		timers->m_sched->ScheduleAbsolute(
-			timers->m_last_event_timestamp[3], memory::EventType::TIMER_3_INC,
-			TimerIncremented<3>, _timers, true
-		);
+		if (next == NEVER) {
+			m_sched->Deschedule(type);
+			return;
+		}
+
+		m_event_timestamp[timer_id] = next;
+
+		m_sched->ScheduleAbsolute(next, type, OVERFLOW_CALLBACKS[timer_id],
+			std::bit_cast<void*>(this), true);
 	}
 
 	void TimerChain::SetInterruptController(memory::InterruptController* int_control) {
@@ -162,63 +150,28 @@ namespace GBA::timers {
 	void TimerChain::SetEventScheduler(memory::EventScheduler* ev_sched) {
 		m_sched = ev_sched;
 
-		m_sched->SetEventTypeRodata(memory::EventType::TIMER_0_INC,
-			TimerIncremented<0>, std::bit_cast<void*>(this));
-		m_sched->SetEventTypeRodata(memory::EventType::TIMER_1_INC,
-			TimerIncremented<1>, std::bit_cast<void*>(this));
-		m_sched->SetEventTypeRodata(memory::EventType::TIMER_2_INC,
-			TimerIncremented<2>, std::bit_cast<void*>(this));
-		m_sched->SetEventTypeRodata(memory::EventType::TIMER_3_INC,
-			TimerIncremented<3>, std::bit_cast<void*>(this));
+		for (u8 timer_id = 0; timer_id < 4; timer_id++) {
+			m_sched->SetEventTypeRodata(
+				memory::EventType(u32(memory::EventType::TIMER_0_INC) + timer_id),
+				OVERFLOW_CALLBACKS[timer_id], std::bit_cast<void*>(this));
+		}
 	}
 
 	void TimerChain::SetMMIO(memory::MMIO* mmio) {
 		mmio->AddRegister<u16>(TIMER_REG_BASE, true, true, &m_registers[0x0], 0xFFFF, [this](u8 value, u16 offset) {
-			u8 shift_amount = offset % 2;
-			u16 modify = ((u16)value << (8 * shift_amount));
-
-			u16 curr_value = m_timer_reload_val[0];
-
-			curr_value &= ~((u16)0xFF << (8 * shift_amount));
-			curr_value |= modify;
-
-			m_timer_reload_val[0] = curr_value;
+			WriteReload(0, value, offset);
 		});
 
 		mmio->AddRegister<u16>(TIMER_REG_BASE + 0x4, true, true, &m_registers[0x4], 0xFFFF, [this](u8 value, u16 offset) {
-			u8 shift_amount = offset % 2;
-			u16 modify = ((u16)value << (8 * shift_amount));
-
-			u16 curr_value = m_timer_reload_val[1];
-
-			curr_value &= ~((u16)0xFF << (8 * shift_amount));
-			curr_value |= modify;
-
-			m_timer_reload_val[1] = curr_value;
+			WriteReload(1, value, offset);
 		});
 
 		mmio->AddRegister<u16>(TIMER_REG_BASE + 0x8, true, true, &m_registers[0x8], 0xFFFF, [this](u8 value, u16 offset) {
-			u8 shift_amount = offset % 2;
-			u16 modify = ((u16)value << (8 * shift_amount));
-
-			u16 curr_value = m_timer_reload_val[2];
-
-			curr_value &= ~((u16)0xFF << (8 * shift_amount));
-			curr_value |= modify;
-
-			m_timer_reload_val[2] = curr_value;
+			WriteReload(2, value, offset);
 		});
 
 		mmio->AddRegister<u16>(TIMER_REG_BASE + 0xC, true, true, &m_registers[0xC], 0xFFFF, [this](u8 value, u16 offset) {
-			u8 shift_amount = offset % 2;
-			u16 modify = ((u16)value << (8 * shift_amount));
-
-			u16 curr_value = m_timer_reload_val[3];
-
-			curr_value &= ~((u16)0xFF << (8 * shift_amount));
-			curr_value |= modify;
-
-			m_timer_reload_val[3] = curr_value;
+			WriteReload(3, value, offset);
 		});
 
 		mmio->AddRegister<u16>(TIMER_REG_BASE + 0x2, true, true, &m_registers[0x2], 0xFFFF, 
@@ -255,65 +208,60 @@ namespace GBA::timers {
 			});
 	}
 
+	void TimerChain::WriteReload(u8 timer_id, u8 value, u16 offset) {
+		u8 shift_amount = offset % 2;
+		u16 modify = ((u16)value << (8 * shift_amount));
+
+		u16 curr_value = m_timer_reload_val[timer_id];
+
+		curr_value &= ~((u16)0xFF << (8 * shift_amount));
+		curr_value |= modify;
+
+		if (curr_value == m_timer_reload_val[timer_id])
+			return;
+
+		//The reload value changes the overflows
+		//to come, not the ones already counted
+		Update();
+
+		m_timer_reload_val[timer_id] = curr_value;
+
+		uint64_t now = m_sched->GetTimestamp();
+
+		for (u8 id = timer_id; id < 4; id++)
+			ScheduleEvent(id, now);
+	}
+
 	void TimerChain::RecalculateEvents(u8 timer_id, u8 new_cnt) {
 		u16 cnt_pos = 0x2 + 4 * timer_id;
 		u16 val_pos = 4 * timer_id;
 
-		if (new_cnt == m_registers[cnt_pos])
+		u8 old_cnt = m_registers[cnt_pos];
+
+		if (new_cnt == old_cnt)
 			return;
 
-		bool enabled = (m_registers[cnt_pos] >> 7) & 1;
+		Update();
+
+		bool enabled = (old_cnt >> 7) & 1;
 		bool new_enabled_val = (new_cnt >> 7) & 1;
-		bool count_up = (new_cnt >> 2) & 1;
 
 		m_registers[cnt_pos] = new_cnt;
 
-		memory::EventType timer_event = memory::EventType::TIMER_0_INC;
-
-		void(*callback)(void*) = nullptr;
-
-		switch (timer_id)
-		{
-		case 0:
-			m_sched->Deschedule(memory::EventType::TIMER_0_INC);
-			timer_event = memory::EventType::TIMER_0_INC;
-			callback = TimerIncremented<0>;
-			break;
-		case 1:
-			m_sched->Deschedule(memory::EventType::TIMER_1_INC);
-			timer_event = memory::EventType::TIMER_1_INC;
-			callback = TimerIncremented<1>;
-			break;
-		case 2:
-			m_sched->Deschedule(memory::EventType::TIMER_2_INC);
-			timer_event = memory::EventType::TIMER_2_INC;
-			callback = TimerIncremented<2>;
-			break;
-		case 3:
-			m_sched->Deschedule(memory::EventType::TIMER_3_INC);
-			timer_event = memory::EventType::TIMER_3_INC;
-			callback = TimerIncremented<3>;
-			break;
-		default:
-			error::Unreachable();
-			break;
-		}
-
-		if (!new_enabled_val || count_up)
-			return;
+		uint64_t now = m_sched->GetTimestamp();
 
-		if (!enabled && new_enabled_val)
+		if (!enabled && new_enabled_val && !IsCountUp(timer_id))
 			*reinterpret_cast<u16*>(m_registers + val_pos) = m_timer_reload_val[timer_id];
 
-		u8 prescaler = new_cnt & 3;
-
-		u32 time_till_ov = ((u32)0x10000 - m_timer_reload_val[timer_id]) * PRESCALERS[prescaler];
-		
-		m_last_read_timestamp[timer_id] = m_sched->GetTimestamp();
-		m_last_event_timestamp[timer_id] = m_last_read_timestamp[timer_id] + time_till_ov;
+		//The prescaler only restarts when the timer
+		//starts or counts differently, Update kept
+		//the phase of the current tick otherwise
+		if ((!enabled && new_enabled_val) || ((old_cnt ^ new_cnt) & 0x7))
+			m_start_timestamp[timer_id] = now;
 
-		m_sched->Schedule(time_till_ov, timer_event, callback,
-			std::bit_cast<void*>(this));
+		//Count up timers after this one depend on it
+		for (u8 id = timer_id; id < 4; id++)
+			ScheduleEvent(id, now);
 	}
 
 	void TimerChain::SetAPU(apu::APU* apu) {
@@ -321,35 +269,36 @@ namespace GBA::timers {
 	}
 
 	void TimerChain::Update() {
-		u8 timer_cnt_index = 0x2;
-		u8 timer_val_index = 0x0;
-
 		uint64_t now = m_sched->GetTimestamp();
 
-		for (u8 index = 0; index < 4; index++) {
-			if (!CHECK_BIT(m_registers[timer_cnt_index], 7) || 
-				CHECK_BIT(m_registers[timer_cnt_index], 2)) {
-				timer_cnt_index += 0x4;
-				timer_val_index += 0x4;
-				continue;
-			}
-
-			u32 curr_val = *reinterpret_cast<u16*>(m_registers + timer_val_index);
-			u32 orig_val = curr_val;
-			u8 prescaler = m_registers[timer_cnt_index] & 0x3;
+		u16 values[4];
+		uint64_t ticks[4];
 
-			curr_val += ((now - m_last_read_timestamp[index]) / PRESCALERS[prescaler]);
-			curr_val &= 0xFFFF;
+		//Count up timers read the state of the
+		//previous one, compute everything first
+		for (u8 timer_id = 0; timer_id < 4; timer_id++) {
+			values[timer_id] = GetValue(timer_id, now);
+			ticks[timer_id] = GetTicks(timer_id, now);
+		}
 
-			*reinterpret_cast<u16*>(m_registers + timer_val_index) = curr_val;
+		for (u8 timer_id = 0; timer_id < 4; timer_id++) {
+			*reinterpret_cast<u16*>(m_registers + 4 * timer_id) = values[timer_id];
 
-			//Modify timestamp only if enough cycles have passed, and
-			//the timer has been incremented
-			if(curr_val != orig_val)
-				m_last_read_timestamp[index] = now;
+			if (!IsEnabled(timer_id) || IsCountUp(timer_id))
+				continue;
 
-			timer_cnt_index += 0x4;
-			timer_val_index += 0x4;
+			//Keep the cycles that did not make a full tick,
+			//so that the value does not depend on how often
+			//the registers are read
+			u8 prescaler = m_registers[0x2 + 4 * timer_id] & 3;
+			m_start_timestamp[timer_id] += ticks[timer_id] * PRESCALERS[prescaler];
 		}
 	}
+
+	void TimerChain::UpdateEvents() {
+		uint64_t now = m_sched->GetTimestamp();
+
+		for (u8 timer_id = 0; timer_id < 4; timer_id++)
+			ScheduleEvent(timer_id, now);
+	}
 }
\ No newline at end of file
@@ -2,9 +2,10 @@
 
 namespace GBA::memory {
 	TimeManager::TimeManager() : 
+		m_config_raw{0},
 		m_curr_cycles{0}, 
 		m_wait_config{},
-		m_config_raw{0}
+		m_access_cycles{}
 	{
 		UpdateWaitstate(0);
 	}
@@ -23,5 +24,58 @@ namespace GBA::memory {
 		m_wait_config.rom0[1] = ROM_SEQ[0][(m_config_raw >> 4) & 0x1];
 		m_wait_config.rom1[1] = ROM_SEQ[1][(m_config_raw >> 7) & 0x1];
 		m_wait_config.rom2[1] = ROM_SEQ[2][(m_config_raw >> 10) & 0x1];
+
+		BuildAccessCycles();
+	}
+
+	void TimeManager::BuildAccessCycles() {
+		for (u8 region = 0; region < NUM_TIMING_REGIONS; region++) {
+			u32 const* rom = nullptr;
+
+			switch (MEMORY_RANGE(region))
+			{
+			case MEMORY_RANGE::ROM_REG_1:
+			case MEMORY_RANGE::ROM_REG_1_SECOND:
+				rom = m_wait_config.rom0;
+				break;
+			case MEMORY_RANGE::ROM_REG_2:
+			case MEMORY_RANGE::ROM_REG_2_SECOND:
+				rom = m_wait_config.rom1;
+				break;
+			case MEMORY_RANGE::ROM_REG_3:
+			case MEMORY_RANGE::ROM_REG_3_SECOND:
+				rom = m_wait_config.rom2;
+				break;
+			default:
+				break;
+			}
+
+			for (u8 acc = 0; acc < 2; acc++) {
+				u32 half, word;
+
+				if (rom) {
+					//32 bit accesses are split in two,
+					//the second one is always sequential
+					half = rom[acc] + 1;
+					word = rom[acc] + rom[1] + 2;
+				}
+				else if (MEMORY_RANGE(region) == MEMORY_RANGE::EWRAM) {
+					half = 3;
+					word = 6;
+				}
+				else if (MEMORY_RANGE(region) == MEMORY_RANGE::SRAM) {
+					half = m_wait_config.sram + 1;
+					word = m_wait_config.sram * 2 + 1;
+				}
+				else {
+					half = 1;
+					word = 1;
+				}
+
+				m_access_cycles[region][0][acc] = (u8)half;
+				m_access_cycles[region][1][acc] = (u8)half;
+				m_access_cycles[region][2][acc] = (u8)word;
+			}
+		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,382 @@
+#include "../../ppu/Compositor.hpp"
+#include "../../ppu/PPU.hpp"
+
+#include "../../common/CpuFeatures.hpp"
+#include "../../common/BitManip.hpp"
+
+#include <algorithm>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(_M_AMD64)
+	#define COMPOSITOR_X86
+
+	#include <immintrin.h>
+
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#define TARGET(isa)
+		#define INLINE_TARGET(isa) __forceinline
+	#else
+		#define TARGET(isa) __attribute__((target(isa)))
+		#define INLINE_TARGET(isa) __attribute__((target(isa), always_inline)) inline
+	#endif
+#endif
+
+namespace GBA::ppu::compositor {
+	using namespace common;
+
+	//The vector kernels load pixels as 4 halfwords
+	static_assert(sizeof(Pixel) == 8);
+	static_assert(offsetof(Pixel, is_present) == 0 && offsetof(Pixel, is_bld_enabled) == 1);
+	static_assert(offsetof(Pixel, palette_id) == 2 && offsetof(Pixel, color) == 4);
+	static_assert(offsetof(Pixel, priority) == 6);
+
+	static u16 BlendColor(u16 color, u16 lower, Layers const& layers) {
+		u16 result = 0;
+
+		for (u32 shift = 0; shift < 15; shift += 5) {
+			u16 first = (color >> shift) & 0x1F;
+			u16 second = (lower >> shift) & 0x1F;
+
+			//I = MIN ( 31, I1st*EVA + I2nd*EVB )
+			u16 value = std::min((first * layers.eva + second * layers.evb + 8) >> 4, 31);
+
+			result |= value << shift;
+		}
+
+		return result;
+	}
+
+	static u16 BrightenColor(u16 color, Layers const& layers) {
+		u16 result = 0;
+
+		for (u32 shift = 0; shift < 15; shift += 5) {
+			u16 value = (color >> shift) & 0x1F;
+			value += ((31 - value) * layers.evy + 8) >> 4;
+			result |= value << shift;
+		}
+
+		return result;
+	}
+
+	static u16 DarkenColor(u16 color, Layers const& layers) {
+		u16 result = 0;
+
+		for (u32 shift = 0; shift < 15; shift += 5) {
+			u16 value = (color >> shift) & 0x1F;
+			value -= (value * layers.evy + 7) >> 4;
+			result |= value << shift;
+		}
+
+		return result;
+	}
+
+	/*
+	* Blending drops the layer on top from the
+	* second targets of all the next pixels,
+	* so a pixel depends on the ones before it
+	*/
+	static u16 ComposePixel(Layers const& layers, u32 x, u16& second_mask) {
+		u8 window_mask = layers.window_masks[x];
+		u16 keys[5];
+
+		for (u32 layer = 0; layer < 4; layer++) {
+			bool drawn = layers.keys[layer] != HIDDEN
+				&& layers.backgrounds[layer][x].palette_id
+				&& CHECK_BIT(window_mask, layer);
+
+			keys[layer] = drawn ? layers.keys[layer] : HIDDEN;
+		}
+
+		Pixel const& sprite = layers.sprites[x];
+
+		keys[4] = (sprite.is_present && sprite.palette_id && CHECK_BIT(window_mask, 4)) ?
+			u16(sprite.priority << 3) : HIDDEN;
+
+		//5 is the backdrop
+		u32 top_layer = 5;
+
+		for (u32 layer = 0; layer < 5; layer++) {
+			if (keys[layer] != HIDDEN && (top_layer == 5 || keys[layer] < keys[top_layer]))
+				top_layer = layer;
+		}
+
+		auto get_pixel = [&](u32 layer) -> Pixel const& {
+			return layer == 4 ? sprite : layers.backgrounds[layer][x];
+		};
+
+		u16 color = top_layer == 5 ? layers.backdrop : get_pixel(top_layer).color;
+		bool semi_transparent = top_layer != 5 && get_pixel(top_layer).is_bld_enabled;
+
+		if (!(CHECK_BIT(window_mask, 5) && CHECK_BIT(layers.first_target, top_layer))
+			&& !semi_transparent)
+			return color;
+
+		u16 effect = semi_transparent ? 1 : layers.effect;
+
+		if (effect == 1) {
+			second_mask = CLEAR_BIT(second_mask, top_layer);
+
+			if (top_layer == 5)
+				return color;
+
+			u32 second_layer = 5;
+
+			for (u32 layer = 0; layer < 5; layer++) {
+				if (!CHECK_BIT(second_mask, layer) || keys[layer] == HIDDEN)
+					continue;
+
+				if (second_layer == 5 || keys[layer] < keys[second_layer])
+					second_layer = layer;
+			}
+
+			if (second_layer != 5)
+				return BlendColor(color, get_pixel(second_layer).color, layers);
+
+			if (CHECK_BIT(second_mask, 5))
+				return BlendColor(color, layers.backdrop, layers);
+
+			if (!semi_transparent)
+				return color;
+
+			//Semi transparent OBJ with nothing
+			//below, use the selected effect
+			effect = layers.effect;
+		}
+
+		switch (effect) {
+		case 2:
+			return BrightenColor(color, layers);
+		case 3:
+			return DarkenColor(color, layers);
+		default:
+			return color & 0x7FFF;
+		}
+	}
+
+	static void ComposeScalar(Layers const& layers, u16* colors) {
+		u16 second_mask = layers.second_target;
+
+		for (u32 x = 0; x < LINE_SIZE; x++)
+			colors[x] = ComposePixel(layers, x, second_mask);
+	}
+
+#ifdef COMPOSITOR_X86
+	/*
+	* Both vector kernels are ComposeKernel.inl
+	* on top of the same operations on halfword
+	* lanes, 8 with SSE4.1 and 16 with AVX2
+	*/
+	namespace sse41 {
+	#define KERNEL_ISA "sse4.1"
+
+		using Vec = __m128i;
+
+		static constexpr u32 WIDTH = 8;
+
+		struct Planes {
+			Vec flags;
+			Vec palette;
+			Vec color;
+			Vec priority;
+		};
+
+		INLINE_TARGET(KERNEL_ISA) Vec Set(u16 value) {
+			return _mm_set1_epi16(static_cast<short>(value));
+		}
+
+		INLINE_TARGET(KERNEL_ISA) Vec LoadMasks(u8 const* masks) {
+			return _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(masks)));
+		}
+
+		INLINE_TARGET(KERNEL_ISA) void Store(u16* dest, Vec value) {
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), value);
+		}
+
+		INLINE_TARGET(KERNEL_ISA) Vec Min(Vec a, Vec b) { return _mm_min_epu16(a, b); }
+		INLINE_TARGET(KERNEL_ISA) Vec Equal(Vec a, Vec b) { return _mm_cmpeq_epi16(a, b); }
+		INLINE_TARGET(KERNEL_ISA) Vec Or(Vec a, Vec b) { return _mm_or_si128(a, b); }
+		INLINE_TARGET(KERNEL_ISA) Vec And(Vec a, Vec b) { return _mm_and_si128(a, b); }
+		INLINE_TARGET(KERNEL_ISA) Vec AndNot(Vec a, Vec b) { return _mm_andnot_si128(b, a); }
+		INLINE_TARGET(KERNEL_ISA) Vec Add(Vec a, Vec b) { return _mm_add_epi16(a, b); }
+		INLINE_TARGET(KERNEL_ISA) Vec Sub(Vec a, Vec b) { return _mm_sub_epi16(a, b); }
+		INLINE_TARGET(KERNEL_ISA) Vec Mul(Vec a, Vec b) { return _mm_mullo_epi16(a, b); }
+		INLINE_TARGET(KERNEL_ISA) Vec ShiftLeft(Vec a, int count) { return _mm_slli_epi16(a, count); }
+		INLINE_TARGET(KERNEL_ISA) Vec ShiftRight(Vec a, int count) { return _mm_srli_epi16(a, count); }
+
+		//mask ? b : a
+		INLINE_TARGET(KERNEL_ISA) Vec Select(Vec a, Vec b, Vec mask) {
+			return _mm_blendv_epi8(a, b, mask);
+		}
+
+		INLINE_TARGET(KERNEL_ISA) bool IsZero(Vec value) {
+			return _mm_testz_si128(value, value);
+		}
+
+		INLINE_TARGET(KERNEL_ISA) u16 OrLanes(Vec value) {
+			value = _mm_or_si128(value, _mm_srli_si128(value, 8));
+			value = _mm_or_si128(value, _mm_srli_si128(value, 4));
+			value = _mm_or_si128(value, _mm_srli_si128(value, 2));
+
+			return static_cast<u16>(_mm_cvtsi128_si32(value));
+		}
+
+		//One field of 8 pixels per vector
+		INLINE_TARGET(KERNEL_ISA) Planes LoadPixels(Pixel const* pixels) {
+			__m128i const* source = reinterpret_cast<__m128i const*>(pixels);
+
+			__m128i v0 = _mm_loadu_si128(source);
+			__m128i v1 = _mm_loadu_si128(source + 1);
+			__m128i v2 = _mm_loadu_si128(source + 2);
+			__m128i v3 = _mm_loadu_si128(source + 3);
+
+			__m128i t0 = _mm_unpacklo_epi16(v0, v1);
+			__m128i t1 = _mm_unpackhi_epi16(v0, v1);
+			__m128i t2 = _mm_unpacklo_epi16(v2, v3);
+			__m128i t3 = _mm_unpackhi_epi16(v2, v3);
+
+			__m128i u0 = _mm_unpacklo_epi16(t0, t1);
+			__m128i u1 = _mm_unpackhi_epi16(t0, t1);
+			__m128i u2 = _mm_unpacklo_epi16(t2, t3);
+			__m128i u3 = _mm_unpackhi_epi16(t2, t3);
+
+			return Planes{
+				_mm_unpacklo_epi64(u0, u2),
+				_mm_unpackhi_epi64(u0, u2),
+				_mm_unpacklo_epi64(u1, u3),
+				_mm_unpackhi_epi64(u1, u3)
+			};
+		}
+
+	#include "../../ppu/ComposeKernel.inl"
+
+	#undef KERNEL_ISA
+	}
+
+	namespace avx2 {
+	#define KERNEL_ISA "avx2"
+
+		using Vec = __m256i;
+
+		static constexpr u32 WIDTH = 16;
+
+		struct Planes {
+			Vec flags;
+			Vec palette;
+			Vec color;
+			Vec priority;
+		};
+
+		INLINE_TARGET(KERNEL_ISA) Vec Set(u16 value) {
+			return _mm256_set1_epi16(static_cast<short>(value));
+		}
+
+		INLINE_TARGET(KERNEL_ISA) Vec LoadMasks(u8 const* masks) {
+			return _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<__m128i const*>(masks)));
+		}
+
+		INLINE_TARGET(KERNEL_ISA) void Store(u16* dest, Vec value) {
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), value);
+		}
+
+		INLINE_TARGET(KERNEL_ISA) Vec Min(Vec a, Vec b) { return _mm256_min_epu16(a, b); }
+		INLINE_TARGET(KERNEL_ISA) Vec Equal(Vec a, Vec b) { return _mm256_cmpeq_epi16(a, b); }
+		INLINE_TARGET(KERNEL_ISA) Vec Or(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+		INLINE_TARGET(KERNEL_ISA) Vec And(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+		INLINE_TARGET(KERNEL_ISA) Vec AndNot(Vec a, Vec b) { return _mm256_andnot_si256(b, a); }
+		INLINE_TARGET(KERNEL_ISA) Vec Add(Vec a, Vec b) { return _mm256_add_epi16(a, b); }
+		INLINE_TARGET(KERNEL_ISA) Vec Sub(Vec a, Vec b) { return _mm256_sub_epi16(a, b); }
+		INLINE_TARGET(KERNEL_ISA) Vec Mul(Vec a, Vec b) { return _mm256_mullo_epi16(a, b); }
+		INLINE_TARGET(KERNEL_ISA) Vec ShiftLeft(Vec a, int count) { return _mm256_slli_epi16(a, count); }
+		INLINE_TARGET(KERNEL_ISA) Vec ShiftRight(Vec a, int count) { return _mm256_srli_epi16(a, count); }
+
+		INLINE_TARGET(KERNEL_ISA) Vec Select(Vec a, Vec b, Vec mask) {
+			return _mm256_blendv_epi8(a, b, mask);
+		}
+
+		INLINE_TARGET(KERNEL_ISA) bool IsZero(Vec value) {
+			return _mm256_testz_si256(value, value);
+		}
+
+		INLINE_TARGET(KERNEL_ISA) u16 OrLanes(Vec value) {
+			__m128i half = _mm_or_si128(_mm256_castsi256_si128(value),
+				_mm256_extracti128_si256(value, 1));
+
+			half = _mm_or_si128(half, _mm_srli_si128(half, 8));
+			half = _mm_or_si128(half, _mm_srli_si128(half, 4));
+			half = _mm_or_si128(half, _mm_srli_si128(half, 2));
+
+			return static_cast<u16>(_mm_cvtsi128_si32(half));
+		}
+
+		/*
+		* Unpacks work on each 128 bit half, which
+		* leaves pairs of pixels out of order
+		*/
+		INLINE_TARGET(KERNEL_ISA) Planes LoadPixels(Pixel const* pixels) {
+			__m256i const* source = reinterpret_cast<__m256i const*>(pixels);
+			__m256i const order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+			__m256i v0 = _mm256_loadu_si256(source);
+			__m256i v1 = _mm256_loadu_si256(source + 1);
+			__m256i v2 = _mm256_loadu_si256(source + 2);
+			__m256i v3 = _mm256_loadu_si256(source + 3);
+
+			__m256i t0 = _mm256_unpacklo_epi16(v0, v1);
+			__m256i t1 = _mm256_unpackhi_epi16(v0, v1);
+			__m256i t2 = _mm256_unpacklo_epi16(v2, v3);
+			__m256i t3 = _mm256_unpackhi_epi16(v2, v3);
+
+			__m256i u0 = _mm256_unpacklo_epi16(t0, t1);
+			__m256i u1 = _mm256_unpackhi_epi16(t0, t1);
+			__m256i u2 = _mm256_unpacklo_epi16(t2, t3);
+			__m256i u3 = _mm256_unpackhi_epi16(t2, t3);
+
+			return Planes{
+				_mm256_permutevar8x32_epi32(_mm256_unpacklo_epi64(u0, u2), order),
+				_mm256_permutevar8x32_epi32(_mm256_unpackhi_epi64(u0, u2), order),
+				_mm256_permutevar8x32_epi32(_mm256_unpacklo_epi64(u1, u3), order),
+				_mm256_permutevar8x32_epi32(_mm256_unpackhi_epi64(u1, u3), order)
+			};
+		}
+
+	#include "../../ppu/ComposeKernel.inl"
+
+	#undef KERNEL_ISA
+	}
+#endif
+
+	static Compose PickComposer() {
+#ifdef COMPOSITOR_X86
+		CpuFeatures const& features = GetCpuFeatures();
+
+		if (features.avx2)
+			return &avx2::Compose;
+
+		if (features.sse41)
+			return &sse41::Compose;
+#endif
+
+		return &ComposeScalar;
+	}
+
+	Compose GetComposer() {
+		static Compose const composer = PickComposer();
+		return composer;
+	}
+
+	std::vector<Compose> GetSupportedComposers() {
+		std::vector<Compose> composers{ &ComposeScalar };
+
+#ifdef COMPOSITOR_X86
+		CpuFeatures const& features = GetCpuFeatures();
+
+		if (features.sse41)
+			composers.push_back(&sse41::Compose);
+
+		if (features.avx2)
+			composers.push_back(&avx2::Compose);
+#endif
+
+		return composers;
+	}
+}
@@ -0,0 +1,92 @@
+#include "../../ppu/LineRenderer.hpp"
+
+#include "../../common/Logger.hpp"
+#include "../../common/Error.hpp"
+
+#include <algorithm>
+
+namespace GBA::ppu {
+	using namespace common;
+
+	LOG_CONTEXT(LineRenderer);
+
+	LineRenderer::LineRenderer(PPU& ppu) :
+		m_ppu{ppu}, m_ctx{},
+		m_internal_reference_x{},
+		m_internal_reference_y{},
+		m_palette_ram(nullptr), m_vram(nullptr),
+		m_oam(nullptr), m_tile_cache{},
+		line_sprites_ids{}, line_sprites_count(0),
+		m_line_data{}, m_obj_window_pixels{},
+		m_backgrounds{}
+	{}
+
+	void LineRenderer::Render(LineSnapshot const& line) {
+		m_ctx = line.registers;
+
+		std::copy_n(line.reference_x, 2, m_internal_reference_x);
+		std::copy_n(line.reference_y, 2, m_internal_reference_y);
+
+		m_palette_ram = line.palette_ram;
+		m_vram = line.vram;
+		m_oam = line.oam;
+
+		m_tile_cache.Attach(line.vram, line.vram_writes);
+
+		m_obj_window_pixels = {};
+
+		u8 mode = m_ctx.m_control & 0x7;
+
+		switch (mode)
+		{
+		case 0:
+			Mode0();
+			break;
+
+		case 1:
+			Mode1();
+			break;
+
+		case 2:
+			Mode2();
+			break;
+
+		case 3:
+			Mode3();
+			break;
+
+		case 4:
+			Mode4();
+			break;
+
+		case 5:
+			Mode5();
+			break;
+
+		default:
+			LOG_ERROR("Invalid display mode {0}!", (unsigned)mode);
+			error::DebugBreak();
+			break;
+		}
+	}
+
+	u32 LineRenderer::ReadRegister32(u8 offset) const {
+		return reinterpret_cast<u32 const*>(m_ctx.array)[offset];
+	}
+
+	u16 LineRenderer::ReadRegister16(u8 offset) const {
+		return reinterpret_cast<u16 const*>(m_ctx.array)[offset];
+	}
+
+	void LineRenderer::OutputLine(unsigned y, std::array<Pixel, 240> const& pixels) {
+		m_ppu.OutputLine(y, pixels);
+	}
+
+	void LineRenderer::OutputLine(unsigned y, std::array<u16, 240> const& colors) {
+		m_ppu.OutputLine(y, colors);
+	}
+
+	void LineRenderer::OutputBlankLine(unsigned y) {
+		m_ppu.OutputBlankLine(y);
+	}
+}
@@ -1,4 +1,4 @@
-#include "../../ppu/PPU.hpp"
+#include "../../ppu/LineRenderer.hpp"
 #include "../../common/Error.hpp"
 
 namespace GBA::ppu {
@@ -14,7 +14,7 @@ namespace GBA::ppu {
 		static constexpr u32 FRAME_H = 160;
 	}
 
-	void PPU::Mode3() {
+	void LineRenderer::Mode3() {
 		bool bg2_enable = (m_ctx.m_control >> 10) & 1;
 		bool forced_blank = (m_ctx.m_control >> 7) & 1;
 
@@ -27,14 +27,8 @@ namespace GBA::ppu {
 			error::DebugBreak();
 		}
 
-		unsigned framebuffer_y = curr_line * 240 * 3;
-
 		if (forced_blank) {
-			for (unsigned x = 0; x < 240; x++) {
-				m_framebuffer[framebuffer_y + x * 3] = 1.0f;
-				m_framebuffer[framebuffer_y + x * 3 + 1] = 1.0f;
-				m_framebuffer[framebuffer_y + x * 3 + 2] = 1.0f;
-			}
+			OutputBlankLine(curr_line);
 
 			return;
 		}
@@ -50,7 +44,7 @@ namespace GBA::ppu {
 				u32 vram_pos = tex_x * mode3::PIXEL_SIZE
 					+ (tex_y * 240 * mode3::PIXEL_SIZE);
 
-				bg2[x].color = *reinterpret_cast<u16*>(m_vram + vram_pos);
+				bg2[x].color = *reinterpret_cast<u16 const*>(m_vram + vram_pos);
 				bg2[x].palette_id = 1;
 			}
 		}
@@ -64,16 +58,6 @@ namespace GBA::ppu {
 			bg2 = MergeBitmap(bg2, m_line_data[4]);
 		}
 
-		for (unsigned x = 0; x < 240; x++) {
-			u16 color_packed = bg2[x].color;
-
-			u8 r = color_packed & 0x1F;
-			u8 g = (color_packed >> 5) & 0x1F;
-			u8 b = (color_packed >> 10) & 0x1F;
-
-			m_framebuffer[framebuffer_y + x * 3] = (float)r / 0x1F;
-			m_framebuffer[framebuffer_y + x * 3 + 1] = (float)g / 0x1F;
-			m_framebuffer[framebuffer_y + x * 3 + 2] = (float)b / 0x1F;
-		}
+		OutputLine(curr_line, bg2);
 	}
 }
\ No newline at end of file
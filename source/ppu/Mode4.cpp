@@ -1,4 +1,4 @@
-#include "../../ppu/PPU.hpp"
+#include "../../ppu/LineRenderer.hpp"
 #include "../../common/Error.hpp"
 
 namespace GBA::ppu {
@@ -16,7 +16,7 @@ namespace GBA::ppu {
 		static constexpr u32 FRAME_H = 160;
 	}
 
-	void PPU::Mode4() {
+	void LineRenderer::Mode4() {
 		bool bg2_enable = (m_ctx.m_control >> 10) & 1;
 		bool forced_blank = (m_ctx.m_control >> 7) & 1;
 		bool frame_select = (m_ctx.m_control >> 4) & 1;
@@ -34,8 +34,6 @@ namespace GBA::ppu {
 
 		if (mosaic)
 			error::DebugBreak();
-			
-		unsigned framebuffer_y = curr_line * 240 * 3;
 
 		u32 vram_offset = 0;
 
@@ -43,11 +41,7 @@ namespace GBA::ppu {
 			vram_offset = mode4::FRAME_1_START;
 
 		if (forced_blank) {
-			for (unsigned x = 0; x < 240; x++) {
-				m_framebuffer[framebuffer_y + x * 3] = 1.0f;
-				m_framebuffer[framebuffer_y + x * 3 + 1] = 1.0f;
-				m_framebuffer[framebuffer_y + x * 3 + 2] = 1.0f;
-			}
+			OutputBlankLine(curr_line);
 
 			return;
 		}
@@ -89,16 +83,6 @@ namespace GBA::ppu {
 			bg2 = MergeBitmap(bg2, m_line_data[4]);
 		}
 
-		for (unsigned x = 0; x < 240; x++) {
-			u16 color_packed = bg2[x].color;
-
-			u8 r = color_packed & 0x1F;
-			u8 g = (color_packed >> 5) & 0x1F;
-			u8 b = (color_packed >> 10) & 0x1F;
-
-			m_framebuffer[framebuffer_y + x * 3] = (float)r / 0x1F;
-			m_framebuffer[framebuffer_y + x * 3 + 1] = (float)g / 0x1F;
-			m_framebuffer[framebuffer_y + x * 3 + 2] = (float)b / 0x1F;
-		}
+		OutputLine(curr_line, bg2);
 	}
 }
\ No newline at end of file
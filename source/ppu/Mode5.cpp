@@ -1,4 +1,4 @@
-#include "../../ppu/PPU.hpp"
+#include "../../ppu/LineRenderer.hpp"
 #include "../../common/Error.hpp"
 
 namespace GBA::ppu {
@@ -16,7 +16,7 @@ namespace GBA::ppu {
 		static constexpr u32 FRAME_H = 128;
 	}
 
-	void PPU::Mode5() {
+	void LineRenderer::Mode5() {
 		bool bg2_enable = (m_ctx.m_control >> 10) & 1;
 		bool forced_blank = (m_ctx.m_control >> 7) & 1;
 		bool frame_select = (m_ctx.m_control >> 4) & 1;
@@ -35,23 +35,19 @@ namespace GBA::ppu {
 		if (mosaic)
 			error::DebugBreak();
 
-		unsigned framebuffer_y = curr_line * 240 * 3;
-
 		u32 vram_offset = 0;
 
 		if (frame_select)
 			vram_offset = mode5::FRAME_1_START;
 
 		if (forced_blank) {
-			for (unsigned x = 0; x < 240; x++) {
-				m_framebuffer[framebuffer_y + x * 3] = 1.0f;
-				m_framebuffer[framebuffer_y + x * 3 + 1] = 1.0f;
-				m_framebuffer[framebuffer_y + x * 3 + 2] = 1.0f;
-			}
+			OutputBlankLine(curr_line);
 
 			return;
 		}
 
+		std::array<Pixel, 240> pixels{};
+
 		for (unsigned x = 0; x < 240; x++) {
 			int tex_x = x;
 			int tex_y = curr_line;
@@ -64,16 +60,12 @@ namespace GBA::ppu {
 				u32 vram_pos = tex_x * mode5::PIXEL_SIZE
 					+ (tex_y * 160 * mode5::PIXEL_SIZE);
 
-				color_packed = *reinterpret_cast<u16*>(m_vram + vram_pos);
+				color_packed = *reinterpret_cast<u16 const*>(m_vram + vram_pos);
 			}
 
-			u8 r = color_packed & 0x1F;
-			u8 g = (color_packed >> 5) & 0x1F;
-			u8 b = (color_packed >> 10) & 0x1F;
-
-			m_framebuffer[framebuffer_y + x * 3] = (float)r / 0x1F;
-			m_framebuffer[framebuffer_y + x * 3 + 1] = (float)g / 0x1F;
-			m_framebuffer[framebuffer_y + x * 3 + 2] = (float)b / 0x1F;
+			pixels[x].color = color_packed;
 		}
+
+		OutputLine(curr_line, pixels);
 	}
 }
\ No newline at end of file
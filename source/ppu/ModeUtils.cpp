@@ -1,4 +1,6 @@
-#include "../../ppu/PPU.hpp"
+#include "../../ppu/LineRenderer.hpp"
+
+#include "../../ppu/Compositor.hpp"
 
 #include "../../common/Error.hpp"
 
@@ -72,7 +74,7 @@ namespace GBA::ppu {
 		constexpr u16 TILE_Y_SIZE = 8;
 	}
 
-	void PPU::CalculateMosaicBG(i32& x, i32& y) {
+	void LineRenderer::CalculateMosaicBG(i32& x, i32& y) {
 		u32 mosaic_reg = ReadRegister32(0x4C / 4);
 
 		u8 h_size = (mosaic_reg & 0xF) + 1;
@@ -85,9 +87,7 @@ namespace GBA::ppu {
 		y -= (y % v_size);
 	}
 
-	std::array<std::array<Pixel, 240>, 5> backgrounds{};
-
-	void PPU::ProcessNormalBackground(int bg_id, int lcd_y) {
+	void LineRenderer::ProcessNormalBackground(int bg_id, int lcd_y) {
 		u16 bg_control = ReadRegister16(detail::bg_control_reg[bg_id] / 2);
 
 		u8 bg_prio = bg_control & 3;
@@ -145,8 +145,8 @@ namespace GBA::ppu {
 			tile_data_size = 0x40;
 		}
 
-		u16* u16_vram_ptr = std::bit_cast<u16*>(m_vram);
-		u16* u16_palette_ptr = std::bit_cast<u16*>(m_palette_ram);
+		u16 const* u16_vram_ptr = std::bit_cast<u16 const*>(m_vram);
+		u16 const* u16_palette_ptr = std::bit_cast<u16 const*>(m_palette_ram);
 			
 
 		for (int x = 0; x < 240; /*x++*/) {
@@ -184,61 +184,35 @@ namespace GBA::ppu {
 			vram_offset = char_base_block + tile_id * tile_data_size
 				+ (tile_row_sz * real_y_offset_in_tile);
 
-			int offset_inc = 1;
-
-			if (hflip) {
-				x_offset_inside_tile = 7 - x_offset_inside_tile;
-				offset_inc = -1;
-			}
-
-			int x_offset_inside_tile_int = x_offset_inside_tile;
-
-			pal_id *= 16;
-
-			while (x_offset_inside_tile_int >= 0 && x_offset_inside_tile_int < 8
-				&& x < 240) {
-				u32 end_vram_offset = vram_offset;
-
-				u16 color = 0;
-
-				if (pal_mode) {
-					end_vram_offset += x_offset_inside_tile_int;
-					u16 color_id = m_vram[end_vram_offset];
-					color = u16_palette_ptr[color_id];
-					backgrounds[bg_id][x].color = color;
-					backgrounds[bg_id][x].palette_id = color_id;
-				}
-				else {
-					end_vram_offset += x_offset_inside_tile_int / 2;
+			//Flipped rows come mirrored,
+			//x always moves forward
+			u8 const* tile_row = pal_mode ?
+				m_tile_cache.GetRow8(vram_offset, hflip) :
+				m_tile_cache.GetRow4(vram_offset, hflip);
 
-					u16 color_id = m_vram[end_vram_offset];
+			u16 const* palette = u16_palette_ptr + (pal_mode ? 0 : pal_id * 16);
 
-					u16 color = 0;
+			while (x_offset_inside_tile < 8 && x < 240) {
+				u8 color_id = tile_row[x_offset_inside_tile];
 
-					if (x_offset_inside_tile_int % 2)
-						color = ((color_id >> 4) & 0xF);
-					else
-						color = (color_id & 0xF);
-
-					backgrounds[bg_id][x].color = u16_palette_ptr[pal_id + color];
-					backgrounds[bg_id][x].palette_id = color;
-				}
+				m_backgrounds[bg_id][x].color = palette[color_id];
+				m_backgrounds[bg_id][x].palette_id = color_id;
 
 				u32 mos_end = x + mos_h_size - 1;
 
 				for (u32 pos = x; pos < mos_end && pos < 239; pos++, x++) {
-					backgrounds[bg_id][pos + 1] = backgrounds[bg_id][pos];
-					x_offset_inside_tile_int += offset_inc;
+					m_backgrounds[bg_id][pos + 1] = m_backgrounds[bg_id][pos];
+					x_offset_inside_tile++;
 				}
 
 				x++;
 				
-				x_offset_inside_tile_int += offset_inc;
+				x_offset_inside_tile++;
 			}
 		}
 	}
 
-	void PPU::ProcessAffineBackground(int bg_id, int lcd_y) {
+	void LineRenderer::ProcessAffineBackground(int bg_id, int lcd_y) {
 		u16 bg_control = ReadRegister16(detail::bg_control_reg[bg_id] / 2);
 
 		u8 bg_prio = bg_control & 3;
@@ -300,7 +274,7 @@ namespace GBA::ppu {
 				else {
 					curr_x += dx;
 					curr_y += dy;
-					backgrounds[bg_id][x].palette_id = 0;
+					m_backgrounds[bg_id][x].palette_id = 0;
 					continue;
 				}
 			}
@@ -310,7 +284,7 @@ namespace GBA::ppu {
 				&& !area_overflow) {
 				curr_x += dx;
 				curr_y += dy;
-				backgrounds[bg_id][x].palette_id = 0;
+				m_backgrounds[bg_id][x].palette_id = 0;
 				continue;
 			}
 
@@ -341,10 +315,10 @@ namespace GBA::ppu {
 
 			u8 color_id = m_vram[vram_offset];
 
-			u16 color = *reinterpret_cast<u16*>(m_palette_ram + color_id * 2);
+			u16 color = *reinterpret_cast<u16 const*>(m_palette_ram + color_id * 2);
 
-			backgrounds[bg_id][x].color = color;
-			backgrounds[bg_id][x].palette_id = color_id;
+			m_backgrounds[bg_id][x].color = color;
+			m_backgrounds[bg_id][x].palette_id = color_id;
 
 			curr_x += dx;
 			curr_y += dy;
@@ -354,11 +328,7 @@ namespace GBA::ppu {
 		m_internal_reference_y[bg_id - 2] = (i32)m_internal_reference_y[bg_id - 2] + dmy;
 	}
 
-	std::array<Pixel, 240> PPU::MergeBackrounds() {
-		std::array<Pixel, 240> merged{};
-
-		backgrounds[4] = m_line_data[4];
-
+	std::array<u16, 240> LineRenderer::MergeBackrounds() {
 		u16 bg1_cnt = ReadRegister16(0x8 / 2);
 		u16 bg2_cnt = ReadRegister16(0xA / 2);
 		u16 bg3_cnt = ReadRegister16(0xC / 2);
@@ -537,29 +507,42 @@ namespace GBA::ppu {
 
 		bool curr_line_has_window = window0_line || window1_line;
 
-		auto get_current_window_id = [&](u16 x_pos) {
-			if (!curr_line_has_window) {
-				if (windows[4].enabled && m_obj_window_pixels[x_pos])
-					return 4;
-				if (windows[2].enabled)
-					return 2;
-				return 3;
+		//Layers (bits 0-4) and effects (bit 5)
+		//let through by each window
+		u8 window_masks[5]{};
+
+		for (u32 window_id = 0; window_id < 5; window_id++) {
+			for (u32 layer = 0; layer < 5; layer++) {
+				if ((window_id == 3 || windows[window_id].layer_enable[layer])
+					&& layer_enabled_global[layer])
+					window_masks[window_id] |= 1 << layer;
 			}
 
-			bool in_win0 = x_pos >= windows[0].left && x_pos <= windows[0].right;
-			bool in_win1 = x_pos >= windows[1].left && x_pos <= windows[1].right;
+			if (window_id == 3 || windows[window_id].enable_special_effects)
+				window_masks[window_id] |= 1 << 5;
+		}
 
-			in_win0 = reverse_win0_h ? !in_win0 : in_win0;
-			in_win1 = reverse_win1_h ? !in_win1 : in_win1;
+		u8 outside_mask = (curr_line_has_window || windows[2].enabled) ?
+			window_masks[2] : window_masks[3];
 
-			if (in_win0 && window0_line)
-				return 0;
-			else if (in_win1 && window1_line)
-				return 1;
-			else if (windows[4].enabled && m_obj_window_pixels[x_pos])
-				return 4;
-			return 2;
-		};
+		std::array<u8, 240> pixel_masks;
+
+		for (u16 x = 0; x < 240; x++) {
+			bool in_win0 = x >= windows[0].left && x <= windows[0].right;
+			bool in_win1 = x >= windows[1].left && x <= windows[1].right;
+
+			in_win0 = (reverse_win0_h ? !in_win0 : in_win0) && window0_line;
+			in_win1 = (reverse_win1_h ? !in_win1 : in_win1) && window1_line;
+
+			if (in_win0)
+				pixel_masks[x] = window_masks[0];
+			else if (in_win1)
+				pixel_masks[x] = window_masks[1];
+			else if (windows[4].enabled && m_obj_window_pixels[x])
+				pixel_masks[x] = window_masks[4];
+			else
+				pixel_masks[x] = outside_mask;
+		}
 
 		struct Priority {
 			u16 priority;
@@ -599,217 +582,49 @@ namespace GBA::ppu {
 		u16 first_target = color_special_effects_reg & 0x3F;
 		u16 second_target = (color_special_effects_reg >> 8) & 0x3F;
 
-		u16 backdrop = *reinterpret_cast<u16*>(m_palette_ram);
+		u16 backdrop = *reinterpret_cast<u16 const*>(m_palette_ram);
 
 		u16 bldalpha = ReadRegister16(0x52 / 2);
 
 		u16 eva = std::min(bldalpha & 0x1F, 16);
 		u16 evb = std::min((bldalpha >> 8) & 0x1F, 16);
+		u16 evy = std::min(ReadRegister16(0x54 / 2) & 0x1F, 16);
 
-		for (u16 x = 0; x < 240; x++) {
-			u8 candidate_layer_index = 0;
-			u8 window_id = get_current_window_id(x);
-
-			bool candidate_found = false;
-
-			u8 curr_index = 0;
-
-			while (!candidate_found && curr_index < total_bgs) {
-				u8 curr_layer = priorities[curr_index].layer;
-
-				candidate_found = !!backgrounds[curr_layer][x].palette_id
-					&& (window_id == 3 || windows[window_id].layer_enable[curr_layer]);
-
-				if (!candidate_found)
-					curr_index++;
-			}
-
-			u8 layer = candidate_found ? priorities[curr_index].layer : 0;
-
-			if (backgrounds[4][x].is_present && backgrounds[4][x].palette_id
-				&& (window_id == 3 || windows[window_id].layer_enable[4])
-				&& layer_enabled_global[4]) {
-				if (!candidate_found || priorities[curr_index].priority >= backgrounds[4][x].priority) {
-					candidate_found = true;
-					layer = 4;
-				}
-			}
-
-			if (candidate_found) {
-				merged[x] = backgrounds[layer][x];
-			}
-			else {
-				merged[x].color = backdrop;
-				merged[x].palette_id = 1;
-				layer = 5;
-			}
-
-			if (((window_id == 3 || windows[window_id].enable_special_effects)
-				&& CHECK_BIT(first_target, layer)) || merged[x].is_bld_enabled) {
-				u16 special_effect_select = curr_effect;
-				u16 real_effect_select = curr_effect;
-
-				if (merged[x].is_bld_enabled)
-					special_effect_select = 1;
-
-				switch (special_effect_select)
-				{
-				case 0x1: {
-					//Try to select second target
-					second_target = CLEAR_BIT(second_target, layer);
-
-					//Selected layer is
-					//backdrop, we 
-					//do not have other
-					//layers to select
-					if (layer == 5)
-						break;
-
-					u8 index = 0;
-
-					bool blend_fail = false;
-
-						index = layer == 4 ? 0 : curr_index + 1;
-						u16 top_priority = layer == 4 ? merged[x].priority : priorities[curr_index].priority;
-
-						while (index < total_bgs) {
-							u8 curr_layer = priorities[index].layer;
-
-							if (priorities[index].priority >= top_priority) {
-								if ((window_id == 3 || windows[window_id].layer_enable[curr_layer])
-									&& layer_enabled_global[curr_layer]
-									&& CHECK_BIT(second_target, curr_layer)
-									&& backgrounds[curr_layer][x].palette_id) {
-									break;
-								}
-
-								index++;
-							}
-							else {
-								if ((window_id == 3 || windows[window_id].layer_enable[curr_layer])
-									&& layer_enabled_global[curr_layer]
-									&& backgrounds[curr_layer][x].palette_id) {
-									blend_fail = true;
-									break;
-								}
-								else {
-									index++;
-								}
-							}
-						}
-
-						bool obj_selected = false;
-						
-						if (layer < 4 
-							&& backgrounds[4][x].is_present
-							&& backgrounds[4][x].palette_id
-							&& (window_id == 3 || windows[window_id].layer_enable[4])
-							&& layer_enabled_global[4]
-							&& CHECK_BIT(second_target, 4)) {
-							//If no matching target was found or object pixel
-							//has higher or same priority as the currently selected 
-							//target slect this layer
-							if (index == total_bgs || backgrounds[4][x].priority <= priorities[index].priority) {
-								index = 4;
-								obj_selected = true;
-							}
-								
-						}
-
-						if (index == total_bgs && !obj_selected)
-							index = 6; //Layer in BGs not found,
-									   //set invalid index
-
-					if (blend_fail)
-						break;
-
-					if (index == 6) {
-						if (CHECK_BIT(second_target, 5)) {
-							index = 5;
-						}
-						else if (merged[x].is_bld_enabled)
-							goto brightness;
-						else
-							break;
-					}
-					
-					u8 second_target_layer = index < 4 ? priorities[index].layer : index;
-
-					if (!CHECK_BIT(second_target, second_target_layer))
-						break;
-
-					Pixel top_pixel = merged[x];
-					Pixel lower_pixel = Pixel{};
-
-					if (second_target_layer == 5) {
-						lower_pixel.palette_id = 1;
-						lower_pixel.color = backdrop;
-					}
-					else {
-						lower_pixel = backgrounds[second_target_layer][x];
-					}
-
-					if (lower_pixel.palette_id) {
-						//Blend
-						u16 color = top_pixel.color;
-						u16 color2 = lower_pixel.color;
-
-						u8 r = color & 0x1F;
-						u8 g = (color >> 5) & 0x1F;
-						u8 b = (color >> 10) & 0x1F;
+		compositor::Layers layers{};
 
-						u8 r2 = color2 & 0x1F;
-						u8 g2 = (color2 >> 5) & 0x1F;
-						u8 b2 = (color2 >> 10) & 0x1F;
+		for (u32 layer = 0; layer < 4; layer++) {
+			layers.backgrounds[layer] = m_backgrounds[layer].data();
+			layers.keys[layer] = compositor::HIDDEN;
+		}
 
-						//I = MIN ( 31, I1st*EVA + I2nd*EVB )
-						r = std::min((r * eva + r2 * evb + 8) >> 4, 31);
-						g = std::min((g * eva + g2 * evb + 8) >> 4, 31);
-						b = std::min((b * eva + b2 * evb + 8) >> 4, 31);
+		/*
+		* A BG key is its priority and its place
+		* among the sorted BGs plus one, OBJ keys
+		* have 0 there so that OBJ wins ties
+		*/
+		for (u32 index = 0; index < total_bgs; index++)
+			layers.keys[priorities[index].layer] = (priorities[index].priority << 3) | (index + 1);
 
-						merged[x].color = r | (g << 5) | (b << 10);
-					}
-					else if (merged[x].is_bld_enabled) {
-						goto brightness;
-					}
-				}
-					break;
-				case 0x2:
-				case 0x3: {
-				brightness:
-					//Brightness decrease/increase
-					u16 evy = std::min( ReadRegister16(0x54 / 2) & 0x1F, 16);
+		layers.sprites = m_line_data[4].data();
+		layers.window_masks = pixel_masks.data();
 
-					u16 color = merged[x].color;
+		layers.first_target = first_target;
+		layers.second_target = second_target;
+		layers.effect = curr_effect;
+		layers.backdrop = backdrop;
 
-					u8 r = color & 0x1F;
-					u8 g = (color >> 5) & 0x1F;
-					u8 b = (color >> 10) & 0x1F;
+		layers.eva = eva;
+		layers.evb = evb;
+		layers.evy = evy;
 
-					if (real_effect_select == 0x2) {
-						r += ((31 - r) * evy + 8) >> 4;
-						g += ((31 - g) * evy + 8) >> 4;
-						b += ((31 - b) * evy + 8) >> 4;
-					}
-					else if(real_effect_select == 0x3) {
-						r -= (r * evy + 7) >> 4;
-						g -= (g * evy + 7) >> 4;
-						b -= (b * evy + 7) >> 4;
-					}
+		std::array<u16, 240> merged;
 
-					merged[x].color = r | (g << 5) | (b << 10);
-				}
-					break;
-				default:
-					break;
-				}
-			}
-		}
+		compositor::GetComposer()(layers, merged.data());
 
 		return merged;
 	}
 
-	std::array<Pixel, 240> PPU::MergeBitmap(
+	std::array<Pixel, 240> LineRenderer::MergeBitmap(
 		std::array<Pixel, 240> const& bg,
 		std::array<Pixel, 240> const& sprites
 	) {
@@ -931,7 +746,7 @@ namespace GBA::ppu {
 		u16 first_target = color_special_effects_reg & 0x3F;
 		u16 second_target = (color_special_effects_reg >> 8) & 0x3F;
 
-		u16 backdrop = *reinterpret_cast<u16*>(m_palette_ram);
+		u16 backdrop = *reinterpret_cast<u16 const*>(m_palette_ram);
 
 		u16 bldalpha = ReadRegister16(0x52 / 2);
 
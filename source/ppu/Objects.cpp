@@ -1,4 +1,4 @@
-#include "../../ppu/PPU.hpp"
+#include "../../ppu/LineRenderer.hpp"
 
 #include "../../common/Error.hpp"
 
@@ -33,10 +33,10 @@ namespace GBA::ppu {
 		};
 	}
 
-#define READ_16(arr, index) *reinterpret_cast<u16*>(arr + index)
-#define READ_32(arr, index) *reinterpret_cast<u32*>(arr + index)
+#define READ_16(arr, index) *reinterpret_cast<u16 const*>(arr + index)
+#define READ_32(arr, index) *reinterpret_cast<u32 const*>(arr + index)
 
-	void PPU::DrawSprites(int lcd_y) {
+	void LineRenderer::DrawSprites(int lcd_y) {
 		line_sprites_count = 0;
 
 		/*
@@ -213,20 +213,17 @@ namespace GBA::ppu {
 							tex_x = end - transformed_x - 1;
 
 						u32 tile_x = tex_x / 8;
-						u32 x_offset = tex_x % 8;
-
-						if (!pal_mode)
-							x_offset /= 2;
 
 						u32 vram_offset = start_offset + vram_y_offset
-							+ (tile_x * tile_size)
-							+ x_offset;
+							+ (tile_x * tile_size);
 
-						vram_offset %= 0x8000;
+						vram_offset = OBJ_VRAM_BASE + (vram_offset % 0x8000);
 
-						u16 color_id = m_vram[OBJ_VRAM_BASE
-							+ vram_offset];
+						u8 const* tile_row = pal_mode ?
+							m_tile_cache.GetRow8(vram_offset, false) :
+							m_tile_cache.GetRow4(vram_offset, false);
 
+						u16 color_id = tile_row[tex_x % 8];
 
 						u16 color = 0;
 
@@ -235,20 +232,8 @@ namespace GBA::ppu {
 								color_id * 2 + OBJ_PALETTE_START);
 						}
 						else {
-							u16 pixel_id = 0;
-
-							if (tex_x % 2)
-								pixel_id = (color_id >> 4) & 0xF;
-							else
-								pixel_id = color_id & 0xF;
-
-							color_id = pixel_id;
-
-							pixel_id *= 2;
-							pixel_id += pal_number * 32;
-
 							color = READ_16(m_palette_ram,
-								pixel_id + OBJ_PALETTE_START);
+								(pal_number * 16 + color_id) * 2 + OBJ_PALETTE_START);
 						}
 
 						if (color_id) {
@@ -334,19 +319,17 @@ namespace GBA::ppu {
 							(y_offset * line_size);
 
 						u32 tile_x = tex_x / 8;
-						u32 x_offset = tex_x % 8;
-
-						if (!pal_mode)
-							x_offset /= 2;
 
 						u32 vram_offset = start_offset + vram_y_offset
-							+ (tile_x * tile_size)
-							+ x_offset;
+							+ (tile_x * tile_size);
 
-						vram_offset %= 0x8000;
+						vram_offset = OBJ_VRAM_BASE + (vram_offset % 0x8000);
 
-						u16 color_id = m_vram[OBJ_VRAM_BASE
-							+ vram_offset];
+						u8 const* tile_row = pal_mode ?
+							m_tile_cache.GetRow8(vram_offset, false) :
+							m_tile_cache.GetRow4(vram_offset, false);
+
+						u16 color_id = tile_row[tex_x % 8];
 
 						u16 color = 0;
 
@@ -355,20 +338,8 @@ namespace GBA::ppu {
 								color_id * 2 + OBJ_PALETTE_START);
 						}
 						else {
-							u16 pixel_id = 0;
-
-							if (tex_x % 2)
-								pixel_id = (color_id >> 4) & 0xF;
-							else
-								pixel_id = color_id & 0xF;
-
-							color_id = pixel_id;
-
-							pixel_id *= 2;
-							pixel_id += pal_number * 32;
-
 							color = READ_16(m_palette_ram,
-								pixel_id + OBJ_PALETTE_START);
+								(pal_number * 16 + color_id) * 2 + OBJ_PALETTE_START);
 						}
 
 						if (color_id) {
@@ -1,4 +1,6 @@
 #include "../../ppu/PPU.hpp"
+#include "../../ppu/LineRenderer.hpp"
+#include "../../ppu/RenderPool.hpp"
 
 #include "../../memory/MMIO.hpp"
 #include "../../memory/InterruptController.hpp"
@@ -8,6 +10,9 @@
 #include "../../common/Logger.hpp"
 #include "../../common/Error.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 namespace GBA::ppu {
 	using namespace common;
 	using memory::EventType;
@@ -18,19 +23,27 @@ namespace GBA::ppu {
 		m_ctx{}, m_mode_cycles{},
 		m_curr_mode{}, m_palette_ram(nullptr),
 		m_vram(nullptr), m_oam(nullptr),
+		m_vram_writes{},
+		m_memory_changes{memory_changes::ALL},
 		m_framebuffer(nullptr),
+		m_frame_format{FrameFormat::RGB555},
+		m_frame_stride{240 * GetPixelSize(FrameFormat::RGB555)},
+		m_color_correction{ColorCorrection::None},
+		m_color_lut{}, m_frame_colors(size_t(240) * 160, 0),
 		m_internal_reference_x{}, 
 		m_internal_reference_y{},
 		m_frame_ok{false}, m_int_control(nullptr),
 		m_sched(nullptr), m_last_event_timestamp{0},
-		m_bus(nullptr), line_sprites_ids{},
-		line_sprites_count(0), m_line_data{},
-		m_obj_window_pixels{}
+		m_bus(nullptr), m_renderer{},
+		m_render_pool{}
 	{
 		m_palette_ram = new u8[0x400];
 		m_vram = new u8[0x18000];
 		m_oam = new u8[0x400];
-		m_framebuffer = new float[240 * 160 * 3];
+		m_framebuffer = new u8[m_frame_stride * 160]{};
+		m_renderer = std::make_unique<LineRenderer>(*this);
+
+		BuildColorLut();
 
 		std::fill_n(m_palette_ram, 0x400, 0x0);
 		std::fill_n(m_vram, 0x18000, 0x0);
@@ -55,8 +68,6 @@ namespace GBA::ppu {
 	void HblankEventCallback(void* ppu_ptr) {
 		PPU& ppu = *reinterpret_cast<PPU*>( ppu_ptr );
 
-		ppu.m_obj_window_pixels = {};
-
 		ppu.Normal();
 
 		if (CHECK_BIT(ppu.m_ctx.m_status, 4)) {
@@ -165,6 +176,8 @@ namespace GBA::ppu {
 		ppu.m_sched->ScheduleAbsolute(ppu.m_last_event_timestamp + PPU::CYCLES_PER_SCANLINE,
 			EventType::HBLANK_IN_VBLANK, VblankHblankCallback, ppu_ptr);
 
+		ppu.WaitForLines();
+
 		ppu.m_frame_ok = true;
 
 		ppu.m_last_event_timestamp += PPU::CYCLES_PER_SCANLINE;
@@ -390,44 +403,243 @@ namespace GBA::ppu {
 	void PPU::HBlank() {}
 
 	void PPU::Normal() {
-		u8 mode = m_ctx.m_control & 0x7;
+		LineSnapshot line{};
 
-		switch (mode)
-		{
-		case 0:
-			Mode0();
-			break;
+		line.registers = m_ctx;
 
-		case 1:
-			Mode1();
-			break;
+		std::copy_n(m_internal_reference_x, 2, line.reference_x);
+		std::copy_n(m_internal_reference_y, 2, line.reference_y);
 
-		case 2:
-			Mode2();
-			break;
+		line.palette_ram = m_palette_ram;
+		line.vram = m_vram;
+		line.vram_writes = m_vram_writes.GetCounts();
+		line.oam = m_oam;
 
-		case 3:
-			Mode3();
-			break;
+		AdvanceReferences();
 
-		case 4:
-			Mode4();
-			break;
+		if (m_render_pool) {
+			m_render_pool->Submit(line, m_memory_changes);
+			m_memory_changes = 0;
+		}
+		else {
+			m_renderer->Render(line);
+		}
+	}
+
+	void PPU::AdvanceReferences() {
+		u8 mode = m_ctx.m_control & 0x7;
 
-		case 5:
-			Mode5();
-			break;
+		for (u32 bg_id = 2; bg_id < 4; bg_id++) {
+			bool affine = mode == 2 || (mode == 1 && bg_id == 2);
 
-		default:
-			LOG_ERROR("Invalid display mode {0}!", (unsigned)mode);
-			error::DebugBreak();
-			break;
+			if (!affine || !CHECK_BIT(m_ctx.m_control, (8 + bg_id)))
+				continue;
+
+			u8 param_base = bg_id == 2 ? 0x20 : 0x30;
+
+			i16 dmx = (i16)ReadRegister16((param_base + 0x2) / 2);
+			i16 dmy = (i16)ReadRegister16((param_base + 0x6) / 2);
+
+			m_internal_reference_x[bg_id - 2] = (i32)m_internal_reference_x[bg_id - 2] + dmx;
+			m_internal_reference_y[bg_id - 2] = (i32)m_internal_reference_y[bg_id - 2] + dmy;
 		}
 	}
 
+	void PPU::WaitForLines() const {
+		if (m_render_pool)
+			m_render_pool->Wait();
+	}
+
+	void PPU::SetRenderThreads(unsigned num_threads) {
+		m_render_pool.reset();
+
+		if (num_threads)
+			m_render_pool = std::make_unique<RenderPool>(*this, num_threads);
+
+		m_memory_changes = memory_changes::ALL;
+	}
+
 	void PPU::ClockCycles(u32 num_cycles) {}
 
+	namespace {
+		/*
+		* LCD gamma and channel bleed of the GBA screen
+		* (from the higan color emulation), each channel
+		* 0-1 as the frame would show it
+		*/
+		void CorrectColor(u32 r, u32 g, u32 b, double& out_r, double& out_g, double& out_b) {
+			constexpr double LCD_GAMMA = 4.0;
+			constexpr double OUT_GAMMA = 2.2;
+
+			double lr = std::pow(r / 31.0, LCD_GAMMA);
+			double lg = std::pow(g / 31.0, LCD_GAMMA);
+			double lb = std::pow(b / 31.0, LCD_GAMMA);
+
+			out_r = std::pow((0 * lb + 50 * lg + 255 * lr) / 255, 1 / OUT_GAMMA) * 255 / 280;
+			out_g = std::pow((30 * lb + 230 * lg + 10 * lr) / 255, 1 / OUT_GAMMA) * 255 / 280;
+			out_b = std::pow((220 * lb + 10 * lg + 50 * lr) / 255, 1 / OUT_GAMMA) * 255 / 280;
+		}
+	}
+
+	void PPU::BuildColorLut() {
+		m_color_lut.resize(0x8000);
+
+		for (u32 color = 0; color < 0x8000; color++) {
+			u32 r = color & 0x1F;
+			u32 g = (color >> 5) & 0x1F;
+			u32 b = (color >> 10) & 0x1F;
+
+			if (m_color_correction == ColorCorrection::LCD) {
+				double out_r, out_g, out_b;
+				CorrectColor(r, g, b, out_r, out_g, out_b);
+
+				u32 max = m_frame_format == FrameFormat::RGB555 ? 31 : 255;
+
+				r = u32(std::lround(out_r * max));
+				g = u32(std::lround(out_g * max));
+				b = u32(std::lround(out_b * max));
+			}
+			else if (m_frame_format == FrameFormat::RGBA8888) {
+				r = (r << 3) | (r >> 2);
+				g = (g << 3) | (g >> 2);
+				b = (b << 3) | (b >> 2);
+			}
+
+			if (m_frame_format == FrameFormat::RGB555)
+				m_color_lut[color] = r | (g << 5) | (b << 10);
+			else
+				m_color_lut[color] = r | (g << 8) | (b << 16) | 0xFF000000;
+		}
+	}
+
+	void PPU::OutputLine(unsigned y, std::array<Pixel, 240> const& pixels) {
+		std::array<u16, 240> colors;
+
+		for (unsigned x = 0; x < 240; x++)
+			colors[x] = pixels[x].color;
+
+		OutputLine(y, colors);
+	}
+
+	void PPU::OutputLine(unsigned y, std::array<u16, 240> const& colors) {
+		u8* line = m_framebuffer + y * m_frame_stride;
+
+		if (IsDirectOutput()) {
+			u16* out = reinterpret_cast<u16*>(line);
+
+			for (unsigned x = 0; x < 240; x++)
+				out[x] = colors[x] & 0x7FFF;
+
+			return;
+		}
+
+		u16* line_colors = m_frame_colors.data() + y * 240;
+		u32 const* lut = m_color_lut.data();
+
+		for (unsigned x = 0; x < 240; x++)
+			line_colors[x] = colors[x] & 0x7FFF;
+
+		if (m_frame_format == FrameFormat::RGB555) {
+			u16* out = reinterpret_cast<u16*>(line);
+
+			for (unsigned x = 0; x < 240; x++)
+				out[x] = u16(lut[line_colors[x]]);
+		}
+		else {
+			u32* out = reinterpret_cast<u32*>(line);
+
+			for (unsigned x = 0; x < 240; x++)
+				out[x] = lut[line_colors[x]];
+		}
+	}
+
+	void PPU::OutputBlankLine(unsigned y) {
+		u8* line = m_framebuffer + y * m_frame_stride;
+
+		if (IsDirectOutput()) {
+			std::fill_n(reinterpret_cast<u16*>(line), 240, u16(0x7FFF));
+			return;
+		}
+
+		u32 white = m_color_lut[0x7FFF];
+
+		std::fill_n(m_frame_colors.begin() + y * 240, 240, 0x7FFF);
+
+		if (m_frame_format == FrameFormat::RGB555)
+			std::fill_n(reinterpret_cast<u16*>(line), 240, u16(white));
+		else
+			std::fill_n(reinterpret_cast<u32*>(line), 240, white);
+	}
+
+	void PPU::StoreFrame(std::vector<u16>& frame) const {
+		if (!IsDirectOutput()) {
+			frame = m_frame_colors;
+			return;
+		}
+
+		frame.resize(size_t(240) * 160);
+
+		for (unsigned y = 0; y < 160; y++) {
+			auto line = reinterpret_cast<u16 const*>(m_framebuffer + y * m_frame_stride);
+			std::copy_n(line, 240, frame.begin() + y * 240);
+		}
+	}
+
+	void PPU::RestoreFrame(std::vector<u16> const& frame) {
+		if (frame.size() != size_t(240) * 160)
+			return;
+
+		std::array<u16, 240> colors{};
+
+		for (unsigned y = 0; y < 160; y++) {
+			std::copy_n(frame.begin() + y * 240, 240, colors.begin());
+			OutputLine(y, colors);
+		}
+	}
+
+	void PPU::SetFrameFormat(FrameFormat format, u32 stride) {
+		WaitForLines();
+
+		u32 pixel_size = GetPixelSize(format);
+
+		stride = std::max(stride, 240 * pixel_size);
+		stride = (stride + pixel_size - 1) & ~(pixel_size - 1);
+
+		if (format == m_frame_format && stride == m_frame_stride)
+			return;
+
+		std::vector<u16> frame{};
+		StoreFrame(frame);
+
+		delete[] m_framebuffer;
+
+		m_framebuffer = new u8[stride * 160]{};
+		m_frame_format = format;
+		m_frame_stride = stride;
+
+		BuildColorLut();
+		RestoreFrame(frame);
+	}
+
+	void PPU::SetColorCorrection(ColorCorrection correction) {
+		WaitForLines();
+
+		if (correction == m_color_correction)
+			return;
+
+		std::vector<u16> frame{};
+		StoreFrame(frame);
+
+		m_color_correction = correction;
+
+		BuildColorLut();
+		RestoreFrame(frame);
+	}
+
 	PPU::~PPU() {
+		//Workers draw into the frame
+		m_render_pool.reset();
+
 		delete[] m_palette_ram;
 		delete[] m_vram;
 		delete[] m_framebuffer;
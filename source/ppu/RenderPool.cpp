@@ -0,0 +1,138 @@
+#include "../../ppu/RenderPool.hpp"
+
+#include <algorithm>
+
+namespace GBA::ppu {
+	using namespace common;
+
+	RenderPool::RenderPool(PPU& ppu, unsigned num_threads) :
+		m_renderers{}, m_threads{}, m_mutex{},
+		m_work{}, m_finished{}, m_stop{false},
+		m_lines{}, m_queued{0}, m_next{0}, m_done{0},
+		m_palettes{}, m_oams{}, m_vrams{},
+		m_palette(nullptr), m_oam(nullptr), m_vram(nullptr)
+	{
+		for (unsigned id = 0; id < num_threads; id++)
+			m_renderers.push_back(std::make_unique<LineRenderer>(ppu));
+
+		for (auto& renderer : m_renderers)
+			m_threads.emplace_back(&RenderPool::Work, this, std::ref(*renderer));
+	}
+
+	RenderPool::~RenderPool() {
+		Wait();
+
+		{
+			std::lock_guard lock{m_mutex};
+			m_stop = true;
+		}
+
+		m_work.notify_all();
+
+		for (auto& thread : m_threads)
+			thread.join();
+	}
+
+	void RenderPool::Submit(LineSnapshot line, u8 changes) {
+		if (m_queued == m_lines.size())
+			Wait();
+
+		//Copies are reused after Wait(),
+		//nothing is left to share
+		if (m_queued == 0)
+			changes = memory_changes::ALL;
+
+		if (changes & memory_changes::PALETTE)
+			m_palette = CopyMemory(m_palettes, line.palette_ram);
+
+		if (changes & memory_changes::OAM)
+			m_oam = CopyMemory(m_oams, line.oam);
+
+		if (changes & memory_changes::VRAM)
+			m_vram = &CopyVRAM(line.vram, line.vram_writes);
+
+		line.palette_ram = m_palette;
+		line.oam = m_oam;
+		line.vram = m_vram->data.data();
+		line.vram_writes = m_vram->writes.data();
+
+		{
+			std::lock_guard lock{m_mutex};
+			m_lines[m_queued++] = line;
+		}
+
+		m_work.notify_one();
+	}
+
+	void RenderPool::Wait() {
+		std::unique_lock lock{m_mutex};
+
+		m_finished.wait(lock, [this]() {
+			return m_done == m_queued;
+		});
+
+		m_queued = 0;
+		m_next = 0;
+		m_done = 0;
+
+		m_palettes.used = 0;
+		m_oams.used = 0;
+		m_vrams.used = 0;
+	}
+
+	void RenderPool::Work(LineRenderer& renderer) {
+		std::unique_lock lock{m_mutex};
+
+		while (true) {
+			m_work.wait(lock, [this]() {
+				return m_stop || m_next != m_queued;
+			});
+
+			if (m_stop)
+				return;
+
+			u32 index = m_next++;
+
+			lock.unlock();
+			renderer.Render(m_lines[index]);
+			lock.lock();
+
+			if (++m_done == m_queued)
+				m_finished.notify_all();
+		}
+	}
+
+	u8 const* RenderPool::CopyMemory(Copies<MemoryCopy>& copies, u8 const* memory) {
+		MemoryCopy& copy = copies.Next();
+
+		std::copy_n(memory, copy.size(), copy.begin());
+
+		return copy.data();
+	}
+
+	/*
+	* A copy is reused from earlier frames,
+	* only tiles written since then (their
+	* write count differs) are copied
+	*/
+	RenderPool::VramCopy const& RenderPool::CopyVRAM(u8 const* vram, u32 const* writes) {
+		VramCopy& copy = m_vrams.Next();
+
+		if (copy.data.empty()) {
+			copy.data.resize(tiles::VRAM_SIZE);
+			copy.writes.resize(tiles::SLOT_COUNT, ~u32(0));
+		}
+
+		for (u32 slot = 0; slot < tiles::SLOT_COUNT; slot++) {
+			if (copy.writes[slot] == writes[slot])
+				continue;
+
+			std::copy_n(vram + slot * tiles::SLOT_SIZE, tiles::SLOT_SIZE,
+				copy.data.begin() + slot * tiles::SLOT_SIZE);
+
+			copy.writes[slot] = writes[slot];
+		}
+
+		return copy;
+	}
+}
@@ -0,0 +1,42 @@
+#include "../../ppu/TileCache.hpp"
+
+#include <algorithm>
+
+namespace GBA::ppu {
+	using namespace common;
+
+	TileWrites::TileWrites() :
+		m_counts(tiles::SLOT_COUNT, 0)
+	{}
+
+	void TileWrites::InvalidateAll() {
+		for (u32& count : m_counts)
+			count++;
+	}
+
+	//No slot decoded yet
+	TileCache::TileCache() :
+		m_vram(nullptr), m_writes(nullptr),
+		m_slots(tiles::SLOT_COUNT), m_decoded(tiles::SLOT_COUNT, ~u32(0))
+	{}
+
+	void TileCache::Decode(u32 index) {
+		u8 const* data = m_vram + index * tiles::SLOT_SIZE;
+		Slot& slot = m_slots[index];
+
+		//Low nibble is the leftmost pixel
+		for (u32 row = 0; row < 8; row++) {
+			for (u32 x = 0; x < 8; x++) {
+				u8 color_id = (data[row * 4 + x / 2] >> ((x & 1) * 4)) & 0xF;
+
+				slot.rows4[0][row][x] = color_id;
+				slot.rows4[1][row][7 - x] = color_id;
+			}
+		}
+
+		for (u32 row = 0; row < 4; row++)
+			std::reverse_copy(data + row * 8, data + row * 8 + 8, slot.mirrored_rows8[row]);
+
+		m_decoded[index] = m_writes[index];
+	}
+}
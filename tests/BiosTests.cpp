@@ -0,0 +1,95 @@
+#include "Test.hpp"
+#include "TestRom.hpp"
+
+namespace GBA::test {
+	namespace {
+		static constexpr u32 BIOS_IF = 0x03007FF8;
+		static constexpr u32 COUNTER = 0x03004000;
+		static constexpr u32 VRAM = 0x06000000;
+	}
+
+	TEST_CASE(VBlankIntrWaitWaitsOneFrame) {
+		Assembler code{};
+
+		auto handler = code.NewLabel();
+		auto start = code.NewLabel();
+		auto wait = code.NewLabel();
+
+		code.B(start);
+
+		//Acknowledge IF and report it to the BIOS
+		code.Bind(handler);
+		code.Add(3, 0, 0x200);
+		code.Ldrh(1, 3, 2);
+		code.Strh(1, 3, 2);
+		code.LoadImm(3, BIOS_IF);
+		code.Ldrh(2, 3, 0);
+		code.OrrReg(2, 2, 1);
+		code.Strh(2, 3, 0);
+		code.Bx(14);
+
+		code.Bind(start);
+		code.LoadImm(0, code.AddressOf(handler));
+		code.LoadImm(1, IRQ_VECTOR);
+		code.Str(0, 1, 0);
+
+		//DISPSTAT VBlank IRQ, IE = VBlank, IME = 1
+		code.LoadImm(4, REG_BASE);
+		code.Mov(0, 8);
+		code.Strh(0, 4, 4);
+		code.Add(3, 4, 0x200);
+		code.Mov(0, 1);
+		code.Strh(0, 3, 0);
+		code.Strh(0, 3, 8);
+
+		code.LoadImm(5, COUNTER);
+		code.Mov(6, 0);
+
+		code.Bind(wait);
+		code.Swi(0x05);
+		code.Add(6, 6, 1);
+		code.Str(6, 5, 0);
+		code.B(wait);
+
+		TestRom rom{ code };
+		auto emu = rom.Boot();
+
+		RunFrames(*emu, 10);
+
+		//One wait per frame, the first may end early
+		u32 frames = ReadWord(*emu, COUNTER);
+
+		CHECK(frames >= 9);
+		CHECK(frames <= 11);
+	}
+
+	TEST_CASE(LZ77UnCompVramKeepsOddTail) {
+		Assembler code{};
+
+		auto start = code.NewLabel();
+		auto data = code.NewLabel();
+
+		code.B(start);
+
+		//"ABC", three literals
+		code.Bind(data);
+		code.Word(0x00000310);
+		code.Word(0x43424100);
+
+		code.Bind(start);
+		code.LoadImm(1, VRAM);
+		code.LoadImm(0, 0xFFFF);
+		code.Strh(0, 1, 2);
+		code.LoadImm(0, code.AddressOf(data));
+		code.Swi(0x12);
+		code.Hang();
+
+		TestRom rom{ code };
+		auto emu = rom.Boot();
+
+		RunFrames(*emu, 1);
+
+		CHECK_EQ(ReadHalf(*emu, VRAM), u16(0x4241));
+		CHECK_EQ(ReadHalf(*emu, VRAM + 2), u16(0xFF43));
+	}
+}
@@ -0,0 +1,882 @@
+#include "Test.hpp"
+#include "TestRom.hpp"
+
+#include "../cpu/core/Register.hpp"
+#include "../cpu/jit/Jit.hpp"
+
+#include "../thirdparty/cereal/include/cereal/archives/binary.hpp"
+
+#include <array>
+#include <sstream>
+
+namespace GBA::test {
+	namespace {
+		static constexpr u32 IWRAM = 0x03000000;
+		static constexpr u32 RESULTS = 0x03004000;
+
+		//mov r0, #value; bx lr
+		void WriteReturnValue(Assembler& code, u32 address, u8 value) {
+			code.LoadImm(1, address);
+			code.LoadImm(0, 0xE3A00000 | value);
+			code.Str(0, 1, 0);
+			code.LoadImm(0, 0xE12FFF1E);
+			code.Str(0, 1, 4);
+		}
+	}
+
+	TEST_CASE(BlockCacheSeesRewrittenCode) {
+		Assembler code{};
+
+		code.LoadImm(5, RESULTS);
+		code.LoadImm(4, IWRAM);
+
+		//Decode the routine, then rewrite and run it again
+		for (u8 value = 1; value <= 3; value++) {
+			WriteReturnValue(code, IWRAM, value);
+			code.Call(4);
+			code.Str(0, 5, 4 * (value - 1));
+		}
+
+		code.Hang();
+
+		TestRom rom{ code };
+		auto emu = rom.Boot();
+
+		RunFrames(*emu, 2);
+
+		CHECK_EQ(ReadWord(*emu, RESULTS), 1u);
+		CHECK_EQ(ReadWord(*emu, RESULTS + 4), 2u);
+		CHECK_EQ(ReadWord(*emu, RESULTS + 8), 3u);
+	}
+
+	namespace {
+		static constexpr u32 REWRITES = 100;
+		static constexpr u32 CALLS = 40;
+
+		/*
+		* Rewrites a routine in IWRAM and calls
+		* it often enough to be translated,
+		* the sum of its results ends in r7
+		*/
+		Assembler RewriteLoop() {
+			Assembler code{};
+
+			code.LoadImm(4, IWRAM);
+			code.LoadImm(5, RESULTS);
+			code.LoadImm(9, 0xE3A00000);
+			code.LoadImm(10, 0xE12FFF1E);
+			code.Mov(6, 0);
+			code.Mov(7, 0);
+
+			auto rewrite = code.NewLabel();
+			auto call = code.NewLabel();
+
+			code.Bind(rewrite);
+			code.OrrReg(0, 9, 6);
+			code.Str(0, 4, 0);
+			code.Str(10, 4, 4);
+			code.Mov(8, CALLS);
+
+			code.Bind(call);
+			code.Call(4);
+			code.AddReg(7, 7, 0);
+			code.Sub(8, 8, 1, true);
+			code.B(call, NE);
+
+			code.Add(6, 6, 1);
+			code.Cmp(6, REWRITES);
+			code.B(rewrite, NE);
+
+			code.Str(7, 5, 0);
+			code.Mov(0, 1);
+			code.Str(0, 5, 4);
+			code.Hang();
+
+			return code;
+		}
+	}
+
+	TEST_CASE(JitMatchesInterpreterOnRewrittenCode) {
+		TestRom rom{ RewriteLoop() };
+
+		u32 expected = CALLS * (REWRITES * (REWRITES - 1) / 2);
+
+		for (auto mode : { cpu::ExecutionMode::INTERPRETER, cpu::ExecutionMode::JIT,
+			cpu::ExecutionMode::JIT_LOCKSTEP }) {
+			auto emu = rom.Boot();
+			emu->GetContext().processor.SetExecutionMode(mode);
+
+			RunFrames(*emu, 4);
+
+			CHECK_EQ(ReadWord(*emu, RESULTS + 4), 1u);
+			CHECK_EQ(ReadWord(*emu, RESULTS), expected);
+		}
+	}
+
+	TEST_CASE(JitFreesInvalidatedTranslations) {
+		TestRom rom{ RewriteLoop() };
+		auto emu = rom.Boot();
+
+		auto& processor = emu->GetContext().processor;
+		processor.SetExecutionMode(cpu::ExecutionMode::JIT);
+
+		if (processor.GetJit() == nullptr)
+			return;
+
+		RunFrames(*emu, 4);
+
+		CHECK_EQ(ReadWord(*emu, RESULTS + 4), 1u);
+
+		//One translation per rewrite if they were kept
+		CHECK(processor.GetJit()->GetBlockCount() < REWRITES / 4);
+	}
+
+	namespace {
+		static constexpr u32 IRQ_FLAG = 0x03005000;
+		static constexpr u32 IRQ_TIMER = 0x03005004;
+
+		static constexpr u32 TIMER_RUNS = 16;
+
+		/*
+		* Timer 0 requests an IRQ 256 cycles after
+		* being started while the CPU spins in an
+		* idle loop or halted, timer 1 counts
+		* the cycles until the handler runs
+		*/
+		Assembler TimerWakeLoop(bool halt) {
+			Assembler code{};
+
+			auto handler = code.NewLabel();
+			auto start = code.NewLabel();
+			auto run = code.NewLabel();
+			auto idle = code.NewLabel();
+
+			code.B(start);
+
+			code.Bind(handler);
+			code.Add(3, 0, 0x100);
+			code.Ldrh(1, 3, 4);
+			code.Mov(2, 0);
+			code.Strh(2, 3, 2);
+			code.LoadImm(3, IRQ_FLAG);
+			code.Str(1, 3, 4);
+			code.Mov(1, 1);
+			code.Str(1, 3, 0);
+			code.Add(3, 0, 0x200);
+			code.Mov(1, 8);
+			code.Strh(1, 3, 2);
+			code.Bx(14);
+
+			code.Bind(start);
+			code.LoadImm(0, code.AddressOf(handler));
+			code.LoadImm(1, IRQ_VECTOR);
+			code.Str(0, 1, 0);
+
+			code.LoadImm(4, REG_BASE);
+			code.LoadImm(5, RESULTS);
+			code.LoadImm(2, IRQ_FLAG);
+			code.Mov(6, 0);
+
+			//IE = timer 0, IME = 1
+			code.Add(3, 4, 0x200);
+			code.Mov(0, 8);
+			code.Strh(0, 3, 0);
+			code.Mov(0, 1);
+			code.Strh(0, 3, 8);
+
+			code.Bind(run);
+			code.Mov(0, 0);
+			code.Str(0, 2, 0);
+			code.Add(3, 4, 0x100);
+			code.Strh(0, 3, 2);
+			code.Strh(0, 3, 6);
+			code.Strh(0, 3, 4);
+			code.Mov(0, 0x80);
+			code.Strh(0, 3, 6);
+			code.LoadImm(0, 0xFF00);
+			code.Strh(0, 3, 0);
+			code.Mov(0, 0xC0);
+			code.Strh(0, 3, 2);
+
+			if (halt)
+				code.Swi(0x02);
+
+			code.Bind(idle);
+			code.Ldr(1, 2, 0);
+			code.Cmp(1, 0);
+			code.B(idle, EQ);
+
+			code.Ldr(0, 2, 4);
+			code.Str(0, 5, 0);
+			code.Add(5, 5, 4);
+			code.Add(6, 6, 1);
+			code.Cmp(6, TIMER_RUNS);
+			code.B(run, NE);
+
+			code.LoadImm(5, RESULTS);
+			code.Mov(0, 1);
+			code.Str(0, 5, 4 * TIMER_RUNS);
+			code.Hang();
+
+			return code;
+		}
+	}
+
+	TEST_CASE(IdleLoopWakesOnTimerIrq) {
+		TestRom rom{ TimerWakeLoop(false) };
+		auto emu = rom.Boot();
+
+		RunFrames(*emu, 2);
+
+		CHECK_EQ(ReadWord(*emu, RESULTS + 4 * TIMER_RUNS), 1u);
+
+		//Overflow after 256 cycles, the rest is
+		//the loop iteration and IRQ entry
+		for (u32 run = 0; run < TIMER_RUNS; run++)
+			CHECK(ReadWord(*emu, RESULTS + 4 * run) < 0x180);
+	}
+
+	TEST_CASE(HaltWakesOnTimerIrq) {
+		TestRom rom{ TimerWakeLoop(true) };
+		auto emu = rom.Boot();
+
+		RunFrames(*emu, 2);
+
+		CHECK_EQ(ReadWord(*emu, RESULTS + 4 * TIMER_RUNS), 1u);
+
+		for (u32 run = 0; run < TIMER_RUNS; run++)
+			CHECK(ReadWord(*emu, RESULTS + 4 * run) < 0x180);
+	}
+
+	namespace {
+		static constexpr u16 BLOCK_LIST = 0x00CF;
+		static constexpr u32 BLOCK_WORDS = 6;
+
+		//EWRAM, IWRAM, then across the first EWRAM page
+		static constexpr std::array<u32, 3> block_bases{ 0x02001000, 0x03001000, 0x02003FF0 };
+
+		static constexpr u32 BLOCK_TIMES = RESULTS + 0x100;
+	}
+
+	TEST_CASE(LdmStmMoveRegisterBlocks) {
+		Assembler code{};
+
+		auto table = code.NewLabel();
+		auto start = code.NewLabel();
+		auto next = code.NewLabel();
+		auto done = code.NewLabel();
+
+		code.B(start);
+
+		code.Bind(table);
+		for (u32 base : block_bases)
+			code.Word(base);
+		code.Word(0);
+
+		code.Bind(start);
+		code.LoadImm(4, REG_BASE);
+		code.LoadImm(5, RESULTS);
+		code.LoadImm(9, code.AddressOf(table));
+		code.LoadImm(10, BLOCK_TIMES);
+		code.Add(11, 4, 0x100);
+
+		auto timer_start = [&code]() {
+			code.Mov(12, 0);
+			code.Strh(12, 11, 6);
+			code.Mov(12, 0x80);
+			code.Strh(12, 11, 6);
+		};
+
+		auto timer_stop = [&code]() {
+			code.Ldrh(12, 11, 4);
+			code.Str(12, 10, 0);
+			code.Add(10, 10, 4);
+		};
+
+		//The same code moves every block, so that
+		//only the addresses change the timing
+		code.Bind(next);
+		code.Ldr(8, 9, 0);
+		code.Add(9, 9, 4);
+		code.Cmp(8, 0);
+		code.B(done, EQ);
+
+		for (u8 reg = 0; reg < 8; reg++) {
+			if (BLOCK_LIST & (1 << reg))
+				code.Add(reg, 8, reg * 0x11);
+		}
+
+		timer_start();
+		code.Stm(8, BLOCK_LIST);
+		timer_stop();
+		code.Str(8, 5, BLOCK_WORDS * 4);
+
+		for (u8 reg = 0; reg < 8; reg++) {
+			if (BLOCK_LIST & (1 << reg))
+				code.Mov(reg, 0);
+		}
+
+		code.Sub(8, 8, BLOCK_WORDS * 4);
+		timer_start();
+		code.Ldm(8, BLOCK_LIST);
+		timer_stop();
+		code.Stm(5, BLOCK_LIST, false);
+		code.Add(5, 5, 0x20);
+		code.B(next);
+
+		code.Bind(done);
+		code.Mov(0, 1);
+		code.Str(0, 5, 0);
+		code.Hang();
+
+		TestRom rom{ code };
+		auto emu = rom.Boot();
+
+		RunFrames(*emu, 1);
+
+		CHECK_EQ(ReadWord(*emu, RESULTS + 0x20 * block_bases.size()), 1u);
+
+		for (u32 pos = 0; pos < block_bases.size(); pos++) {
+			u32 base = block_bases[pos];
+			u32 results = RESULTS + pos * 0x20;
+			u32 word = 0;
+
+			for (u8 reg = 0; reg < 8; reg++) {
+				if (!(BLOCK_LIST & (1 << reg)))
+					continue;
+
+				CHECK_EQ(ReadWord(*emu, base + word * 4), base + reg * 0x11);
+				CHECK_EQ(ReadWord(*emu, results + word * 4), base + reg * 0x11);
+				word++;
+			}
+
+			CHECK_EQ(ReadWord(*emu, results + BLOCK_WORDS * 4), base + BLOCK_WORDS * 4);
+		}
+
+		//STM then LDM for each base, EWRAM words take
+		//6 cycles and IWRAM words 1, page or not
+		for (u32 access = 0; access < 2; access++) {
+			u32 ewram = ReadWord(*emu, BLOCK_TIMES + access * 4);
+			u32 iwram = ReadWord(*emu, BLOCK_TIMES + 8 + access * 4);
+			u32 across = ReadWord(*emu, BLOCK_TIMES + 16 + access * 4);
+
+			CHECK_EQ(ewram - iwram, BLOCK_WORDS * 5);
+			CHECK_EQ(across, ewram);
+		}
+	}
+
+	namespace {
+		static constexpr u32 MEMORY_DATA = 0x02010000;
+		static constexpr u32 ARM_STORES = 0x02020000;
+		static constexpr u32 THUMB_STORES = 0x02030000;
+		static constexpr u32 MEMORY_LOOPS = 128;
+
+		/*
+		* THUMB loop over the data at r4, r6 times,
+		* sums loads into r7 and logs to r3
+		*/
+		static constexpr std::array<u16, 26> thumb_memory_loop{
+			0x6860, 0x183F, //ldr r0, [r4, #4]; add r7, r7, r0
+			0x8860, 0x183F, //ldrh r0, [r4, #2]
+			0x78E0, 0x183F, //ldrb r0, [r4, #3]
+			0x2101, //mov r1, #1
+			0x5E60, 0x183F, //ldsh r0, [r4, r1]
+			0x5660, 0x183F, //ldsb r0, [r4, r1]
+			0x6067, //str r7, [r4, #4]
+			0x8067, //strh r7, [r4, #2]
+			0x70E7, //strb r7, [r4, #3]
+			0xB481, //push {r0, r7}
+			0xBC06, //pop {r1, r2}
+			0x187F, 0x18BF, //add r7, r7, r1; add r7, r7, r2
+			0x1C22, //add r2, r4, #0
+			0xCA03, //ldmia r2!, {r0, r1}
+			0x183F, 0x187F,
+			0xC381, //stmia r3!, {r0, r7}
+			0x3E01, //sub r6, #1
+			0xD1E6, //bne loop
+			0x4770 //bx lr
+		};
+	}
+
+	TEST_CASE(JitMatchesInterpreterOnMemoryOps) {
+		Assembler code{};
+
+		auto thumb = code.NewLabel();
+		auto start = code.NewLabel();
+		auto loop = code.NewLabel();
+
+		code.B(start);
+
+		code.Bind(thumb);
+		for (u32 pos = 0; pos < thumb_memory_loop.size(); pos += 2)
+			code.Word(thumb_memory_loop[pos] | (thumb_memory_loop[pos + 1] << 16));
+
+		code.Bind(start);
+		code.LoadImm(4, MEMORY_DATA);
+		code.LoadImm(5, RESULTS);
+		code.LoadImm(8, ARM_STORES);
+		code.LoadImm(11, REG_BASE + 0x100);
+		code.Mov(9, 2);
+		code.Mov(7, 0);
+
+		code.LoadImm(0, 0x80F17F02);
+		code.Str(0, 4, 0);
+		code.LoadImm(0, 0x12FE8034);
+		code.Str(0, 4, 4);
+
+		auto timer_start = [&code]() {
+			code.Mov(12, 0);
+			code.Strh(12, 11, 6);
+			code.Mov(12, 0x80);
+			code.Strh(12, 11, 6);
+		};
+
+		//Unaligned, signed, indexed and block transfers,
+		//stores feed back into the following loads
+		timer_start();
+		code.LoadImm(6, MEMORY_LOOPS);
+
+		code.Bind(loop);
+		code.Ldr(0, 4, 1);
+		code.AddReg(7, 7, 0);
+		code.Ldrh(0, 4, 3);
+		code.AddReg(7, 7, 0);
+		code.Word(0xE1D400D2); //ldrsb r0, [r4, #2]
+		code.AddReg(7, 7, 0);
+		code.Word(0xE1D400F1); //ldrsh r0, [r4, #1]
+		code.AddReg(7, 7, 0);
+		code.Ldrb(0, 4, 3);
+		code.AddReg(7, 7, 0);
+		code.Str(7, 4, 4);
+		code.Strh(7, 4, 6);
+		code.Strb(7, 4, 1);
+		code.MovReg(10, 4);
+		code.Word(0xE49A0004); //ldr r0, [r10], #4
+		code.AddReg(7, 7, 0);
+		code.Word(0xE5BA1004); //ldr r1, [r10, #4]!
+		code.AddReg(7, 7, 1);
+		code.AddReg(7, 7, 10);
+		code.Word(0xE7940009); //ldr r0, [r4, r9]
+		code.AddReg(7, 7, 0);
+		code.Word(0xE7C47009); //strb r7, [r4, r9]
+		code.Ldm(4, 0xF, false);
+		code.AddReg(7, 7, 2);
+		code.AddReg(7, 7, 3);
+		code.Stm(8, 0x81);
+		code.Sub(6, 6, 1, true);
+		code.B(loop, NE);
+
+		code.Ldrh(12, 11, 4);
+		code.Str(12, 5, 0);
+
+		timer_start();
+		code.LoadImm(6, MEMORY_LOOPS);
+		code.LoadImm(3, THUMB_STORES);
+		code.LoadImm(0, code.AddressOf(thumb) | 1);
+		code.Call(0);
+		code.Ldrh(12, 11, 4);
+		code.Str(12, 5, 4);
+
+		code.Str(7, 5, 8);
+		code.Str(8, 5, 12);
+		code.Str(3, 5, 16);
+		code.Mov(0, 1);
+		code.Str(0, 5, 20);
+		code.Hang();
+
+		TestRom rom{ code };
+
+		std::array<u32, 7> expected{};
+
+		for (auto mode : { cpu::ExecutionMode::INTERPRETER, cpu::ExecutionMode::JIT,
+			cpu::ExecutionMode::JIT_LOCKSTEP }) {
+			auto emu = rom.Boot();
+			emu->GetContext().processor.SetExecutionMode(mode);
+
+			RunFrames(*emu, 2);
+
+			CHECK_EQ(ReadWord(*emu, RESULTS + 20), 1u);
+			CHECK_EQ(ReadWord(*emu, RESULTS + 12), ARM_STORES + MEMORY_LOOPS * 8);
+			CHECK_EQ(ReadWord(*emu, RESULTS + 16), THUMB_STORES + MEMORY_LOOPS * 8);
+
+			//Timer samples, sum, data and the last logged words
+			std::array<u32, 7> results{ ReadWord(*emu, RESULTS), ReadWord(*emu, RESULTS + 4),
+				ReadWord(*emu, RESULTS + 8), ReadWord(*emu, MEMORY_DATA),
+				ReadWord(*emu, MEMORY_DATA + 4), ReadWord(*emu, ARM_STORES + MEMORY_LOOPS * 8 - 4),
+				ReadWord(*emu, THUMB_STORES + MEMORY_LOOPS * 8 - 4) };
+
+			if (mode == cpu::ExecutionMode::INTERPRETER)
+				expected = results;
+
+			for (u32 pos = 0; pos < results.size(); pos++)
+				CHECK_EQ(results[pos], expected[pos]);
+		}
+	}
+
+	namespace {
+		using cpu::Mode;
+		using cpu::RegisterManager;
+
+		//Index order of the register banks
+		static constexpr std::array<Mode, 6> bank_modes{ Mode::User, Mode::FIQ,
+			Mode::IRQ, Mode::SWI, Mode::ABRT, Mode::UND };
+
+		static constexpr u32 STALE = 0xDEAD0000;
+
+		//r8-r14 of FIQ, r13-r14 of the others, User otherwise
+		u32 ExpectedReg(u8 bank, u8 id) {
+			if (id >= 8 + RegisterManager::BANK_START[bank] && id < 15)
+				return ((bank + 1) << 8) | id;
+
+			return (1 << 8) | id;
+		}
+
+		RegisterManager FilledRegisters(Mode mode) {
+			RegisterManager regs{};
+
+			for (u8 bank = 0; bank < bank_modes.size(); bank++) {
+				for (u8 id = 8 + RegisterManager::BANK_START[bank]; id < 15; id++)
+					regs.SetReg(bank_modes[bank], id, ExpectedReg(bank, id));
+			}
+
+			for (u8 id = 0; id < 16; id++)
+				regs.SetReg(Mode::User, id, ExpectedReg(0, id));
+
+			regs.SwitchMode(mode);
+
+			return regs;
+		}
+
+		void CheckRegisters(RegisterManager const& regs, Mode mode) {
+			u8 curr_bank = cpu::GetModeFromID(mode);
+
+			CHECK_EQ(regs.GetCurrentModeId(), curr_bank);
+
+			for (u8 id = 0; id < 16; id++)
+				CHECK_EQ(regs.GetReg(id), ExpectedReg(curr_bank, id));
+
+			for (u8 bank = 0; bank < bank_modes.size(); bank++) {
+				for (u8 id = 8; id < 15; id++)
+					CHECK_EQ(regs.GetReg(bank_modes[bank], id), ExpectedReg(bank, id));
+			}
+		}
+	}
+
+	TEST_CASE(RegisterSavestatesRoundTrip) {
+		for (auto mode : { Mode::User, Mode::IRQ, Mode::FIQ }) {
+			std::stringstream stream{};
+
+			{
+				cereal::BinaryOutputArchive ar{ stream };
+				ar(FilledRegisters(mode));
+			}
+
+			RegisterManager loaded{};
+
+			{
+				cereal::BinaryInputArchive ar{ stream };
+				ar(loaded);
+			}
+
+			CheckRegisters(loaded, mode);
+		}
+	}
+
+	/*
+	* The copying implementation only synced the
+	* banks of a mode when leaving it and User
+	* r8-r12 when entering FIQ, the other slots
+	* hold whatever was left there
+	*/
+	TEST_CASE(RegisterSavestatesLoadLegacyLayout) {
+		for (auto mode : { Mode::User, Mode::IRQ, Mode::FIQ }) {
+			u8 curr_bank = cpu::GetModeFromID(mode);
+
+			u32 curr_regs[16]{};
+			u32 commonly_shared[5]{};
+			u32 banked_regs[6][7]{};
+
+			for (u8 id = 0; id < 16; id++)
+				curr_regs[id] = ExpectedReg(curr_bank, id);
+
+			for (u8 id = 0; id < 5; id++)
+				commonly_shared[id] = mode == Mode::FIQ ? ExpectedReg(0, 8 + id) : STALE;
+
+			for (u8 bank = 0; bank < 6; bank++) {
+				for (u8 id = 0; id < 7; id++) {
+					bool synced = bank != curr_bank && id >= RegisterManager::BANK_START[bank];
+					banked_regs[bank][id] = synced ? ExpectedReg(bank, 8 + id) : STALE;
+				}
+			}
+
+			std::stringstream stream{};
+
+			{
+				cereal::BinaryOutputArchive ar{ stream };
+				ar(curr_bank);
+				ar(curr_regs);
+				ar(commonly_shared);
+				ar(banked_regs);
+			}
+
+			RegisterManager loaded{};
+
+			{
+				cereal::BinaryInputArchive ar{ stream };
+				ar(loaded);
+			}
+
+			CheckRegisters(loaded, mode);
+		}
+	}
+
+	namespace {
+		static constexpr u8 FLAG_N = 8;
+		static constexpr u8 FLAG_Z = 4;
+		static constexpr u8 FLAG_C = 2;
+		static constexpr u8 FLAG_V = 1;
+
+		/*
+		* cmp r3, r4 leaves flags pending, then
+		* opcode reads them and sets or keeps
+		* them, nzcv is what it must leave
+		*/
+		struct FlagCase {
+			u32 cmp_first;
+			u32 cmp_second;
+			u32 opcode;
+			u32 first;
+			u32 second;
+			u32 result;
+			u8 nzcv;
+		};
+
+		static constexpr std::array<FlagCase, 20> flag_cases{ {
+			//adcs r0, r1, r2
+			{ 0, 0, 0xE0B10002, 0xFFFFFFFF, 0, 0, FLAG_Z | FLAG_C },
+			{ 0, 1, 0xE0B10002, 0xFFFFFFFF, 0, 0xFFFFFFFF, FLAG_N },
+			{ 0x80000000, 1, 0xE0B10002, 0x7FFFFFFF, 0, 0x80000000, FLAG_N | FLAG_V },
+			{ 0, 1, 0xE0B10002, 0x80000000, 0x80000000, 0, FLAG_Z | FLAG_C | FLAG_V },
+			//sbcs r0, r1, r2
+			{ 0, 1, 0xE0D10002, 5, 5, 0xFFFFFFFF, FLAG_N },
+			{ 0, 0, 0xE0D10002, 5, 5, 0, FLAG_Z | FLAG_C },
+			{ 0, 1, 0xE0D10002, 0x80000000, 0, 0x7FFFFFFF, FLAG_C | FLAG_V },
+			{ 0, 0, 0xE0D10002, 0, 0xFFFFFFFF, 1, 0 },
+			//adc r0, r1, r2 and sbc r0, r1, r2 keep the flags of cmp
+			{ 0, 0, 0xE0A10002, 1, 2, 4, FLAG_Z | FLAG_C },
+			{ 0, 1, 0xE0C10002, 5, 2, 2, FLAG_N },
+			//movs r0, r1, lsl #1, V is kept
+			{ 0, 0, 0xE1B00081, 0x80000001, 0, 2, FLAG_C },
+			{ 0x7FFFFFFF, 0xFFFFFFFF, 0xE1B00081, 0x40000000, 0, 0x80000000, FLAG_N | FLAG_V },
+			//movs r0, r1, lsr #1
+			{ 0x80000000, 1, 0xE1B000A1, 1, 0, 0, FLAG_Z | FLAG_C | FLAG_V },
+			//movs r0, r1, lsr #32
+			{ 0, 1, 0xE1B00021, 0x80000000, 0, 0, FLAG_Z | FLAG_C },
+			//movs r0, r1, ror r2, no shift keeps C
+			{ 0, 0, 0xE1B00271, 0x80000000, 0, 0x80000000, FLAG_N | FLAG_C },
+			{ 0, 1, 0xE1B00271, 0, 0x20, 0, FLAG_Z },
+			//movs r0, r1, rrx
+			{ 0, 0, 0xE1B00061, 0, 0, 0x80000000, FLAG_N },
+			{ 0, 1, 0xE1B00061, 3, 0, 1, FLAG_C },
+			//msr cpsr_f, #0x80000000 drops the pending cmp
+			{ 0, 0, 0xE328F102, 0, 0, 0, FLAG_N },
+			//msr cpsr_f, r2
+			{ 0, 1, 0xE128F002, 0, 0x30000000, 0, FLAG_C | FLAG_V }
+		} };
+
+		//Any of the permanently undefined encodings
+		static constexpr u32 UNDEFINED = 0xE7F000F0;
+
+		//mrs r7, cpsr
+		static constexpr u32 MRS_R7 = 0xE10F7000;
+
+		static constexpr u32 FLAG_RESULTS = 0x80;
+
+		bool PassesCondition(u8 cond, u8 nzcv) {
+			bool n = nzcv & FLAG_N;
+			bool z = nzcv & FLAG_Z;
+			bool c = nzcv & FLAG_C;
+			bool v = nzcv & FLAG_V;
+
+			switch (cond)
+			{
+			case 0x0: return z;
+			case 0x1: return !z;
+			case 0x2: return c;
+			case 0x3: return !c;
+			case 0x4: return n;
+			case 0x5: return !n;
+			case 0x6: return v;
+			case 0x7: return !v;
+			case 0x8: return c && !z;
+			case 0x9: return !c || z;
+			case 0xA: return n == v;
+			case 0xB: return n != v;
+			case 0xC: return !z && n == v;
+			case 0xD: return z || n != v;
+			default: return true;
+			}
+		}
+
+		void RunFlagCase(Assembler& code, FlagCase const& flag_case) {
+			code.LoadImm(3, flag_case.cmp_first);
+			code.LoadImm(4, flag_case.cmp_second);
+			code.LoadImm(1, flag_case.first);
+			code.LoadImm(2, flag_case.second);
+			code.Mov(0, 0);
+			code.CmpReg(3, 4);
+			code.Word(flag_case.opcode);
+		}
+	}
+
+	/*
+	* Every case is run again for each reader,
+	* so that each one sees the flags pending:
+	* mrs, an undefined instruction whose handler
+	* returns with movs pc, lr and each condition
+	*/
+	TEST_CASE(DeferredFlagsMatchEveryReader) {
+		Assembler code{};
+
+		code.LoadImm(5, RESULTS);
+
+		for (u32 pos = 0; pos < flag_cases.size(); pos++) {
+			auto const& flag_case = flag_cases[pos];
+			i32 results = i32(pos * FLAG_RESULTS);
+
+			RunFlagCase(code, flag_case);
+			code.Str(0, 5, results);
+			code.Word(MRS_R7);
+			code.Str(7, 5, results + 4);
+
+			RunFlagCase(code, flag_case);
+			code.Word(UNDEFINED);
+			code.Word(MRS_R7);
+			code.Str(7, 5, results + 8);
+
+			for (u8 cond = 0; cond < 0xE; cond++) {
+				RunFlagCase(code, flag_case);
+				code.Mov(6, 0);
+				code.Mov(6, 1, Condition(cond));
+				code.Str(6, 5, results + 12 + cond * 4);
+			}
+		}
+
+		code.Mov(0, 1);
+		code.Str(0, 5, i32(flag_cases.size() * FLAG_RESULTS));
+		code.Hang();
+
+		TestRom rom{ code };
+		auto emu = rom.Boot();
+
+		RunFrames(*emu, 1);
+
+		CHECK_EQ(ReadWord(*emu, RESULTS + flag_cases.size() * FLAG_RESULTS), 1u);
+
+		for (u32 pos = 0; pos < flag_cases.size(); pos++) {
+			auto const& flag_case = flag_cases[pos];
+			u32 results = RESULTS + pos * FLAG_RESULTS;
+
+			CHECK_EQ(ReadWord(*emu, results), flag_case.result);
+			CHECK_EQ(ReadWord(*emu, results + 4) >> 28, u32(flag_case.nzcv));
+			CHECK_EQ(ReadWord(*emu, results + 8) >> 28, u32(flag_case.nzcv));
+
+			for (u8 cond = 0; cond < 0xE; cond++) {
+				u32 passed = ReadWord(*emu, results + 12 + cond * 4);
+				CHECK_EQ(passed, u32(PassesCondition(cond, flag_case.nzcv)));
+			}
+		}
+	}
+
+	namespace {
+		static constexpr u32 PATCH_CALLS = 40;
+
+		/*
+		* The routine stores r1 over the instruction
+		* at start + 16 through patch, past what the
+		* pipeline has fetched, then runs into it
+		* without branching. It returns r0
+		*/
+		struct PatchedRoutine {
+			u32 start;
+			u32 patch;
+		};
+
+		static constexpr std::array<PatchedRoutine, 3> patched_routines{ {
+			//Inside one page
+			{ 0x02000100, 0x02000110 },
+			//Into the next page
+			{ 0x02003FF8, 0x02004008 },
+			//Off the end of EWRAM into its mirror,
+			//patched through the first copy
+			{ 0x0203FFF8, 0x02000008 }
+		} };
+
+		void WriteCodeWord(Assembler& code, u32 address, u32 value) {
+			code.LoadImm(0, value);
+			code.LoadImm(1, address);
+			code.Str(0, 1, 0);
+		}
+
+		void WritePatchedRoutine(Assembler& code, PatchedRoutine const& routine) {
+			//str r1, [r2]; mov r0, r0 x3; mov r0, #0; bx lr
+			WriteCodeWord(code, routine.start, 0xE5821000);
+
+			for (u32 nop = 1; nop < 4; nop++)
+				WriteCodeWord(code, routine.start + nop * 4, 0xE1A00000);
+
+			WriteCodeWord(code, routine.patch, 0xE3A00000);
+			WriteCodeWord(code, routine.patch + 4, 0xE12FFF1E);
+		}
+	}
+
+	TEST_CASE(CodeWindowSeesPatchedCode) {
+		Assembler code{};
+
+		code.LoadImm(5, RESULTS);
+
+		for (auto const& routine : patched_routines) {
+			WritePatchedRoutine(code, routine);
+
+			auto call = code.NewLabel();
+
+			//Every call patches in mov r0, #call
+			code.LoadImm(2, routine.patch);
+			code.LoadImm(4, routine.start);
+			code.Mov(6, 1);
+
+			code.Bind(call);
+			code.LoadImm(1, 0xE3A00000);
+			code.OrrReg(1, 1, 6);
+			code.Call(4);
+			code.Str(0, 5, 0);
+			code.Add(5, 5, 4);
+			code.Add(6, 6, 1);
+			code.Cmp(6, PATCH_CALLS + 1);
+			code.B(call, NE);
+		}
+
+		code.Mov(0, 1);
+		code.Str(0, 5, 0);
+		code.Hang();
+
+		TestRom rom{ code };
+
+		for (auto mode : { cpu::ExecutionMode::INTERPRETER, cpu::ExecutionMode::JIT,
+			cpu::ExecutionMode::JIT_LOCKSTEP }) {
+			auto emu = rom.Boot();
+			emu->GetContext().processor.SetExecutionMode(mode);
+
+			RunFrames(*emu, 1);
+
+			u32 done = RESULTS + patched_routines.size() * PATCH_CALLS * 4;
+
+			CHECK_EQ(ReadWord(*emu, done), 1u);
+
+			for (u32 pos = 0; pos < patched_routines.size(); pos++) {
+				for (u32 call = 0; call < PATCH_CALLS; call++)
+					CHECK_EQ(ReadWord(*emu, RESULTS + (pos * PATCH_CALLS + call) * 4), call + 1);
+			}
+		}
+	}
+}
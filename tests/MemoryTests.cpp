@@ -0,0 +1,593 @@
+#include "Test.hpp"
+#include "TestRom.hpp"
+
+#include "../memory/EventScheduler.hpp"
+#include "../memory/MMIO.hpp"
+
+#include <algorithm>
+#include <array>
+#include <tuple>
+#include <vector>
+
+namespace GBA::test {
+	namespace {
+		static constexpr u32 RESULTS = 0x03004000;
+
+		struct Fired {
+			memory::EventType type;
+			uint64_t timestamp;
+		};
+
+		struct EventLog {
+			memory::EventScheduler* scheduler;
+			std::vector<Fired>* fired;
+			memory::EventType type;
+		};
+
+		void LogEvent(void* userdata) {
+			auto* log = static_cast<EventLog*>(userdata);
+			log->fired->push_back({ log->type, log->scheduler->GetTimestamp() });
+		}
+	}
+
+	TEST_CASE(EventHeapFiresInTimestampOrder) {
+		static constexpr u32 TYPES = u32(memory::EventType::EVENT_MAX);
+
+		memory::EventScheduler scheduler{};
+		std::vector<Fired> fired{};
+		std::array<EventLog, TYPES> logs{};
+
+		//Trigger timestamp, scheduling order and type of every pending event
+		std::vector<std::tuple<uint64_t, u32, u32>> expected{};
+		std::array<std::size_t, TYPES> expected_pos{};
+		u32 order = 0;
+
+		u32 seed = 0x1234567;
+
+		auto random = [&seed](u32 range) {
+			seed = seed * 1103515245 + 12345;
+			return (seed >> 16) % range;
+		};
+
+		//Several types share a timestamp
+		for (u32 type = 0; type < TYPES; type++) {
+			logs[type] = { &scheduler, &fired, memory::EventType(type) };
+
+			u32 cycles = 1 + random(8) * 4;
+
+			CHECK(scheduler.Schedule(cycles, memory::EventType(type), &LogEvent, &logs[type]));
+			expected_pos[type] = expected.size();
+			expected.push_back({ cycles, order++, type });
+		}
+
+		//Pending types are refused unless moved
+		CHECK(!scheduler.Schedule(100, memory::EventType::HBLANK, &LogEvent, &logs[0]));
+
+		CHECK(scheduler.Deschedule(memory::EventType::TIMER_2_INC));
+		std::get<0>(expected[expected_pos[u32(memory::EventType::TIMER_2_INC)]]) = ~0ull;
+
+		CHECK(scheduler.Reschedule(memory::EventType::VBLANK, 2));
+		expected[expected_pos[u32(memory::EventType::VBLANK)]] = { 2, order++, u32(memory::EventType::VBLANK) };
+
+		CHECK(scheduler.Schedule(5, memory::EventType::APU_SAMPLE_OUT, &LogEvent,
+			&logs[u32(memory::EventType::APU_SAMPLE_OUT)], true));
+		expected[expected_pos[u32(memory::EventType::APU_SAMPLE_OUT)]] =
+			{ 5, order++, u32(memory::EventType::APU_SAMPLE_OUT) };
+
+		std::sort(expected.begin(), expected.end());
+
+		CHECK_EQ(scheduler.GetFirstEvent().trigger_timestamp, std::get<0>(expected[0]));
+
+		for (u32 cycle = 0; cycle < 64; cycle++)
+			scheduler.Advance(1);
+
+		CHECK_EQ(fired.size(), std::size_t(TYPES - 1));
+
+		for (std::size_t pos = 0; pos < fired.size() && pos < expected.size(); pos++) {
+			CHECK_EQ(u32(fired[pos].type), std::get<2>(expected[pos]));
+			CHECK_EQ(fired[pos].timestamp, std::get<0>(expected[pos]));
+		}
+
+		CHECK_EQ(scheduler.GetFirstEvent().trigger_timestamp, ~0ull);
+	}
+
+	namespace {
+		static constexpr u32 ROM_READS = 64;
+
+		/*
+		* Cycles taken by a loop of ROM reads,
+		* counted by timer 1, r0 = result
+		*/
+		void TimeRomReads(Assembler& code) {
+			auto loop = code.NewLabel();
+
+			code.Add(3, 4, 0x100);
+			code.Mov(0, 0);
+			code.Strh(0, 3, 6);
+			code.Mov(0, 0x80);
+			code.Strh(0, 3, 6);
+
+			code.Mov(2, ROM_READS);
+			code.Bind(loop);
+			code.Ldr(1, 8, 0);
+			code.Sub(2, 2, 1, true);
+			code.B(loop, NE);
+
+			code.Ldrh(0, 3, 4);
+		}
+	}
+
+	TEST_CASE(WaitcntChangesRomTiming) {
+		Assembler code{};
+
+		code.LoadImm(4, REG_BASE);
+		code.LoadImm(5, RESULTS);
+		code.LoadImm(8, CODE_START);
+
+		//Default, then WS0 3/1 with prefetch, then back
+		for (u32 waitcnt : { 0x0000u, 0x4014u, 0x0000u }) {
+			code.Add(3, 4, 0x200);
+			code.LoadImm(0, waitcnt);
+			code.Strh(0, 3, 4);
+
+			TimeRomReads(code);
+			code.Str(0, 5, 0);
+			code.Add(5, 5, 4);
+		}
+
+		code.Hang();
+
+		TestRom rom{ code };
+		auto emu = rom.Boot();
+
+		RunFrames(*emu, 1);
+
+		u32 slow = ReadWord(*emu, RESULTS);
+		u32 fast = ReadWord(*emu, RESULTS + 4);
+
+		CHECK(slow > ROM_READS * 8);
+		CHECK(fast * 4 < slow * 3);
+		CHECK_EQ(ReadWord(*emu, RESULTS + 8), slow);
+	}
+
+	TEST_CASE(MmioDispatchesEveryCallback) {
+		static constexpr u16 REGISTERS = 300;
+
+		memory::MMIO mmio{};
+
+		std::array<u8, REGISTERS> backing{};
+		std::array<u16, REGISTERS> written{};
+
+		//More callbacks than a byte can index
+		for (u16 offset = 0; offset < REGISTERS; offset++) {
+			mmio.AddRegister<u8>(offset, true, true, &backing[offset], 0xFF,
+				[&written, offset](u8 value, u16 pos) {
+					written[offset] = u16((pos << 8) | value);
+				});
+		}
+
+		std::array<u8, 4> plain{};
+		mmio.AddRegister<u32>(0x400, true, true, plain.data(), 0x00FFFFFF);
+
+		for (u16 offset = 0; offset < REGISTERS; offset += 2)
+			mmio.Write<u16>(offset, u16(offset * 3));
+
+		bool dispatched = true;
+
+		for (u16 offset = 0; offset < REGISTERS; offset++) {
+			u8 value = u8((offset & ~1) * 3 >> ((offset & 1) * 8));
+			dispatched = dispatched && written[offset] == u16((offset << 8) | value);
+		}
+
+		CHECK(dispatched);
+
+		//Masked word path for plain registers
+		mmio.Write<u32>(0x400, 0xAABBCCDD);
+		CHECK_EQ(mmio.Read<u32>(0x400), 0x00BBCCDDu);
+		CHECK_EQ(mmio.Read<u16>(0x402), u16(0x00BB));
+	}
+
+	namespace {
+		/*
+		* Written through one address, read through
+		* the other, canonical is where the debugger
+		* finds it, it does not resolve mirrors
+		*/
+		struct Alias {
+			u32 write;
+			u32 read;
+			u32 canonical;
+			u32 size;
+		};
+
+		static constexpr std::array<Alias, 15> aliases{ {
+			//EWRAM, 256 KB mirrored up to 0x02FFFFFF
+			{ 0x02040010, 0x02000010, 0x02000010, 4 },
+			{ 0x02FFFFF0, 0x0203FFF0, 0x0203FFF0, 4 },
+			{ 0x02000020, 0x02A40020, 0x02000020, 2 },
+			{ 0x02080030, 0x02000031, 0x02000030, 1 },
+			//IWRAM, 32 KB mirrored up to 0x03FFFFFF
+			{ 0x03008010, 0x03000010, 0x03000010, 4 },
+			{ 0x03FFA000, 0x03002000, 0x03002000, 4 },
+			{ 0x03000022, 0x03F08022, 0x03000022, 2 },
+			{ 0x03010030, 0x03000033, 0x03000030, 1 },
+			//VRAM, 96 KB mirrored every 128 KB
+			{ 0x06020010, 0x06000010, 0x06000010, 4 },
+			{ 0x06000014, 0x06FE0014, 0x06000014, 2 },
+			//The last 32 KB of each mirror are OBJ VRAM again
+			{ 0x06018010, 0x06010010, 0x06010010, 4 },
+			{ 0x0601FFFC, 0x06017FFC, 0x06017FFC, 4 },
+			{ 0x06014020, 0x0603C020, 0x06014020, 2 },
+			{ 0x06FF8040, 0x06010040, 0x06010040, 4 },
+			{ 0x0601C050, 0x06014052, 0x06014050, 1 }
+		} };
+
+		u32 AliasValue(u32 pos) {
+			return 0x11223344 + pos * 0x01030507;
+		}
+
+	}
+
+	TEST_CASE(MirrorsReachTheSameMemory) {
+		Assembler code{};
+
+		code.LoadImm(5, RESULTS);
+
+		for (u32 pos = 0; pos < aliases.size(); pos++) {
+			auto const& alias = aliases[pos];
+
+			code.LoadImm(1, alias.write);
+			code.LoadImm(2, alias.read);
+			code.LoadImm(0, AliasValue(pos));
+
+			//VRAM byte writes fill a halfword,
+			//write whole words and read bytes
+			if (alias.size == 2)
+				code.Strh(0, 1, 0);
+			else
+				code.Str(0, 1, 0);
+
+			if (alias.size == 1)
+				code.Ldrb(3, 2, 0);
+			else if (alias.size == 2)
+				code.Ldrh(3, 2, 0);
+			else
+				code.Ldr(3, 2, 0);
+
+			code.Str(3, 5, i32(pos * 4));
+		}
+
+		code.Mov(0, 1);
+		code.Str(0, 5, i32(aliases.size() * 4));
+		code.Hang();
+
+		TestRom rom{ code };
+		auto emu = rom.Boot();
+
+		RunFrames(*emu, 1);
+
+		CHECK_EQ(ReadWord(*emu, RESULTS + aliases.size() * 4), 1u);
+
+		for (u32 pos = 0; pos < aliases.size(); pos++) {
+			auto const& alias = aliases[pos];
+
+			u32 value = AliasValue(pos);
+
+			//Bytes are read from within the written word
+			if (alias.size == 1)
+				CHECK_EQ(ReadWord(*emu, RESULTS + pos * 4), (value >> ((alias.read & 3) * 8)) & 0xFF);
+			else if (alias.size == 2)
+				CHECK_EQ(ReadWord(*emu, RESULTS + pos * 4), value & 0xFFFF);
+			else
+				CHECK_EQ(ReadWord(*emu, RESULTS + pos * 4), value);
+
+			if (alias.size == 2)
+				CHECK_EQ(ReadHalf(*emu, alias.canonical), u16(value));
+			else
+				CHECK_EQ(ReadWord(*emu, alias.canonical), value);
+		}
+	}
+
+	TEST_CASE(TimerIrqToggleKeepsPrescalerPhase) {
+		Assembler code{};
+
+		code.LoadImm(4, REG_BASE);
+		code.LoadImm(5, RESULTS);
+		code.Add(3, 4, 0x100);
+
+		/*
+		* Timer 0 runs with prescaler 64. In the
+		* first pass of each pair its IRQ bit is
+		* set halfway, the second pass stores the
+		* same value to the stopped timer 1 instead
+		*/
+		for (u32 delay = 1; delay <= 8; delay++) {
+			for (u32 target : { 2u, 6u }) {
+				auto first = code.NewLabel();
+				auto second = code.NewLabel();
+
+				code.Mov(0, 0);
+				code.Strh(0, 3, 2);
+				code.Strh(0, 3, 0);
+				code.Mov(0, 0x81);
+				code.Strh(0, 3, 2);
+
+				code.Mov(2, delay);
+				code.Bind(first);
+				code.Sub(2, 2, 1, true);
+				code.B(first, NE);
+
+				code.Mov(0, 0xC1);
+				code.Strh(0, 3, target);
+
+				code.Mov(2, 8);
+				code.Bind(second);
+				code.Sub(2, 2, 1, true);
+				code.B(second, NE);
+
+				code.Ldrh(0, 3, 0);
+				code.Str(0, 5, 0);
+				code.Add(5, 5, 4);
+
+				code.Mov(0, 0);
+				code.Strh(0, 3, 6);
+			}
+		}
+
+		code.Hang();
+
+		TestRom rom{ code };
+		auto emu = rom.Boot();
+
+		RunFrames(*emu, 1);
+
+		for (u32 delay = 0; delay < 8; delay++) {
+			u32 toggled = ReadWord(*emu, RESULTS + delay * 8);
+
+			CHECK(toggled != 0);
+			CHECK_EQ(toggled, ReadWord(*emu, RESULTS + delay * 8 + 4));
+		}
+	}
+
+	namespace {
+		static constexpr u32 OVERFLOW_COUNT = 0x03005000;
+		static constexpr u32 OVERFLOWS = 40;
+	}
+
+	TEST_CASE(CascadedTimersCountOverflows) {
+		Assembler code{};
+
+		auto handler = code.NewLabel();
+		auto start = code.NewLabel();
+		auto wait = code.NewLabel();
+		auto drain = code.NewLabel();
+
+		code.B(start);
+
+		code.Bind(handler);
+		code.Add(3, 0, 0x200);
+		code.Mov(1, 8);
+		code.Strh(1, 3, 2);
+		code.LoadImm(3, OVERFLOW_COUNT);
+		code.Ldr(1, 3, 0);
+		code.Add(1, 1, 1);
+		code.Str(1, 3, 0);
+		code.Bx(14);
+
+		code.Bind(start);
+		code.LoadImm(0, code.AddressOf(handler));
+		code.LoadImm(1, IRQ_VECTOR);
+		code.Str(0, 1, 0);
+
+		code.LoadImm(4, REG_BASE);
+		code.LoadImm(5, RESULTS);
+		code.LoadImm(6, OVERFLOW_COUNT);
+
+		code.Add(3, 4, 0x200);
+		code.Mov(0, 8);
+		code.Strh(0, 3, 0);
+		code.Mov(0, 1);
+		code.Strh(0, 3, 8);
+
+		//Timer 2 counts overflows of timer 1 (every 8),
+		//which counts overflows of timer 0 (every 256 cycles)
+		code.Add(3, 4, 0x100);
+		code.Mov(0, 0x84);
+		code.Strh(0, 3, 10);
+		code.LoadImm(0, 0xFFF8);
+		code.Strh(0, 3, 4);
+
+		//Only a timer started in normal mode loads
+		//its reload value, prescaler 1024 keeps it
+		code.Mov(0, 0x83);
+		code.Strh(0, 3, 6);
+		code.Mov(0, 0x84);
+		code.Strh(0, 3, 6);
+		code.LoadImm(0, 0xFF00);
+		code.Strh(0, 3, 0);
+		code.Mov(0, 0xC0);
+		code.Strh(0, 3, 2);
+
+		code.Bind(wait);
+		code.Ldr(1, 6, 0);
+		code.Cmp(1, OVERFLOWS);
+		code.B(wait, NE);
+
+		//Stop timer 0 and let a last IRQ be handled
+		code.Mov(0, 0);
+		code.Strh(0, 3, 2);
+
+		code.Mov(2, 16);
+		code.Bind(drain);
+		code.Sub(2, 2, 1, true);
+		code.B(drain, NE);
+
+		code.Ldrh(0, 3, 4);
+		code.Str(0, 5, 0);
+		code.Ldrh(0, 3, 8);
+		code.Str(0, 5, 4);
+		code.Ldr(0, 6, 0);
+		code.Str(0, 5, 8);
+		code.Hang();
+
+		TestRom rom{ code };
+		auto emu = rom.Boot();
+
+		RunFrames(*emu, 2);
+
+		u32 timer1 = ReadWord(*emu, RESULTS);
+		u32 timer2 = ReadWord(*emu, RESULTS + 4);
+		u32 handled = ReadWord(*emu, RESULTS + 8);
+
+		CHECK(handled >= OVERFLOWS);
+		CHECK(timer1 >= 0xFFF8);
+		CHECK_EQ(timer2 * 8 + (timer1 - 0xFFF8), handled);
+	}
+
+	namespace {
+		static constexpr u32 DMA_SOURCE = 0x03002000;
+		static constexpr u32 DMA_WORDS = 128;
+
+		static constexpr u32 EWRAM = 0x02000000;
+
+		//32 bit, enabled, started immediately
+		static constexpr u16 DMA_WORD = 0x8400;
+		static constexpr u16 DMA_HALF = 0x8000;
+		static constexpr u16 DMA_DEST_DEC = 1 << 5;
+		static constexpr u16 DMA_SOURCE_FIXED = 2 << 7;
+
+		//Runs DMA 3, r4 = REG_BASE
+		void StartDma3(Assembler& code, u32 source, u32 dest, u16 count, u16 control) {
+			code.Add(3, 4, 0xD4);
+			code.LoadImm(0, source);
+			code.Str(0, 3, 0);
+			code.LoadImm(0, dest);
+			code.Str(0, 3, 4);
+			code.LoadImm(0, count | (u32(control) << 16));
+			code.Str(0, 3, 8);
+		}
+
+		//DMA_SOURCE[i] = i + 0x100
+		void FillDmaSource(Assembler& code) {
+			auto fill = code.NewLabel();
+
+			code.LoadImm(6, DMA_SOURCE);
+			code.LoadImm(0, 0x100);
+			code.Mov(2, DMA_WORDS);
+
+			code.Bind(fill);
+			code.Str(0, 6, 0);
+			code.Add(6, 6, 4);
+			code.Add(0, 0, 1);
+			code.Sub(2, 2, 1, true);
+			code.B(fill, NE);
+		}
+	}
+
+	TEST_CASE(DmaCopiesBetweenRamRegions) {
+		static constexpr u32 COPY = EWRAM;
+		static constexpr u32 FILL = EWRAM + 0x1000;
+		static constexpr u32 REVERSED = EWRAM + 0x2000;
+		static constexpr u32 HALVES = 0x06000000;
+
+		Assembler code{};
+
+		code.LoadImm(4, REG_BASE);
+		code.LoadImm(5, RESULTS);
+
+		FillDmaSource(code);
+
+		StartDma3(code, DMA_SOURCE, COPY, DMA_WORDS, DMA_WORD);
+		StartDma3(code, DMA_SOURCE + 8, FILL, 32, DMA_WORD | DMA_SOURCE_FIXED);
+		StartDma3(code, DMA_SOURCE, REVERSED + 15 * 4, 16, DMA_WORD | DMA_DEST_DEC);
+		StartDma3(code, DMA_SOURCE, HALVES, 2 * 16, DMA_HALF);
+
+		//Overlapping, each unit reads what the previous one wrote
+		StartDma3(code, DMA_SOURCE, DMA_SOURCE + 4, 8, DMA_WORD);
+
+		code.Mov(0, 1);
+		code.Str(0, 5, 0);
+		code.Hang();
+
+		TestRom rom{ code };
+		auto emu = rom.Boot();
+
+		RunFrames(*emu, 1);
+
+		CHECK_EQ(ReadWord(*emu, RESULTS), 1u);
+
+		for (u32 word = 0; word < DMA_WORDS; word++)
+			CHECK_EQ(ReadWord(*emu, COPY + word * 4), word + 0x100);
+
+		for (u32 word = 0; word < 32; word++)
+			CHECK_EQ(ReadWord(*emu, FILL + word * 4), 0x102u);
+
+		for (u32 word = 0; word < 16; word++)
+			CHECK_EQ(ReadWord(*emu, REVERSED + word * 4), 15 - word + 0x100);
+
+		for (u32 word = 0; word < 16; word++)
+			CHECK_EQ(ReadWord(*emu, HALVES + word * 4), word + 0x100);
+
+		for (u32 word = 0; word <= 8; word++)
+			CHECK_EQ(ReadWord(*emu, DMA_SOURCE + word * 4), 0x100u);
+
+		CHECK_EQ(ReadWord(*emu, DMA_SOURCE + 9 * 4), 0x109u);
+	}
+
+	TEST_CASE(DmaChargesEveryUnit) {
+		struct Transfer {
+			u32 dest;
+			u16 control;
+		};
+
+		static constexpr u32 SHORT = 32;
+		static constexpr u32 LONG = 96;
+
+		static constexpr std::array<Transfer, 3> transfers{ {
+			{ 0x03003000, DMA_WORD },
+			{ EWRAM, DMA_WORD },
+			{ EWRAM, DMA_HALF }
+		} };
+
+		Assembler code{};
+
+		code.LoadImm(4, REG_BASE);
+		code.LoadImm(5, RESULTS);
+
+		FillDmaSource(code);
+
+		//Timer 1 counts the cycles of each transfer
+		for (auto const& transfer : transfers) {
+			for (u32 count : { SHORT, LONG }) {
+				code.Add(7, 4, 0x100);
+				code.Mov(0, 0);
+				code.Strh(0, 7, 6);
+				code.Mov(0, 0x80);
+				code.Strh(0, 7, 6);
+
+				StartDma3(code, DMA_SOURCE, transfer.dest, u16(count), transfer.control);
+
+				code.Ldrh(0, 7, 4);
+				code.Str(0, 5, 0);
+				code.Add(5, 5, 4);
+			}
+		}
+
+		code.Hang();
+
+		TestRom rom{ code };
+		auto emu = rom.Boot();
+
+		RunFrames(*emu, 1);
+
+		//IWRAM takes 1 cycle per unit, EWRAM 3 per halfword
+		static constexpr std::array<u32, 3> unit_cycles{ 2, 7, 4 };
+
+		for (u32 pos = 0; pos < transfers.size(); pos++) {
+			u32 short_cycles = ReadWord(*emu, RESULTS + pos * 8);
+			u32 long_cycles = ReadWord(*emu, RESULTS + pos * 8 + 4);
+
+			CHECK_EQ(long_cycles - short_cycles, (LONG - SHORT) * unit_cycles[pos]);
+		}
+	}
+}
@@ -0,0 +1,560 @@
+#include "Test.hpp"
+#include "TestRom.hpp"
+
+#include "../ppu/Compositor.hpp"
+#include "../ppu/PPU.hpp"
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <vector>
+
+namespace GBA::test {
+	namespace {
+		static constexpr u32 DISPCNT = REG_BASE;
+		static constexpr u32 VRAM = 0x06000000;
+
+		//Nothing to run, the tests set up the PPU through the bus
+		TestRom IdleRom() {
+			Assembler code{};
+			code.Hang();
+			return TestRom{ code };
+		}
+
+		u32 ReadPixel(ppu::Frame const& frame, u32 x, u32 y) {
+			u8 const* line = frame.data + y * frame.stride;
+
+			if (frame.format == ppu::FrameFormat::RGB555)
+				return reinterpret_cast<u16 const*>(line)[x];
+
+			return reinterpret_cast<u32 const*>(line)[x];
+		}
+
+		//Bit 15 set on some, the frame drops it
+		u16 BitmapColor(u32 x, u32 y) {
+			return u16(x * 37 + y * 1031);
+		}
+
+		//Mode 3 with BG2 showing BitmapColor
+		void DrawBitmap(emulation::Emulator& emu) {
+			WriteHalf(emu, DISPCNT, 0x0403);
+
+			for (u32 y = 0; y < 160; y++) {
+				for (u32 x = 0; x < 240; x++)
+					WriteHalf(emu, VRAM + (y * 240 + x) * 2, BitmapColor(x, y));
+			}
+		}
+
+		u32 ExpandChannel(u32 value) {
+			return (value << 3) | (value >> 2);
+		}
+
+		u32 ToRGBA8888(u16 color) {
+			return ExpandChannel(color & 0x1F) | (ExpandChannel((color >> 5) & 0x1F) << 8) |
+				(ExpandChannel((color >> 10) & 0x1F) << 16) | 0xFF000000;
+		}
+	}
+
+	TEST_CASE(FrameFormatsMatchVram) {
+		struct Output {
+			ppu::FrameFormat format;
+			u32 stride;
+			u32 expected_stride;
+		};
+
+		//Too small strides pack the lines
+		static constexpr std::array<Output, 5> outputs{ {
+			{ ppu::FrameFormat::RGB555, 0, 480 },
+			{ ppu::FrameFormat::RGB555, 512, 512 },
+			{ ppu::FrameFormat::RGBA8888, 0, 960 },
+			{ ppu::FrameFormat::RGBA8888, 1030, 1032 },
+			{ ppu::FrameFormat::RGB555, 100, 480 }
+		} };
+
+		auto rom = IdleRom();
+		auto emu = rom.Boot();
+		auto& ppu = emu->GetContext().ppu;
+
+		DrawBitmap(*emu);
+
+		for (auto const& output : outputs) {
+			ppu.SetFrameFormat(output.format, output.stride);
+
+			RunFrames(*emu, 1);
+
+			auto frame = ppu.GetFrame();
+
+			CHECK_EQ(u32(frame.format), u32(output.format));
+			CHECK_EQ(frame.stride, output.expected_stride);
+
+			u32 mismatches = 0;
+
+			for (u32 y = 0; y < 160; y++) {
+				for (u32 x = 0; x < 240; x++) {
+					u16 color = BitmapColor(x, y) & 0x7FFF;
+					u32 expected = output.format == ppu::FrameFormat::RGB555 ?
+						color : ToRGBA8888(color);
+
+					mismatches += ReadPixel(frame, x, y) != expected;
+				}
+			}
+
+			CHECK_EQ(mismatches, 0u);
+		}
+	}
+
+	namespace {
+		struct RandomLine {
+			std::array<std::array<ppu::Pixel, 240>, 4> backgrounds;
+			std::array<ppu::Pixel, 240> sprites;
+			std::array<u8, 240> window_masks;
+			ppu::compositor::Layers layers;
+		};
+
+		class Random {
+		public :
+			Random(u32 seed) : m_seed{ seed } {}
+
+			u32 Next(u32 range) {
+				m_seed = m_seed * 1103515245 + 12345;
+				return (m_seed >> 8) % range;
+			}
+
+		private :
+			u32 m_seed;
+		};
+
+		ppu::Pixel RandomPixel(Random& random, bool sprite) {
+			ppu::Pixel pixel{};
+
+			pixel.is_present = random.Next(4) != 0;
+			pixel.is_bld_enabled = sprite && random.Next(4) == 0;
+			pixel.palette_id = random.Next(4) ? i16(1 + random.Next(255)) : 0;
+			pixel.color = u16(random.Next(0x8000));
+			pixel.priority = u8(random.Next(4));
+
+			return pixel;
+		}
+
+		/*
+		* Any mix of layers, windows and effects the
+		* PPU can set up, keys ordered as it sorts BGs
+		*/
+		void FillLine(Random& random, RandomLine& line) {
+			for (auto& background : line.backgrounds)
+				std::generate(background.begin(), background.end(),
+					[&]() { return RandomPixel(random, false); });
+
+			std::generate(line.sprites.begin(), line.sprites.end(),
+				[&]() { return RandomPixel(random, true); });
+
+			//Mostly all enabled, windows cover runs of pixels
+			u8 mask = 0x3F;
+
+			for (auto& window_mask : line.window_masks) {
+				if (random.Next(16) == 0)
+					mask = random.Next(2) ? 0x3F : u8(random.Next(0x40));
+
+				window_mask = mask;
+			}
+
+			auto& layers = line.layers;
+
+			std::array<u32, 4> priorities{};
+			std::array<u32, 4> order{};
+
+			for (auto& priority : priorities)
+				priority = random.Next(4);
+
+			std::iota(order.begin(), order.end(), 0);
+			std::stable_sort(order.begin(), order.end(), [&](u32 a, u32 b) {
+				return priorities[a] < priorities[b];
+			});
+
+			for (u32 place = 0; place < 4; place++) {
+				u32 bg = order[place];
+
+				layers.backgrounds[bg] = line.backgrounds[bg].data();
+				layers.keys[bg] = random.Next(5) ? u16((priorities[bg] << 3) | (place + 1)) :
+					ppu::compositor::HIDDEN;
+			}
+
+			layers.sprites = line.sprites.data();
+			layers.window_masks = line.window_masks.data();
+
+			layers.first_target = u16(random.Next(0x40));
+			layers.second_target = u16(random.Next(0x40));
+			layers.effect = u16(random.Next(4));
+			layers.backdrop = u16(random.Next(0x8000));
+
+			layers.eva = u16(random.Next(17));
+			layers.evb = u16(random.Next(17));
+			layers.evy = u16(random.Next(17));
+		}
+	}
+
+	TEST_CASE(ComposersMatchScalar) {
+		static constexpr u32 LINES = 4000;
+
+		auto composers = ppu::compositor::GetSupportedComposers();
+
+		CHECK(!composers.empty());
+
+		if (composers.size() < 2)
+			return;
+
+		Random random{ 0xC0FFEE };
+		RandomLine line{};
+
+		std::array<u16, 240> expected{};
+		std::array<u16, 240> colors{};
+
+		std::vector<u32> mismatches(composers.size());
+
+		for (u32 count = 0; count < LINES; count++) {
+			FillLine(random, line);
+
+			composers[0](line.layers, expected.data());
+
+			for (std::size_t kernel = 1; kernel < composers.size(); kernel++) {
+				colors.fill(0xFFFF);
+				composers[kernel](line.layers, colors.data());
+
+				mismatches[kernel] += !std::equal(colors.begin(), colors.end(), expected.begin());
+			}
+		}
+
+		for (std::size_t kernel = 1; kernel < composers.size(); kernel++)
+			CHECK_EQ(mismatches[kernel], 0u);
+	}
+
+	namespace {
+		static constexpr u32 PALETTE = 0x05000000;
+		static constexpr u32 OAM = 0x07000000;
+
+		static constexpr u32 BG_TILE = VRAM + 0x20;
+		static constexpr u32 OBJ_TILE = VRAM + 0x10000;
+		static constexpr u32 BG_MAP = VRAM + 0x4000;
+
+		static constexpr u32 DMA_SOURCE = 0x03002000;
+
+		using Tile = std::array<u8, 32>;
+
+		u16 BgColor(u32 index) {
+			return u16(index * 0x0421);
+		}
+
+		u16 ObjColor(u32 index) {
+			return u16((index << 10) | 0x1F);
+		}
+
+		u32 TileIndex(Tile const& tile, u32 x, u32 y) {
+			return (tile[y * 4 + x / 2] >> ((x & 1) * 4)) & 0xF;
+		}
+
+		/*
+		* BG0 filled with tile 1, every other column
+		* mirrored, an OBJ in the top left corner
+		* mirrored too. Returns RGB555 as expected
+		*/
+		u16 TileScenePixel(Tile const& bg, Tile const& obj, u32 x, u32 y) {
+			if (x < 8 && y < 8) {
+				u32 index = TileIndex(obj, 7 - x, y);
+
+				if (index)
+					return ObjColor(index);
+			}
+
+			u32 column = x % 8;
+
+			if ((x / 8) & 1)
+				column = 7 - column;
+
+			//Transparent shows the backdrop, BgColor(0)
+			return BgColor(TileIndex(bg, column, y % 8));
+		}
+
+		void WriteTile(emulation::Emulator& emu, u32 address, Tile const& tile) {
+			for (u32 pos = 0; pos < tile.size(); pos += 2)
+				WriteHalf(emu, address + pos, u16(tile[pos] | (tile[pos + 1] << 8)));
+		}
+
+		void SetUpTileScene(emulation::Emulator& emu, Tile const& bg, Tile const& obj) {
+			for (u32 index = 0; index < 16; index++) {
+				WriteHalf(emu, PALETTE + index * 2, BgColor(index));
+				WriteHalf(emu, PALETTE + 0x200 + index * 2, ObjColor(index));
+			}
+
+			WriteTile(emu, BG_TILE, bg);
+			WriteTile(emu, OBJ_TILE, obj);
+
+			//Map block 8, tile 1, odd columns flipped
+			for (u32 entry = 0; entry < 32 * 32; entry++)
+				WriteHalf(emu, BG_MAP + entry * 2, u16(1 | (((entry % 32) & 1) << 10)));
+
+			//OBJ 0 at 0, 0 mirrored, the others off
+			WriteHalf(emu, OAM, 0x0000);
+			WriteHalf(emu, OAM + 2, 0x1000);
+			WriteHalf(emu, OAM + 4, 0x0000);
+
+			for (u32 obj = 1; obj < 128; obj++)
+				WriteHalf(emu, OAM + obj * 8, 0x0200);
+
+			//BG0 on map block 8, 1D OBJ mapping
+			WriteHalf(emu, REG_BASE + 0x08, 0x0800);
+			WriteHalf(emu, DISPCNT, 0x1140);
+		}
+
+		u32 CountWrongPixels(emulation::Emulator& emu, Tile const& bg, Tile const& obj) {
+			auto frame = emu.GetContext().ppu.GetFrame();
+			u32 wrong = 0;
+
+			for (u32 y = 0; y < 160; y++) {
+				for (u32 x = 0; x < 240; x++)
+					wrong += ReadPixel(frame, x, y) != TileScenePixel(bg, obj, x, y);
+			}
+
+			return wrong;
+		}
+
+		void StartDma3(emulation::Emulator& emu, u32 source, u32 dest, u16 count, u16 control) {
+			WriteWord(emu, REG_BASE + 0xD4, source);
+			WriteWord(emu, REG_BASE + 0xD8, dest);
+			WriteWord(emu, REG_BASE + 0xDC, count | (u32(control) << 16));
+		}
+	}
+
+	TEST_CASE(TileCacheSeesVramWrites) {
+		Tile bg{};
+		Tile obj{};
+
+		//Asymmetric rows, so that mirroring shows
+		for (u32 pos = 0; pos < bg.size(); pos++) {
+			bg[pos] = u8(((pos * 3 + 1) & 0xF) | (((pos * 5 + 2) & 0xF) << 4));
+			obj[pos] = u8(((pos + 9) & 0xF) | (((pos * 7) & 0xF) << 4));
+		}
+
+		auto rom = IdleRom();
+		auto emu = rom.Boot();
+
+		//Bus writes take time, the first lines are
+		//drawn while the scene is being set up
+		SetUpTileScene(*emu, bg, obj);
+
+		RunFrames(*emu, 2);
+		CHECK_EQ(CountWrongPixels(*emu, bg, obj), 0u);
+
+		//Drawn once, so every row below is cached
+		bg[12] = 0x0F;
+		bg[13] = 0xA0;
+		WriteHalf(*emu, BG_TILE + 12, 0xA00F);
+
+		RunFrames(*emu, 1);
+		CHECK_EQ(CountWrongPixels(*emu, bg, obj), 0u);
+
+		for (u32 pos = 0; pos < obj.size(); pos++)
+			obj[pos] = u8(0x10 * (pos & 0xF) + 3);
+
+		for (u32 pos = 0; pos < obj.size(); pos += 2)
+			WriteHalf(*emu, DMA_SOURCE + pos, u16(obj[pos] | (obj[pos + 1] << 8)));
+
+		//Block DMA, 32 bit units
+		StartDma3(*emu, DMA_SOURCE, OBJ_TILE, 8, 0x8400);
+
+		RunFrames(*emu, 1);
+		CHECK_EQ(CountWrongPixels(*emu, bg, obj), 0u);
+
+		//Fill from a fixed source, 16 bit units
+		for (u32 pos = 0; pos < bg.size(); pos += 2) {
+			bg[pos] = 0x21;
+			bg[pos + 1] = 0x43;
+		}
+
+		WriteHalf(*emu, DMA_SOURCE, 0x4321);
+		StartDma3(*emu, DMA_SOURCE, BG_TILE, 16, 0x8100);
+
+		RunFrames(*emu, 1);
+		CHECK_EQ(CountWrongPixels(*emu, bg, obj), 0u);
+
+		obj[4] = 0x00;
+		obj[5] = 0x00;
+		obj[6] = 0x5E;
+		obj[7] = 0x00;
+		WriteWord(*emu, OBJ_TILE + 4, 0x005E0000);
+
+		RunFrames(*emu, 1);
+		CHECK_EQ(CountWrongPixels(*emu, bg, obj), 0u);
+	}
+
+	TEST_CASE(DirectOutputConvertsCurrentFrame) {
+		auto rom = IdleRom();
+		auto emu = rom.Boot();
+		auto& ppu = emu->GetContext().ppu;
+
+		DrawBitmap(*emu);
+		RunFrames(*emu, 2);
+
+		//Pixels of the current frame different from color(x, y)
+		auto count_wrong = [&ppu](auto color) {
+			auto frame = ppu.GetFrame();
+			u32 wrong = 0;
+
+			for (u32 y = 0; y < 160; y++) {
+				for (u32 x = 0; x < 240; x++)
+					wrong += ReadPixel(frame, x, y) != color(x, y);
+			}
+
+			return wrong;
+		};
+
+		auto raw = [](u32 x, u32 y) -> u32 {
+			return BitmapColor(x, y) & 0x7FFF;
+		};
+
+		auto rgba = [](u32 x, u32 y) -> u32 {
+			return ToRGBA8888(BitmapColor(x, y) & 0x7FFF);
+		};
+
+		CHECK_EQ(count_wrong(raw), 0u);
+
+		//The frame written without lookup is converted
+		ppu.SetColorCorrection(ppu::ColorCorrection::LCD);
+		CHECK(count_wrong(raw) > 240u * 160 / 2);
+
+		ppu.SetColorCorrection(ppu::ColorCorrection::None);
+		CHECK_EQ(count_wrong(raw), 0u);
+
+		ppu.SetFrameFormat(ppu::FrameFormat::RGBA8888);
+		CHECK_EQ(count_wrong(rgba), 0u);
+
+		ppu.SetFrameFormat(ppu::FrameFormat::RGB555, 512);
+		CHECK_EQ(count_wrong(raw), 0u);
+
+		//Forced blank
+		WriteHalf(*emu, DISPCNT, 0x0483);
+		RunFrames(*emu, 1);
+
+		CHECK_EQ(count_wrong([](u32, u32) -> u32 { return 0x7FFF; }), 0u);
+
+		ppu.SetFrameFormat(ppu::FrameFormat::RGBA8888);
+		CHECK_EQ(count_wrong([](u32, u32) -> u32 { return 0xFFFFFFFF; }), 0u);
+	}
+
+	namespace {
+		static constexpr u32 SCROLL_TABLE = 0x03003000;
+
+		/*
+		* Every line changes the BG0 scroll, a color,
+		* a tile row and the OBJ position, every frame
+		* switches between mode 0 and mode 1 with an
+		* affine BG2, HBLANK DMA sets the BG0 Y scroll
+		*/
+		TestRom MidFrameRom() {
+			Assembler code{};
+
+			auto loop = code.NewLabel();
+
+			code.LoadImm(4, REG_BASE);
+			code.LoadImm(5, PALETTE);
+			code.LoadImm(6, BG_TILE);
+			code.LoadImm(7, OAM);
+			code.LoadImm(9, 0x1140);
+			code.Mov(8, 0);
+			code.Mov(2, 0xFF);
+
+			code.Bind(loop);
+			code.Ldrh(1, 4, 6);
+			code.CmpReg(1, 2);
+			code.B(loop, EQ);
+			code.MovReg(2, 1);
+
+			code.AddReg(0, 1, 1);
+			code.AddReg(0, 0, 1);
+			code.AddReg(0, 0, 8);
+			code.Strh(0, 4, 0x10);
+			code.Strh(0, 5, 2);
+			code.Strh(0, 6, 12);
+			code.Strh(1, 7, 2);
+
+			code.Cmp(1, 160);
+			code.B(loop, NE);
+			code.Add(8, 8, 1);
+			code.Eor(9, 9, 0x400);
+			code.Eor(9, 9, 0x1);
+			code.Strh(9, 4, 0);
+			code.B(loop);
+
+			return TestRom{ code };
+		}
+
+		void SetUpMidFrameScene(emulation::Emulator& emu) {
+			Tile bg{};
+			Tile obj{};
+
+			for (u32 pos = 0; pos < bg.size(); pos++) {
+				bg[pos] = u8(pos * 0x35 + 0x12);
+				obj[pos] = u8(pos * 0x1B + 0x21);
+			}
+
+			SetUpTileScene(emu, bg, obj);
+
+			//BG2 on the same blocks, rotated
+			WriteHalf(emu, REG_BASE + 0x0C, 0x0800);
+			WriteHalf(emu, REG_BASE + 0x20, 0x0100);
+			WriteHalf(emu, REG_BASE + 0x22, 0x0020);
+			WriteHalf(emu, REG_BASE + 0x24, 0xFFE0);
+			WriteHalf(emu, REG_BASE + 0x26, 0x0100);
+
+			for (u32 entry = 0; entry < 0x800; entry++)
+				WriteHalf(emu, SCROLL_TABLE + entry * 2, u16(entry * 7));
+
+			//DMA 0, 1 halfword per HBLANK to BG0VOFS, repeated
+			WriteWord(emu, REG_BASE + 0xB0, SCROLL_TABLE);
+			WriteWord(emu, REG_BASE + 0xB4, REG_BASE + 0x12);
+			WriteWord(emu, REG_BASE + 0xB8, 1 | (0xA240u << 16));
+		}
+
+		std::vector<u8> CopyFrame(ppu::Frame const& frame) {
+			return std::vector<u8>(frame.data, frame.data + frame.stride * 160);
+		}
+	}
+
+	TEST_CASE(RenderThreadsMatchHblankDrawing) {
+		static constexpr u32 FRAMES = 12;
+
+		auto rom = MidFrameRom();
+
+		for (ppu::FrameFormat format : { ppu::FrameFormat::RGB555, ppu::FrameFormat::RGBA8888 }) {
+			auto single = rom.Boot();
+			auto threaded = rom.Boot();
+
+			single->GetContext().ppu.SetFrameFormat(format);
+			threaded->GetContext().ppu.SetFrameFormat(format);
+			threaded->GetContext().ppu.SetRenderThreads(4);
+
+			SetUpMidFrameScene(*single);
+			SetUpMidFrameScene(*threaded);
+
+			u32 different = 0;
+			u32 changed = 0;
+			std::vector<u8> previous{};
+
+			for (u32 count = 0; count < FRAMES; count++) {
+				RunFrames(*single, 1);
+				RunFrames(*threaded, 1);
+
+				auto expected = CopyFrame(single->GetContext().ppu.GetFrame());
+				auto frame = CopyFrame(threaded->GetContext().ppu.GetFrame());
+
+				different += frame != expected;
+				changed += expected != previous;
+				previous = expected;
+			}
+
+			CHECK_EQ(different, 0u);
+
+			//Each frame shows something new
+			CHECK_EQ(changed, FRAMES);
+		}
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+namespace GBA::test {
+	using TestFunction = void(*)();
+
+	struct TestCase {
+		const char* name;
+		TestFunction function;
+	};
+
+	std::vector<TestCase>& GetTests();
+
+	//Records a failed check of the running test
+	void Fail(const char* file, int line, std::string const& message);
+
+	struct Registration {
+		Registration(const char* name, TestFunction function) {
+			GetTests().push_back({ name, function });
+		}
+	};
+}
+
+#define TEST_CASE(NAME) \
+	static void NAME(); \
+	static ::GBA::test::Registration NAME##_registration{ #NAME, NAME }; \
+	static void NAME()
+
+#define CHECK(COND) \
+	do { \
+		if (!(COND)) \
+			::GBA::test::Fail(__FILE__, __LINE__, #COND); \
+	} while (0)
+
+#define CHECK_EQ(A, B) \
+	do { \
+		auto const check_a = (A); \
+		auto const check_b = (B); \
+		if (!(check_a == check_b)) \
+			::GBA::test::Fail(__FILE__, __LINE__, fmt::format("{} == {} ({:#x} != {:#x})", \
+				#A, #B, check_a, check_b)); \
+	} while (0)
@@ -0,0 +1,274 @@
+#include "TestRom.hpp"
+
+#include "../common/Error.hpp"
+
+#include <atomic>
+#include <bit>
+#include <filesystem>
+#include <fstream>
+
+namespace GBA::test {
+	namespace {
+		static constexpr u32 UNBOUND = ~0u;
+
+		//b CODE_START, the rest of the header stays empty
+		static constexpr u32 HEADER_BRANCH = 0xEA000000 | ((CODE_START - 0x08000008) >> 2);
+
+		u32 EncodeImmediate(u32 value) {
+			for (u32 rotate = 0; rotate < 16; rotate++) {
+				u32 imm = std::rotl(value, rotate * 2);
+
+				if (imm <= 0xFF)
+					return (rotate << 8) | imm;
+			}
+
+			error::Assert(false, "Immediate cannot be encoded");
+			return 0;
+		}
+	}
+
+	Assembler::Assembler(u32 base) :
+		m_base{ base }, m_code{}, m_labels{}, m_fixups{} {}
+
+	Assembler::Label Assembler::NewLabel() {
+		m_labels.push_back(UNBOUND);
+		return Label(m_labels.size() - 1);
+	}
+
+	void Assembler::Bind(Label label) {
+		m_labels[label] = u32(m_code.size());
+
+		for (auto const& fixup : m_fixups) {
+			if (fixup.target != label)
+				continue;
+
+			i32 offset = i32(m_labels[label]) - i32(fixup.index) - 2;
+			m_code[fixup.index] |= u32(offset) & 0xFFFFFF;
+		}
+	}
+
+	u32 Assembler::AddressOf(Label label) const {
+		error::Assert(m_labels[label] != UNBOUND, "Label is not bound");
+		return m_base + m_labels[label] * 4;
+	}
+
+	void Assembler::Word(u32 value) {
+		m_code.push_back(value);
+	}
+
+	void Assembler::DataImm(u8 opcode, bool set_flags, u8 rd, u8 rn, u32 imm, Condition cond) {
+		Word((u32(cond) << 28) | (1 << 25) | (u32(opcode) << 21) | (u32(set_flags) << 20) |
+			(u32(rn) << 16) | (u32(rd) << 12) | EncodeImmediate(imm));
+	}
+
+	void Assembler::DataReg(u8 opcode, bool set_flags, u8 rd, u8 rn, u8 rm) {
+		Word((u32(AL) << 28) | (u32(opcode) << 21) | (u32(set_flags) << 20) |
+			(u32(rn) << 16) | (u32(rd) << 12) | rm);
+	}
+
+	void Assembler::Mov(u8 rd, u32 imm, Condition cond) {
+		DataImm(0xD, false, rd, 0, imm, cond);
+	}
+
+	void Assembler::MovReg(u8 rd, u8 rm, Condition cond) {
+		Word((u32(cond) << 28) | (0xD << 21) | (u32(rd) << 12) | rm);
+	}
+
+	void Assembler::LoadImm(u8 rd, u32 value) {
+		Mov(rd, value & 0xFF);
+
+		for (u32 shift = 8; shift < 32; shift += 8) {
+			if (value & (0xFF << shift))
+				Orr(rd, rd, value & (0xFF << shift));
+		}
+	}
+
+	void Assembler::Add(u8 rd, u8 rn, u32 imm, Condition cond) {
+		DataImm(0x4, false, rd, rn, imm, cond);
+	}
+
+	void Assembler::AddReg(u8 rd, u8 rn, u8 rm) {
+		DataReg(0x4, false, rd, rn, rm);
+	}
+
+	void Assembler::Sub(u8 rd, u8 rn, u32 imm, bool set_flags) {
+		DataImm(0x2, set_flags, rd, rn, imm, AL);
+	}
+
+	void Assembler::And(u8 rd, u8 rn, u32 imm) {
+		DataImm(0x0, false, rd, rn, imm, AL);
+	}
+
+	void Assembler::Orr(u8 rd, u8 rn, u32 imm) {
+		DataImm(0xC, false, rd, rn, imm, AL);
+	}
+
+	void Assembler::OrrReg(u8 rd, u8 rn, u8 rm) {
+		DataReg(0xC, false, rd, rn, rm);
+	}
+
+	void Assembler::Eor(u8 rd, u8 rn, u32 imm) {
+		DataImm(0x1, false, rd, rn, imm, AL);
+	}
+
+	void Assembler::Cmp(u8 rn, u32 imm) {
+		DataImm(0xA, true, 0, rn, imm, AL);
+	}
+
+	void Assembler::CmpReg(u8 rn, u8 rm) {
+		DataReg(0xA, true, 0, rn, rm);
+	}
+
+	void Assembler::Transfer(bool load, bool byte, u8 rd, u8 rn, i32 offset) {
+		u32 up = offset >= 0;
+		u32 magnitude = u32(offset < 0 ? -offset : offset);
+
+		error::Assert(magnitude < 0x1000, "Offset out of range");
+
+		Word((u32(AL) << 28) | (1 << 26) | (1 << 24) | (up << 23) | (u32(byte) << 22) |
+			(u32(load) << 20) | (u32(rn) << 16) | (u32(rd) << 12) | magnitude);
+	}
+
+	void Assembler::Halfword(bool load, u8 rd, u8 rn, i32 offset) {
+		u32 up = offset >= 0;
+		u32 magnitude = u32(offset < 0 ? -offset : offset);
+
+		error::Assert(magnitude < 0x100, "Offset out of range");
+
+		Word((u32(AL) << 28) | (1 << 24) | (up << 23) | (1 << 22) | (u32(load) << 20) |
+			(u32(rn) << 16) | (u32(rd) << 12) | ((magnitude >> 4) << 8) | 0xB0 | (magnitude & 0xF));
+	}
+
+	void Assembler::Ldr(u8 rd, u8 rn, i32 offset) {
+		Transfer(true, false, rd, rn, offset);
+	}
+
+	void Assembler::Str(u8 rd, u8 rn, i32 offset) {
+		Transfer(false, false, rd, rn, offset);
+	}
+
+	void Assembler::Ldrb(u8 rd, u8 rn, i32 offset) {
+		Transfer(true, true, rd, rn, offset);
+	}
+
+	void Assembler::Strb(u8 rd, u8 rn, i32 offset) {
+		Transfer(false, true, rd, rn, offset);
+	}
+
+	void Assembler::Ldrh(u8 rd, u8 rn, i32 offset) {
+		Halfword(true, rd, rn, offset);
+	}
+
+	void Assembler::Strh(u8 rd, u8 rn, i32 offset) {
+		Halfword(false, rd, rn, offset);
+	}
+
+	void Assembler::Ldm(u8 rn, u16 list, bool writeback) {
+		Word((u32(AL) << 28) | (0b100 << 25) | (1 << 23) | (u32(writeback) << 21) |
+			(1 << 20) | (u32(rn) << 16) | list);
+	}
+
+	void Assembler::Stm(u8 rn, u16 list, bool writeback) {
+		Word((u32(AL) << 28) | (0b100 << 25) | (1 << 23) | (u32(writeback) << 21) |
+			(u32(rn) << 16) | list);
+	}
+
+	void Assembler::Branch(Label target, Condition cond, bool link) {
+		u32 index = u32(m_code.size());
+		u32 opcode = (u32(cond) << 28) | (0b101 << 25) | (u32(link) << 24);
+
+		if (m_labels[target] == UNBOUND) {
+			m_fixups.push_back({ index, target });
+			Word(opcode);
+			return;
+		}
+
+		i32 offset = i32(m_labels[target]) - i32(index) - 2;
+		Word(opcode | (u32(offset) & 0xFFFFFF));
+	}
+
+	void Assembler::B(Label target, Condition cond) {
+		Branch(target, cond, false);
+	}
+
+	void Assembler::Bl(Label target) {
+		Branch(target, AL, true);
+	}
+
+	void Assembler::Bx(u8 rm) {
+		Word((u32(AL) << 28) | 0x012FFF10 | rm);
+	}
+
+	void Assembler::Call(u8 rm) {
+		//add lr, pc, #0
+		Word(0xE28FE000);
+		Bx(rm);
+	}
+
+	void Assembler::Swi(u8 number) {
+		Word((u32(AL) << 28) | (0xF << 24) | (u32(number) << 16));
+	}
+
+	void Assembler::Hang() {
+		auto self = NewLabel();
+		Bind(self);
+		B(self);
+	}
+
+	std::vector<u32> const& Assembler::GetCode() const {
+		return m_code;
+	}
+
+	TestRom::TestRom(Assembler const& code) :
+		m_path{}
+	{
+		static std::atomic<u32> rom_count{};
+
+		m_path = (std::filesystem::temp_directory_path() /
+			fmt::format("gba_test_{}.gba", rom_count++)).string();
+
+		std::vector<u32> words((CODE_START - 0x08000000) / 4);
+		words[0] = HEADER_BRANCH;
+		words.insert(words.end(), code.GetCode().begin(), code.GetCode().end());
+
+		//Keep the ROM a power of two like real carts
+		words.resize(std::max<std::size_t>(std::bit_ceil(words.size()), 0x400));
+
+		std::ofstream out{ m_path, std::ios::out | std::ios::binary };
+		out.write(reinterpret_cast<const char*>(words.data()),
+			std::streamsize(words.size() * sizeof(u32)));
+	}
+
+	TestRom::~TestRom() {
+		std::error_code ec{};
+		std::filesystem::remove(m_path, ec);
+	}
+
+	std::unique_ptr<emulation::Emulator> TestRom::Boot() const {
+		//No BIOS file, the HLE BIOS takes over
+		return std::make_unique<emulation::Emulator>(m_path, "");
+	}
+
+	void RunFrames(emulation::Emulator& emu, u32 count) {
+		while (count--) {
+			emu.RunTillVblank();
+			(void)emu.GetContext().ppu.GetFrame();
+		}
+	}
+
+	u32 ReadWord(emulation::Emulator& emu, u32 address) {
+		return emu.GetContext().bus.DebuggerRead32(address);
+	}
+
+	u16 ReadHalf(emulation::Emulator& emu, u32 address) {
+		return emu.GetContext().bus.DebuggerRead16(address);
+	}
+
+	void WriteWord(emulation::Emulator& emu, u32 address, u32 value) {
+		emu.GetContext().bus.Write<u32>(address, value);
+	}
+
+	void WriteHalf(emulation::Emulator& emu, u32 address, u16 value) {
+		emu.GetContext().bus.Write<u16>(address, value);
+	}
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../common/Defs.hpp"
+#include "../emu/Emulator.hpp"
+
+namespace GBA::test {
+	using namespace common;
+
+	//Where the assembled code starts, after the header
+	static constexpr u32 CODE_START = 0x080000C0;
+
+	static constexpr u32 REG_BASE = 0x04000000;
+
+	//Handler called by the BIOS with r0 = REG_BASE
+	static constexpr u32 IRQ_VECTOR = 0x03007FFC;
+
+	enum Condition : u8 {
+		EQ = 0x0,
+		NE = 0x1,
+		CS = 0x2,
+		CC = 0x3,
+		AL = 0xE
+	};
+
+	/*
+	* Minimal ARM assembler for test ROMs,
+	* immediates must be encodable unless
+	* loaded with LoadImm
+	*/
+	class Assembler {
+	public :
+		using Label = u32;
+
+		Assembler(u32 base = CODE_START);
+
+		u32 Here() const {
+			return m_base + u32(m_code.size() * 4);
+		}
+
+		//Branches may target a label before it is bound
+		Label NewLabel();
+		void Bind(Label label);
+		u32 AddressOf(Label label) const;
+
+		void Word(u32 value);
+
+		void Mov(u8 rd, u32 imm, Condition cond = AL);
+		void MovReg(u8 rd, u8 rm, Condition cond = AL);
+		void LoadImm(u8 rd, u32 value);
+		void Add(u8 rd, u8 rn, u32 imm, Condition cond = AL);
+		void AddReg(u8 rd, u8 rn, u8 rm);
+		void Sub(u8 rd, u8 rn, u32 imm, bool set_flags = false);
+		void And(u8 rd, u8 rn, u32 imm);
+		void Orr(u8 rd, u8 rn, u32 imm);
+		void OrrReg(u8 rd, u8 rn, u8 rm);
+		void Eor(u8 rd, u8 rn, u32 imm);
+		void Cmp(u8 rn, u32 imm);
+		void CmpReg(u8 rn, u8 rm);
+
+		void Ldr(u8 rd, u8 rn, i32 offset = 0);
+		void Str(u8 rd, u8 rn, i32 offset = 0);
+		void Ldrh(u8 rd, u8 rn, i32 offset = 0);
+		void Strh(u8 rd, u8 rn, i32 offset = 0);
+		void Ldrb(u8 rd, u8 rn, i32 offset = 0);
+		void Strb(u8 rd, u8 rn, i32 offset = 0);
+
+		//Increment after, optional writeback
+		void Ldm(u8 rn, u16 list, bool writeback = true);
+		void Stm(u8 rn, u16 list, bool writeback = true);
+
+		void B(Label target, Condition cond = AL);
+		void Bl(Label target);
+		void Bx(u8 rm);
+		//Call through a register, returns after it
+		void Call(u8 rm);
+		void Swi(u8 number);
+
+		//Branch to itself
+		void Hang();
+
+		std::vector<u32> const& GetCode() const;
+
+	private :
+		void DataImm(u8 opcode, bool set_flags, u8 rd, u8 rn, u32 imm, Condition cond);
+		void DataReg(u8 opcode, bool set_flags, u8 rd, u8 rn, u8 rm);
+		void Transfer(bool load, bool byte, u8 rd, u8 rn, i32 offset);
+		void Halfword(bool load, u8 rd, u8 rn, i32 offset);
+		void Branch(Label target, Condition cond, bool link);
+
+		struct Fixup {
+			u32 index;
+			Label target;
+		};
+
+		u32 m_base;
+		std::vector<u32> m_code;
+		std::vector<u32> m_labels;
+		std::vector<Fixup> m_fixups;
+	};
+
+	/*
+	* Writes the assembled code to a temporary
+	* ROM file and boots it with the HLE BIOS
+	*/
+	class TestRom {
+	public :
+		TestRom(Assembler const& code);
+		~TestRom();
+
+		std::unique_ptr<emulation::Emulator> Boot() const;
+
+	private :
+		std::string m_path;
+	};
+
+	void RunFrames(emulation::Emulator& emu, u32 count);
+
+	u32 ReadWord(emulation::Emulator& emu, u32 address);
+	u16 ReadHalf(emulation::Emulator& emu, u32 address);
+
+	//Through the bus as the CPU would, caches see them
+	void WriteWord(emulation::Emulator& emu, u32 address, u32 value);
+	void WriteHalf(emulation::Emulator& emu, u32 address, u16 value);
+}
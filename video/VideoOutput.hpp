@@ -3,6 +3,7 @@
 union SDL_Event;
 
 #include "../common/Defs.hpp"
+#include "../ppu/Frame.hpp"
 
 namespace GBA::input {
 	class Keypad;
@@ -27,7 +28,7 @@ namespace GBA::video {
 		virtual void ProcessEvent(SDL_Event* ev) = 0;
 
 		virtual void PresentFrame() = 0;
-		virtual void SetFrame(float* buffer) = 0;
+		virtual void SetFrame(ppu::Frame const& frame) = 0;
 
 		void SetKeypad(input::Keypad* keypad) {
 			m_keypad = keypad;
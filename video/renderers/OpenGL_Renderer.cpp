@@ -34,9 +34,12 @@ namespace GBA::video::renderer {
 		m_alt_status{false}, m_enable_hooks{hooks_enable},
 		m_emu{nullptr}, m_show_cheat_insert_win{false}
 	{
-		m_gl_data.placeholder_data = new float[240 * 160 * 3];
+		m_gl_data.placeholder_data = new uint8_t[240 * 160 * 4];
+		m_gl_data.placeholder_format = ppu::FrameFormat::RGB555;
 
-		std::fill_n(m_gl_data.placeholder_data, 240 * 160 * 3, 0.5f);
+		//Gray
+		std::fill_n(reinterpret_cast<uint16_t*>(m_gl_data.placeholder_data),
+			240 * 160, 0x3DEF);
 	}
 
 	void OpenGL::CheckForErrors() {
@@ -329,9 +332,15 @@ namespace GBA::video::renderer {
 		}
 	}
 
-	void OpenGL::SetFrame(float* buffer) {
-		std::copy_n(buffer, GBA_WIDTH * GBA_HEIGHT * 3,
-			m_gl_data.placeholder_data);
+	void OpenGL::SetFrame(ppu::Frame const& frame) {
+		unsigned line_size = GBA_WIDTH * ppu::GetPixelSize(frame.format);
+
+		for (unsigned y = 0; y < GBA_HEIGHT; y++) {
+			std::copy_n(frame.data + y * frame.stride, line_size,
+				m_gl_data.placeholder_data + y * line_size);
+		}
+
+		m_gl_data.placeholder_format = frame.format;
 	}
 
 	std::string OpenGL::FileDialog(std::string title, std::string filters) {
@@ -596,8 +605,12 @@ namespace GBA::video::renderer {
 
 		glUniform1i(m_gl_data.texture_loc, 0);
 
+		//RGB555 is already in the layout of 1_5_5_5_REV
+		GLenum pixel_type = m_gl_data.placeholder_format == ppu::FrameFormat::RGB555 ?
+			GL_UNSIGNED_SHORT_1_5_5_5_REV : GL_UNSIGNED_BYTE;
+
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB,
-			240, 160, 0, GL_RGB, GL_FLOAT, (void*)m_gl_data.placeholder_data);
+			240, 160, 0, GL_RGBA, pixel_type, (void*)m_gl_data.placeholder_data);
 
 		glBindVertexArray(m_gl_data.vertex_array);
 
@@ -38,7 +38,7 @@ namespace GBA::video::renderer {
 
 		void PresentFrame() override;
 
-		void SetFrame(float* buffer) override;
+		void SetFrame(ppu::Frame const& frame) override;
 
 		void SetQuickSaveAction(QuickSaveCallback callback) {
 			m_quick_save = callback;
@@ -106,7 +106,8 @@ namespace GBA::video::renderer {
 		
 		struct {
 			uint32_t texture_id;
-			float* placeholder_data;
+			uint8_t* placeholder_data;
+			ppu::FrameFormat placeholder_format;
 			uint32_t program_id;
 			uint32_t buffer_id;
 			uint32_t vertex_array;